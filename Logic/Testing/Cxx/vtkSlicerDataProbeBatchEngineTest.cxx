@@ -0,0 +1,327 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeBatchEngine.h"
+#include "vtkSlicerDataProbeLogic.h"
+
+// MRML includes
+#include <vtkMRMLScalarVolumeNode.h>
+
+// VTK includes
+#include <vtkDoubleArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkImageData.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkStringArray.h>
+#include <vtkTable.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+/// Random image of \a dims voxels of \a numberOfComponents components,
+/// labels in [0, 5] if \a labelMap.
+vtkImageData* NewRandomImage(const int dims[3], int numberOfComponents, bool labelMap)
+{
+  vtkImageData* imageData = vtkImageData::New();
+  imageData->SetDimensions(dims[0], dims[1], dims[2]);
+  if (labelMap)
+    {
+    imageData->SetScalarTypeToShort();
+    }
+  else
+    {
+    imageData->SetScalarTypeToDouble();
+    }
+  imageData->SetNumberOfScalarComponents(numberOfComponents);
+  imageData->AllocateScalars();
+  for (int k = 0; k < dims[2]; ++k)
+    {
+    for (int j = 0; j < dims[1]; ++j)
+      {
+      for (int i = 0; i < dims[0]; ++i)
+        {
+        for (int componentIdx = 0; componentIdx < numberOfComponents; ++componentIdx)
+          {
+          imageData->SetScalarComponentFromDouble(i, j, k, componentIdx, labelMap ?
+            vtkMath::Floor(vtkMath::Random(0., 6.)) : vtkMath::Random(-100., 100.));
+          }
+        }
+      }
+    }
+  return imageData;
+}
+
+//-----------------------------------------------------------------------------
+/// Linear interpolation of the component \a componentIdx of \a imageData at
+/// \a ijk, within the centers of the voxels.
+double Interpolate(vtkImageData* imageData, const double ijk[3], int componentIdx)
+{
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+  int base[3];
+  double fraction[3];
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    base[axis] = std::min(vtkMath::Floor(ijk[axis]), dims[axis] - 2);
+    fraction[axis] = ijk[axis] - base[axis];
+    }
+  double value = 0.;
+  for (int corner = 0; corner < 8; ++corner)
+    {
+    const int offset[3] = {corner & 1, (corner >> 1) & 1, (corner >> 2) & 1};
+    double weight = 1.;
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      weight *= offset[axis] ? fraction[axis] : 1. - fraction[axis];
+      }
+    value += weight * imageData->GetScalarComponentAsDouble(
+      base[0] + offset[0], base[1] + offset[1], base[2] + offset[2], componentIdx);
+    }
+  return value;
+}
+
+//-----------------------------------------------------------------------------
+bool SameValue(double value, double expectedValue)
+{
+  if (vtkMath::IsNan(expectedValue))
+    {
+    return vtkMath::IsNan(value) != 0;
+    }
+  return fabs(value - expectedValue) <= 1e-9 * std::max(1., fabs(expectedValue));
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkSlicerDataProbeBatchEngineTest(int vtkNotUsed(argc), char * vtkNotUsed(argv) [])
+{
+  vtkMath::RandomSeed(997);
+
+  // A rotated scalar volume, a flipped label map, an RGB volume and a volume
+  // without image
+  const int numberOfVolumes = 4;
+  const char* volumeNames[numberOfVolumes] = {"Scalar", "Label", "RGB", "Empty"};
+  const int volumeDims[numberOfVolumes][3] = {{23, 17, 11}, {19, 21, 9}, {9, 8, 7}, {0, 0, 0}};
+  const int numberOfComponents[numberOfVolumes] = {1, 1, 3, 1};
+  const double spacings[numberOfVolumes][3] = {{0.9, 1.1, 2.}, {1.3, 0.8, 1.7}, {2.5, 2.5, 2.5}, {1., 1., 1.}};
+  const double origins[numberOfVolumes][3] = {{-10., -8., -12.}, {12., 9., -10.}, {-11., -10., -9.}, {0., 0., 0.}};
+  vtkNew<vtkMRMLScalarVolumeNode> volumeNodes[numberOfVolumes];
+  for (int volumeIdx = 0; volumeIdx < numberOfVolumes; ++volumeIdx)
+    {
+    vtkMRMLScalarVolumeNode* volumeNode = volumeNodes[volumeIdx].GetPointer();
+    volumeNode->SetName(volumeNames[volumeIdx]);
+    double directions[3][3] = {{1., 0., 0.}, {0., 1., 0.}, {0., 0., 1.}};
+    if (volumeIdx == 0)
+      {
+      directions[0][0] = directions[1][1] = cos(0.2);
+      directions[0][1] = -sin(0.2);
+      directions[1][0] = sin(0.2);
+      }
+    else if (volumeIdx == 1)
+      {
+      directions[0][0] = directions[1][1] = -1.;
+      volumeNode->SetLabelMap(1);
+      }
+    volumeNode->SetIJKToRASDirections(directions);
+    volumeNode->SetSpacing(spacings[volumeIdx][0], spacings[volumeIdx][1], spacings[volumeIdx][2]);
+    volumeNode->SetOrigin(origins[volumeIdx][0], origins[volumeIdx][1], origins[volumeIdx][2]);
+    if (volumeDims[volumeIdx][0] > 0)
+      {
+      vtkImageData* imageData = NewRandomImage(volumeDims[volumeIdx], numberOfComponents[volumeIdx], volumeIdx == 1);
+      volumeNode->SetAndObserveImageData(imageData);
+      imageData->Delete();
+      }
+    }
+
+  // 2 point sets of 997 points in total, a prime number of points that no
+  // chunk size divides, partly outside of the volumes
+  const int numberOfPoints = 997;
+  const int firstSetSize = 600;
+  vtkNew<vtkPoints> pointSets[2];
+  for (int pointIdx = 0; pointIdx < numberOfPoints; ++pointIdx)
+    {
+    pointSets[pointIdx < firstSetSize ? 0 : 1]->InsertNextPoint(
+      vtkMath::Random(-14., 14.), vtkMath::Random(-14., 14.), vtkMath::Random(-14., 14.));
+    }
+
+  vtkNew<vtkSlicerDataProbeLogic> logic;
+  vtkSlicerDataProbeBatchEngine* batchEngine = logic->GetBatchEngine();
+  batchEngine->AddPoints(pointSets[0].GetPointer(), "first");
+  batchEngine->AddPoints(pointSets[1].GetPointer(), "second");
+  for (int volumeIdx = 0; volumeIdx < numberOfVolumes; ++volumeIdx)
+    {
+    batchEngine->AddVolumeNode(volumeNodes[volumeIdx].GetPointer());
+    }
+
+  // Expected statuses, and values at the voxels read by ProbePixel() or
+  // linearly interpolated, point by point
+  std::vector<int> expectedStatuses(numberOfPoints * numberOfVolumes);
+  std::vector<double> expectedValues[2];
+  for (int interpolation = 0; interpolation < 2; ++interpolation)
+    {
+    expectedValues[interpolation].resize(3 * numberOfPoints * numberOfVolumes);
+    }
+  for (int pointIdx = 0; pointIdx < numberOfPoints; ++pointIdx)
+    {
+    double ras[3];
+    pointSets[pointIdx < firstSetSize ? 0 : 1]->GetPoint(
+      pointIdx < firstSetSize ? pointIdx : pointIdx - firstSetSize, ras);
+    for (int volumeIdx = 0; volumeIdx < numberOfVolumes; ++volumeIdx)
+      {
+      vtkMRMLScalarVolumeNode* volumeNode = volumeNodes[volumeIdx].GetPointer();
+      const int resultIdx = pointIdx * numberOfVolumes + volumeIdx;
+      int probeStatus = logic->ProbeRAS(volumeNode, ras);
+      if (probeStatus & vtkSlicerDataProbeLogic::PROBE_SUCCESS)
+        {
+        probeStatus = volumeNode->GetLabelMap() ? vtkSlicerDataProbeLogic::PROBE_SUCCESS_LABEL_VOLUME :
+          vtkSlicerDataProbeLogic::PROBE_SUCCESS_SCALAR_VOLUME;
+        }
+      expectedStatuses[resultIdx] = probeStatus;
+      double ijk[3] = {0., 0., 0.};
+      logic->ConvertRASToIJK(volumeNode, ras, ijk);
+      bool interior = !volumeNode->GetLabelMap();
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        interior = interior && ijk[axis] >= 0. && ijk[axis] <= volumeDims[volumeIdx][axis] - 1;
+        }
+      for (int componentIdx = 0; componentIdx < 3; ++componentIdx)
+        {
+        double value = componentIdx < numberOfComponents[volumeIdx] &&
+          (probeStatus & vtkSlicerDataProbeLogic::PROBE_SUCCESS) ? logic->GetPixelValue(componentIdx) : vtkMath::Nan();
+        expectedValues[vtkSlicerDataProbeBatchEngine::NearestNeighbor][3 * resultIdx + componentIdx] = value;
+        if (interior && componentIdx < numberOfComponents[volumeIdx])
+          {
+          value = Interpolate(volumeNode->GetImageData(), ijk, componentIdx);
+          }
+        expectedValues[vtkSlicerDataProbeBatchEngine::Linear][3 * resultIdx + componentIdx] = value;
+        }
+      }
+    }
+
+  const int chunkSizes[3] = {1, 7, 64};
+  for (int interpolation = 0; interpolation < 2; ++interpolation)
+    {
+    for (int numberOfThreads = 1; numberOfThreads <= 4; numberOfThreads += 3)
+      {
+      for (int chunkSizeIdx = 0; chunkSizeIdx < 3; ++chunkSizeIdx)
+        {
+        batchEngine->SetInterpolation(interpolation);
+        batchEngine->SetNumberOfThreads(numberOfThreads);
+        batchEngine->SetChunkSize(chunkSizes[chunkSizeIdx]);
+        if (!batchEngine->Update())
+          {
+          std::cerr << "Line " << __LINE__ << " - Failed to update with " << numberOfThreads
+                    << " threads and chunks of " << chunkSizes[chunkSizeIdx] << " points" << std::endl;
+          return EXIT_FAILURE;
+          }
+
+        // Point columns, then a value and a status column per volume
+        vtkTable* output = batchEngine->GetOutput();
+        vtkStringArray* pointSetNames = vtkStringArray::SafeDownCast(output->GetColumn(0));
+        vtkIdTypeArray* pointIds = vtkIdTypeArray::SafeDownCast(output->GetColumn(1));
+        if (output->GetNumberOfColumns() != 5 + 2 * numberOfVolumes || output->GetNumberOfRows() != numberOfPoints
+            || !pointSetNames || std::string(pointSetNames->GetName()) != "PointSet"
+            || !pointIds || std::string(pointIds->GetName()) != "PointId"
+            || std::string(output->GetColumn(2)->GetName()) != "R"
+            || std::string(output->GetColumn(3)->GetName()) != "A"
+            || std::string(output->GetColumn(4)->GetName()) != "S")
+          {
+          std::cerr << "Line " << __LINE__ << " - Output of " << output->GetNumberOfColumns() << " columns and "
+                    << output->GetNumberOfRows() << " rows does not start with the point columns" << std::endl;
+          return EXIT_FAILURE;
+          }
+        for (int pointIdx = 0; pointIdx < numberOfPoints; ++pointIdx)
+          {
+          const int pointSetIdx = pointIdx < firstSetSize ? 0 : 1;
+          const vtkIdType pointId = pointIdx < firstSetSize ? pointIdx : pointIdx - firstSetSize;
+          double ras[3];
+          pointSets[pointSetIdx]->GetPoint(pointId, ras);
+          if (pointSetNames->GetValue(pointIdx) != (pointSetIdx == 0 ? "first" : "second")
+              || pointIds->GetValue(pointIdx) != pointId
+              || output->GetValue(pointIdx, 2).ToDouble() != ras[0]
+              || output->GetValue(pointIdx, 3).ToDouble() != ras[1]
+              || output->GetValue(pointIdx, 4).ToDouble() != ras[2])
+            {
+            std::cerr << "Line " << __LINE__ << " - Row " << pointIdx << " is not point " << pointId
+                      << " of set " << pointSetIdx << std::endl;
+            return EXIT_FAILURE;
+            }
+          }
+
+        for (int volumeIdx = 0; volumeIdx < numberOfVolumes; ++volumeIdx)
+          {
+          vtkDoubleArray* values =
+            vtkDoubleArray::SafeDownCast(output->GetColumn(batchEngine->GetValueColumnIndex(volumeIdx)));
+          vtkIntArray* statuses =
+            vtkIntArray::SafeDownCast(output->GetColumn(batchEngine->GetStatusColumnIndex(volumeIdx)));
+          if (batchEngine->GetValueColumnIndex(volumeIdx) != 5 + 2 * volumeIdx
+              || batchEngine->GetStatusColumnIndex(volumeIdx) != 6 + 2 * volumeIdx
+              || !values || values->GetName() != std::string(volumeNames[volumeIdx])
+              || values->GetNumberOfComponents() != numberOfComponents[volumeIdx]
+              || !statuses || statuses->GetName() != std::string(volumeNames[volumeIdx]) + " status")
+            {
+            std::cerr << "Line " << __LINE__ << " - Wrong columns for volume " << volumeNames[volumeIdx]
+                      << std::endl;
+            return EXIT_FAILURE;
+            }
+          for (int pointIdx = 0; pointIdx < numberOfPoints; ++pointIdx)
+            {
+            const int resultIdx = pointIdx * numberOfVolumes + volumeIdx;
+            bool same = statuses->GetValue(pointIdx) == expectedStatuses[resultIdx];
+            for (int componentIdx = 0; componentIdx < numberOfComponents[volumeIdx]; ++componentIdx)
+              {
+              same = same && SameValue(values->GetComponent(pointIdx, componentIdx),
+                                       expectedValues[interpolation][3 * resultIdx + componentIdx]);
+              }
+            if (!same)
+              {
+              std::cerr << "Line " << __LINE__ << " - Interpolation " << interpolation << " with "
+                        << numberOfThreads << " threads and chunks of " << chunkSizes[chunkSizeIdx]
+                        << " points: point " << pointIdx << " in " << volumeNames[volumeIdx] << " is "
+                        << values->GetComponent(pointIdx, 0) << " of status " << statuses->GetValue(pointIdx)
+                        << " instead of " << expectedValues[interpolation][3 * resultIdx]
+                        << " of status " << expectedStatuses[resultIdx] << std::endl;
+              return EXIT_FAILURE;
+              }
+            }
+          }
+        }
+      }
+    }
+
+  if (batchEngine->GetValueColumnIndex(numberOfVolumes) != -1
+      || batchEngine->GetStatusColumnIndex(-1) != -1)
+    {
+    std::cerr << "Line " << __LINE__ << " - Column of an unknown volume" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,248 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeComponentIndex.h"
+#include "vtkSlicerDataProbeLogic.h"
+
+// MRML includes
+#include <vtkMRMLScalarVolumeNode.h>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+/// Fill the box \a extent of \a imageData with \a label.
+void FillBox(vtkImageData* imageData, const int extent[6], short label)
+{
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+  short* scalars = static_cast<short*>(imageData->GetScalarPointer());
+  for (int k = std::max(extent[4], 0); k <= std::min(extent[5], dims[2] - 1); ++k)
+    {
+    for (int j = std::max(extent[2], 0); j <= std::min(extent[3], dims[1] - 1); ++j)
+      {
+      for (int i = std::max(extent[0], 0); i <= std::min(extent[1], dims[0] - 1); ++i)
+        {
+        scalars[i + dims[0] * (j + dims[1] * k)] = label;
+        }
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+/// Random box of at most \a maximumSize voxels per side within \a dims.
+void RandomBox(const int dims[3], int maximumSize, int extent[6])
+{
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    extent[2 * axis] = static_cast<int>(vtkMath::Random(0., dims[axis]));
+    extent[2 * axis + 1] = extent[2 * axis] + static_cast<int>(vtkMath::Random(0., maximumSize));
+    }
+}
+
+//-----------------------------------------------------------------------------
+/// Return true if \a updated and \a rebuilt have the same components, with
+/// the same voxels and statistics, whatever their ids.
+bool SameComponents(vtkImageData* imageData, vtkSlicerDataProbeComponentIndex* updated,
+                    vtkSlicerDataProbeComponentIndex* rebuilt)
+{
+  if (updated->GetNumberOfComponents() != rebuilt->GetNumberOfComponents())
+    {
+    std::cerr << "  " << updated->GetNumberOfComponents() << " components instead of "
+              << rebuilt->GetNumberOfComponents() << std::endl;
+    return false;
+    }
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+  std::map<unsigned int, unsigned int> updatedToRebuilt;
+  std::map<unsigned int, unsigned int> rebuiltToUpdated;
+  for (int k = 0; k < dims[2]; ++k)
+    {
+    for (int j = 0; j < dims[1]; ++j)
+      {
+      for (int i = 0; i < dims[0]; ++i)
+        {
+        // The ids must map one to one
+        unsigned int updatedId = updated->GetComponentId(i, j, k);
+        unsigned int rebuiltId = rebuilt->GetComponentId(i, j, k);
+        std::map<unsigned int, unsigned int>::const_iterator updatedIt =
+          updatedToRebuilt.insert(std::make_pair(updatedId, rebuiltId)).first;
+        std::map<unsigned int, unsigned int>::const_iterator rebuiltIt =
+          rebuiltToUpdated.insert(std::make_pair(rebuiltId, updatedId)).first;
+        if ((updatedId == 0) != (rebuiltId == 0)
+            || updatedIt->second != rebuiltId || rebuiltIt->second != updatedId)
+          {
+          std::cerr << "  voxel (" << i << ", " << j << ", " << k << ") is in component "
+                    << updatedId << " instead of " << rebuiltId << std::endl;
+          return false;
+          }
+        }
+      }
+    }
+  for (std::map<unsigned int, unsigned int>::const_iterator it = updatedToRebuilt.begin();
+       it != updatedToRebuilt.end(); ++it)
+    {
+    if (it->first == 0)
+      {
+      continue;
+      }
+    double updatedCentroid[3] = {0., 0., 0.};
+    double rebuiltCentroid[3] = {0., 0., 0.};
+    int updatedBounds[6] = {0, -1, 0, -1, 0, -1};
+    int rebuiltBounds[6] = {0, -1, 0, -1, 0, -1};
+    if (updated->GetComponentLabel(it->first) != rebuilt->GetComponentLabel(it->second)
+        || updated->GetComponentNumberOfVoxels(it->first) != rebuilt->GetComponentNumberOfVoxels(it->second)
+        || !updated->GetComponentCentroid(it->first, updatedCentroid)
+        || !rebuilt->GetComponentCentroid(it->second, rebuiltCentroid)
+        || sqrt(vtkMath::Distance2BetweenPoints(updatedCentroid, rebuiltCentroid)) > 1e-9
+        || !updated->GetComponentBounds(it->first, updatedBounds)
+        || !rebuilt->GetComponentBounds(it->second, rebuiltBounds)
+        || !std::equal(updatedBounds, updatedBounds + 6, rebuiltBounds))
+      {
+      std::cerr << "  component " << it->first << " differs from component " << it->second << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkSlicerDataProbeComponentIndexTest(int vtkNotUsed(argc), char * vtkNotUsed(argv) [])
+{
+  vtkMath::RandomSeed(4321);
+
+  // Sparse blocks of 3 labels over a background: the components span a few
+  // slices, so that an update only labels a part of the image again, and
+  // edits split and merge them across the slabs of the threads.
+  const int dims[3] = {32, 24, 48};
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(dims[0], dims[1], dims[2]);
+  imageData->SetScalarTypeToShort();
+  imageData->SetNumberOfScalarComponents(1);
+  imageData->AllocateScalars();
+  int extent[6] = {0, dims[0] - 1, 0, dims[1] - 1, 0, dims[2] - 1};
+  FillBox(imageData.GetPointer(), extent, 0);
+  for (int boxIdx = 0; boxIdx < 40; ++boxIdx)
+    {
+    RandomBox(dims, 5, extent);
+    FillBox(imageData.GetPointer(), extent, static_cast<short>(1 + boxIdx % 3));
+    }
+
+  vtkNew<vtkSlicerDataProbeComponentIndex> updated;
+  updated->SetNumberOfThreads(4);
+  if (!updated->Update(imageData.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << " - Failed to build the component index" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  for (int editIdx = 0; editIdx < 200; ++editIdx)
+    {
+    RandomBox(dims, 4, extent);
+    FillBox(imageData.GetPointer(), extent, static_cast<short>(vtkMath::Random(0., 4.)));
+    imageData->GetPointData()->GetScalars()->Modified();
+    if (!updated->UpdateExtent(imageData.GetPointer(), extent)
+        || !updated->IsUpToDate(imageData.GetPointer()))
+      {
+      std::cerr << "Line " << __LINE__ << " - Failed to update edit " << editIdx << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    vtkNew<vtkSlicerDataProbeComponentIndex> rebuilt;
+    rebuilt->SetNumberOfThreads(1);
+    rebuilt->Update(imageData.GetPointer());
+    if (!SameComponents(imageData.GetPointer(), updated.GetPointer(), rebuilt.GetPointer()))
+      {
+      std::cerr << "Line " << __LINE__ << " - Edit " << editIdx << " of extent ["
+                << extent[0] << "-" << extent[1] << ", " << extent[2] << "-" << extent[3] << ", "
+                << extent[4] << "-" << extent[5] << "] differs from a full rebuild" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Probes past the center of the voxels whose next voxel along I has
+  // another label: the component is the one of the probed voxel, which is
+  // not the closest voxel, and has the probed label.
+  vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+  volumeNode->SetLabelMap(1);
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+  vtkNew<vtkSlicerDataProbeLogic> logic;
+  const short* scalars = static_cast<short*>(imageData->GetScalarPointer());
+  int numberOfBoundaryProbes = 0;
+  for (int k = 0; k < dims[2]; k += 3)
+    {
+    for (int j = 0; j < dims[1]; ++j)
+      {
+      for (int i = 0; i < dims[0] - 1; ++i)
+        {
+        const short label = scalars[i + dims[0] * (j + dims[1] * k)];
+        if (label == scalars[i + 1 + dims[0] * (j + dims[1] * k)])
+          {
+          continue;
+          }
+        ++numberOfBoundaryProbes;
+        double ijk[3] = {i + 0.7, j + 0.4, k + 0.6};
+        const int probeStatus = logic->ProbeComponent(volumeNode.GetPointer(), ijk);
+        const unsigned int componentId = updated->GetComponentId(i, j, k);
+        if (!(probeStatus & vtkSlicerDataProbeLogic::PROBE_SUCCESS)
+            || logic->GetPixelValue(0) != label
+            || (logic->GetComponentId() == 0) != (componentId == 0)
+            || logic->GetComponentNumberOfVoxels() !=
+               (componentId ? updated->GetComponentNumberOfVoxels(componentId) : 0))
+          {
+          std::cerr << "Line " << __LINE__ << " - Probe at (" << ijk[0] << ", " << ijk[1] << ", " << ijk[2]
+                    << ") found label " << logic->GetPixelValue(0) << " and a component of "
+                    << logic->GetComponentNumberOfVoxels() << " voxels instead of label " << label
+                    << " and " << (componentId ? updated->GetComponentNumberOfVoxels(componentId) : 0)
+                    << " voxels" << std::endl;
+          return EXIT_FAILURE;
+          }
+        if (componentId && logic->GetComponentIndex(volumeNode.GetPointer())->GetComponentLabel(
+              logic->GetComponentId()) != label)
+          {
+          std::cerr << "Line " << __LINE__ << " - Component " << logic->GetComponentId() << " of voxel ("
+                    << i << ", " << j << ", " << k << ") is not of label " << label << std::endl;
+          return EXIT_FAILURE;
+          }
+        }
+      }
+    }
+  if (numberOfBoundaryProbes == 0)
+    {
+    std::cerr << "Line " << __LINE__ << " - No label boundary probed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
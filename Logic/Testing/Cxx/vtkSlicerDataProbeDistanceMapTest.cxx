@@ -0,0 +1,185 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeDistanceMap.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+/// Signed distance from the voxel (\a i, \a j, \a k) to the closest voxel
+/// on the other side of the boundary of \a label, searched over all the
+/// voxels. vtkMath::Nan() if there is no such voxel.
+double BruteForceDistance(const short* scalars, const int dims[3], const double spacing[3], int label,
+                          int i, int j, int k)
+{
+  const bool inside = scalars[i + dims[0] * (j + dims[1] * k)] == label;
+  double minimumDistance2 = -1.;
+  for (int otherK = 0; otherK < dims[2]; ++otherK)
+    {
+    for (int otherJ = 0; otherJ < dims[1]; ++otherJ)
+      {
+      for (int otherI = 0; otherI < dims[0]; ++otherI)
+        {
+        if ((scalars[otherI + dims[0] * (otherJ + dims[1] * otherK)] == label) == inside)
+          {
+          continue;
+          }
+        const double offset[3] = {(otherI - i) * spacing[0], (otherJ - j) * spacing[1],
+                                  (otherK - k) * spacing[2]};
+        const double distance2 = vtkMath::Dot(offset, offset);
+        if (minimumDistance2 < 0. || distance2 < minimumDistance2)
+          {
+          minimumDistance2 = distance2;
+          }
+        }
+      }
+    }
+  if (minimumDistance2 < 0.)
+    {
+    return vtkMath::Nan();
+    }
+  return inside ? -sqrt(minimumDistance2) : sqrt(minimumDistance2);
+}
+
+//-----------------------------------------------------------------------------
+/// Call Update() until the map of \a label is available. Return false if
+/// the computation stopped without a map or takes more than 10 seconds.
+bool WaitForMap(vtkSlicerDataProbeDistanceMap* distanceMap, vtkImageData* imageData, int label,
+                const double spacing[3])
+{
+  for (int attempt = 0; attempt < 10000; ++attempt)
+    {
+    if (distanceMap->Update(imageData, label, spacing))
+      {
+      return true;
+      }
+    if (!distanceMap->IsComputing())
+      {
+      return false;
+      }
+    vtksys::SystemTools::Delay(1);
+    }
+  return false;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkSlicerDataProbeDistanceMapTest(int vtkNotUsed(argc), char * vtkNotUsed(argv) [])
+{
+  vtkMath::RandomSeed(2718);
+
+  // Blocks of labels 1 and 2 over a background, with scattered voxels of
+  // label 2 so that the closest boundary is often off the axes
+  const int dims[3] = {13, 11, 9};
+  const double spacing[3] = {0.7, 1.6, 2.3};
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(dims[0], dims[1], dims[2]);
+  imageData->SetScalarTypeToShort();
+  imageData->SetNumberOfScalarComponents(1);
+  imageData->AllocateScalars();
+  short* scalars = static_cast<short*>(imageData->GetScalarPointer());
+  for (int k = 0; k < dims[2]; ++k)
+    {
+    for (int j = 0; j < dims[1]; ++j)
+      {
+      for (int i = 0; i < dims[0]; ++i)
+        {
+        short label = 0;
+        if (i >= 2 && i <= 7 && j >= 3 && j <= 8 && k >= 1 && k <= 5)
+          {
+          label = 1;
+          }
+        else if (i >= 9 && j <= 4 && k >= 4)
+          {
+          label = 2;
+          }
+        if (vtkMath::Random() < 0.03)
+          {
+          label = 2;
+          }
+        scalars[i + dims[0] * (j + dims[1] * k)] = label;
+        }
+      }
+    }
+
+  vtkNew<vtkSlicerDataProbeDistanceMap> distanceMap;
+  distanceMap->SetMaximumNumberOfMaps(2);
+  // Label 7 has no voxel, all the distances are unknown
+  const int labels[3] = {1, 2, 7};
+  for (int labelIdx = 0; labelIdx < 3; ++labelIdx)
+    {
+    const int label = labels[labelIdx];
+    distanceMap->SetNumberOfThreads(labelIdx == 0 ? 1 : 3);
+    if (!WaitForMap(distanceMap.GetPointer(), imageData.GetPointer(), label, spacing)
+        || distanceMap->GetLabel() != label)
+      {
+      std::cerr << "Line " << __LINE__ << " - Failed to compute the map of label " << label << std::endl;
+      return EXIT_FAILURE;
+      }
+    for (int k = 0; k < dims[2]; ++k)
+      {
+      for (int j = 0; j < dims[1]; ++j)
+        {
+        for (int i = 0; i < dims[0]; ++i)
+          {
+          const double expectedDistance = BruteForceDistance(scalars, dims, spacing, label, i, j, k);
+          const double distance = distanceMap->GetDistance(i, j, k);
+          if (vtkMath::IsNan(distance) != vtkMath::IsNan(expectedDistance)
+              || (!vtkMath::IsNan(expectedDistance)
+                  && fabs(distance - expectedDistance) > 1e-5 * std::max(1., fabs(expectedDistance))))
+            {
+            std::cerr << "Line " << __LINE__ << " - Voxel (" << i << ", " << j << ", " << k
+                      << ") is at " << distance << " mm of label " << label << " instead of "
+                      << expectedDistance << " mm" << std::endl;
+            return EXIT_FAILURE;
+            }
+          }
+        }
+      }
+    }
+
+  // The map of label 2 is kept, the one of label 1 has been released
+  if (!distanceMap->Update(imageData.GetPointer(), 2, spacing)
+      || distanceMap->Update(imageData.GetPointer(), 1, spacing))
+    {
+    std::cerr << "Line " << __LINE__ << " - The maps of the last 2 labels are not the ones kept" << std::endl;
+    return EXIT_FAILURE;
+    }
+  distanceMap->Reset();
+  if (distanceMap->IsComputing() || !vtkMath::IsNan(distanceMap->GetDistance(0, 0, 0)))
+    {
+    std::cerr << "Line " << __LINE__ << " - Failed to reset the maps" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,337 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeHistogram.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+/// Image of \a dims voxels of \a scalarType, VTK_SHORT or VTK_DOUBLE, left
+/// to fill.
+void AllocateImage(vtkImageData* imageData, const int dims[3], int scalarType)
+{
+  imageData->SetDimensions(dims[0], dims[1], dims[2]);
+  if (scalarType == VTK_SHORT)
+    {
+    imageData->SetScalarTypeToShort();
+    }
+  else
+    {
+    imageData->SetScalarTypeToDouble();
+    }
+  imageData->SetNumberOfScalarComponents(1);
+  imageData->AllocateScalars();
+}
+
+//-----------------------------------------------------------------------------
+/// Sorted values of the voxels of \a imageData, NaN values excluded.
+template <class T>
+std::vector<double> SortedValues(vtkImageData* imageData)
+{
+  int dims[3];
+  imageData->GetDimensions(dims);
+  const T* scalars = static_cast<T*>(imageData->GetScalarPointer());
+  std::vector<double> values;
+  for (int voxelIdx = 0; voxelIdx < dims[0] * dims[1] * dims[2]; ++voxelIdx)
+    {
+    const double value = static_cast<double>(scalars[voxelIdx]);
+    if (!vtkMath::IsNan(value))
+      {
+      values.push_back(value);
+      }
+    }
+  std::sort(values.begin(), values.end());
+  return values;
+}
+
+//-----------------------------------------------------------------------------
+/// Number of sorted values in [\a lower, \a upper).
+double CountValues(const std::vector<double>& values, double lower, double upper)
+{
+  return static_cast<double>(std::lower_bound(values.begin(), values.end(), upper)
+                             - std::lower_bound(values.begin(), values.end(), lower));
+}
+
+//-----------------------------------------------------------------------------
+/// Call Update() until the histogram of \a imageData is available. Return
+/// false if the computation stopped without a histogram or takes more than
+/// 10 seconds.
+bool WaitForHistogram(vtkSlicerDataProbeHistogram* histogram, vtkImageData* imageData)
+{
+  for (int attempt = 0; attempt < 10000; ++attempt)
+    {
+    if (histogram->Update(imageData))
+      {
+      return true;
+      }
+    if (!histogram->IsComputing())
+      {
+      return false;
+      }
+    vtksys::SystemTools::Delay(1);
+    }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+/// Compare the percentiles and values of \a histogram with the ones of the
+/// sorted \a values. The percentile of a value v is the percentage of values
+/// lower than v plus half of the ones equal to v. With one bin per value,
+/// \a binWidth being 0, the percentiles are exact and the values within half
+/// a unit, otherwise both are within a bin of \a binWidth.
+bool CheckHistogram(vtkSlicerDataProbeHistogram* histogram, const std::vector<double>& values,
+                    double binWidth, int line)
+{
+  const bool exact = binWidth == 0.;
+  const double numberOfValues = static_cast<double>(values.size());
+  double range[2];
+  histogram->GetRange(range);
+  if (histogram->GetNumberOfVoxels() != static_cast<vtkIdType>(values.size())
+      || range[0] != values.front() || range[1] != values.back())
+    {
+    std::cerr << "Line " << line << " - " << histogram->GetNumberOfVoxels() << " voxels in ["
+              << range[0] << ", " << range[1] << "] instead of " << values.size() << " in ["
+              << values.front() << ", " << values.back() << "]" << std::endl;
+    return false;
+    }
+
+  // Percentiles of values around and within the range
+  const double margin = exact ? 2. : binWidth;
+  const double step = exact ? 1. : (range[1] - range[0] + 2. * margin) / 200.;
+  const double lastValue = range[1] + margin + 0.5 * step;
+  for (double value = range[0] - margin; value <= lastValue; value += step)
+    {
+    const double lowerCount = CountValues(values, -VTK_DOUBLE_MAX, value);
+    const double equalCount = static_cast<double>(
+      std::upper_bound(values.begin(), values.end(), value)
+      - std::lower_bound(values.begin(), values.end(), value));
+    const double expectedPercentile = 100. * (lowerCount + 0.5 * equalCount) / numberOfValues;
+    // The percentiles only differ by the values of the bin of the value
+    const double tolerance = exact ? 1e-9 :
+      100. * CountValues(values, value - 1.01 * binWidth, value + 1.01 * binWidth) / numberOfValues
+      + 1e-9;
+    const double percentile = histogram->GetPercentile(value);
+    if (!(fabs(percentile - expectedPercentile) <= tolerance))
+      {
+      std::cerr << "Line " << line << " - Percentile of " << value << ": " << percentile
+                << " instead of " << expectedPercentile << " +/- " << tolerance << std::endl;
+      return false;
+      }
+    }
+
+  // Values of percentiles, the value of p being in the bin of the
+  // ceil(p * N / 100)-th lowest value
+  const double percentiles[11] = {0., 0.5, 1., 2.5, 10., 25., 50., 75., 90., 99., 100.};
+  for (int percentileIdx = 0; percentileIdx < 11; ++percentileIdx)
+    {
+    const double percentile = percentiles[percentileIdx];
+    const double count = percentile * histogram->GetNumberOfVoxels() / 100.;
+    const size_t rank = static_cast<size_t>(std::max(std::ceil(count) - 1., 0.));
+    const double tolerance = exact ? 0.5 + 1e-9 : 1.01 * binWidth;
+    const double value = histogram->GetValue(percentile);
+    if (!(fabs(value - values[rank]) <= tolerance))
+      {
+      std::cerr << "Line " << line << " - Value of percentile " << percentile << ": " << value
+                << " instead of " << values[rank] << " +/- " << tolerance << std::endl;
+      return false;
+      }
+    // Within a bin the percentiles are interpolated the same way both ways
+    if (!(fabs(histogram->GetPercentile(value) - percentile) <= 1e-6))
+      {
+      std::cerr << "Line " << line << " - Percentile " << percentile << " gives back "
+                << histogram->GetPercentile(value) << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkSlicerDataProbeHistogramTest(int vtkNotUsed(argc), char * vtkNotUsed(argv) [])
+{
+  vtkMath::RandomSeed(1618);
+  vtkNew<vtkSlicerDataProbeHistogram> histogram;
+
+  // Skewed integer values, whose range fits in the bins: one bin per value
+  const int smallDims[3] = {10, 10, 10};
+  vtkNew<vtkImageData> shortImage;
+  AllocateImage(shortImage.GetPointer(), smallDims, VTK_SHORT);
+  short* shortScalars = static_cast<short*>(shortImage->GetScalarPointer());
+  for (int voxelIdx = 0; voxelIdx < 1000; ++voxelIdx)
+    {
+    const double random = vtkMath::Random();
+    shortScalars[voxelIdx] = static_cast<short>(vtkMath::Floor(-40. + 100. * random * random));
+    }
+  for (int numberOfThreads = 1; numberOfThreads <= 4; numberOfThreads += 3)
+    {
+    histogram->SetNumberOfThreads(numberOfThreads);
+    histogram->Reset();
+    if (!WaitForHistogram(histogram.GetPointer(), shortImage.GetPointer())
+        || !CheckHistogram(histogram.GetPointer(), SortedValues<short>(shortImage.GetPointer()), 0., __LINE__))
+      {
+      std::cerr << "Line " << __LINE__ << " - Wrong histogram of the integer image with "
+                << numberOfThreads << " threads" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Gaussian real values, more than bins, and a slice of NaN values ignored
+  const int realDims[3] = {10, 10, 11};
+  vtkNew<vtkImageData> realImage;
+  AllocateImage(realImage.GetPointer(), realDims, VTK_DOUBLE);
+  double* realScalars = static_cast<double*>(realImage->GetScalarPointer());
+  for (int voxelIdx = 0; voxelIdx < 1100; ++voxelIdx)
+    {
+    realScalars[voxelIdx] = voxelIdx < 1000 ? vtkMath::Gaussian(12., 3.) : vtkMath::Nan();
+    }
+  histogram->SetNumberOfBins(64);
+  std::vector<double> realValues = SortedValues<double>(realImage.GetPointer());
+  if (!WaitForHistogram(histogram.GetPointer(), realImage.GetPointer())
+      || !CheckHistogram(histogram.GetPointer(), realValues,
+                         (realValues.back() - realValues.front()) / 64., __LINE__))
+    {
+    std::cerr << "Line " << __LINE__ << " - Wrong histogram of the real image" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Constant images, of one integer bin or of real bins of unit width
+  histogram->SetNumberOfBins(4096);
+  for (int voxelIdx = 0; voxelIdx < 1000; ++voxelIdx)
+    {
+    shortScalars[voxelIdx] = 7;
+    realScalars[voxelIdx] = 7.;
+    }
+  shortImage->Modified();
+  realImage->Modified();
+  double window = 0.;
+  double level = 0.;
+  if (!WaitForHistogram(histogram.GetPointer(), shortImage.GetPointer())
+      || !CheckHistogram(histogram.GetPointer(), SortedValues<short>(shortImage.GetPointer()), 0., __LINE__)
+      || histogram->GetPercentile(7.) != 50.
+      || !histogram->GetWindowLevel(1., 99., window, level)
+      || fabs(level - 7.) > 1e-9 || window > 1.)
+    {
+    std::cerr << "Line " << __LINE__ << " - Wrong histogram of the constant integer image" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (!WaitForHistogram(histogram.GetPointer(), realImage.GetPointer())
+      || !CheckHistogram(histogram.GetPointer(), SortedValues<double>(realImage.GetPointer()), 1., __LINE__))
+    {
+    std::cerr << "Line " << __LINE__ << " - Wrong histogram of the constant real image" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Only NaN values: a histogram without voxels
+  for (int voxelIdx = 0; voxelIdx < 1000; ++voxelIdx)
+    {
+    realScalars[voxelIdx] = vtkMath::Nan();
+    }
+  realImage->Modified();
+  if (!WaitForHistogram(histogram.GetPointer(), realImage.GetPointer())
+      || histogram->GetNumberOfVoxels() != 0
+      || !vtkMath::IsNan(histogram->GetPercentile(7.))
+      || !vtkMath::IsNan(histogram->GetValue(50.))
+      || histogram->GetWindowLevel(1., 99., window, level))
+    {
+    std::cerr << "Line " << __LINE__ << " - Wrong histogram of the NaN image" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Requests aborted by another request or a reset, then reissued: only the
+  // last request is made available
+  const int largeDims[3] = {64, 64, 64};
+  const int numberOfLargeVoxels = largeDims[0] * largeDims[1] * largeDims[2];
+  vtkNew<vtkImageData> largeImage;
+  AllocateImage(largeImage.GetPointer(), largeDims, VTK_SHORT);
+  short* largeScalars = static_cast<short*>(largeImage->GetScalarPointer());
+  for (int voxelIdx = 0; voxelIdx < numberOfLargeVoxels; ++voxelIdx)
+    {
+    largeScalars[voxelIdx] = static_cast<short>(vtkMath::Floor(vtkMath::Random(-1000., 3000.)));
+    }
+  vtkNew<vtkImageData> otherImage;
+  AllocateImage(otherImage.GetPointer(), largeDims, VTK_DOUBLE);
+  double* otherScalars = static_cast<double*>(otherImage->GetScalarPointer());
+  for (int voxelIdx = 0; voxelIdx < numberOfLargeVoxels; ++voxelIdx)
+    {
+    otherScalars[voxelIdx] = vtkMath::Gaussian(0., 100.);
+    }
+  histogram->SetNumberOfThreads(2);
+  for (int attempt = 0; attempt < 2; ++attempt)
+    {
+    largeImage->Modified();
+    if (histogram->Update(largeImage.GetPointer()) || !histogram->IsComputing())
+      {
+      std::cerr << "Line " << __LINE__ << " - Failed to request the histogram" << std::endl;
+      return EXIT_FAILURE;
+      }
+    if (attempt == 0)
+      {
+      histogram->Update(otherImage.GetPointer());
+      }
+    else
+      {
+      histogram->Reset();
+      if (histogram->IsComputing() || histogram->GetNumberOfVoxels() != 0
+          || !vtkMath::IsNan(histogram->GetPercentile(0.)))
+        {
+        std::cerr << "Line " << __LINE__ << " - Failed to reset the histogram" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    if (!WaitForHistogram(histogram.GetPointer(), largeImage.GetPointer())
+        || histogram->IsUpToDate(otherImage.GetPointer())
+        || !CheckHistogram(histogram.GetPointer(), SortedValues<short>(largeImage.GetPointer()), 0., __LINE__))
+      {
+      std::cerr << "Line " << __LINE__ << " - Wrong histogram after aborting request " << attempt << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Modified values outdate the histogram
+  for (int voxelIdx = 0; voxelIdx < numberOfLargeVoxels; voxelIdx += 2)
+    {
+    largeScalars[voxelIdx] = 5000;
+    }
+  largeImage->Modified();
+  if (histogram->IsUpToDate(largeImage.GetPointer())
+      || !WaitForHistogram(histogram.GetPointer(), largeImage.GetPointer())
+      || !CheckHistogram(histogram.GetPointer(), SortedValues<short>(largeImage.GetPointer()),
+                         (5000. + 1000.) / 4096., __LINE__))
+    {
+    std::cerr << "Line " << __LINE__ << " - Wrong histogram of the modified image" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
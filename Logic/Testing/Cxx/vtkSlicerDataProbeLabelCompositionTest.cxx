@@ -0,0 +1,193 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeLabelComposition.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+/// Count the labels of the voxels of \a imageData within the window of
+/// semi-axes \a radius centered on \a center, a cube if \a ball is false.
+vtkIdType CountLabels(vtkImageData* imageData, const int center[3], bool ball, const double radius[3],
+                      std::map<int, vtkIdType>& counts)
+{
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+  const short* scalars = static_cast<short*>(imageData->GetScalarPointer());
+  int windowRadius[3];
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    windowRadius[axis] = static_cast<int>(floor(radius[axis]));
+    }
+  vtkIdType numberOfVoxels = 0;
+  for (int k = center[2] - windowRadius[2]; k <= center[2] + windowRadius[2]; ++k)
+    {
+    for (int j = center[1] - windowRadius[1]; j <= center[1] + windowRadius[1]; ++j)
+      {
+      for (int i = center[0] - windowRadius[0]; i <= center[0] + windowRadius[0]; ++i)
+        {
+        if (i < 0 || j < 0 || k < 0 || i >= dims[0] || j >= dims[1] || k >= dims[2])
+          {
+          continue;
+          }
+        const int offset[3] = {i - center[0], j - center[1], k - center[2]};
+        double distance2 = 0.;
+        for (int axis = 0; axis < 3; ++axis)
+          {
+          distance2 += offset[axis] != 0 ? (offset[axis] / radius[axis]) * (offset[axis] / radius[axis]) : 0.;
+          }
+        if (ball && distance2 > 1. + 1e-9)
+          {
+          continue;
+          }
+        ++counts[scalars[i + dims[0] * (j + dims[1] * k)]];
+        ++numberOfVoxels;
+        }
+      }
+    }
+  return numberOfVoxels;
+}
+
+//-----------------------------------------------------------------------------
+/// Return true if \a composition has the labels and number of voxels
+/// counted by CountLabels(), sorted by decreasing number of voxels.
+bool SameComposition(vtkSlicerDataProbeLabelComposition* composition, vtkIdType numberOfVoxels,
+                     std::map<int, vtkIdType>& counts)
+{
+  if (composition->GetNumberOfVoxels() != numberOfVoxels
+      || composition->GetNumberOfLabels() != static_cast<int>(counts.size()))
+    {
+    std::cerr << "  " << composition->GetNumberOfVoxels() << " voxels of "
+              << composition->GetNumberOfLabels() << " labels instead of " << numberOfVoxels
+              << " voxels of " << counts.size() << " labels" << std::endl;
+    return false;
+    }
+  for (int labelIdx = 0; labelIdx < composition->GetNumberOfLabels(); ++labelIdx)
+    {
+    const int label = composition->GetLabel(labelIdx);
+    if (composition->GetLabelNumberOfVoxels(labelIdx) != counts[label]
+        || (labelIdx > 0 && composition->GetLabelNumberOfVoxels(labelIdx) >
+            composition->GetLabelNumberOfVoxels(labelIdx - 1)))
+      {
+      std::cerr << "  label " << label << " counts " << composition->GetLabelNumberOfVoxels(labelIdx)
+                << " voxels instead of " << counts[label] << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkSlicerDataProbeLabelCompositionTest(int vtkNotUsed(argc), char * vtkNotUsed(argv) [])
+{
+  vtkMath::RandomSeed(3);
+
+  // Labels spanning a few hundred values, mixed within each block of voxels
+  const int dims[3] = {37, 29, 23};
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(dims[0], dims[1], dims[2]);
+  imageData->SetScalarTypeToShort();
+  imageData->SetNumberOfScalarComponents(1);
+  imageData->AllocateScalars();
+  short* scalars = static_cast<short*>(imageData->GetScalarPointer());
+  const vtkIdType numberOfVoxels = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  for (vtkIdType voxelIdx = 0; voxelIdx < numberOfVoxels; ++voxelIdx)
+    {
+    scalars[voxelIdx] = static_cast<short>(vtkMath::Floor(vtkMath::Random(-2., 5.)) + (voxelIdx / 500) % 40 * 10);
+    }
+
+  vtkNew<vtkSlicerDataProbeLabelComposition> composition;
+  int incrementalUpdates = 0;
+  int numberOfUpdates = 0;
+  // Cubes of radius 1 and 3, an ellipsoid and a flat ellipsoid
+  const double windowRadii[4][3] = {{1., 1., 1.}, {3., 3., 3.}, {3.5, 2.2, 1.}, {0.5, 4., 2.7}};
+  for (int windowIdx = 0; windowIdx < 4; ++windowIdx)
+    {
+    const bool ball = windowIdx >= 2;
+    if (ball)
+      {
+      composition->SetBallWindow(windowRadii[windowIdx]);
+      }
+    else
+      {
+      composition->SetCubeWindow(static_cast<int>(windowRadii[windowIdx][0]));
+      }
+    // Moves of a few voxels along one axis, sometimes farther than the
+    // window size, partly outside of the image
+    int position[3] = {5, 5, 5};
+    for (int moveIdx = 0; moveIdx < 3000; ++moveIdx)
+      {
+      const int axis = static_cast<int>(vtkMath::Random(0., 3.));
+      int move = vtkMath::Round(vtkMath::Random(-4., 4.));
+      if (vtkMath::Random() < 0.1)
+        {
+        move *= 5;
+        }
+      position[axis] = std::min(std::max(position[axis] + move, -3), dims[axis] + 2);
+      int center[3];
+      for (int centerAxis = 0; centerAxis < 3; ++centerAxis)
+        {
+        center[centerAxis] = std::min(std::max(position[centerAxis], 0), dims[centerAxis] - 1);
+        }
+
+      if (!composition->Update(imageData.GetPointer(), center))
+        {
+        std::cerr << "Line " << __LINE__ << " - Failed to update move " << moveIdx << std::endl;
+        return EXIT_FAILURE;
+        }
+      ++numberOfUpdates;
+      incrementalUpdates += composition->GetLastUpdateIncremental() ? 1 : 0;
+
+      std::map<int, vtkIdType> counts;
+      vtkIdType windowNumberOfVoxels =
+        CountLabels(imageData.GetPointer(), center, ball, windowRadii[windowIdx], counts);
+      if (!SameComposition(composition.GetPointer(), windowNumberOfVoxels, counts))
+        {
+        std::cerr << "Line " << __LINE__ << " - Window " << windowIdx << " at (" << center[0] << ", "
+                  << center[1] << ", " << center[2] << ") differs from the voxels counted one by one"
+                  << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  // Most moves must be incremental
+  if (incrementalUpdates < numberOfUpdates / 2)
+    {
+    std::cerr << "Line " << __LINE__ << " - Only " << incrementalUpdates << " incremental updates out of "
+              << numberOfUpdates << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,199 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeLogic.h"
+
+// MRML includes
+#include <vtkMRMLScalarVolumeNode.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+/// f(x) = 1/2 (x - x0)^T A (x - x0) + b.x, x being in RAS.
+struct Quadratic
+{
+  double A[3][3];
+  double Center[3];
+  double B[3];
+
+  double Value(const double ras[3])const
+  {
+    double offset[3];
+    vtkMath::Subtract(ras, this->Center, offset);
+    double aTimesOffset[3];
+    vtkMath::Multiply3x3(this->A, offset, aTimesOffset);
+    return 0.5 * vtkMath::Dot(offset, aTimesOffset) + vtkMath::Dot(this->B, ras);
+  }
+
+  void Gradient(const double ras[3], double gradient[3])const
+  {
+    double offset[3];
+    vtkMath::Subtract(ras, this->Center, offset);
+    vtkMath::Multiply3x3(this->A, offset, gradient);
+    vtkMath::Add(gradient, this->B, gradient);
+  }
+};
+
+//-----------------------------------------------------------------------------
+/// Rotation of \a angle radians around \a axis.
+void Rotation(int axis, double angle, double rotation[3][3])
+{
+  vtkMath::Identity3x3(rotation);
+  const int first = (axis + 1) % 3;
+  const int second = (axis + 2) % 3;
+  rotation[first][first] = cos(angle);
+  rotation[first][second] = -sin(angle);
+  rotation[second][first] = sin(angle);
+  rotation[second][second] = cos(angle);
+}
+
+//-----------------------------------------------------------------------------
+bool Near(double value, double expected)
+{
+  return fabs(value - expected) <= 1e-6 * std::max(1., fabs(expected));
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkSlicerDataProbeLogicDerivativesTest(int vtkNotUsed(argc), char * vtkNotUsed(argv) [])
+{
+  // Hessian of eigenvalues 0.5, -1.5 and 3 along rotated axes
+  const double expectedEigenvalues[3] = {0.5, -1.5, 3.};
+  Quadratic quadratic;
+  double eigenvectors[3][3];
+  Rotation(0, 0.4, eigenvectors);
+  double diagonal[3][3];
+  vtkMath::Identity3x3(diagonal);
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    diagonal[axis][axis] = expectedEigenvalues[axis];
+    }
+  double eigenvectorsT[3][3];
+  double diagonalTimesEigenvectorsT[3][3];
+  vtkMath::Transpose3x3(eigenvectors, eigenvectorsT);
+  vtkMath::Multiply3x3(diagonal, eigenvectorsT, diagonalTimesEigenvectorsT);
+  vtkMath::Multiply3x3(eigenvectors, diagonalTimesEigenvectorsT, quadratic.A);
+  const double center[3] = {-3., 12., 5.};
+  const double b[3] = {2., -1., 0.5};
+  std::copy(center, center + 3, quadratic.Center);
+  std::copy(b, b + 3, quadratic.B);
+
+  // Anisotropic spacing, and IJK axes rotated around S and flipped along A
+  const int dims[3] = {12, 10, 8};
+  double directions[3][3];
+  Rotation(2, 0.3, directions);
+  for (int row = 0; row < 3; ++row)
+    {
+    directions[row][1] = -directions[row][1];
+    }
+  vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+  volumeNode->SetIJKToRASDirections(directions);
+  volumeNode->SetSpacing(0.7, 1.3, 2.5);
+  volumeNode->SetOrigin(-4., 20., 3.);
+  vtkNew<vtkMatrix4x4> ijkToRAS;
+  volumeNode->GetIJKToRASMatrix(ijkToRAS.GetPointer());
+
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(dims[0], dims[1], dims[2]);
+  imageData->SetScalarTypeToDouble();
+  imageData->SetNumberOfScalarComponents(1);
+  imageData->AllocateScalars();
+  double* scalars = static_cast<double*>(imageData->GetScalarPointer());
+  for (int k = 0; k < dims[2]; ++k)
+    {
+    for (int j = 0; j < dims[1]; ++j)
+      {
+      for (int i = 0; i < dims[0]; ++i)
+        {
+        const double ijk[4] = {static_cast<double>(i), static_cast<double>(j), static_cast<double>(k), 1.};
+        double ras[4];
+        ijkToRAS->MultiplyPoint(ijk, ras);
+        scalars[i + dims[0] * (j + dims[1] * k)] = quadratic.Value(ras);
+        }
+      }
+    }
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+
+  vtkNew<vtkSlicerDataProbeLogic> logic;
+  const int kernels[2] = {vtkSlicerDataProbeLogic::CENTRAL_DIFFERENCE_KERNEL,
+                          vtkSlicerDataProbeLogic::GAUSSIAN_KERNEL};
+  // The derivatives are those of the voxel closest to the probed position
+  const double probedIJKs[3][3] = {{5., 4., 3.}, {6.3, 4.6, 3.9}, {2.4, 5., 4.2}};
+  for (int kernelIdx = 0; kernelIdx < 2; ++kernelIdx)
+    {
+    for (int probeIdx = 0; probeIdx < 3; ++probeIdx)
+      {
+      double ijk[3] = {probedIJKs[probeIdx][0], probedIJKs[probeIdx][1], probedIJKs[probeIdx][2]};
+      if (logic->ProbeDerivatives(volumeNode.GetPointer(), ijk, kernels[kernelIdx]) !=
+          vtkSlicerDataProbeLogic::PROBE_SUCCESS_SCALAR_VOLUME)
+        {
+        std::cerr << "Line " << __LINE__ << " - Failed to probe the derivatives with kernel "
+                  << kernels[kernelIdx] << std::endl;
+        return EXIT_FAILURE;
+        }
+      const double voxel[4] = {static_cast<double>(vtkMath::Round(ijk[0])),
+                               static_cast<double>(vtkMath::Round(ijk[1])),
+                               static_cast<double>(vtkMath::Round(ijk[2])), 1.};
+      double ras[4];
+      ijkToRAS->MultiplyPoint(voxel, ras);
+      double expectedGradient[3];
+      quadratic.Gradient(ras, expectedGradient);
+      double gradient[3];
+      logic->GetGradient(gradient);
+      double eigenvalues[3];
+      logic->GetHessianEigenvalues(eigenvalues);
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        if (!Near(gradient[axis], expectedGradient[axis]) || !Near(eigenvalues[axis], expectedEigenvalues[axis]))
+          {
+          std::cerr << "Line " << __LINE__ << " - Kernel " << kernels[kernelIdx] << " at ("
+                    << ijk[0] << ", " << ijk[1] << ", " << ijk[2] << "): gradient ("
+                    << gradient[0] << ", " << gradient[1] << ", " << gradient[2] << "), eigenvalues ("
+                    << eigenvalues[0] << ", " << eigenvalues[1] << ", " << eigenvalues[2] << ") instead of ("
+                    << expectedGradient[0] << ", " << expectedGradient[1] << ", " << expectedGradient[2]
+                    << "), (0.5, -1.5, 3)" << std::endl;
+          return EXIT_FAILURE;
+          }
+        }
+      if (!Near(logic->GetGradientMagnitude(), vtkMath::Norm(expectedGradient))
+          || !Near(logic->GetPixelValue(0), quadratic.Value(ras)))
+        {
+        std::cerr << "Line " << __LINE__ << " - Gradient magnitude " << logic->GetGradientMagnitude()
+                  << " and value " << logic->GetPixelValue(0) << " instead of "
+                  << vtkMath::Norm(expectedGradient) << " and " << quadratic.Value(ras) << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,245 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeLogic.h"
+
+// MRML includes
+#include <vtkMRMLScalarVolumeNode.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+/// Displacement field of \a dims voxels, 3 double components.
+vtkImageData* NewDisplacementImage(const int dims[3])
+{
+  vtkImageData* imageData = vtkImageData::New();
+  imageData->SetDimensions(dims[0], dims[1], dims[2]);
+  imageData->SetScalarTypeToDouble();
+  imageData->SetNumberOfScalarComponents(3);
+  imageData->AllocateScalars();
+  return imageData;
+}
+
+//-----------------------------------------------------------------------------
+bool Near(double value, double expected)
+{
+  return fabs(value - expected) <= 1e-9 * std::max(1., fabs(expected));
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkSlicerDataProbeLogicDisplacementTest(int vtkNotUsed(argc), char * vtkNotUsed(argv) [])
+{
+  vtkNew<vtkSlicerDataProbeLogic> logic;
+
+  // Uniform scaling u = a.x around the RAS origin: F = (1 + a) I, whose
+  // determinant is (1 + a)^3 and whose Green-Lagrange strains are all
+  // a + a^2 / 2, on the borders too. The field is sampled along rotated and
+  // anisotropic IJK axes.
+  const int dims[3] = {9, 8, 7};
+  const double angle = 0.5;
+  double directions[3][3] = {{cos(angle), 0., sin(angle)}, {0., 1., 0.}, {-sin(angle), 0., cos(angle)}};
+  vtkNew<vtkMRMLScalarVolumeNode> scalingNode;
+  scalingNode->SetIJKToRASDirections(directions);
+  scalingNode->SetSpacing(0.8, 1.2, 1.9);
+  scalingNode->SetOrigin(5., -3., 2.);
+  vtkNew<vtkMatrix4x4> ijkToRAS;
+  scalingNode->GetIJKToRASMatrix(ijkToRAS.GetPointer());
+  vtkImageData* scalingImage = NewDisplacementImage(dims);
+  scalingNode->SetAndObserveImageData(scalingImage);
+  scalingImage->Delete();
+  double* scalars = static_cast<double*>(scalingImage->GetScalarPointer());
+
+  const double scales[2] = {0.15, -0.4};
+  // The closest voxel is probed, like ProbePixel() does
+  const double probedIJKs[3][3] = {{3.6, 2.2, 6.4}, {0.2, 0.4, 0.1}, {8.3, 4.5, 3.}};
+  for (int scaleIdx = 0; scaleIdx < 2; ++scaleIdx)
+    {
+    const double a = scales[scaleIdx];
+    for (int k = 0; k < dims[2]; ++k)
+      {
+      for (int j = 0; j < dims[1]; ++j)
+        {
+        for (int i = 0; i < dims[0]; ++i)
+          {
+          const double ijk[4] = {static_cast<double>(i), static_cast<double>(j), static_cast<double>(k), 1.};
+          double ras[4];
+          ijkToRAS->MultiplyPoint(ijk, ras);
+          for (int component = 0; component < 3; ++component)
+            {
+            scalars[3 * (i + dims[0] * (j + dims[1] * k)) + component] = a * ras[component];
+            }
+          }
+        }
+      }
+    scalingImage->Modified();
+
+    for (int probeIdx = 0; probeIdx < 3; ++probeIdx)
+      {
+      double ijk[3] = {probedIJKs[probeIdx][0], probedIJKs[probeIdx][1], probedIJKs[probeIdx][2]};
+      if (logic->ProbeDisplacement(scalingNode.GetPointer(), ijk) !=
+          vtkSlicerDataProbeLogic::PROBE_SUCCESS_SCALAR_VOLUME)
+        {
+        std::cerr << "Line " << __LINE__ << " - Failed to probe the displacement at (" << ijk[0] << ", "
+                  << ijk[1] << ", " << ijk[2] << ")" << std::endl;
+        return EXIT_FAILURE;
+        }
+      const double voxel[4] = {static_cast<double>(std::min(vtkMath::Round(ijk[0]), dims[0] - 1)),
+                               static_cast<double>(std::min(vtkMath::Round(ijk[1]), dims[1] - 1)),
+                               static_cast<double>(std::min(vtkMath::Round(ijk[2]), dims[2] - 1)), 1.};
+      double ras[4];
+      ijkToRAS->MultiplyPoint(voxel, ras);
+      double displacement[3];
+      logic->GetDisplacement(displacement);
+      double strains[3];
+      logic->GetPrincipalStrains(strains);
+      const double expectedStrain = a + 0.5 * a * a;
+      bool same = Near(logic->GetJacobianDeterminant(), (1. + a) * (1. + a) * (1. + a));
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        same = same && Near(displacement[axis], a * ras[axis]) && Near(strains[axis], expectedStrain);
+        }
+      if (!same)
+        {
+        std::cerr << "Line " << __LINE__ << " - Scaling by " << a << " at (" << ijk[0] << ", " << ijk[1]
+                  << ", " << ijk[2] << "): displacement (" << displacement[0] << ", " << displacement[1]
+                  << ", " << displacement[2] << "), determinant " << logic->GetJacobianDeterminant()
+                  << ", strains (" << strains[0] << ", " << strains[1] << ", " << strains[2]
+                  << ") instead of (" << a * ras[0] << ", " << a * ras[1] << ", " << a * ras[2] << "), "
+                  << (1. + a) * (1. + a) * (1. + a) << ", " << expectedStrain << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+
+    // A uniform expansion or contraction folds nowhere
+    int extent[6] = {0, dims[0] - 1, 0, dims[1] - 1, 0, dims[2] - 1};
+    if (logic->ProbeFolding(scalingNode.GetPointer(), extent) != vtkSlicerDataProbeLogic::PROBE_SUCCESS_SCALAR_VOLUME
+        || logic->GetFoldingNumberOfVoxels() != dims[0] * dims[1] * dims[2]
+        || logic->GetNumberOfFoldedVoxels() != 0
+        || !Near(logic->GetMinimumJacobianDeterminant(), (1. + a) * (1. + a) * (1. + a)))
+      {
+      std::cerr << "Line " << __LINE__ << " - Scaling by " << a << " folds " << logic->GetNumberOfFoldedVoxels()
+                << " voxels out of " << logic->GetFoldingNumberOfVoxels() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Inverted region: within the box of voxels [i0, i1] x [j0, j1] x [k0, k1],
+  // the R displacement decreases 3 times faster than R increases. Only
+  // dR/dR contributes to the determinant, 1 + dUR/dR, which is -2 inside the
+  // box and -0.5 on its first and last I slices (central differences across
+  // the box border): all the voxels of the box are folded, no other.
+  const int foldingDims[3] = {16, 12, 10};
+  const int box[6] = {5, 9, 3, 7, 2, 6};
+  const double spacing[3] = {1.5, 0.7, 1.1};
+  vtkNew<vtkMRMLScalarVolumeNode> foldingNode;
+  foldingNode->SetSpacing(spacing[0], spacing[1], spacing[2]);
+  foldingNode->SetOrigin(-10., 4., 7.);
+  vtkImageData* foldingImage = NewDisplacementImage(foldingDims);
+  foldingNode->SetAndObserveImageData(foldingImage);
+  foldingImage->Delete();
+  scalars = static_cast<double*>(foldingImage->GetScalarPointer());
+  for (int k = 0; k < foldingDims[2]; ++k)
+    {
+    for (int j = 0; j < foldingDims[1]; ++j)
+      {
+      for (int i = 0; i < foldingDims[0]; ++i)
+        {
+        const bool inBox = j >= box[2] && j <= box[3] && k >= box[4] && k <= box[5];
+        double* displacement = scalars + 3 * (i + foldingDims[0] * (j + foldingDims[1] * k));
+        displacement[0] = inBox ? -3. * spacing[0] * (std::min(std::max(i, box[0]), box[1]) - box[0]) : 0.;
+        displacement[1] = 0.;
+        displacement[2] = 0.;
+        }
+      }
+    }
+
+  const vtkIdType boxNumberOfVoxels = (box[1] - box[0] + 1) * (box[3] - box[2] + 1) * (box[5] - box[4] + 1);
+  int extent[6] = {0, foldingDims[0] - 1, 0, foldingDims[1] - 1, 0, foldingDims[2] - 1};
+  int foldedExtent[6];
+  int minimumIJK[3];
+  if (logic->ProbeFolding(foldingNode.GetPointer(), extent) != vtkSlicerDataProbeLogic::PROBE_SUCCESS_SCALAR_VOLUME
+      || logic->GetFoldingNumberOfVoxels() != foldingDims[0] * foldingDims[1] * foldingDims[2]
+      || logic->GetNumberOfFoldedVoxels() != boxNumberOfVoxels
+      || !Near(logic->GetMinimumJacobianDeterminant(), -2.))
+    {
+    std::cerr << "Line " << __LINE__ << " - " << logic->GetNumberOfFoldedVoxels() << " folded voxels out of "
+              << logic->GetFoldingNumberOfVoxels() << ", minimum determinant "
+              << logic->GetMinimumJacobianDeterminant() << " instead of " << boxNumberOfVoxels << " and -2"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  logic->GetFoldedExtent(foldedExtent);
+  logic->GetMinimumJacobianDeterminantIJK(minimumIJK);
+  if (!std::equal(box, box + 6, foldedExtent)
+      || minimumIJK[0] <= box[0] || minimumIJK[0] >= box[1]
+      || minimumIJK[1] < box[2] || minimumIJK[1] > box[3] || minimumIJK[2] < box[4] || minimumIJK[2] > box[5])
+    {
+    std::cerr << "Line " << __LINE__ << " - Folded extent [" << foldedExtent[0] << "-" << foldedExtent[1] << ", "
+              << foldedExtent[2] << "-" << foldedExtent[3] << ", " << foldedExtent[4] << "-" << foldedExtent[5]
+              << "], minimum at (" << minimumIJK[0] << ", " << minimumIJK[1] << ", " << minimumIJK[2]
+              << ") is not the box" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Extent clamped to the image, up to the first folded I slice
+  int partialExtent[6] = {-4, box[0], 0, foldingDims[1] + 3, 0, foldingDims[2] - 1};
+  if (logic->ProbeFolding(foldingNode.GetPointer(), partialExtent) !=
+      vtkSlicerDataProbeLogic::PROBE_SUCCESS_SCALAR_VOLUME
+      || logic->GetFoldingNumberOfVoxels() != (box[0] + 1) * foldingDims[1] * foldingDims[2]
+      || logic->GetNumberOfFoldedVoxels() != boxNumberOfVoxels / (box[1] - box[0] + 1)
+      || !Near(logic->GetMinimumJacobianDeterminant(), -0.5))
+    {
+    std::cerr << "Line " << __LINE__ << " - " << logic->GetNumberOfFoldedVoxels() << " folded voxels out of "
+              << logic->GetFoldingNumberOfVoxels() << " within the partial extent" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The probed determinant agrees with the scan
+  double ijk[3] = {box[0] + 2., box[2] + 1., box[4] + 1.};
+  if (logic->ProbeDisplacement(foldingNode.GetPointer(), ijk) != vtkSlicerDataProbeLogic::PROBE_SUCCESS_SCALAR_VOLUME
+      || !Near(logic->GetJacobianDeterminant(), -2.))
+    {
+    std::cerr << "Line " << __LINE__ << " - Determinant " << logic->GetJacobianDeterminant()
+              << " instead of -2 within the inverted region" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  int outsideExtent[6] = {foldingDims[0], foldingDims[0] + 2, 0, 1, 0, 1};
+  if (logic->ProbeFolding(foldingNode.GetPointer(), outsideExtent) != vtkSlicerDataProbeLogic::PROBE_ERROR_OUT_OF_FRAME)
+    {
+    std::cerr << "Line " << __LINE__ << " - Folding probed outside of the image" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,210 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeViewportStatistics.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+/// Value of the volume voxel (i, j, k): a few repeated values, so that many
+/// pixels are equal to the extrema, and a single bright voxel.
+short VolumeValue(int i, int j, int k)
+{
+  return static_cast<short>((i * 7 + j * 13 + k * 31) % 97 + (i == 50 && j == 60 ? 500 : 0));
+}
+
+//-----------------------------------------------------------------------------
+/// Nearest neighbor reslice of \a volumeImage through \a xyToIJK into
+/// \a sliceImage, 0 outside of the volume.
+void Reslice(vtkImageData* volumeImage, vtkMatrix4x4* xyToIJK, vtkImageData* sliceImage)
+{
+  int volumeDims[3] = {0, 0, 0};
+  volumeImage->GetDimensions(volumeDims);
+  int dims[3] = {0, 0, 0};
+  sliceImage->GetDimensions(dims);
+  const short* volumeScalars = static_cast<short*>(volumeImage->GetScalarPointer());
+  short* scalars = static_cast<short*>(sliceImage->GetScalarPointer());
+  for (int y = 0; y < dims[1]; ++y)
+    {
+    for (int x = 0; x < dims[0]; ++x)
+      {
+      int ijk[3] = {0, 0, 0};
+      bool inside = true;
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        ijk[axis] = vtkMath::Round(xyToIJK->GetElement(axis, 0) * x + xyToIJK->GetElement(axis, 1) * y
+                                   + xyToIJK->GetElement(axis, 3));
+        inside = inside && ijk[axis] >= 0 && ijk[axis] < volumeDims[axis];
+        }
+      scalars[x + dims[0] * y] = inside ?
+        volumeScalars[ijk[0] + volumeDims[0] * (ijk[1] + volumeDims[1] * ijk[2])] : 0;
+      }
+    }
+  sliceImage->GetPointData()->GetScalars()->Modified();
+}
+
+//-----------------------------------------------------------------------------
+/// Return true if \a updated and \a rebuilt have the same statistics.
+bool SameStatistics(vtkSlicerDataProbeViewportStatistics* updated,
+                    vtkSlicerDataProbeViewportStatistics* rebuilt, int numberOfBins)
+{
+  if (updated->GetNumberOfVoxels() != rebuilt->GetNumberOfVoxels())
+    {
+    std::cerr << "  " << updated->GetNumberOfVoxels() << " voxels instead of "
+              << rebuilt->GetNumberOfVoxels() << std::endl;
+    return false;
+    }
+  if (rebuilt->GetNumberOfVoxels() == 0)
+    {
+    return true;
+    }
+  if (fabs(updated->GetMean() - rebuilt->GetMean()) > 1e-6
+      || fabs(updated->GetStandardDeviation() - rebuilt->GetStandardDeviation()) > 1e-5
+      || updated->GetMinimum() != rebuilt->GetMinimum()
+      || updated->GetMaximum() != rebuilt->GetMaximum())
+    {
+    std::cerr << "  mean " << updated->GetMean() << ", deviation " << updated->GetStandardDeviation()
+              << ", range [" << updated->GetMinimum() << ", " << updated->GetMaximum() << "] instead of "
+              << rebuilt->GetMean() << ", " << rebuilt->GetStandardDeviation()
+              << ", [" << rebuilt->GetMinimum() << ", " << rebuilt->GetMaximum() << "]" << std::endl;
+    return false;
+    }
+  for (int bin = 0; bin < numberOfBins; ++bin)
+    {
+    if (updated->GetHistogram()[bin] != rebuilt->GetHistogram()[bin])
+      {
+      std::cerr << "  bin " << bin << " counts " << updated->GetHistogram()[bin] << " voxels instead of "
+                << rebuilt->GetHistogram()[bin] << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkSlicerDataProbeViewportStatisticsTest(int vtkNotUsed(argc), char * vtkNotUsed(argv) [])
+{
+  vtkMath::RandomSeed(1234);
+
+  const int volumeDims[3] = {200, 150, 3};
+  vtkNew<vtkImageData> volumeImage;
+  volumeImage->SetDimensions(volumeDims[0], volumeDims[1], volumeDims[2]);
+  volumeImage->SetScalarTypeToShort();
+  volumeImage->SetNumberOfScalarComponents(1);
+  volumeImage->AllocateScalars();
+  short* volumeScalars = static_cast<short*>(volumeImage->GetScalarPointer());
+  for (int k = 0; k < volumeDims[2]; ++k)
+    {
+    for (int j = 0; j < volumeDims[1]; ++j)
+      {
+      for (int i = 0; i < volumeDims[0]; ++i)
+        {
+        volumeScalars[i + volumeDims[0] * (j + volumeDims[1] * k)] = VolumeValue(i, j, k);
+        }
+      }
+    }
+
+  vtkNew<vtkImageData> sliceImage;
+  sliceImage->SetDimensions(64, 48, 1);
+  sliceImage->SetScalarTypeToShort();
+  sliceImage->SetNumberOfScalarComponents(1);
+  sliceImage->AllocateScalars();
+
+  vtkNew<vtkMatrix4x4> xyToIJK;
+  xyToIJK->SetElement(0, 3, -10.);
+  xyToIJK->SetElement(1, 3, -5.);
+  xyToIJK->SetElement(2, 3, 1.);
+
+  vtkNew<vtkSlicerDataProbeViewportStatistics> updated;
+  int incrementalUpdates = 0;
+  for (int panIdx = 0; panIdx < 2000; ++panIdx)
+    {
+    if (panIdx % 300 == 299)
+      {
+      // Zoom, the statistics are computed again
+      xyToIJK->SetElement(0, 0, xyToIJK->GetElement(0, 0) == 1. ? 2. : 1.);
+      }
+    else
+      {
+      // Pan by a few pixels around the volume, rarely by half a pixel
+      double x = xyToIJK->GetElement(0, 3) + xyToIJK->GetElement(0, 0) * vtkMath::Round(vtkMath::Random(-4., 4.));
+      double y = xyToIJK->GetElement(1, 3) + vtkMath::Round(vtkMath::Random(-4., 4.));
+      if (vtkMath::Random() < 0.02)
+        {
+        x += 0.5;
+        }
+      xyToIJK->SetElement(0, 3, x < -40. || x > 180. ? -10. : x);
+      xyToIJK->SetElement(1, 3, y < -30. || y > 130. ? -5. : y);
+      }
+    Reslice(volumeImage.GetPointer(), xyToIJK.GetPointer(), sliceImage.GetPointer());
+
+    // Progressive updates are only subsampled if they can't be incremental
+    const int sampleStride = vtkMath::Random() < 0.2 ? 4 : 1;
+    if (!updated->Update(sliceImage.GetPointer(), xyToIJK.GetPointer(), volumeImage.GetPointer(), sampleStride))
+      {
+      std::cerr << "Line " << __LINE__ << " - Failed to update pan " << panIdx << std::endl;
+      return EXIT_FAILURE;
+      }
+    if (updated->GetSampleStride() != (updated->GetLastUpdateIncremental() ? 1 : sampleStride))
+      {
+      std::cerr << "Line " << __LINE__ << " - Pan " << panIdx << " sampled every "
+                << updated->GetSampleStride() << " pixel" << std::endl;
+      return EXIT_FAILURE;
+      }
+    incrementalUpdates += updated->GetLastUpdateIncremental() ? 1 : 0;
+    if (updated->GetSampleStride() != 1)
+      {
+      continue;
+      }
+
+    vtkNew<vtkSlicerDataProbeViewportStatistics> rebuilt;
+    rebuilt->Update(sliceImage.GetPointer(), xyToIJK.GetPointer(), volumeImage.GetPointer());
+    if (!SameStatistics(updated.GetPointer(), rebuilt.GetPointer(), updated->GetNumberOfBins()))
+      {
+      std::cerr << "Line " << __LINE__ << " - Pan " << panIdx << " to ("
+                << xyToIJK->GetElement(0, 3) << ", " << xyToIJK->GetElement(1, 3)
+                << ") differs from a full rebuild" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Most pans must be incremental
+  if (incrementalUpdates < 1000)
+    {
+    std::cerr << "Line " << __LINE__ << " - Only " << incrementalUpdates
+              << " incremental updates out of 2000" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
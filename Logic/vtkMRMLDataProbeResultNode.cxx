@@ -0,0 +1,205 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkMRMLDataProbeResultNode.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkMRMLDataProbeResultNode);
+
+//----------------------------------------------------------------------------
+vtkMRMLNode* vtkMRMLDataProbeResultNode::CreateNodeInstance()
+{
+  return vtkMRMLDataProbeResultNode::New();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLDataProbeResultNode::vtkMRMLDataProbeResultNode()
+{
+  this->HideFromEditors = 1;
+  this->SaveWithScene = 0;
+  this->Valid = false;
+  this->ViewName = 0;
+  this->RAS[0] = this->RAS[1] = this->RAS[2] = 0.0;
+  for (int layer = 0; layer < NumberOfLayers; ++layer)
+    {
+    vtkMRMLDataProbeResultNode::ClearLayerResult(this->LayerResults[layer]);
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLDataProbeResultNode::~vtkMRMLDataProbeResultNode()
+{
+  this->SetViewName(0);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLDataProbeResultNode::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Valid: " << this->Valid << "\n";
+  os << indent << "ViewName: " << (this->ViewName ? this->ViewName : "(none)") << "\n";
+  os << indent << "RAS: " << this->RAS[0] << " " << this->RAS[1] << " " << this->RAS[2] << "\n";
+  for (int layer = 0; layer < NumberOfLayers; ++layer)
+    {
+    const LayerResult& result = this->LayerResults[layer];
+    os << indent << "Layer " << layer << ": " << result.VolumeNodeID
+       << " IJK " << result.IJK[0] << " " << result.IJK[1] << " " << result.IJK[2]
+       << " Status " << result.Status << " Values";
+    for (int valueIdx = 0; valueIdx < result.NumberOfValues; ++valueIdx)
+      {
+      os << " " << result.Values[valueIdx];
+      }
+    os << " " << result.Description << "\n";
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLDataProbeResultNode::Copy(vtkMRMLNode *anode)
+{
+  int wasModifying = this->StartModify();
+  this->Superclass::Copy(anode);
+  vtkMRMLDataProbeResultNode* node = vtkMRMLDataProbeResultNode::SafeDownCast(anode);
+  if (node)
+    {
+    this->Valid = node->Valid;
+    this->SetViewName(node->ViewName);
+    this->SetRAS(node->RAS);
+    for (int layer = 0; layer < NumberOfLayers; ++layer)
+      {
+      this->LayerResults[layer] = node->LayerResults[layer];
+      }
+    this->Modified();
+    }
+  this->EndModify(wasModifying);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLDataProbeResultNode::ClearLayerResult(LayerResult& result)
+{
+  result.VolumeNodeID.clear();
+  result.IJK[0] = result.IJK[1] = result.IJK[2] = -1.0;
+  result.Status = 0;
+  result.NumberOfValues = 0;
+  for (int valueIdx = 0; valueIdx < MaximumNumberOfValues; ++valueIdx)
+    {
+    result.Values[valueIdx] = vtkMath::Nan();
+    }
+  result.Description.clear();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLDataProbeResultNode::SetLayer(int layer, const char* volumeNodeID, const double ijk[3],
+                                          int status, int numberOfValues, const double* values,
+                                          const char* description)
+{
+  if (layer < 0 || layer >= NumberOfLayers)
+    {
+    vtkErrorMacro(<< "SetLayer: invalid layer " << layer);
+    return;
+    }
+  LayerResult& result = this->LayerResults[layer];
+  vtkMRMLDataProbeResultNode::ClearLayerResult(result);
+  result.VolumeNodeID = volumeNodeID ? volumeNodeID : "";
+  std::copy(ijk, ijk + 3, result.IJK);
+  result.Status = status;
+  result.NumberOfValues = values ? std::min(std::max(numberOfValues, 0), static_cast<int>(MaximumNumberOfValues)) : 0;
+  std::copy(values, values + result.NumberOfValues, result.Values);
+  result.Description = description ? description : "";
+  this->Valid = true;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLDataProbeResultNode::ClearLayer(int layer)
+{
+  if (layer < 0 || layer >= NumberOfLayers)
+    {
+    vtkErrorMacro(<< "ClearLayer: invalid layer " << layer);
+    return;
+    }
+  vtkMRMLDataProbeResultNode::ClearLayerResult(this->LayerResults[layer]);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLDataProbeResultNode::Reset()
+{
+  if (!this->Valid)
+    {
+    return;
+    }
+  for (int layer = 0; layer < NumberOfLayers; ++layer)
+    {
+    vtkMRMLDataProbeResultNode::ClearLayerResult(this->LayerResults[layer]);
+    }
+  this->Valid = false;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+const char* vtkMRMLDataProbeResultNode::GetLayerVolumeNodeID(int layer)const
+{
+  return layer >= 0 && layer < NumberOfLayers ? this->LayerResults[layer].VolumeNodeID.c_str() : "";
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLDataProbeResultNode::GetLayerIJK(int layer, double ijk[3])const
+{
+  if (layer < 0 || layer >= NumberOfLayers)
+    {
+    ijk[0] = ijk[1] = ijk[2] = -1.0;
+    return;
+    }
+  std::copy(this->LayerResults[layer].IJK, this->LayerResults[layer].IJK + 3, ijk);
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLDataProbeResultNode::GetLayerStatus(int layer)const
+{
+  return layer >= 0 && layer < NumberOfLayers ? this->LayerResults[layer].Status : 0;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLDataProbeResultNode::GetLayerNumberOfValues(int layer)const
+{
+  return layer >= 0 && layer < NumberOfLayers ? this->LayerResults[layer].NumberOfValues : 0;
+}
+
+//----------------------------------------------------------------------------
+double vtkMRMLDataProbeResultNode::GetLayerValue(int layer, int nth)const
+{
+  if (layer < 0 || layer >= NumberOfLayers ||
+      nth < 0 || nth >= this->LayerResults[layer].NumberOfValues)
+    {
+    return vtkMath::Nan();
+    }
+  return this->LayerResults[layer].Values[nth];
+}
+
+//----------------------------------------------------------------------------
+const char* vtkMRMLDataProbeResultNode::GetLayerDescription(int layer)const
+{
+  return layer >= 0 && layer < NumberOfLayers ? this->LayerResults[layer].Description.c_str() : "";
+}
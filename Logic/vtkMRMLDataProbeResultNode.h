@@ -0,0 +1,125 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkMRMLDataProbeResultNode_h
+#define __vtkMRMLDataProbeResultNode_h
+
+// MRML includes
+#include <vtkMRMLNode.h>
+
+// STD includes
+#include <string>
+
+#include "vtkSlicerDataProbeModuleLogicExport.h"
+
+/// \ingroup Slicer_QtModules_DataProbe
+/// Latest probe result of the DataProbe module.
+///
+/// The node holds the world position under the cursor and, for each slice
+/// layer, the probed volume, IJK, values, status and description, in a fixed
+/// layout. It is updated by qSlicerDataProbeInfoWidget on every probe so that
+/// other modules can read the result instead of probing again.
+/// The widget disables the modified events of the node while updating it and
+/// flushes them with InvokePendingModifiedEvent() at most once per frame.
+/// The node is neither saved with the scene nor shown in the editors.
+/// \sa vtkSlicerDataProbeLogic::GetResultNode
+class VTK_SLICER_DATAPROBE_MODULE_LOGIC_EXPORT vtkMRMLDataProbeResultNode :
+  public vtkMRMLNode
+{
+public:
+  static vtkMRMLDataProbeResultNode *New();
+  vtkTypeMacro(vtkMRMLDataProbeResultNode,vtkMRMLNode);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  virtual vtkMRMLNode* CreateNodeInstance();
+  virtual const char* GetNodeTagName() {return "DataProbeResult";}
+  virtual void Copy(vtkMRMLNode *node);
+
+  enum Layers
+    {
+    LabelLayer = 0,
+    BackgroundLayer,
+    ForegroundLayer,
+    NumberOfLayers
+    };
+
+  /// Same as vtkSlicerDataProbeLogic::GetMaxGetNumberOfPixelValues().
+  enum
+    {
+    MaximumNumberOfValues = 3
+    };
+
+  /// Return true if the cursor is over a view and the result is set.
+  vtkGetMacro(Valid, bool);
+
+  /// Name of the probed view.
+  vtkGetStringMacro(ViewName);
+  vtkSetStringMacro(ViewName);
+
+  /// World position under the cursor.
+  vtkGetVector3Macro(RAS, double);
+  vtkSetVector3Macro(RAS, double);
+
+  /// Set the result of \a layer: the ID of the probed volume, the probed
+  /// \a ijk, the vtkSlicerDataProbeLogic::DataProbeStatus \a status, the
+  /// first \a numberOfValues of \a values and the pixel \a description.
+  /// The result is then valid.
+  void SetLayer(int layer, const char* volumeNodeID, const double ijk[3], int status,
+                int numberOfValues, const double* values, const char* description);
+
+  /// Clear the result of \a layer, for example if it has no volume.
+  void ClearLayer(int layer);
+
+  /// Clear all the layers and invalidate the result.
+  void Reset();
+
+  /// Return the result of \a layer, an empty ID, -1 IJK, 0 status and no
+  /// value if the layer is not set.
+  const char* GetLayerVolumeNodeID(int layer)const;
+  void GetLayerIJK(int layer, double ijk[3])const;
+  int GetLayerStatus(int layer)const;
+  int GetLayerNumberOfValues(int layer)const;
+  double GetLayerValue(int layer, int nth)const;
+  const char* GetLayerDescription(int layer)const;
+
+protected:
+  vtkMRMLDataProbeResultNode();
+  virtual ~vtkMRMLDataProbeResultNode();
+
+  struct LayerResult
+  {
+    std::string VolumeNodeID;
+    double IJK[3];
+    int Status;
+    int NumberOfValues;
+    double Values[MaximumNumberOfValues];
+    std::string Description;
+  };
+
+  static void ClearLayerResult(LayerResult& result);
+
+  bool Valid;
+  char* ViewName;
+  double RAS[3];
+  LayerResult LayerResults[NumberOfLayers];
+
+private:
+  vtkMRMLDataProbeResultNode(const vtkMRMLDataProbeResultNode&); // Not implemented
+  void operator=(const vtkMRMLDataProbeResultNode&);             // Not implemented
+};
+
+#endif
@@ -0,0 +1,563 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeBatchEngine.h"
+#include "vtkSlicerDataProbeLogic.h"
+#include "vtkSlicerDataProbeTransformCache.h"
+
+// MRML includes
+#include <vtkMRMLDiffusionTensorVolumeNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+
+// VTK includes
+#include <vtkDoubleArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkImageData.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMultiThreader.h>
+#include <vtkMutexLock.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPoints.h>
+#include <vtkSmartPointer.h>
+#include <vtkStringArray.h>
+#include <vtkTable.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Sample the \a numberOfComponents components of \a scalars at the
+/// continuous index \a ijk into \a values, linearly interpolated if
+/// \a linear, otherwise at the voxel read by
+/// vtkSlicerDataProbeLogic::ProbePixel(): the voxel of the truncated index
+/// for a \a label map, the closest voxel for other volumes.
+/// Return false if \a ijk is out of the image, like ProbePixel().
+template <class T>
+bool vtkSlicerDataProbeSampleImage(const T* scalars, const int dims[3], int numberOfComponents,
+                                   const double ijk[3], bool label, bool linear, double* values)
+{
+  const vtkIdType incrementY = static_cast<vtkIdType>(dims[0]) * numberOfComponents;
+  const vtkIdType incrementZ = incrementY * dims[1];
+  bool interior = true;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    if (ijk[axis] < 0.0 || ijk[axis] >= dims[axis])
+      {
+      return false;
+      }
+    interior = interior && ijk[axis] <= dims[axis] - 1;
+    }
+  if (!linear || !interior)
+    {
+    int voxel[3];
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      voxel[axis] = label ? static_cast<int>(ijk[axis]) : std::min(vtkMath::Round(ijk[axis]), dims[axis] - 1);
+      }
+    const T* tuple = scalars + voxel[2] * incrementZ + voxel[1] * incrementY +
+                     static_cast<vtkIdType>(voxel[0]) * numberOfComponents;
+    for (int componentIdx = 0; componentIdx < numberOfComponents; ++componentIdx)
+      {
+      values[componentIdx] = static_cast<double>(tuple[componentIdx]);
+      }
+    return true;
+    }
+
+  int base[3];
+  int next[3];
+  double fraction[3];
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    base[axis] = static_cast<int>(ijk[axis]);
+    next[axis] = std::min(base[axis] + 1, dims[axis] - 1);
+    fraction[axis] = ijk[axis] - base[axis];
+    }
+  const vtkIdType offsetI[2] = {static_cast<vtkIdType>(base[0]) * numberOfComponents,
+                                static_cast<vtkIdType>(next[0]) * numberOfComponents};
+  const vtkIdType offsetJ[2] = {base[1] * incrementY, next[1] * incrementY};
+  const vtkIdType offsetK[2] = {base[2] * incrementZ, next[2] * incrementZ};
+  for (int componentIdx = 0; componentIdx < numberOfComponents; ++componentIdx)
+    {
+    values[componentIdx] = 0.0;
+    }
+  for (int dk = 0; dk < 2; ++dk)
+    {
+    const double weightK = dk ? fraction[2] : 1.0 - fraction[2];
+    for (int dj = 0; dj < 2; ++dj)
+      {
+      const double weightJK = weightK * (dj ? fraction[1] : 1.0 - fraction[1]);
+      const T* row = scalars + offsetK[dk] + offsetJ[dj];
+      for (int componentIdx = 0; componentIdx < numberOfComponents; ++componentIdx)
+        {
+        values[componentIdx] += weightJK *
+          ((1.0 - fraction[0]) * static_cast<double>(row[offsetI[0] + componentIdx]) +
+           fraction[0] * static_cast<double>(row[offsetI[1] + componentIdx]));
+        }
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+class vtkSlicerDataProbeBatchEngine::vtkInternal
+{
+public:
+  vtkInternal();
+  ~vtkInternal();
+
+  struct PointSet
+  {
+    vtkSmartPointer<vtkPoints> Points;
+    std::string Name;
+  };
+
+  /// Everything the threads need to sample a volume.
+  struct VolumeInfo
+  {
+    vtkImageData* ImageData;
+    int Dimensions[3];
+    int NumberOfComponents;
+    bool Linear;
+    /// Status of all the rows if the volume can not be sampled.
+    int ErrorStatus;
+    int SampledStatus;
+    /// World to IJK, for linearly transformed volumes.
+    double RASToIJK[3][4];
+    /// IJK of each point, for non-linearly transformed volumes.
+    std::vector<double> IJKs;
+    vtkDoubleArray* Values;
+    vtkIntArray* Statuses;
+  };
+
+  void PrepareVolume(vtkMRMLVolumeNode* volumeNode, VolumeInfo& volume);
+  void SampleChunk(const VolumeInfo& volume, vtkIdType first, vtkIdType last)const;
+  static VTK_THREAD_RETURN_TYPE ExecuteTasks(void* arg);
+
+  std::vector<PointSet> PointSets;
+  std::vector<vtkWeakPointer<vtkMRMLVolumeNode> > VolumeNodes;
+  vtkSmartPointer<vtkSlicerDataProbeTransformCache> TransformCache;
+  vtkSmartPointer<vtkTable> Output;
+  /// Output value column of each volume node, -1 if skipped.
+  std::vector<int> ValueColumnIndexes;
+
+  // Update state, shared by the threads
+  bool Interpolate;
+  std::vector<double> RAS;
+  std::vector<VolumeInfo> Volumes;
+  /// (volume, first point) of each task, volume by volume.
+  std::vector<std::pair<int, vtkIdType> > Tasks;
+  vtkIdType ChunkSize;
+  size_t NextTask;
+  vtkSmartPointer<vtkMutexLock> Lock;
+};
+
+//---------------------------------------------------------------------------
+// vtkInternal methods
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeBatchEngine::vtkInternal::vtkInternal()
+{
+  this->Output = vtkSmartPointer<vtkTable>::New();
+  this->Interpolate = true;
+  this->ChunkSize = 1;
+  this->NextTask = 0;
+  this->Lock = vtkSmartPointer<vtkMutexLock>::New();
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeBatchEngine::vtkInternal::~vtkInternal()
+{
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeBatchEngine::vtkInternal::PrepareVolume(
+  vtkMRMLVolumeNode* volumeNode, VolumeInfo& volume)
+{
+  volume.ImageData = 0;
+  volume.NumberOfComponents = 1;
+  volume.Linear = true;
+  volume.ErrorStatus = vtkSlicerDataProbeLogic::UNKNOWN;
+  vtkMRMLScalarVolumeNode * scalarVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode);
+  if (!scalarVolumeNode || vtkMRMLDiffusionTensorVolumeNode::SafeDownCast(volumeNode))
+    {
+    volume.ErrorStatus = vtkSlicerDataProbeLogic::PROBE_ERROR_NO_SCALAR_VOLUME;
+    return;
+    }
+  vtkImageData * imageData = volumeNode->GetImageData();
+  if (!imageData || !imageData->GetScalarPointer())
+    {
+    volume.ErrorStatus = vtkSlicerDataProbeLogic::PROBE_ERROR_NO_IMAGE_DATA;
+    return;
+    }
+  volume.ImageData = imageData;
+  imageData->GetDimensions(volume.Dimensions);
+  volume.NumberOfComponents = imageData->GetNumberOfScalarComponents();
+  volume.SampledStatus = scalarVolumeNode->GetLabelMap() ?
+    vtkSlicerDataProbeLogic::PROBE_SUCCESS_LABEL_VOLUME :
+    vtkSlicerDataProbeLogic::PROBE_SUCCESS_SCALAR_VOLUME;
+
+  vtkNew<vtkMatrix4x4> rasToIJK;
+  volume.Linear = this->TransformCache->GetRASToIJKMatrix(volumeNode, rasToIJK.GetPointer());
+  if (volume.Linear)
+    {
+    for (int row = 0; row < 3; ++row)
+      {
+      for (int column = 0; column < 4; ++column)
+        {
+        volume.RASToIJK[row][column] = rasToIJK->GetElement(row, column);
+        }
+      }
+    return;
+    }
+  // The cached displacement grid is filled lazily, map the points here
+  const vtkIdType numberOfPoints = static_cast<vtkIdType>(this->RAS.size() / 3);
+  volume.IJKs.resize(3 * numberOfPoints);
+  for (vtkIdType pointIdx = 0; pointIdx < numberOfPoints; ++pointIdx)
+    {
+    this->TransformCache->TransformRASToIJK(volumeNode, &this->RAS[3 * pointIdx], &volume.IJKs[3 * pointIdx]);
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeBatchEngine::vtkInternal::SampleChunk(
+  const VolumeInfo& volume, vtkIdType first, vtkIdType last)const
+{
+  const bool label = volume.SampledStatus == vtkSlicerDataProbeLogic::PROBE_SUCCESS_LABEL_VOLUME;
+  const bool linear = this->Interpolate && !label;
+  void * scalars = volume.ImageData->GetScalarPointer();
+  const int numberOfComponents = volume.NumberOfComponents;
+  for (vtkIdType pointIdx = first; pointIdx < last; ++pointIdx)
+    {
+    double ijk[3];
+    if (volume.Linear)
+      {
+      const double* ras = &this->RAS[3 * pointIdx];
+      for (int row = 0; row < 3; ++row)
+        {
+        ijk[row] = volume.RASToIJK[row][0] * ras[0] + volume.RASToIJK[row][1] * ras[1] +
+                   volume.RASToIJK[row][2] * ras[2] + volume.RASToIJK[row][3];
+        }
+      }
+    else
+      {
+      std::copy(&volume.IJKs[3 * pointIdx], &volume.IJKs[3 * pointIdx] + 3, ijk);
+      }
+    double* values = volume.Values->GetPointer(pointIdx * numberOfComponents);
+    bool sampled = false;
+    switch (volume.ImageData->GetScalarType())
+      {
+      vtkTemplateMacro(sampled = vtkSlicerDataProbeSampleImage(
+        static_cast<VTK_TT*>(scalars), volume.Dimensions, numberOfComponents, ijk, label, linear, values));
+      }
+    if (!sampled)
+      {
+      std::fill(values, values + numberOfComponents, vtkMath::Nan());
+      }
+    volume.Statuses->SetValue(pointIdx, sampled ?
+      volume.SampledStatus : static_cast<int>(vtkSlicerDataProbeLogic::PROBE_ERROR_OUT_OF_FRAME));
+    }
+}
+
+//---------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkSlicerDataProbeBatchEngine::vtkInternal::ExecuteTasks(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkInternal* self = static_cast<vtkInternal*>(threadInfo->UserData);
+  const vtkIdType numberOfPoints = static_cast<vtkIdType>(self->RAS.size() / 3);
+  while (true)
+    {
+    // Tasks are handed out in order, the threads move through the volumes
+    // together instead of each reading a different image
+    self->Lock->Lock();
+    size_t taskIdx = self->NextTask++;
+    self->Lock->Unlock();
+    if (taskIdx >= self->Tasks.size())
+      {
+      break;
+      }
+    const std::pair<int, vtkIdType>& task = self->Tasks[taskIdx];
+    self->SampleChunk(self->Volumes[task.first], task.second,
+                      std::min(task.second + self->ChunkSize, numberOfPoints));
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+// vtkSlicerDataProbeBatchEngine methods
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerDataProbeBatchEngine);
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeBatchEngine::vtkSlicerDataProbeBatchEngine()
+{
+  this->Internal = new vtkInternal;
+  this->Interpolation = Linear;
+  this->NumberOfThreads = 0;
+  this->ChunkSize = 1024;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeBatchEngine::~vtkSlicerDataProbeBatchEngine()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeBatchEngine::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Interpolation: " << this->Interpolation << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "ChunkSize: " << this->ChunkSize << "\n";
+  os << indent << "NumberOfPointSets: " << this->GetNumberOfPointSets() << "\n";
+  os << indent << "NumberOfVolumeNodes: " << this->GetNumberOfVolumeNodes() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeBatchEngine::SetTransformCache(vtkSlicerDataProbeTransformCache* transformCache)
+{
+  if (this->Internal->TransformCache.GetPointer() == transformCache)
+    {
+    return;
+    }
+  this->Internal->TransformCache = transformCache;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeTransformCache* vtkSlicerDataProbeBatchEngine::GetTransformCache()const
+{
+  return this->Internal->TransformCache;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeBatchEngine::AddPoints(vtkPoints* points, const char* name)
+{
+  if (!points)
+    {
+    return;
+    }
+  vtkInternal::PointSet pointSet;
+  pointSet.Points = points;
+  pointSet.Name = name ? name : "";
+  this->Internal->PointSets.push_back(pointSet);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeBatchEngine::RemoveAllPoints()
+{
+  this->Internal->PointSets.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDataProbeBatchEngine::GetNumberOfPointSets()const
+{
+  return static_cast<int>(this->Internal->PointSets.size());
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeBatchEngine::AddVolumeNode(vtkMRMLVolumeNode* volumeNode)
+{
+  if (!volumeNode)
+    {
+    return;
+    }
+  this->Internal->VolumeNodes.push_back(volumeNode);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeBatchEngine::RemoveAllVolumeNodes()
+{
+  this->Internal->VolumeNodes.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDataProbeBatchEngine::GetNumberOfVolumeNodes()const
+{
+  return static_cast<int>(this->Internal->VolumeNodes.size());
+}
+
+//----------------------------------------------------------------------------
+vtkTable* vtkSlicerDataProbeBatchEngine::GetOutput()const
+{
+  return this->Internal->Output;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDataProbeBatchEngine::GetValueColumnIndex(int volumeIdx)const
+{
+  if (volumeIdx < 0 || volumeIdx >= static_cast<int>(this->Internal->ValueColumnIndexes.size()))
+    {
+    return -1;
+    }
+  return this->Internal->ValueColumnIndexes[volumeIdx];
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDataProbeBatchEngine::GetStatusColumnIndex(int volumeIdx)const
+{
+  const int valueColumnIndex = this->GetValueColumnIndex(volumeIdx);
+  return valueColumnIndex < 0 ? -1 : valueColumnIndex + 1;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeBatchEngine::Update()
+{
+  vtkTable* output = this->Internal->Output;
+  output->Initialize();
+  if (!this->Internal->TransformCache)
+    {
+    this->Internal->TransformCache = vtkSmartPointer<vtkSlicerDataProbeTransformCache>::New();
+    }
+
+  // Point columns
+  vtkIdType numberOfPoints = 0;
+  for (size_t pointSetIdx = 0; pointSetIdx < this->Internal->PointSets.size(); ++pointSetIdx)
+    {
+    numberOfPoints += this->Internal->PointSets[pointSetIdx].Points->GetNumberOfPoints();
+    }
+  vtkNew<vtkStringArray> pointSetNames;
+  pointSetNames->SetName("PointSet");
+  pointSetNames->SetNumberOfValues(numberOfPoints);
+  vtkNew<vtkIdTypeArray> pointIds;
+  pointIds->SetName("PointId");
+  pointIds->SetNumberOfValues(numberOfPoints);
+  const char* rasNames[3] = {"R", "A", "S"};
+  vtkSmartPointer<vtkDoubleArray> rasColumns[3];
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    rasColumns[axis] = vtkSmartPointer<vtkDoubleArray>::New();
+    rasColumns[axis]->SetName(rasNames[axis]);
+    rasColumns[axis]->SetNumberOfValues(numberOfPoints);
+    }
+  std::vector<double>& ras = this->Internal->RAS;
+  ras.resize(3 * numberOfPoints);
+  vtkIdType rowIdx = 0;
+  for (size_t pointSetIdx = 0; pointSetIdx < this->Internal->PointSets.size(); ++pointSetIdx)
+    {
+    const vtkInternal::PointSet& pointSet = this->Internal->PointSets[pointSetIdx];
+    for (vtkIdType pointIdx = 0; pointIdx < pointSet.Points->GetNumberOfPoints(); ++pointIdx, ++rowIdx)
+      {
+      pointSet.Points->GetPoint(pointIdx, &ras[3 * rowIdx]);
+      pointSetNames->SetValue(rowIdx, pointSet.Name);
+      pointIds->SetValue(rowIdx, pointIdx);
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        rasColumns[axis]->SetValue(rowIdx, ras[3 * rowIdx + axis]);
+        }
+      }
+    }
+  output->AddColumn(pointSetNames.GetPointer());
+  output->AddColumn(pointIds.GetPointer());
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    output->AddColumn(rasColumns[axis]);
+    }
+
+  // Volume columns, the volumes that can not be sampled are filled directly
+  std::vector<vtkInternal::VolumeInfo>& volumes = this->Internal->Volumes;
+  volumes.clear();
+  volumes.reserve(this->Internal->VolumeNodes.size());
+  this->Internal->ValueColumnIndexes.assign(this->Internal->VolumeNodes.size(), -1);
+  for (size_t volumeIdx = 0; volumeIdx < this->Internal->VolumeNodes.size(); ++volumeIdx)
+    {
+    vtkMRMLVolumeNode* volumeNode = this->Internal->VolumeNodes[volumeIdx];
+    if (!volumeNode)
+      {
+      continue;
+      }
+    this->Internal->ValueColumnIndexes[volumeIdx] = static_cast<int>(output->GetNumberOfColumns());
+    volumes.push_back(vtkInternal::VolumeInfo());
+    vtkInternal::VolumeInfo& volume = volumes.back();
+    this->Internal->PrepareVolume(volumeNode, volume);
+    std::string columnName = volumeNode->GetName() ? volumeNode->GetName() : volumeNode->GetID();
+    vtkNew<vtkDoubleArray> values;
+    values->SetName(columnName.c_str());
+    values->SetNumberOfComponents(volume.NumberOfComponents);
+    values->SetNumberOfTuples(numberOfPoints);
+    vtkNew<vtkIntArray> statuses;
+    statuses->SetName((columnName + " status").c_str());
+    statuses->SetNumberOfValues(numberOfPoints);
+    if (!volume.ImageData)
+      {
+      std::fill(values->GetPointer(0), values->GetPointer(0) + numberOfPoints * volume.NumberOfComponents,
+                vtkMath::Nan());
+      std::fill(statuses->GetPointer(0), statuses->GetPointer(0) + numberOfPoints, volume.ErrorStatus);
+      }
+    volume.Values = values.GetPointer();
+    volume.Statuses = statuses.GetPointer();
+    output->AddColumn(values.GetPointer());
+    output->AddColumn(statuses.GetPointer());
+    }
+  if (numberOfPoints == 0 || volumes.empty())
+    {
+    volumes.clear();
+    std::vector<double>().swap(ras);
+    return false;
+    }
+
+  // (volume, chunk) tasks, volume by volume
+  this->Internal->Interpolate = this->Interpolation == Linear;
+  this->Internal->ChunkSize = this->ChunkSize;
+  this->Internal->Tasks.clear();
+  for (size_t volumeIdx = 0; volumeIdx < volumes.size(); ++volumeIdx)
+    {
+    if (!volumes[volumeIdx].ImageData)
+      {
+      continue;
+      }
+    for (vtkIdType first = 0; first < numberOfPoints; first += this->ChunkSize)
+      {
+      this->Internal->Tasks.push_back(std::make_pair(static_cast<int>(volumeIdx), first));
+      }
+    }
+  this->Internal->NextTask = 0;
+  if (!this->Internal->Tasks.empty())
+    {
+    vtkNew<vtkMultiThreader> threader;
+    int numberOfThreads = this->NumberOfThreads > 0 ?
+      this->NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+    numberOfThreads = std::min(numberOfThreads, VTK_MAX_THREADS);
+    numberOfThreads = std::max(std::min(numberOfThreads, static_cast<int>(this->Internal->Tasks.size())), 1);
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod(vtkInternal::ExecuteTasks, this->Internal);
+    threader->SingleMethodExecute();
+    }
+
+  this->Internal->Tasks.clear();
+  volumes.clear();
+  std::vector<double>().swap(ras);
+  output->Modified();
+  return true;
+}
@@ -0,0 +1,132 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerDataProbeBatchEngine_h
+#define __vtkSlicerDataProbeBatchEngine_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkSlicerDataProbeModuleLogicExport.h"
+
+class vtkMRMLVolumeNode;
+class vtkPoints;
+class vtkSlicerDataProbeTransformCache;
+class vtkTable;
+
+/// \ingroup Slicer_QtModules_DataProbe
+/// Sample sets of world positions, for example the fiducials of several
+/// fiducial lists, in a set of volumes, all at once.
+///
+/// Update() fills a table with one row per point and, for each volume, a
+/// value column and a status column. The status is a
+/// vtkSlicerDataProbeLogic::DataProbeStatus: PROBE_SUCCESS_SCALAR_VOLUME or
+/// PROBE_SUCCESS_LABEL_VOLUME when sampled, PROBE_ERROR_OUT_OF_FRAME outside
+/// of the volume, PROBE_ERROR_NO_SCALAR_VOLUME for non scalar volumes and
+/// PROBE_ERROR_NO_IMAGE_DATA for empty volumes. The value is NaN unless
+/// sampled, multi-component volumes get one value component per scalar
+/// component.
+///
+/// The world to IJK mapping of each volume is taken from the transform
+/// cache: a single matrix for linear transforms, otherwise each point is
+/// mapped beforehand in the calling thread. The points are then split into
+/// chunks, and the (volume, chunk) tasks, ordered volume by volume so that
+/// a thread keeps reading the same image, are distributed among threads.
+/// \sa vtkSlicerDataProbeLogic::GetBatchEngine
+class VTK_SLICER_DATAPROBE_MODULE_LOGIC_EXPORT vtkSlicerDataProbeBatchEngine :
+  public vtkObject
+{
+public:
+  static vtkSlicerDataProbeBatchEngine *New();
+  vtkTypeMacro(vtkSlicerDataProbeBatchEngine,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  enum InterpolationType
+    {
+    NearestNeighbor = 0,
+    Linear
+    };
+
+  /// Interpolation of the scalar volumes. The nearest voxel is the one read
+  /// by vtkSlicerDataProbeLogic::ProbePixel(), label maps are always sampled
+  /// at the voxel of the truncated IJK position like ProbePixel() does.
+  /// Linear interpolation falls back to the nearest voxel past the center of
+  /// the last voxel.
+  /// Default is Linear.
+  vtkSetClampMacro(Interpolation, int, NearestNeighbor, Linear);
+  vtkGetMacro(Interpolation, int);
+
+  /// Number of threads processing the tasks, 0 to use the default number of
+  /// threads of vtkMultiThreader.
+  /// Default is 0.
+  vtkSetClampMacro(NumberOfThreads, int, 0, VTK_INT_MAX);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Number of points sampled per task.
+  /// Default is 1024.
+  vtkSetClampMacro(ChunkSize, int, 1, VTK_INT_MAX);
+  vtkGetMacro(ChunkSize, int);
+
+  /// Cache providing the world to IJK mappings of the volumes. A private
+  /// cache is created if none is set.
+  void SetTransformCache(vtkSlicerDataProbeTransformCache* transformCache);
+  vtkSlicerDataProbeTransformCache* GetTransformCache()const;
+
+  /// Add the world positions \a points, identified by \a name in the
+  /// "PointSet" column of the output.
+  void AddPoints(vtkPoints* points, const char* name = 0);
+  void RemoveAllPoints();
+  int GetNumberOfPointSets()const;
+
+  /// Add \a volumeNode to the sampled volumes. Its columns are named after
+  /// the volume.
+  void AddVolumeNode(vtkMRMLVolumeNode* volumeNode);
+  void RemoveAllVolumeNodes();
+  int GetNumberOfVolumeNodes()const;
+
+  /// Sample all the points in all the volumes and fill the output.
+  /// The volumes deleted since they were added are skipped.
+  /// Return false if there is nothing to sample.
+  bool Update();
+
+  /// Table filled by Update(), with the columns "PointSet", "PointId", "R",
+  /// "A" and "S", followed by "<volume>" and "<volume> status" per volume.
+  vtkTable* GetOutput()const;
+
+  /// Return the index in the output of the value column and of the status
+  /// column of the volume \a volumeIdx, in the order of AddVolumeNode().
+  /// Return -1 if the volume was skipped by the last Update().
+  int GetValueColumnIndex(int volumeIdx)const;
+  int GetStatusColumnIndex(int volumeIdx)const;
+
+protected:
+  vtkSlicerDataProbeBatchEngine();
+  virtual ~vtkSlicerDataProbeBatchEngine();
+
+  int Interpolation;
+  int NumberOfThreads;
+  int ChunkSize;
+
+private:
+  vtkSlicerDataProbeBatchEngine(const vtkSlicerDataProbeBatchEngine&); // Not implemented
+  void operator=(const vtkSlicerDataProbeBatchEngine&);                // Not implemented
+
+  class vtkInternal;
+  vtkInternal * Internal;
+};
+
+#endif
@@ -0,0 +1,268 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeBlockMinMax.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <algorithm>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Accumulate the extrema of the first component of each row of voxels
+/// of the block slice \a bk into the blocks it belongs to.
+template <class T>
+void vtkSlicerDataProbeComputeBlockMinMax(const T* scalars, const int dims[3], int numberOfComponents,
+                                          int blockSize, const int blockDims[3], int bk,
+                                          double* minima, double* maxima)
+{
+  const int endK = std::min((bk + 1) * blockSize, dims[2]);
+  const T* voxel = scalars + static_cast<vtkIdType>(bk) * blockSize * dims[0] * dims[1] * numberOfComponents;
+  const vtkIdType blockSliceOffset = static_cast<vtkIdType>(bk) * blockDims[0] * blockDims[1];
+  for (int k = bk * blockSize; k < endK; ++k)
+    {
+    for (int j = 0; j < dims[1]; ++j)
+      {
+      const vtkIdType blockRowOffset = blockSliceOffset + (j / blockSize) * blockDims[0];
+      for (int bi = 0; bi < blockDims[0]; ++bi)
+        {
+        const int endI = std::min((bi + 1) * blockSize, dims[0]);
+        T rowMin = *voxel;
+        T rowMax = *voxel;
+        for (int i = bi * blockSize; i < endI; ++i, voxel += numberOfComponents)
+          {
+          rowMin = std::min(rowMin, *voxel);
+          rowMax = std::max(rowMax, *voxel);
+          }
+        double& blockMin = minima[blockRowOffset + bi];
+        double& blockMax = maxima[blockRowOffset + bi];
+        blockMin = std::min(blockMin, static_cast<double>(rowMin));
+        blockMax = std::max(blockMax, static_cast<double>(rowMax));
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+/// Blocks computed by the threads: each thread accumulates whole block
+/// slices, so that no two threads write the same block.
+struct vtkSlicerDataProbeBlockMinMaxTask
+{
+  vtkDataArray* Scalars;
+  int Dimensions[3];
+  int BlockSize;
+  int BlockDimensions[3];
+  double* Minima;
+  double* Maxima;
+};
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkSlicerDataProbeExecuteBlockMinMaxTask(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkSlicerDataProbeBlockMinMaxTask* task =
+    static_cast<vtkSlicerDataProbeBlockMinMaxTask*>(threadInfo->UserData);
+  for (int bk = threadInfo->ThreadID; bk < task->BlockDimensions[2];
+       bk += threadInfo->NumberOfThreads)
+    {
+    switch (task->Scalars->GetDataType())
+      {
+      vtkTemplateMacro(vtkSlicerDataProbeComputeBlockMinMax(
+        static_cast<VTK_TT*>(task->Scalars->GetVoidPointer(0)), task->Dimensions,
+        task->Scalars->GetNumberOfComponents(), task->BlockSize, task->BlockDimensions, bk,
+        task->Minima, task->Maxima));
+      }
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerDataProbeBlockMinMax);
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeBlockMinMax::vtkSlicerDataProbeBlockMinMax()
+{
+  this->BlockSize = 8;
+  this->NumberOfThreads = 0;
+  this->Scalars = 0;
+  this->ScalarsMTime = 0;
+  this->ComputedBlockSize = 0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->BlockDimensions[axis] = 0;
+    this->ImageDimensions[axis] = 0;
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeBlockMinMax::~vtkSlicerDataProbeBlockMinMax()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeBlockMinMax::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "BlockSize: " << this->BlockSize << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "BlockDimensions: " << this->BlockDimensions[0] << " "
+     << this->BlockDimensions[1] << " " << this->BlockDimensions[2] << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeBlockMinMax::Reset()
+{
+  this->ImageData = 0;
+  this->Scalars = 0;
+  this->ScalarsMTime = 0;
+  this->ComputedBlockSize = 0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->BlockDimensions[axis] = 0;
+    this->ImageDimensions[axis] = 0;
+    }
+  std::vector<double>().swap(this->Minima);
+  std::vector<double>().swap(this->Maxima);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeBlockMinMax::IsUpToDate(vtkImageData* imageData)const
+{
+  if (!imageData || imageData != this->ImageData.GetPointer()
+      || this->ComputedBlockSize != this->BlockSize)
+    {
+    return false;
+    }
+  vtkDataArray* scalars = imageData->GetPointData()->GetScalars();
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+  return scalars
+    && scalars->GetVoidPointer(0) == this->Scalars
+    && std::max(scalars->GetMTime(), imageData->GetMTime()) == this->ScalarsMTime
+    && dims[0] == this->ImageDimensions[0]
+    && dims[1] == this->ImageDimensions[1]
+    && dims[2] == this->ImageDimensions[2];
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeBlockMinMax::Update(vtkImageData* imageData)
+{
+  if (this->IsUpToDate(imageData))
+    {
+    return true;
+    }
+  this->Reset();
+  vtkDataArray* scalars = imageData ? imageData->GetPointData()->GetScalars() : 0;
+  if (!scalars || scalars->GetNumberOfTuples() == 0)
+    {
+    return false;
+    }
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+  vtkIdType numberOfBlocks = 1;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->ImageDimensions[axis] = dims[axis];
+    this->BlockDimensions[axis] = (dims[axis] + this->BlockSize - 1) / this->BlockSize;
+    numberOfBlocks *= this->BlockDimensions[axis];
+    }
+  this->Minima.assign(numberOfBlocks, VTK_DOUBLE_MAX);
+  this->Maxima.assign(numberOfBlocks, -VTK_DOUBLE_MAX);
+
+  switch (scalars->GetDataType())
+    {
+    vtkTemplateMacro(break);
+    default:
+      this->Reset();
+      return false;
+    }
+
+  vtkSlicerDataProbeBlockMinMaxTask task;
+  task.Scalars = scalars;
+  task.BlockSize = this->BlockSize;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    task.Dimensions[axis] = dims[axis];
+    task.BlockDimensions[axis] = this->BlockDimensions[axis];
+    }
+  task.Minima = &this->Minima[0];
+  task.Maxima = &this->Maxima[0];
+  int numberOfThreads = this->NumberOfThreads > 0 ?
+    this->NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  numberOfThreads = std::min(std::min(numberOfThreads, VTK_MAX_THREADS), this->BlockDimensions[2]);
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(std::max(numberOfThreads, 1));
+  threader->SetSingleMethod(vtkSlicerDataProbeExecuteBlockMinMaxTask, &task);
+  threader->SingleMethodExecute();
+
+  this->ImageData = imageData;
+  this->Scalars = scalars->GetVoidPointer(0);
+  this->ScalarsMTime = std::max(scalars->GetMTime(), imageData->GetMTime());
+  this->ComputedBlockSize = this->BlockSize;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkSlicerDataProbeBlockMinMax::GetImageData()const
+{
+  return this->ImageData.GetPointer();
+}
+
+//----------------------------------------------------------------------------
+const int* vtkSlicerDataProbeBlockMinMax::GetBlockDimensions()const
+{
+  return this->BlockDimensions;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeBlockMinMax::GetBlockIndex(int bi, int bj, int bk)const
+{
+  if (bi < 0 || bi >= this->BlockDimensions[0]
+      || bj < 0 || bj >= this->BlockDimensions[1]
+      || bk < 0 || bk >= this->BlockDimensions[2])
+    {
+    return -1;
+    }
+  return bi + this->BlockDimensions[0] * (bj + static_cast<vtkIdType>(this->BlockDimensions[1]) * bk);
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDataProbeBlockMinMax::GetBlockMinimum(int bi, int bj, int bk)const
+{
+  vtkIdType blockIdx = this->GetBlockIndex(bi, bj, bk);
+  return blockIdx >= 0 ? this->Minima[blockIdx] : vtkMath::Nan();
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDataProbeBlockMinMax::GetBlockMaximum(int bi, int bj, int bk)const
+{
+  vtkIdType blockIdx = this->GetBlockIndex(bi, bj, bk);
+  return blockIdx >= 0 ? this->Maxima[blockIdx] : vtkMath::Nan();
+}
@@ -0,0 +1,102 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerDataProbeBlockMinMax_h
+#define __vtkSlicerDataProbeBlockMinMax_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkWeakPointer.h>
+
+#include "vtkSlicerDataProbeModuleLogicExport.h"
+
+// STD includes
+#include <vector>
+
+class vtkImageData;
+
+/// \ingroup Slicer_QtModules_DataProbe
+/// Minimum and maximum of the first scalar component of an image, computed
+/// over blocks of BlockSize^3 voxels.
+///
+/// It is used to skip the empty regions of a volume when marching along a
+/// ray: a block whose maximum is below the searched value does not need to
+/// be visited voxel by voxel.
+/// \sa vtkSlicerDataProbeLogic::ProbeRay
+class VTK_SLICER_DATAPROBE_MODULE_LOGIC_EXPORT vtkSlicerDataProbeBlockMinMax :
+  public vtkObject
+{
+public:
+  static vtkSlicerDataProbeBlockMinMax *New();
+  vtkTypeMacro(vtkSlicerDataProbeBlockMinMax,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Number of voxels along each side of a block.
+  /// Default is 8.
+  vtkSetClampMacro(BlockSize, int, 2, 64);
+  vtkGetMacro(BlockSize, int);
+
+  /// Number of threads computing the blocks, 0 to use the default number
+  /// of threads of vtkMultiThreader. The threads share the block slices.
+  /// Default is 0.
+  vtkSetClampMacro(NumberOfThreads, int, 0, VTK_INT_MAX);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Compute the blocks of \a imageData if they are not up-to-date.
+  /// Return false if the image has no scalars.
+  bool Update(vtkImageData* imageData);
+
+  /// Return true if the blocks have been computed from the current
+  /// scalars of \a imageData.
+  bool IsUpToDate(vtkImageData* imageData)const;
+
+  /// Return the image the blocks have been computed from, if it still exists.
+  vtkImageData* GetImageData()const;
+
+  /// Return the number of blocks along each axis.
+  const int* GetBlockDimensions()const;
+
+  /// Return the extrema of the block (\a bi, \a bj, \a bk).
+  double GetBlockMinimum(int bi, int bj, int bk)const;
+  double GetBlockMaximum(int bi, int bj, int bk)const;
+
+  /// Release the blocks.
+  void Reset();
+
+protected:
+  vtkSlicerDataProbeBlockMinMax();
+  virtual ~vtkSlicerDataProbeBlockMinMax();
+
+  vtkIdType GetBlockIndex(int bi, int bj, int bk)const;
+
+  int BlockSize;
+  int NumberOfThreads;
+  int BlockDimensions[3];
+  int ImageDimensions[3];
+  vtkWeakPointer<vtkImageData> ImageData;
+  void* Scalars;
+  unsigned long ScalarsMTime;
+  int ComputedBlockSize;
+  std::vector<double> Minima;
+  std::vector<double> Maxima;
+
+private:
+  vtkSlicerDataProbeBlockMinMax(const vtkSlicerDataProbeBlockMinMax&); // Not implemented
+  void operator=(const vtkSlicerDataProbeBlockMinMax&);                // Not implemented
+};
+
+#endif
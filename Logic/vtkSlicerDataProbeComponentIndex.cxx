@@ -0,0 +1,745 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeComponentIndex.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <set>
+#include <vector>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Run of voxels [Start, End] of the same non-zero label in a row.
+struct vtkSlicerDataProbeRun
+{
+  int Start;
+  int End;
+  int Label;
+};
+
+//----------------------------------------------------------------------------
+/// Run-length encode the non-zero labels of the rows of the K slice \a k.
+/// \a rowStarts receives the index of the first run of each row.
+template <class T>
+void vtkSlicerDataProbeExtractRuns(const T* scalars, const int dims[3], int numberOfComponents, int k,
+                                   std::vector<vtkSlicerDataProbeRun>& runs,
+                                   std::vector<vtkIdType>& rowStarts)
+{
+  runs.clear();
+  rowStarts.resize(dims[1] + 1);
+  const T* row = scalars + static_cast<vtkIdType>(k) * dims[0] * dims[1] * numberOfComponents;
+  for (int j = 0; j < dims[1]; ++j, row += static_cast<vtkIdType>(dims[0]) * numberOfComponents)
+    {
+    rowStarts[j] = static_cast<vtkIdType>(runs.size());
+    int i = 0;
+    while (i < dims[0])
+      {
+      const int label = static_cast<int>(row[i * numberOfComponents]);
+      const int start = i;
+      while (++i < dims[0] && static_cast<int>(row[i * numberOfComponents]) == label)
+        {
+        }
+      if (label != 0)
+        {
+        vtkSlicerDataProbeRun run = {start, i - 1, label};
+        runs.push_back(run);
+        }
+      }
+    }
+  rowStarts[dims[1]] = static_cast<vtkIdType>(runs.size());
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+class vtkSlicerDataProbeComponentIndex::vtkInternal
+{
+public:
+  vtkInternal();
+
+  struct Component
+  {
+    Component();
+
+    int Label;
+    vtkIdType Count;
+    double Sum[3];
+    int Bounds[6];
+  };
+
+  /// Label the components of the slices [firstSlice, lastSlice], whose
+  /// previous components must have been released. No component may cross
+  /// the border of the slices.
+  bool LabelSlices(vtkImageData* imageData, int firstSlice, int lastSlice, int numberOfThreads);
+
+  /// Release the components crossing the slices [firstSlice, lastSlice] and
+  /// extend the range to their bounds, until no released component crosses
+  /// the range border.
+  void ReleaseComponents(int& firstSlice, int& lastSlice);
+
+  unsigned int GetId(vtkIdType voxelIdx)const;
+  unsigned int NewComponentId();
+
+  // Tasks run in parallel over the slices or slabs
+  typedef void (vtkInternal::*TaskType)(int taskIdx);
+  void ParallelFor(TaskType task, int numberOfTasks);
+  static VTK_THREAD_RETURN_TYPE ExecuteTasks(void* arg);
+  void ExtractSliceRuns(int sliceIdx);
+  void UnionSlab(int slabIdx);
+  void FillSlice(int sliceIdx);
+
+  vtkIdType Find(vtkIdType runIdx);
+  void Union(vtkIdType runIdx1, vtkIdType runIdx2);
+  void UnionRows(int sliceIdx1, int j1, int sliceIdx2, int j2);
+  vtkIdType RowStart(int sliceIdx, int j)const;
+  vtkIdType RowEnd(int sliceIdx, int j)const;
+
+  vtkWeakPointer<vtkImageData> ImageData;
+  void* Scalars;
+  unsigned long ScalarsMTime;
+  int Dimensions[3];
+
+  std::vector<Component> Components;
+  std::vector<unsigned int> FreeComponentIds;
+  bool WideIds;
+  std::vector<unsigned short> ShortIds;
+  std::vector<unsigned int> IntIds;
+
+  // Labeling state, shared with the threads
+  vtkDataArray* LabeledScalars;
+  int FirstSlice;
+  int NumberOfThreads;
+  TaskType Task;
+  int NumberOfTasks;
+  std::vector<std::vector<vtkSlicerDataProbeRun> > SliceRuns;
+  std::vector<std::vector<vtkIdType> > SliceRowStarts;
+  std::vector<vtkSlicerDataProbeRun> Runs;
+  std::vector<vtkIdType> RowStarts;
+  std::vector<vtkIdType> Parents;
+  std::vector<unsigned int> RunIds;
+  std::vector<int> SlabStarts;
+};
+
+//---------------------------------------------------------------------------
+// vtkInternal methods
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeComponentIndex::vtkInternal::Component::Component()
+{
+  this->Label = 0;
+  this->Count = 0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Sum[axis] = 0.0;
+    this->Bounds[2 * axis] = VTK_INT_MAX;
+    this->Bounds[2 * axis + 1] = VTK_INT_MIN;
+    }
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeComponentIndex::vtkInternal::vtkInternal()
+{
+  this->Scalars = 0;
+  this->ScalarsMTime = 0;
+  this->WideIds = false;
+  this->LabeledScalars = 0;
+  this->FirstSlice = 0;
+  this->NumberOfThreads = 1;
+  this->Task = 0;
+  this->NumberOfTasks = 0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Dimensions[axis] = 0;
+    }
+}
+
+//---------------------------------------------------------------------------
+unsigned int vtkSlicerDataProbeComponentIndex::vtkInternal::GetId(vtkIdType voxelIdx)const
+{
+  return this->WideIds ? this->IntIds[voxelIdx] : this->ShortIds[voxelIdx];
+}
+
+//---------------------------------------------------------------------------
+unsigned int vtkSlicerDataProbeComponentIndex::vtkInternal::NewComponentId()
+{
+  if (!this->FreeComponentIds.empty())
+    {
+    unsigned int componentId = this->FreeComponentIds.back();
+    this->FreeComponentIds.pop_back();
+    return componentId;
+    }
+  this->Components.push_back(Component());
+  return static_cast<unsigned int>(this->Components.size() - 1);
+}
+
+//---------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkSlicerDataProbeComponentIndex::vtkInternal::ExecuteTasks(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkInternal* self = static_cast<vtkInternal*>(threadInfo->UserData);
+  for (int taskIdx = threadInfo->ThreadID; taskIdx < self->NumberOfTasks;
+       taskIdx += threadInfo->NumberOfThreads)
+    {
+    (self->*(self->Task))(taskIdx);
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeComponentIndex::vtkInternal::ParallelFor(TaskType task, int numberOfTasks)
+{
+  this->Task = task;
+  this->NumberOfTasks = numberOfTasks;
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(std::max(std::min(this->NumberOfThreads, numberOfTasks), 1));
+  threader->SetSingleMethod(vtkInternal::ExecuteTasks, this);
+  threader->SingleMethodExecute();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeComponentIndex::vtkInternal::ExtractSliceRuns(int sliceIdx)
+{
+  switch (this->LabeledScalars->GetDataType())
+    {
+    vtkTemplateMacro(vtkSlicerDataProbeExtractRuns(
+      static_cast<VTK_TT*>(this->LabeledScalars->GetVoidPointer(0)), this->Dimensions,
+      this->LabeledScalars->GetNumberOfComponents(), this->FirstSlice + sliceIdx,
+      this->SliceRuns[sliceIdx], this->SliceRowStarts[sliceIdx]));
+    }
+}
+
+//---------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeComponentIndex::vtkInternal::RowStart(int sliceIdx, int j)const
+{
+  return this->RowStarts[static_cast<vtkIdType>(sliceIdx) * this->Dimensions[1] + j];
+}
+
+//---------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeComponentIndex::vtkInternal::RowEnd(int sliceIdx, int j)const
+{
+  return this->RowStarts[static_cast<vtkIdType>(sliceIdx) * this->Dimensions[1] + j + 1];
+}
+
+//---------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeComponentIndex::vtkInternal::Find(vtkIdType runIdx)
+{
+  // Path halving
+  while (this->Parents[runIdx] != runIdx)
+    {
+    this->Parents[runIdx] = this->Parents[this->Parents[runIdx]];
+    runIdx = this->Parents[runIdx];
+    }
+  return runIdx;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeComponentIndex::vtkInternal::Union(vtkIdType runIdx1, vtkIdType runIdx2)
+{
+  runIdx1 = this->Find(runIdx1);
+  runIdx2 = this->Find(runIdx2);
+  // The root is always the first run of the component
+  if (runIdx1 < runIdx2)
+    {
+    this->Parents[runIdx2] = runIdx1;
+    }
+  else if (runIdx2 < runIdx1)
+    {
+    this->Parents[runIdx1] = runIdx2;
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeComponentIndex::vtkInternal::UnionRows(int sliceIdx1, int j1, int sliceIdx2, int j2)
+{
+  vtkIdType runIdx1 = this->RowStart(sliceIdx1, j1);
+  const vtkIdType end1 = this->RowEnd(sliceIdx1, j1);
+  vtkIdType runIdx2 = this->RowStart(sliceIdx2, j2);
+  const vtkIdType end2 = this->RowEnd(sliceIdx2, j2);
+  while (runIdx1 < end1 && runIdx2 < end2)
+    {
+    const vtkSlicerDataProbeRun& run1 = this->Runs[runIdx1];
+    const vtkSlicerDataProbeRun& run2 = this->Runs[runIdx2];
+    if (run1.End < run2.Start)
+      {
+      ++runIdx1;
+      continue;
+      }
+    if (run2.End < run1.Start)
+      {
+      ++runIdx2;
+      continue;
+      }
+    // Overlapping runs
+    if (run1.Label == run2.Label)
+      {
+      this->Union(runIdx1, runIdx2);
+      }
+    if (run1.End < run2.End)
+      {
+      ++runIdx1;
+      }
+    else
+      {
+      ++runIdx2;
+      }
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeComponentIndex::vtkInternal::UnionSlab(int slabIdx)
+{
+  // Runs of a slab are only connected to runs of the same slab here, the
+  // threads never touch the same parents.
+  for (int sliceIdx = this->SlabStarts[slabIdx]; sliceIdx < this->SlabStarts[slabIdx + 1]; ++sliceIdx)
+    {
+    for (int j = 0; j < this->Dimensions[1]; ++j)
+      {
+      if (j > 0)
+        {
+        this->UnionRows(sliceIdx, j - 1, sliceIdx, j);
+        }
+      if (sliceIdx > this->SlabStarts[slabIdx])
+        {
+        this->UnionRows(sliceIdx - 1, j, sliceIdx, j);
+        }
+      }
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeComponentIndex::vtkInternal::FillSlice(int sliceIdx)
+{
+  const int k = this->FirstSlice + sliceIdx;
+  for (int j = 0; j < this->Dimensions[1]; ++j)
+    {
+    const vtkIdType rowOffset = this->Dimensions[0] *
+      (j + static_cast<vtkIdType>(this->Dimensions[1]) * k);
+    if (this->WideIds)
+      {
+      std::fill(this->IntIds.begin() + rowOffset, this->IntIds.begin() + rowOffset + this->Dimensions[0], 0u);
+      }
+    else
+      {
+      std::fill(this->ShortIds.begin() + rowOffset, this->ShortIds.begin() + rowOffset + this->Dimensions[0],
+                static_cast<unsigned short>(0));
+      }
+    const vtkIdType end = this->RowEnd(sliceIdx, j);
+    for (vtkIdType runIdx = this->RowStart(sliceIdx, j); runIdx < end; ++runIdx)
+      {
+      const vtkSlicerDataProbeRun& run = this->Runs[runIdx];
+      const unsigned int componentId = this->RunIds[runIdx];
+      if (this->WideIds)
+        {
+        std::fill(this->IntIds.begin() + rowOffset + run.Start,
+                  this->IntIds.begin() + rowOffset + run.End + 1, componentId);
+        }
+      else
+        {
+        std::fill(this->ShortIds.begin() + rowOffset + run.Start,
+                  this->ShortIds.begin() + rowOffset + run.End + 1,
+                  static_cast<unsigned short>(componentId));
+        }
+      }
+    }
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDataProbeComponentIndex::vtkInternal::LabelSlices(
+  vtkImageData* imageData, int firstSlice, int lastSlice, int numberOfThreads)
+{
+  vtkDataArray* scalars = imageData->GetPointData()->GetScalars();
+  switch (scalars->GetDataType())
+    {
+    vtkTemplateMacro(break);
+    default:
+      return false;
+    }
+  const int numberOfSlices = lastSlice - firstSlice + 1;
+  if (numberOfThreads <= 0)
+    {
+    numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+    }
+  this->NumberOfThreads = std::min(numberOfThreads, VTK_MAX_THREADS);
+  this->LabeledScalars = scalars;
+  this->FirstSlice = firstSlice;
+
+  // Run-length encode the slices
+  this->SliceRuns.resize(numberOfSlices);
+  this->SliceRowStarts.resize(numberOfSlices);
+  this->ParallelFor(&vtkInternal::ExtractSliceRuns, numberOfSlices);
+
+  // Gather the runs of all the slices
+  vtkIdType numberOfRuns = 0;
+  for (int sliceIdx = 0; sliceIdx < numberOfSlices; ++sliceIdx)
+    {
+    numberOfRuns += static_cast<vtkIdType>(this->SliceRuns[sliceIdx].size());
+    }
+  this->Runs.clear();
+  this->Runs.reserve(numberOfRuns);
+  this->RowStarts.resize(static_cast<vtkIdType>(numberOfSlices) * this->Dimensions[1] + 1);
+  for (int sliceIdx = 0; sliceIdx < numberOfSlices; ++sliceIdx)
+    {
+    const vtkIdType sliceStart = static_cast<vtkIdType>(this->Runs.size());
+    for (int j = 0; j < this->Dimensions[1]; ++j)
+      {
+      this->RowStarts[static_cast<vtkIdType>(sliceIdx) * this->Dimensions[1] + j] =
+        sliceStart + this->SliceRowStarts[sliceIdx][j];
+      }
+    this->Runs.insert(this->Runs.end(), this->SliceRuns[sliceIdx].begin(), this->SliceRuns[sliceIdx].end());
+    std::vector<vtkSlicerDataProbeRun>().swap(this->SliceRuns[sliceIdx]);
+    }
+  this->RowStarts.back() = numberOfRuns;
+
+  // Union-find of the runs: slabs in parallel, then their borders
+  this->Parents.resize(numberOfRuns);
+  for (vtkIdType runIdx = 0; runIdx < numberOfRuns; ++runIdx)
+    {
+    this->Parents[runIdx] = runIdx;
+    }
+  const int numberOfSlabs = std::max(std::min(this->NumberOfThreads, numberOfSlices), 1);
+  this->SlabStarts.resize(numberOfSlabs + 1);
+  for (int slabIdx = 0; slabIdx <= numberOfSlabs; ++slabIdx)
+    {
+    this->SlabStarts[slabIdx] = static_cast<int>(static_cast<vtkIdType>(numberOfSlices) * slabIdx / numberOfSlabs);
+    }
+  this->ParallelFor(&vtkInternal::UnionSlab, numberOfSlabs);
+  for (int slabIdx = 1; slabIdx < numberOfSlabs; ++slabIdx)
+    {
+    const int sliceIdx = this->SlabStarts[slabIdx];
+    for (int j = 0; j < this->Dimensions[1]; ++j)
+      {
+      this->UnionRows(sliceIdx - 1, j, sliceIdx, j);
+      }
+    }
+
+  // Number the components and accumulate their statistics. Roots are the
+  // first run of their component, they are numbered before their children.
+  this->RunIds.resize(numberOfRuns);
+  for (int sliceIdx = 0; sliceIdx < numberOfSlices; ++sliceIdx)
+    {
+    const int k = firstSlice + sliceIdx;
+    for (int j = 0; j < this->Dimensions[1]; ++j)
+      {
+      const vtkIdType end = this->RowEnd(sliceIdx, j);
+      for (vtkIdType runIdx = this->RowStart(sliceIdx, j); runIdx < end; ++runIdx)
+        {
+        const vtkSlicerDataProbeRun& run = this->Runs[runIdx];
+        const vtkIdType rootIdx = this->Find(runIdx);
+        const unsigned int componentId = (rootIdx == runIdx) ?
+          this->NewComponentId() : this->RunIds[rootIdx];
+        this->RunIds[runIdx] = componentId;
+        Component& component = this->Components[componentId];
+        const vtkIdType length = run.End - run.Start + 1;
+        component.Label = run.Label;
+        component.Count += length;
+        component.Sum[0] += 0.5 * (run.Start + run.End) * length;
+        component.Sum[1] += static_cast<double>(j) * length;
+        component.Sum[2] += static_cast<double>(k) * length;
+        component.Bounds[0] = std::min(component.Bounds[0], run.Start);
+        component.Bounds[1] = std::max(component.Bounds[1], run.End);
+        component.Bounds[2] = std::min(component.Bounds[2], j);
+        component.Bounds[3] = std::max(component.Bounds[3], j);
+        component.Bounds[4] = std::min(component.Bounds[4], k);
+        component.Bounds[5] = std::max(component.Bounds[5], k);
+        }
+      }
+    }
+
+  // Switch to 32 bit IDs when needed
+  if (!this->WideIds && this->Components.size() > VTK_UNSIGNED_SHORT_MAX + 1u)
+    {
+    this->IntIds.assign(this->ShortIds.begin(), this->ShortIds.end());
+    std::vector<unsigned short>().swap(this->ShortIds);
+    this->WideIds = true;
+    }
+
+  this->ParallelFor(&vtkInternal::FillSlice, numberOfSlices);
+
+  // Release the labeling state
+  std::vector<vtkSlicerDataProbeRun>().swap(this->Runs);
+  std::vector<vtkIdType>().swap(this->RowStarts);
+  std::vector<vtkIdType>().swap(this->Parents);
+  std::vector<unsigned int>().swap(this->RunIds);
+  this->SliceRuns.clear();
+  this->SliceRowStarts.clear();
+  this->LabeledScalars = 0;
+  return true;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeComponentIndex::vtkInternal::ReleaseComponents(int& firstSlice, int& lastSlice)
+{
+  std::set<unsigned int> releasedIds;
+  int scannedFirstSlice = lastSlice + 1;
+  int scannedLastSlice = lastSlice;
+  const vtkIdType sliceSize = static_cast<vtkIdType>(this->Dimensions[0]) * this->Dimensions[1];
+  for (;;)
+    {
+    int newFirstSlice = firstSlice;
+    int newLastSlice = lastSlice;
+    for (int k = firstSlice; k <= lastSlice; ++k)
+      {
+      if (k >= scannedFirstSlice && k <= scannedLastSlice)
+        {
+        continue;
+        }
+      unsigned int lastId = 0;
+      for (vtkIdType voxelIdx = k * sliceSize; voxelIdx < (k + 1) * sliceSize; ++voxelIdx)
+        {
+        const unsigned int componentId = this->GetId(voxelIdx);
+        if (componentId == 0 || componentId == lastId)
+          {
+          continue;
+          }
+        lastId = componentId;
+        if (releasedIds.insert(componentId).second)
+          {
+          newFirstSlice = std::min(newFirstSlice, this->Components[componentId].Bounds[4]);
+          newLastSlice = std::max(newLastSlice, this->Components[componentId].Bounds[5]);
+          }
+        }
+      }
+    scannedFirstSlice = firstSlice;
+    scannedLastSlice = lastSlice;
+    if (newFirstSlice == firstSlice && newLastSlice == lastSlice)
+      {
+      break;
+      }
+    firstSlice = newFirstSlice;
+    lastSlice = newLastSlice;
+    }
+  for (std::set<unsigned int>::const_iterator it = releasedIds.begin(); it != releasedIds.end(); ++it)
+    {
+    this->Components[*it] = Component();
+    this->FreeComponentIds.push_back(*it);
+    }
+}
+
+//----------------------------------------------------------------------------
+// vtkSlicerDataProbeComponentIndex methods
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerDataProbeComponentIndex);
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeComponentIndex::vtkSlicerDataProbeComponentIndex()
+{
+  this->NumberOfThreads = 0;
+  this->Internal = new vtkInternal;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeComponentIndex::~vtkSlicerDataProbeComponentIndex()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeComponentIndex::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "NumberOfComponents: " << this->GetNumberOfComponents() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeComponentIndex::Reset()
+{
+  this->Internal->ImageData = 0;
+  this->Internal->Scalars = 0;
+  this->Internal->ScalarsMTime = 0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Internal->Dimensions[axis] = 0;
+    }
+  std::vector<vtkInternal::Component>().swap(this->Internal->Components);
+  std::vector<unsigned int>().swap(this->Internal->FreeComponentIds);
+  std::vector<unsigned short>().swap(this->Internal->ShortIds);
+  std::vector<unsigned int>().swap(this->Internal->IntIds);
+  this->Internal->WideIds = false;
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkSlicerDataProbeComponentIndex::GetImageData()const
+{
+  return this->Internal->ImageData.GetPointer();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeComponentIndex::IsUpToDate(vtkImageData* imageData)const
+{
+  if (!imageData || imageData != this->Internal->ImageData.GetPointer())
+    {
+    return false;
+    }
+  vtkDataArray* scalars = imageData->GetPointData()->GetScalars();
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+  return scalars
+    && scalars->GetVoidPointer(0) == this->Internal->Scalars
+    && std::max(scalars->GetMTime(), imageData->GetMTime()) == this->Internal->ScalarsMTime
+    && dims[0] == this->Internal->Dimensions[0]
+    && dims[1] == this->Internal->Dimensions[1]
+    && dims[2] == this->Internal->Dimensions[2];
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeComponentIndex::Update(vtkImageData* imageData)
+{
+  if (this->IsUpToDate(imageData))
+    {
+    return true;
+    }
+  this->Reset();
+  vtkDataArray* scalars = imageData ? imageData->GetPointData()->GetScalars() : 0;
+  if (!scalars || scalars->GetNumberOfTuples() == 0)
+    {
+    return false;
+    }
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Internal->Dimensions[axis] = dims[axis];
+    }
+  // Component 0 is the background
+  this->Internal->Components.resize(1);
+  this->Internal->ShortIds.resize(static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2]);
+  if (!this->Internal->LabelSlices(imageData, 0, dims[2] - 1, this->NumberOfThreads))
+    {
+    this->Reset();
+    return false;
+    }
+  this->Internal->ImageData = imageData;
+  this->Internal->Scalars = scalars->GetVoidPointer(0);
+  this->Internal->ScalarsMTime = std::max(scalars->GetMTime(), imageData->GetMTime());
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeComponentIndex::UpdateExtent(vtkImageData* imageData, const int extent[6])
+{
+  vtkDataArray* scalars = imageData ? imageData->GetPointData()->GetScalars() : 0;
+  int dims[3] = {0, 0, 0};
+  if (imageData)
+    {
+    imageData->GetDimensions(dims);
+    }
+  if (!scalars
+      || imageData != this->Internal->ImageData.GetPointer()
+      || scalars->GetVoidPointer(0) != this->Internal->Scalars
+      || dims[0] != this->Internal->Dimensions[0]
+      || dims[1] != this->Internal->Dimensions[1]
+      || dims[2] != this->Internal->Dimensions[2])
+    {
+    return this->Update(imageData);
+    }
+  // Slices next to the modified ones may get connected to them
+  int firstSlice = std::max(extent[4] - 1, 0);
+  int lastSlice = std::min(extent[5] + 1, dims[2] - 1);
+  if (firstSlice <= lastSlice)
+    {
+    this->Internal->ReleaseComponents(firstSlice, lastSlice);
+    if (!this->Internal->LabelSlices(imageData, firstSlice, lastSlice, this->NumberOfThreads))
+      {
+      this->Reset();
+      return false;
+      }
+    }
+  this->Internal->ScalarsMTime = std::max(scalars->GetMTime(), imageData->GetMTime());
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeComponentIndex::GetNumberOfComponents()const
+{
+  if (this->Internal->Components.empty())
+    {
+    return 0;
+    }
+  return static_cast<vtkIdType>(this->Internal->Components.size() - 1 -
+                                this->Internal->FreeComponentIds.size());
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkSlicerDataProbeComponentIndex::GetComponentId(int i, int j, int k)const
+{
+  const int* dims = this->Internal->Dimensions;
+  if (i < 0 || i >= dims[0] || j < 0 || j >= dims[1] || k < 0 || k >= dims[2])
+    {
+    return 0;
+    }
+  return this->Internal->GetId(i + dims[0] * (j + static_cast<vtkIdType>(dims[1]) * k));
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDataProbeComponentIndex::GetComponentLabel(unsigned int componentId)const
+{
+  return componentId < this->Internal->Components.size() ?
+    this->Internal->Components[componentId].Label : 0;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeComponentIndex::GetComponentNumberOfVoxels(unsigned int componentId)const
+{
+  return componentId < this->Internal->Components.size() ?
+    this->Internal->Components[componentId].Count : 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeComponentIndex::GetComponentCentroid(unsigned int componentId, double centroid[3])const
+{
+  if (componentId >= this->Internal->Components.size() ||
+      this->Internal->Components[componentId].Count == 0)
+    {
+    return false;
+    }
+  const vtkInternal::Component& component = this->Internal->Components[componentId];
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    centroid[axis] = component.Sum[axis] / component.Count;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeComponentIndex::GetComponentBounds(unsigned int componentId, int bounds[6])const
+{
+  if (componentId >= this->Internal->Components.size() ||
+      this->Internal->Components[componentId].Count == 0)
+    {
+    return false;
+    }
+  std::copy(this->Internal->Components[componentId].Bounds,
+            this->Internal->Components[componentId].Bounds + 6, bounds);
+  return true;
+}
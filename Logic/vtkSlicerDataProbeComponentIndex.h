@@ -0,0 +1,104 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerDataProbeComponentIndex_h
+#define __vtkSlicerDataProbeComponentIndex_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkSlicerDataProbeModuleLogicExport.h"
+
+class vtkImageData;
+
+/// \ingroup Slicer_QtModules_DataProbe
+/// Connected components (6-connectivity) of the non-zero labels of a label map.
+///
+/// Each row of the label map is run-length encoded and the runs are merged
+/// with a union-find: the K slices are split into slabs labeled in parallel,
+/// the slab borders being merged afterwards. The result is stored as a
+/// component ID volume (16 bits, or 32 bits when there are more than 65535
+/// components) and a table of the voxel count, centroid and bounds of each
+/// component. Looking up the component of a voxel is a single array read.
+///
+/// After an edit, UpdateExtent() only relabels the slices of the modified
+/// extent extended to the components crossing it.
+/// \sa vtkSlicerDataProbeLogic::ProbeComponent
+class VTK_SLICER_DATAPROBE_MODULE_LOGIC_EXPORT vtkSlicerDataProbeComponentIndex :
+  public vtkObject
+{
+public:
+  static vtkSlicerDataProbeComponentIndex *New();
+  vtkTypeMacro(vtkSlicerDataProbeComponentIndex,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Number of threads used to label the slabs, 0 to use the default number
+  /// of threads of vtkMultiThreader.
+  /// Default is 0.
+  vtkSetClampMacro(NumberOfThreads, int, 0, VTK_INT_MAX);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Label the components of \a imageData if the index is not up-to-date.
+  /// Return false if the image has no scalars.
+  bool Update(vtkImageData* imageData);
+
+  /// Update the index of \a imageData after the voxels of \a extent have been
+  /// modified. Only the slices of \a extent and of the components crossing
+  /// them are labeled again if the index was built for \a imageData,
+  /// otherwise the whole image is labeled.
+  bool UpdateExtent(vtkImageData* imageData, const int extent[6]);
+
+  /// Return true if the index has been built from the current scalars of
+  /// \a imageData.
+  bool IsUpToDate(vtkImageData* imageData)const;
+
+  /// Return the image the index has been built from, if it still exists.
+  vtkImageData* GetImageData()const;
+
+  /// Return the number of components.
+  vtkIdType GetNumberOfComponents()const;
+
+  /// Return the component of the voxel (\a i, \a j, \a k), 0 if the voxel
+  /// is background or out of the image.
+  unsigned int GetComponentId(int i, int j, int k)const;
+
+  /// Return the label value, the number of voxels, the IJK centroid and the
+  /// IJK bounds of the component \a componentId. Return 0 or false if the
+  /// component does not exist.
+  int GetComponentLabel(unsigned int componentId)const;
+  vtkIdType GetComponentNumberOfVoxels(unsigned int componentId)const;
+  bool GetComponentCentroid(unsigned int componentId, double centroid[3])const;
+  bool GetComponentBounds(unsigned int componentId, int bounds[6])const;
+
+  /// Release the index.
+  void Reset();
+
+protected:
+  vtkSlicerDataProbeComponentIndex();
+  virtual ~vtkSlicerDataProbeComponentIndex();
+
+  int NumberOfThreads;
+
+private:
+  vtkSlicerDataProbeComponentIndex(const vtkSlicerDataProbeComponentIndex&); // Not implemented
+  void operator=(const vtkSlicerDataProbeComponentIndex&);                   // Not implemented
+
+  class vtkInternal;
+  vtkInternal * Internal;
+};
+
+#endif
@@ -0,0 +1,700 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeDistanceMap.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMultiThreader.h>
+#include <vtkMutexLock.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <new>
+#include <vector>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Squared distance of the voxels where the distance is not known.
+const float vtkSlicerDataProbeInfiniteDistance = VTK_FLOAT_MAX;
+
+//----------------------------------------------------------------------------
+/// Per-thread buffers of the line transforms.
+struct vtkSlicerDataProbeLineBuffers
+{
+  std::vector<double> Lines;
+  std::vector<double> Distances;
+  std::vector<double> Intersections;
+  std::vector<int> Parabolas;
+};
+
+//----------------------------------------------------------------------------
+/// Replace the squared distances \a f of a line of \a n samples, \a spacing
+/// apart, by min_q(f(q) + (spacing * (p - q))^2), computed from the lower
+/// envelope of the parabolas rooted at the samples of finite distance.
+void vtkSlicerDataProbeTransformLine(double* f, int n, double spacing,
+                                     vtkSlicerDataProbeLineBuffers& buffers)
+{
+  double* d = &buffers.Distances[0];
+  double* z = &buffers.Intersections[0];
+  int* v = &buffers.Parabolas[0];
+  const double spacing2 = spacing * spacing;
+  int k = -1;
+  for (int q = 0; q < n; ++q)
+    {
+    if (f[q] >= vtkSlicerDataProbeInfiniteDistance)
+      {
+      continue;
+      }
+    double s = -VTK_DOUBLE_MAX;
+    while (k >= 0)
+      {
+      const int p = v[k];
+      s = ((f[q] + spacing2 * q * q) - (f[p] + spacing2 * p * p)) / (2.0 * spacing2 * (q - p));
+      if (s > z[k])
+        {
+        break;
+        }
+      --k;
+      }
+    if (k < 0)
+      {
+      s = -VTK_DOUBLE_MAX;
+      }
+    ++k;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = VTK_DOUBLE_MAX;
+    }
+  if (k < 0)
+    {
+    // No finite distance on the line
+    return;
+    }
+  k = 0;
+  for (int q = 0; q < n; ++q)
+    {
+    while (z[k + 1] < q)
+      {
+      ++k;
+      }
+    const double delta = spacing * (q - v[k]);
+    d[q] = delta * delta + f[v[k]];
+    }
+  std::copy(d, d + n, f);
+}
+
+//----------------------------------------------------------------------------
+/// Transform the columns of the plane whose element (r, c) is at
+/// plane[r * rowStride + c]. The columns are gathered first so that the
+/// plane is read and written row by row.
+void vtkSlicerDataProbeTransformColumns(float* plane, vtkIdType rowStride,
+                                        int numberOfRows, int numberOfColumns,
+                                        double spacing,
+                                        vtkSlicerDataProbeLineBuffers& buffers)
+{
+  buffers.Lines.resize(static_cast<size_t>(numberOfRows) * numberOfColumns);
+  buffers.Distances.resize(numberOfRows);
+  buffers.Intersections.resize(numberOfRows + 1);
+  buffers.Parabolas.resize(numberOfRows);
+  double* lines = &buffers.Lines[0];
+  for (int r = 0; r < numberOfRows; ++r)
+    {
+    const float* row = plane + r * rowStride;
+    for (int c = 0; c < numberOfColumns; ++c)
+      {
+      lines[static_cast<size_t>(c) * numberOfRows + r] = row[c];
+      }
+    }
+  for (int c = 0; c < numberOfColumns; ++c)
+    {
+    vtkSlicerDataProbeTransformLine(lines + static_cast<size_t>(c) * numberOfRows,
+                                    numberOfRows, spacing, buffers);
+    }
+  for (int r = 0; r < numberOfRows; ++r)
+    {
+    float* row = plane + r * rowStride;
+    for (int c = 0; c < numberOfColumns; ++c)
+      {
+      row[c] = static_cast<float>(lines[static_cast<size_t>(c) * numberOfRows + r]);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+/// Set \a mask to 1 for the voxels of the first component of \a scalars
+/// equal to \a label, 0 otherwise.
+template <class T>
+void vtkSlicerDataProbeCopyLabelMask(const T* scalars, int numberOfComponents,
+                                     vtkIdType numberOfVoxels, int label,
+                                     unsigned char* mask)
+{
+  for (vtkIdType voxelIdx = 0; voxelIdx < numberOfVoxels; ++voxelIdx)
+    {
+    mask[voxelIdx] = static_cast<int>(scalars[voxelIdx * numberOfComponents]) == label ? 1 : 0;
+    }
+}
+
+//----------------------------------------------------------------------------
+/// Initialize the squared distances of the voxels of a row: 0 inside the
+/// label for \a outside (distance to the label), 0 outside of the label for
+/// \a inside (distance to the rest of the image), infinite otherwise.
+void vtkSlicerDataProbeInitializeRow(const unsigned char* mask, int n,
+                                     float* outside, float* inside)
+{
+  for (int i = 0; i < n; ++i)
+    {
+    outside[i] = mask[i] ? 0.f : vtkSlicerDataProbeInfiniteDistance;
+    inside[i] = mask[i] ? vtkSlicerDataProbeInfiniteDistance : 0.f;
+    }
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+class vtkSlicerDataProbeDistanceMap::vtkInternal
+{
+public:
+  vtkInternal();
+  ~vtkInternal();
+
+  /// Description of a distance map, computed or requested.
+  struct MapInfo
+  {
+    MapInfo();
+    void Set(vtkImageData* imageData, int label, const double spacing[3]);
+    bool Matches(vtkImageData* imageData, int label, const double spacing[3])const;
+
+    vtkWeakPointer<vtkImageData> ImageData;
+    void* Scalars;
+    unsigned long ScalarsMTime;
+    int Label;
+    double Spacing[3];
+    int Dimensions[3];
+  };
+
+  /// Computed map.
+  struct Map
+  {
+    MapInfo Info;
+    std::vector<float> Distances;
+  };
+
+  /// Start computing the requested map in the background.
+  void Start(vtkImageData* imageData, int label, const double spacing[3], int numberOfThreads);
+
+  /// If the background computation is over, wait for its thread and make
+  /// its map available, releasing the least recently used maps beyond
+  /// \a maximumNumberOfMaps.
+  void Collect(int maximumNumberOfMaps);
+
+  /// Make the computed map matching \a imageData, \a label and \a spacing
+  /// the available map and return true, return false if there is none.
+  /// Release the maps of other images and the maps of the image computed
+  /// from previous scalars.
+  bool Use(vtkImageData* imageData, int label, const double spacing[3]);
+
+  /// Abort the background computation, if any, and wait for its thread.
+  void Abort();
+
+  bool IsAbortRequested();
+  void ReleaseBuffers();
+
+  // Background computation
+  static VTK_THREAD_RETURN_TYPE Compute(void* arg);
+  bool ComputeMap();
+
+  // Tasks run in parallel over the slices or rows
+  typedef void (vtkInternal::*TaskType)(int taskIdx);
+  void ParallelFor(TaskType task, int numberOfTasks);
+  static VTK_THREAD_RETURN_TYPE ExecuteTasks(void* arg);
+  void TransformSliceRows(int k);
+  void TransformSliceColumns(int k);
+  void TransformRowSlices(int j);
+
+  // Computed maps, the available map first then by decreasing last use
+  std::list<Map> Maps;
+
+  // Requested map, shared with the background thread. The label is copied
+  // into a mask so that the image can be modified while computing.
+  MapInfo Request;
+  std::vector<unsigned char> Mask;
+  int NumberOfThreads;
+  std::vector<float> Outside;
+  std::vector<float> Inside;
+  TaskType Task;
+  int NumberOfTasks;
+
+  vtkMultiThreader* Threader;
+  int ThreadId;
+  vtkMutexLock* Lock;
+  bool AbortRequested;
+  bool Finished;
+  bool Succeeded;
+};
+
+//---------------------------------------------------------------------------
+// vtkInternal methods
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeDistanceMap::vtkInternal::MapInfo::MapInfo()
+{
+  this->Scalars = 0;
+  this->ScalarsMTime = 0;
+  this->Label = 0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Spacing[axis] = 0.0;
+    this->Dimensions[axis] = 0;
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeDistanceMap::vtkInternal::MapInfo::Set(
+  vtkImageData* imageData, int label, const double spacing[3])
+{
+  vtkDataArray* scalars = imageData->GetPointData()->GetScalars();
+  this->ImageData = imageData;
+  this->Scalars = scalars->GetVoidPointer(0);
+  this->ScalarsMTime = std::max(scalars->GetMTime(), imageData->GetMTime());
+  this->Label = label;
+  imageData->GetDimensions(this->Dimensions);
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Spacing[axis] = spacing[axis];
+    }
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDataProbeDistanceMap::vtkInternal::MapInfo::Matches(
+  vtkImageData* imageData, int label, const double spacing[3])const
+{
+  if (!imageData || imageData != this->ImageData.GetPointer() || label != this->Label)
+    {
+    return false;
+    }
+  vtkDataArray* scalars = imageData->GetPointData()->GetScalars();
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+  return scalars
+    && scalars->GetVoidPointer(0) == this->Scalars
+    && std::max(scalars->GetMTime(), imageData->GetMTime()) == this->ScalarsMTime
+    && dims[0] == this->Dimensions[0]
+    && dims[1] == this->Dimensions[1]
+    && dims[2] == this->Dimensions[2]
+    && spacing[0] == this->Spacing[0]
+    && spacing[1] == this->Spacing[1]
+    && spacing[2] == this->Spacing[2];
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeDistanceMap::vtkInternal::vtkInternal()
+{
+  this->NumberOfThreads = 1;
+  this->Task = 0;
+  this->NumberOfTasks = 0;
+  this->Threader = vtkMultiThreader::New();
+  this->ThreadId = -1;
+  this->Lock = vtkMutexLock::New();
+  this->AbortRequested = false;
+  this->Finished = false;
+  this->Succeeded = false;
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeDistanceMap::vtkInternal::~vtkInternal()
+{
+  this->Abort();
+  this->Threader->Delete();
+  this->Lock->Delete();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeDistanceMap::vtkInternal::Start(
+  vtkImageData* imageData, int label, const double spacing[3], int numberOfThreads)
+{
+  this->Abort();
+  this->Request.Set(imageData, label, spacing);
+  vtkDataArray* scalars = imageData->GetPointData()->GetScalars();
+  const int* dims = this->Request.Dimensions;
+  const vtkIdType numberOfVoxels = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  try
+    {
+    this->Mask.resize(numberOfVoxels);
+    }
+  catch (const std::bad_alloc&)
+    {
+    this->ReleaseBuffers();
+    return;
+    }
+  switch (scalars->GetDataType())
+    {
+    vtkTemplateMacro(vtkSlicerDataProbeCopyLabelMask(
+      static_cast<VTK_TT*>(scalars->GetVoidPointer(0)), scalars->GetNumberOfComponents(),
+      numberOfVoxels, label, &this->Mask[0]));
+    }
+  if (numberOfThreads <= 0)
+    {
+    numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+    }
+  this->NumberOfThreads = std::min(numberOfThreads, VTK_MAX_THREADS);
+  this->AbortRequested = false;
+  this->Finished = false;
+  this->Succeeded = false;
+  this->ThreadId = this->Threader->SpawnThread(vtkInternal::Compute, this);
+  if (this->ThreadId < 0)
+    {
+    this->ReleaseBuffers();
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeDistanceMap::vtkInternal::Collect(int maximumNumberOfMaps)
+{
+  if (this->ThreadId < 0)
+    {
+    return;
+    }
+  this->Lock->Lock();
+  bool finished = this->Finished;
+  this->Lock->Unlock();
+  if (!finished)
+    {
+    return;
+    }
+  this->Threader->TerminateThread(this->ThreadId);
+  this->ThreadId = -1;
+  // The map of an image modified while computing is discarded
+  const MapInfo& request = this->Request;
+  if (this->Succeeded
+      && request.Matches(request.ImageData.GetPointer(), request.Label, request.Spacing))
+    {
+    this->Maps.push_front(Map());
+    this->Maps.front().Info = this->Request;
+    this->Maps.front().Distances.swap(this->Outside);
+    while (static_cast<int>(this->Maps.size()) > maximumNumberOfMaps)
+      {
+      this->Maps.pop_back();
+      }
+    }
+  this->ReleaseBuffers();
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDataProbeDistanceMap::vtkInternal::Use(
+  vtkImageData* imageData, int label, const double spacing[3])
+{
+  std::list<Map>::iterator it = this->Maps.begin();
+  while (it != this->Maps.end())
+    {
+    const MapInfo& info = it->Info;
+    if (!info.Matches(imageData, info.Label, info.Spacing))
+      {
+      it = this->Maps.erase(it);
+      continue;
+      }
+    if (info.Label == label && info.Matches(imageData, label, spacing))
+      {
+      this->Maps.splice(this->Maps.begin(), this->Maps, it);
+      return true;
+      }
+    ++it;
+    }
+  return false;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeDistanceMap::vtkInternal::Abort()
+{
+  if (this->ThreadId < 0)
+    {
+    return;
+    }
+  this->Lock->Lock();
+  this->AbortRequested = true;
+  this->Lock->Unlock();
+  this->Threader->TerminateThread(this->ThreadId);
+  this->ThreadId = -1;
+  this->ReleaseBuffers();
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDataProbeDistanceMap::vtkInternal::IsAbortRequested()
+{
+  this->Lock->Lock();
+  bool abortRequested = this->AbortRequested;
+  this->Lock->Unlock();
+  return abortRequested;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeDistanceMap::vtkInternal::ReleaseBuffers()
+{
+  std::vector<unsigned char>().swap(this->Mask);
+  std::vector<float>().swap(this->Outside);
+  std::vector<float>().swap(this->Inside);
+  this->Request = MapInfo();
+}
+
+//---------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkSlicerDataProbeDistanceMap::vtkInternal::Compute(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkInternal* self = static_cast<vtkInternal*>(threadInfo->UserData);
+  bool succeeded = self->ComputeMap();
+  self->Lock->Lock();
+  self->Succeeded = succeeded;
+  self->Finished = true;
+  self->Lock->Unlock();
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDataProbeDistanceMap::vtkInternal::ComputeMap()
+{
+  const int* dims = this->Request.Dimensions;
+  const size_t numberOfVoxels = static_cast<size_t>(dims[0]) * dims[1] * dims[2];
+  try
+    {
+    this->Outside.resize(numberOfVoxels);
+    this->Inside.resize(numberOfVoxels);
+    }
+  catch (const std::bad_alloc&)
+    {
+    return false;
+    }
+  this->ParallelFor(&vtkInternal::TransformSliceRows, dims[2]);
+  this->ParallelFor(&vtkInternal::TransformSliceColumns, dims[2]);
+  this->ParallelFor(&vtkInternal::TransformRowSlices, dims[1]);
+  return !this->IsAbortRequested();
+}
+
+//---------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkSlicerDataProbeDistanceMap::vtkInternal::ExecuteTasks(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkInternal* self = static_cast<vtkInternal*>(threadInfo->UserData);
+  for (int taskIdx = threadInfo->ThreadID; taskIdx < self->NumberOfTasks;
+       taskIdx += threadInfo->NumberOfThreads)
+    {
+    if (self->IsAbortRequested())
+      {
+      break;
+      }
+    (self->*(self->Task))(taskIdx);
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeDistanceMap::vtkInternal::ParallelFor(TaskType task, int numberOfTasks)
+{
+  if (this->IsAbortRequested())
+    {
+    return;
+    }
+  this->Task = task;
+  this->NumberOfTasks = numberOfTasks;
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(std::max(std::min(this->NumberOfThreads, numberOfTasks), 1));
+  threader->SetSingleMethod(vtkInternal::ExecuteTasks, this);
+  threader->SingleMethodExecute();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeDistanceMap::vtkInternal::TransformSliceRows(int k)
+{
+  const int* dims = this->Request.Dimensions;
+  vtkSlicerDataProbeLineBuffers buffers;
+  for (int j = 0; j < dims[1]; ++j)
+    {
+    const vtkIdType rowIdx = (static_cast<vtkIdType>(k) * dims[1] + j) * dims[0];
+    float* outside = &this->Outside[rowIdx];
+    float* inside = &this->Inside[rowIdx];
+    vtkSlicerDataProbeInitializeRow(&this->Mask[rowIdx], dims[0], outside, inside);
+    vtkSlicerDataProbeTransformColumns(outside, 1, dims[0], 1, this->Request.Spacing[0], buffers);
+    vtkSlicerDataProbeTransformColumns(inside, 1, dims[0], 1, this->Request.Spacing[0], buffers);
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeDistanceMap::vtkInternal::TransformSliceColumns(int k)
+{
+  const int* dims = this->Request.Dimensions;
+  const vtkIdType sliceIdx = static_cast<vtkIdType>(k) * dims[0] * dims[1];
+  vtkSlicerDataProbeLineBuffers buffers;
+  vtkSlicerDataProbeTransformColumns(&this->Outside[sliceIdx], dims[0], dims[1], dims[0],
+                                     this->Request.Spacing[1], buffers);
+  vtkSlicerDataProbeTransformColumns(&this->Inside[sliceIdx], dims[0], dims[1], dims[0],
+                                     this->Request.Spacing[1], buffers);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeDistanceMap::vtkInternal::TransformRowSlices(int j)
+{
+  const int* dims = this->Request.Dimensions;
+  const vtkIdType sliceSize = static_cast<vtkIdType>(dims[0]) * dims[1];
+  const vtkIdType rowIdx = static_cast<vtkIdType>(j) * dims[0];
+  vtkSlicerDataProbeLineBuffers buffers;
+  vtkSlicerDataProbeTransformColumns(&this->Outside[rowIdx], sliceSize, dims[2], dims[0],
+                                     this->Request.Spacing[2], buffers);
+  vtkSlicerDataProbeTransformColumns(&this->Inside[rowIdx], sliceSize, dims[2], dims[0],
+                                     this->Request.Spacing[2], buffers);
+  // The squared distances of the row are final, combine them into the
+  // signed distances (stored in place of the distances to the label).
+  for (int k = 0; k < dims[2]; ++k)
+    {
+    float* outside = &this->Outside[k * sliceSize + rowIdx];
+    const float* inside = &this->Inside[k * sliceSize + rowIdx];
+    for (int i = 0; i < dims[0]; ++i)
+      {
+      if (outside[i] >= vtkSlicerDataProbeInfiniteDistance)
+        {
+        continue;
+        }
+      if (outside[i] > 0.f)
+        {
+        outside[i] = std::sqrt(outside[i]);
+        }
+      else
+        {
+        outside[i] = inside[i] >= vtkSlicerDataProbeInfiniteDistance ?
+          -vtkSlicerDataProbeInfiniteDistance : -std::sqrt(inside[i]);
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// vtkSlicerDataProbeDistanceMap methods
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerDataProbeDistanceMap);
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeDistanceMap::vtkSlicerDataProbeDistanceMap()
+{
+  this->NumberOfThreads = 0;
+  this->MaximumNumberOfMaps = 4;
+  this->Internal = new vtkInternal;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeDistanceMap::~vtkSlicerDataProbeDistanceMap()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeDistanceMap::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "MaximumNumberOfMaps: " << this->MaximumNumberOfMaps << "\n";
+  os << indent << "NumberOfMaps: " << this->Internal->Maps.size() << "\n";
+  os << indent << "Label: " << this->GetLabel() << "\n";
+  os << indent << "Computing: " << this->IsComputing() << "\n";
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeDistanceMap::Update(vtkImageData* imageData, int label, const double spacing[3])
+{
+  this->Internal->Collect(this->MaximumNumberOfMaps);
+  if (this->Internal->Use(imageData, label, spacing))
+    {
+    return true;
+    }
+  vtkDataArray* scalars = imageData ? imageData->GetPointData()->GetScalars() : 0;
+  if (!scalars || scalars->GetNumberOfTuples() == 0)
+    {
+    this->Reset();
+    return false;
+    }
+  if (this->Internal->ThreadId >= 0 && this->Internal->Request.Matches(imageData, label, spacing))
+    {
+    return false;
+    }
+  this->Internal->Start(imageData, label, spacing, this->NumberOfThreads);
+  return false;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeDistanceMap::IsUpToDate(vtkImageData* imageData, int label,
+                                               const double spacing[3])const
+{
+  return !this->Internal->Maps.empty()
+    && this->Internal->Maps.front().Info.Matches(imageData, label, spacing);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeDistanceMap::IsComputing()const
+{
+  return this->Internal->ThreadId >= 0;
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkSlicerDataProbeDistanceMap::GetImageData()const
+{
+  if (this->IsComputing())
+    {
+    return this->Internal->Request.ImageData.GetPointer();
+    }
+  return this->Internal->Maps.empty() ? 0 : this->Internal->Maps.front().Info.ImageData.GetPointer();
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDataProbeDistanceMap::GetLabel()const
+{
+  return this->Internal->Maps.empty() ? 0 : this->Internal->Maps.front().Info.Label;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDataProbeDistanceMap::GetDistance(int i, int j, int k)const
+{
+  if (this->Internal->Maps.empty())
+    {
+    return vtkMath::Nan();
+    }
+  const vtkInternal::Map& map = this->Internal->Maps.front();
+  const int* dims = map.Info.Dimensions;
+  if (i < 0 || i >= dims[0] || j < 0 || j >= dims[1] || k < 0 || k >= dims[2])
+    {
+    return vtkMath::Nan();
+    }
+  const float distance =
+    map.Distances[(static_cast<vtkIdType>(k) * dims[1] + j) * dims[0] + i];
+  return std::abs(distance) >= vtkSlicerDataProbeInfiniteDistance ? vtkMath::Nan() : distance;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeDistanceMap::Reset()
+{
+  this->Internal->Abort();
+  this->Internal->Maps.clear();
+}
@@ -0,0 +1,109 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerDataProbeDistanceMap_h
+#define __vtkSlicerDataProbeDistanceMap_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkSlicerDataProbeModuleLogicExport.h"
+
+class vtkImageData;
+
+/// \ingroup Slicer_QtModules_DataProbe
+/// Signed Euclidean distance, in millimeters, from each voxel of a label map
+/// to the boundary of one of its labels.
+///
+/// The distance is negative inside the label and is measured between voxel
+/// centers: a voxel inside the label is at minus the distance to the closest
+/// voxel outside of the label, and conversely.
+///
+/// The exact transform is computed in linear time by separable lower
+/// envelopes of parabolas (Felzenszwalb and Huttenlocher), one pass per axis,
+/// the lines of each pass being processed in parallel. The computation runs
+/// in a background thread started by Update(): the map can be read once
+/// Update() returns true. The label is copied into a mask before starting,
+/// the image may be modified while computing; the map is then discarded.
+/// The distances are stored as floats; two float volumes are used while
+/// computing. The maps of the last used labels of the image are kept.
+/// \sa vtkSlicerDataProbeLogic::ProbeBoundaryDistance
+class VTK_SLICER_DATAPROBE_MODULE_LOGIC_EXPORT vtkSlicerDataProbeDistanceMap :
+  public vtkObject
+{
+public:
+  static vtkSlicerDataProbeDistanceMap *New();
+  vtkTypeMacro(vtkSlicerDataProbeDistanceMap,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Number of threads used to process the lines of each pass, 0 to use the
+  /// default number of threads of vtkMultiThreader.
+  /// Default is 0.
+  vtkSetClampMacro(NumberOfThreads, int, 0, VTK_INT_MAX);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Maximum number of computed maps kept, the least recently used map is
+  /// released first.
+  /// Default is 4.
+  vtkSetClampMacro(MaximumNumberOfMaps, int, 1, VTK_INT_MAX);
+  vtkGetMacro(MaximumNumberOfMaps, int);
+
+  /// Return true if the map of \a label in \a imageData, with the voxel
+  /// \a spacing, has been computed and make it the available map.
+  /// Otherwise start computing it in the background, aborting any other
+  /// computation, and return false.
+  /// Must be called from the thread that reads the map.
+  bool Update(vtkImageData* imageData, int label, const double spacing[3]);
+
+  /// Return true if the map has been computed for \a label from the current
+  /// scalars of \a imageData with the voxel \a spacing.
+  bool IsUpToDate(vtkImageData* imageData, int label, const double spacing[3])const;
+
+  /// Return true if a map is being computed in the background.
+  bool IsComputing()const;
+
+  /// Return the image the map has been computed from, or is being computed
+  /// from, if it still exists.
+  vtkImageData* GetImageData()const;
+
+  /// Return the label of the available map.
+  int GetLabel()const;
+
+  /// Return the signed distance of the voxel (\a i, \a j, \a k) of the
+  /// available map, vtkMath::Nan() if the voxel is out of the image or if
+  /// the label has no voxel.
+  double GetDistance(int i, int j, int k)const;
+
+  /// Abort the computation, if any, and release the map.
+  void Reset();
+
+protected:
+  vtkSlicerDataProbeDistanceMap();
+  virtual ~vtkSlicerDataProbeDistanceMap();
+
+  int NumberOfThreads;
+  int MaximumNumberOfMaps;
+
+private:
+  vtkSlicerDataProbeDistanceMap(const vtkSlicerDataProbeDistanceMap&); // Not implemented
+  void operator=(const vtkSlicerDataProbeDistanceMap&);                // Not implemented
+
+  class vtkInternal;
+  vtkInternal * Internal;
+};
+
+#endif
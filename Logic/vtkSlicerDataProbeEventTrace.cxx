@@ -0,0 +1,437 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeEventTrace.h"
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLSliceNode.h>
+#include <vtkMRMLTransformNode.h>
+#include <vtkMRMLVolumeNode.h>
+
+// VTK includes
+#include <vtkCollection.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const char vtkSlicerDataProbeEventTraceMagic[4] = {'D', 'P', 'T', 'R'};
+const unsigned int vtkSlicerDataProbeEventTraceVersion = 1;
+
+//----------------------------------------------------------------------------
+/// FNV-1a hash of \a size bytes of \a data, continued from \a hash.
+unsigned int vtkSlicerDataProbeHashBytes(unsigned int hash, const void* data, size_t size)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t byteIdx = 0; byteIdx < size; ++byteIdx)
+    {
+    hash ^= bytes[byteIdx];
+    hash *= 16777619u;
+    }
+  return hash;
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkSlicerDataProbeHashString(unsigned int hash, const char* text)
+{
+  // Include the terminating null so that "ab","c" and "a","bc" differ.
+  return text ? vtkSlicerDataProbeHashBytes(hash, text, strlen(text) + 1)
+              : vtkSlicerDataProbeHashBytes(hash, "", 1);
+}
+
+//----------------------------------------------------------------------------
+/// Write the \a size low bytes of \a value, least significant first.
+void vtkSlicerDataProbeWriteInteger(std::ostream& stream, unsigned int value, int size)
+{
+  for (int byteIdx = 0; byteIdx < size; ++byteIdx)
+    {
+    stream.put(static_cast<char>((value >> (8 * byteIdx)) & 0xff));
+    }
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeReadInteger(std::istream& stream, unsigned int& value, int size)
+{
+  unsigned char bytes[4];
+  if (!stream.read(reinterpret_cast<char*>(bytes), size))
+    {
+    return false;
+    }
+  value = 0;
+  for (int byteIdx = 0; byteIdx < size; ++byteIdx)
+    {
+    value |= static_cast<unsigned int>(bytes[byteIdx]) << (8 * byteIdx);
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+class vtkSlicerDataProbeEventTrace::vtkInternal
+{
+public:
+  struct Event
+  {
+    unsigned short View;
+    unsigned char Type;
+    short Position[2];
+    /// Microseconds since the previous event, as written in the file.
+    unsigned int Delay;
+    unsigned short Fingerprint;
+    /// Microseconds since the first event.
+    double Time;
+  };
+
+  /// Return the index of \a value in \a table, appending it if needed.
+  template <class T>
+  static unsigned short GetIndex(std::vector<T>& table, const T& value);
+
+  std::vector<std::string> ViewNames;
+  std::vector<unsigned int> Fingerprints;
+  std::vector<Event> Events;
+  double LastTime;
+};
+
+//----------------------------------------------------------------------------
+template <class T>
+unsigned short vtkSlicerDataProbeEventTrace::vtkInternal::GetIndex(std::vector<T>& table, const T& value)
+{
+  // The tables are tiny: a few views and a fingerprint per scene change.
+  typename std::vector<T>::iterator it = std::find(table.begin(), table.end(), value);
+  if (it != table.end())
+    {
+    return static_cast<unsigned short>(it - table.begin());
+    }
+  table.push_back(value);
+  return static_cast<unsigned short>(table.size() - 1);
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerDataProbeEventTrace);
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeEventTrace::vtkSlicerDataProbeEventTrace()
+{
+  this->Internal = new vtkInternal;
+  this->Internal->LastTime = 0.0;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeEventTrace::~vtkSlicerDataProbeEventTrace()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeEventTrace::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfEvents: " << this->GetNumberOfEvents() << "\n";
+  os << indent << "NumberOfViews: " << this->Internal->ViewNames.size() << "\n";
+  os << indent << "NumberOfFingerprints: " << this->Internal->Fingerprints.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeEventTrace::Reset()
+{
+  this->Internal->ViewNames.clear();
+  this->Internal->Fingerprints.clear();
+  this->Internal->Events.clear();
+  this->Internal->LastTime = 0.0;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeEventTrace::AddEvent(const char* viewName, int eventType, const int xy[2],
+                                            double time, unsigned int sceneFingerprint)
+{
+  if (eventType < EnterEvent || eventType > LeaveEvent)
+    {
+    vtkErrorMacro(<< "AddEvent: invalid event type " << eventType);
+    return;
+    }
+  if (this->Internal->ViewNames.size() >= VTK_UNSIGNED_SHORT_MAX ||
+      this->Internal->Fingerprints.size() >= VTK_UNSIGNED_SHORT_MAX)
+    {
+    vtkErrorMacro(<< "AddEvent: too many views or scene states, event ignored");
+    return;
+    }
+  vtkInternal::Event event;
+  event.View = vtkInternal::GetIndex(this->Internal->ViewNames, std::string(viewName ? viewName : ""));
+  event.Type = static_cast<unsigned char>(eventType);
+  for (int axis = 0; axis < 2; ++axis)
+    {
+    event.Position[axis] = static_cast<short>(
+      std::min(std::max(xy[axis], static_cast<int>(VTK_SHORT_MIN)), static_cast<int>(VTK_SHORT_MAX)));
+    }
+  double delay = this->Internal->Events.empty() ? 0.0 : (time - this->Internal->LastTime) * 1e6;
+  event.Delay = static_cast<unsigned int>(
+    vtkMath::Round(std::min(std::max(delay, 0.0), static_cast<double>(VTK_UNSIGNED_INT_MAX))));
+  event.Time = this->Internal->Events.empty() ? 0.0 : this->Internal->Events.back().Time + event.Delay;
+  event.Fingerprint = vtkInternal::GetIndex(this->Internal->Fingerprints, sceneFingerprint);
+  this->Internal->Events.push_back(event);
+  this->Internal->LastTime = time;
+  // No Modified(): events are added on every mouse move.
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeEventTrace::GetNumberOfEvents()const
+{
+  return static_cast<vtkIdType>(this->Internal->Events.size());
+}
+
+//----------------------------------------------------------------------------
+const char* vtkSlicerDataProbeEventTrace::GetEventViewName(vtkIdType eventIdx)const
+{
+  if (eventIdx < 0 || eventIdx >= this->GetNumberOfEvents())
+    {
+    return 0;
+    }
+  return this->Internal->ViewNames[this->Internal->Events[eventIdx].View].c_str();
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDataProbeEventTrace::GetEventType(vtkIdType eventIdx)const
+{
+  if (eventIdx < 0 || eventIdx >= this->GetNumberOfEvents())
+    {
+    return -1;
+    }
+  return this->Internal->Events[eventIdx].Type;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeEventTrace::GetEventPosition(vtkIdType eventIdx, int xy[2])const
+{
+  if (eventIdx < 0 || eventIdx >= this->GetNumberOfEvents())
+    {
+    xy[0] = xy[1] = 0;
+    return;
+    }
+  xy[0] = this->Internal->Events[eventIdx].Position[0];
+  xy[1] = this->Internal->Events[eventIdx].Position[1];
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDataProbeEventTrace::GetEventTime(vtkIdType eventIdx)const
+{
+  if (eventIdx < 0 || eventIdx >= this->GetNumberOfEvents())
+    {
+    return 0.0;
+    }
+  return this->Internal->Events[eventIdx].Time * 1e-6;
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkSlicerDataProbeEventTrace::GetEventSceneFingerprint(vtkIdType eventIdx)const
+{
+  if (eventIdx < 0 || eventIdx >= this->GetNumberOfEvents())
+    {
+    return 0;
+    }
+  return this->Internal->Fingerprints[this->Internal->Events[eventIdx].Fingerprint];
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeEventTrace::Write(const char* fileName)const
+{
+  std::ofstream stream(fileName ? fileName : "", std::ios::out | std::ios::binary);
+  if (!stream)
+    {
+    vtkErrorMacro(<< "Write: can't open " << (fileName ? fileName : "(null)"));
+    return false;
+    }
+  stream.write(vtkSlicerDataProbeEventTraceMagic, sizeof(vtkSlicerDataProbeEventTraceMagic));
+  vtkSlicerDataProbeWriteInteger(stream, vtkSlicerDataProbeEventTraceVersion, 4);
+
+  vtkSlicerDataProbeWriteInteger(stream, static_cast<unsigned int>(this->Internal->ViewNames.size()), 4);
+  for (std::vector<std::string>::const_iterator it = this->Internal->ViewNames.begin();
+       it != this->Internal->ViewNames.end(); ++it)
+    {
+    size_t length = std::min(it->size(), static_cast<size_t>(VTK_UNSIGNED_SHORT_MAX));
+    vtkSlicerDataProbeWriteInteger(stream, static_cast<unsigned int>(length), 2);
+    stream.write(it->data(), length);
+    }
+
+  vtkSlicerDataProbeWriteInteger(stream, static_cast<unsigned int>(this->Internal->Fingerprints.size()), 4);
+  for (std::vector<unsigned int>::const_iterator it = this->Internal->Fingerprints.begin();
+       it != this->Internal->Fingerprints.end(); ++it)
+    {
+    vtkSlicerDataProbeWriteInteger(stream, *it, 4);
+    }
+
+  vtkSlicerDataProbeWriteInteger(stream, static_cast<unsigned int>(this->Internal->Events.size()), 4);
+  for (std::vector<vtkInternal::Event>::const_iterator it = this->Internal->Events.begin();
+       it != this->Internal->Events.end(); ++it)
+    {
+    vtkSlicerDataProbeWriteInteger(stream, it->View, 2);
+    vtkSlicerDataProbeWriteInteger(stream, it->Type, 1);
+    vtkSlicerDataProbeWriteInteger(stream, static_cast<unsigned short>(it->Position[0]), 2);
+    vtkSlicerDataProbeWriteInteger(stream, static_cast<unsigned short>(it->Position[1]), 2);
+    vtkSlicerDataProbeWriteInteger(stream, it->Delay, 4);
+    vtkSlicerDataProbeWriteInteger(stream, it->Fingerprint, 2);
+    }
+  if (!stream)
+    {
+    vtkErrorMacro(<< "Write: failed to write " << fileName);
+    return false;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeEventTrace::Read(const char* fileName)
+{
+  std::ifstream stream(fileName ? fileName : "", std::ios::in | std::ios::binary);
+  if (!stream)
+    {
+    vtkErrorMacro(<< "Read: can't open " << (fileName ? fileName : "(null)"));
+    return false;
+    }
+  char magic[sizeof(vtkSlicerDataProbeEventTraceMagic)];
+  unsigned int version = 0;
+  if (!stream.read(magic, sizeof(magic)) ||
+      memcmp(magic, vtkSlicerDataProbeEventTraceMagic, sizeof(magic)) != 0 ||
+      !vtkSlicerDataProbeReadInteger(stream, version, 4) ||
+      version != vtkSlicerDataProbeEventTraceVersion)
+    {
+    vtkErrorMacro(<< "Read: " << fileName << " is not a data probe event trace");
+    return false;
+    }
+
+  vtkInternal loaded;
+  loaded.LastTime = 0.0;
+  unsigned int count = 0;
+  bool ok = vtkSlicerDataProbeReadInteger(stream, count, 4) && count <= VTK_UNSIGNED_SHORT_MAX;
+  for (unsigned int viewIdx = 0; ok && viewIdx < count; ++viewIdx)
+    {
+    unsigned int length = 0;
+    ok = vtkSlicerDataProbeReadInteger(stream, length, 2);
+    std::string viewName(length, '\0');
+    ok = ok && (length == 0 || stream.read(&viewName[0], length));
+    loaded.ViewNames.push_back(viewName);
+    }
+  ok = ok && vtkSlicerDataProbeReadInteger(stream, count, 4) && count <= VTK_UNSIGNED_SHORT_MAX;
+  for (unsigned int fingerprintIdx = 0; ok && fingerprintIdx < count; ++fingerprintIdx)
+    {
+    unsigned int fingerprint = 0;
+    ok = vtkSlicerDataProbeReadInteger(stream, fingerprint, 4);
+    loaded.Fingerprints.push_back(fingerprint);
+    }
+  ok = ok && vtkSlicerDataProbeReadInteger(stream, count, 4);
+  double time = 0.0;
+  for (unsigned int eventIdx = 0; ok && eventIdx < count; ++eventIdx)
+    {
+    unsigned int view = 0, type = 0, x = 0, y = 0, delay = 0, fingerprint = 0;
+    ok = vtkSlicerDataProbeReadInteger(stream, view, 2) &&
+         vtkSlicerDataProbeReadInteger(stream, type, 1) &&
+         vtkSlicerDataProbeReadInteger(stream, x, 2) &&
+         vtkSlicerDataProbeReadInteger(stream, y, 2) &&
+         vtkSlicerDataProbeReadInteger(stream, delay, 4) &&
+         vtkSlicerDataProbeReadInteger(stream, fingerprint, 2) &&
+         view < loaded.ViewNames.size() && type <= LeaveEvent &&
+         fingerprint < loaded.Fingerprints.size();
+    if (!ok)
+      {
+      break;
+      }
+    vtkInternal::Event event;
+    event.View = static_cast<unsigned short>(view);
+    event.Type = static_cast<unsigned char>(type);
+    event.Position[0] = static_cast<short>(static_cast<unsigned short>(x));
+    event.Position[1] = static_cast<short>(static_cast<unsigned short>(y));
+    event.Delay = eventIdx == 0 ? 0 : delay;
+    time += event.Delay;
+    event.Time = time;
+    event.Fingerprint = static_cast<unsigned short>(fingerprint);
+    loaded.Events.push_back(event);
+    }
+  if (!ok)
+    {
+    vtkErrorMacro(<< "Read: " << fileName << " is truncated or corrupted");
+    return false;
+    }
+  *this->Internal = loaded;
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkSlicerDataProbeEventTrace::ComputeSceneFingerprint(vtkMRMLScene* scene)
+{
+  unsigned int hash = 2166136261u;
+  if (!scene)
+    {
+    return hash;
+    }
+  vtkSmartPointer<vtkCollection> volumeNodes;
+  volumeNodes.TakeReference(scene->GetNodesByClass("vtkMRMLVolumeNode"));
+  for (int nodeIdx = 0; nodeIdx < volumeNodes->GetNumberOfItems(); ++nodeIdx)
+    {
+    vtkMRMLVolumeNode* volumeNode = vtkMRMLVolumeNode::SafeDownCast(volumeNodes->GetItemAsObject(nodeIdx));
+    if (!volumeNode)
+      {
+      continue;
+      }
+    // Node IDs and modification times differ from one session to the other,
+    // only hash what the probe depends on.
+    hash = vtkSlicerDataProbeHashString(hash, volumeNode->GetClassName());
+    hash = vtkSlicerDataProbeHashString(hash, volumeNode->GetName());
+    hash = vtkSlicerDataProbeHashBytes(hash, volumeNode->GetSpacing(), 3 * sizeof(double));
+    hash = vtkSlicerDataProbeHashBytes(hash, volumeNode->GetOrigin(), 3 * sizeof(double));
+    int transformed = volumeNode->GetParentTransformNode() != 0;
+    hash = vtkSlicerDataProbeHashBytes(hash, &transformed, sizeof(transformed));
+    vtkImageData* imageData = volumeNode->GetImageData();
+    if (imageData)
+      {
+      int layout[5];
+      imageData->GetDimensions(layout);
+      layout[3] = imageData->GetScalarType();
+      layout[4] = imageData->GetNumberOfScalarComponents();
+      hash = vtkSlicerDataProbeHashBytes(hash, layout, sizeof(layout));
+      }
+    }
+  // The same device position probes another voxel once a slice is moved,
+  // rotated or zoomed.
+  vtkSmartPointer<vtkCollection> sliceNodes;
+  sliceNodes.TakeReference(scene->GetNodesByClass("vtkMRMLSliceNode"));
+  for (int nodeIdx = 0; nodeIdx < sliceNodes->GetNumberOfItems(); ++nodeIdx)
+    {
+    vtkMRMLSliceNode* sliceNode = vtkMRMLSliceNode::SafeDownCast(sliceNodes->GetItemAsObject(nodeIdx));
+    if (!sliceNode || !sliceNode->GetXYToRAS())
+      {
+      continue;
+      }
+    hash = vtkSlicerDataProbeHashString(hash, sliceNode->GetLayoutName());
+    hash = vtkSlicerDataProbeHashBytes(hash, sliceNode->GetXYToRAS()->Element, 16 * sizeof(double));
+    }
+  return hash;
+}
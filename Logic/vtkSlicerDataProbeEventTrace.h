@@ -0,0 +1,96 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerDataProbeEventTrace_h
+#define __vtkSlicerDataProbeEventTrace_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkSlicerDataProbeModuleLogicExport.h"
+
+class vtkMRMLScene;
+
+/// \ingroup Slicer_QtModules_DataProbe
+/// Stream of the mouse events probed in the views, to replay a probing
+/// session offline.
+///
+/// Each event holds the name of the view, the event type, the device XY
+/// position, the time since the first event and a fingerprint of the scene
+/// state, see ComputeSceneFingerprint().
+///
+/// The trace is written in a compact binary format: the view names and the
+/// fingerprints are stored once in tables, followed by 13 bytes per event
+/// (view index, type, X and Y as 16-bit integers, microseconds since the
+/// previous event, fingerprint index), all little-endian.
+/// \sa qSlicerDataProbeInfoWidget::replayEventTrace
+class VTK_SLICER_DATAPROBE_MODULE_LOGIC_EXPORT vtkSlicerDataProbeEventTrace :
+  public vtkObject
+{
+public:
+  static vtkSlicerDataProbeEventTrace *New();
+  vtkTypeMacro(vtkSlicerDataProbeEventTrace,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  enum EventTypes
+    {
+    EnterEvent = 0,
+    MouseMoveEvent,
+    LeaveEvent
+    };
+
+  /// Remove all the events.
+  void Reset();
+
+  /// Append an event of \a eventType at the device position \a xy of the
+  /// view \a viewName. \a time is in seconds, only the difference with the
+  /// time of the previous event is kept.
+  void AddEvent(const char* viewName, int eventType, const int xy[2], double time,
+                unsigned int sceneFingerprint);
+
+  vtkIdType GetNumberOfEvents()const;
+  const char* GetEventViewName(vtkIdType eventIdx)const;
+  int GetEventType(vtkIdType eventIdx)const;
+  void GetEventPosition(vtkIdType eventIdx, int xy[2])const;
+  /// Return the time of the event, in seconds since the first event.
+  double GetEventTime(vtkIdType eventIdx)const;
+  unsigned int GetEventSceneFingerprint(vtkIdType eventIdx)const;
+
+  /// Write the trace into, or read it from, the binary file \a fileName.
+  /// Return false on error.
+  bool Write(const char* fileName)const;
+  bool Read(const char* fileName);
+
+  /// Return a hash of the volumes of \a scene: names, classes, geometry,
+  /// scalar types and whether they are transformed, and of the XYToRAS
+  /// matrix of each slice node. It tells whether a trace is replayed on the
+  /// scene and slice geometry it was recorded from.
+  static unsigned int ComputeSceneFingerprint(vtkMRMLScene* scene);
+
+protected:
+  vtkSlicerDataProbeEventTrace();
+  virtual ~vtkSlicerDataProbeEventTrace();
+
+private:
+  vtkSlicerDataProbeEventTrace(const vtkSlicerDataProbeEventTrace&); // Not implemented
+  void operator=(const vtkSlicerDataProbeEventTrace&);               // Not implemented
+
+  class vtkInternal;
+  vtkInternal * Internal;
+};
+
+#endif
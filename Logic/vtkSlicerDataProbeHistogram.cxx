@@ -0,0 +1,609 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeHistogram.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMultiThreader.h>
+#include <vtkMutexLock.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Range of the finite values of the tuples [first, last) of \a scalars.
+template <class T>
+void vtkSlicerDataProbeComputeRange(const T* scalars, int numberOfComponents,
+                                    vtkIdType first, vtkIdType last, double range[2])
+{
+  for (vtkIdType tupleIdx = first; tupleIdx < last; ++tupleIdx)
+    {
+    const double value = static_cast<double>(scalars[tupleIdx * numberOfComponents]);
+    // Skip NaN and infinite values
+    if (!(std::abs(value) <= VTK_DOUBLE_MAX))
+      {
+      continue;
+      }
+    if (value < range[0])
+      {
+      range[0] = value;
+      }
+    if (value > range[1])
+      {
+      range[1] = value;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+/// Count the values of the tuples [first, last) of \a scalars into the
+/// \a numberOfBins bins of \a counts, the bin b covering
+/// [origin + b * binWidth, origin + (b + 1) * binWidth). Values out of the
+/// bins, e.g. infinite values, are counted in the first or last bin.
+template <class T>
+void vtkSlicerDataProbeFillHistogram(const T* scalars, int numberOfComponents,
+                                     vtkIdType first, vtkIdType last,
+                                     double origin, double binWidth, int numberOfBins,
+                                     vtkIdType* counts)
+{
+  const double scale = 1. / binWidth;
+  for (vtkIdType tupleIdx = first; tupleIdx < last; ++tupleIdx)
+    {
+    const double value = static_cast<double>(scalars[tupleIdx * numberOfComponents]);
+    if (vtkMath::IsNan(value))
+      {
+      continue;
+      }
+    // Clamp before converting, infinite values do not fit in an int
+    const double bin = std::min(std::max((value - origin) * scale, 0.), numberOfBins - 1.);
+    ++counts[static_cast<int>(bin)];
+    }
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+class vtkSlicerDataProbeHistogram::vtkInternal
+{
+public:
+  vtkInternal();
+  ~vtkInternal();
+
+  /// Description of a histogram, computed or requested.
+  struct HistogramInfo
+  {
+    HistogramInfo();
+    void Set(vtkImageData* imageData, int numberOfBins);
+    bool Matches(vtkImageData* imageData)const;
+
+    vtkWeakPointer<vtkImageData> ImageData;
+    void* Scalars;
+    unsigned long ScalarsMTime;
+    int NumberOfBins;
+  };
+
+  /// Start computing the requested histogram in the background.
+  void Start(vtkImageData* imageData, int numberOfBins, int numberOfThreads);
+
+  /// If the background computation is over, wait for its thread and make
+  /// its histogram available.
+  void Collect();
+
+  /// Abort the background computation, if any, and wait for its thread.
+  void Abort();
+
+  bool IsAbortRequested();
+  void ReleaseRequest();
+
+  // Background computation
+  static VTK_THREAD_RETURN_TYPE Compute(void* arg);
+  bool ComputeHistogram();
+  static VTK_THREAD_RETURN_TYPE ComputeChunkRange(void* arg);
+  static VTK_THREAD_RETURN_TYPE FillChunkHistogram(void* arg);
+  void GetChunk(int chunkIdx, int numberOfChunks, vtkIdType& first, vtkIdType& last)const;
+
+  // Available histogram
+  HistogramInfo Histogram;
+  double Origin;
+  double BinWidth;
+  double Range[2];
+  std::vector<vtkIdType> Counts;
+  std::vector<vtkIdType> CumulativeCounts;
+
+  // Requested histogram, shared with the background thread
+  HistogramInfo Request;
+  vtkSmartPointer<vtkDataArray> RequestScalars;
+  int NumberOfThreads;
+  double RequestOrigin;
+  double RequestBinWidth;
+  int RequestNumberOfBins;
+  std::vector<double> ChunkRanges;
+  std::vector<vtkIdType> ChunkCounts;
+  std::vector<vtkIdType> RequestCounts;
+
+  vtkMultiThreader* Threader;
+  int ThreadId;
+  vtkMutexLock* Lock;
+  bool AbortRequested;
+  bool Finished;
+  bool Succeeded;
+};
+
+//---------------------------------------------------------------------------
+// vtkInternal methods
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeHistogram::vtkInternal::HistogramInfo::HistogramInfo()
+{
+  this->Scalars = 0;
+  this->ScalarsMTime = 0;
+  this->NumberOfBins = 0;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeHistogram::vtkInternal::HistogramInfo::Set(
+  vtkImageData* imageData, int numberOfBins)
+{
+  vtkDataArray* scalars = imageData->GetPointData()->GetScalars();
+  this->ImageData = imageData;
+  this->Scalars = scalars->GetVoidPointer(0);
+  this->ScalarsMTime = std::max(scalars->GetMTime(), imageData->GetMTime());
+  this->NumberOfBins = numberOfBins;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDataProbeHistogram::vtkInternal::HistogramInfo::Matches(vtkImageData* imageData)const
+{
+  if (!imageData || imageData != this->ImageData.GetPointer())
+    {
+    return false;
+    }
+  vtkDataArray* scalars = imageData->GetPointData()->GetScalars();
+  return scalars
+    && scalars->GetVoidPointer(0) == this->Scalars
+    && std::max(scalars->GetMTime(), imageData->GetMTime()) == this->ScalarsMTime;
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeHistogram::vtkInternal::vtkInternal()
+{
+  this->Origin = 0.;
+  this->BinWidth = 1.;
+  this->Range[0] = vtkMath::Nan();
+  this->Range[1] = vtkMath::Nan();
+  this->NumberOfThreads = 1;
+  this->RequestOrigin = 0.;
+  this->RequestBinWidth = 1.;
+  this->RequestNumberOfBins = 0;
+  this->Threader = vtkMultiThreader::New();
+  this->ThreadId = -1;
+  this->Lock = vtkMutexLock::New();
+  this->AbortRequested = false;
+  this->Finished = false;
+  this->Succeeded = false;
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeHistogram::vtkInternal::~vtkInternal()
+{
+  this->Abort();
+  this->Threader->Delete();
+  this->Lock->Delete();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeHistogram::vtkInternal::Start(
+  vtkImageData* imageData, int numberOfBins, int numberOfThreads)
+{
+  this->Abort();
+  this->Request.Set(imageData, numberOfBins);
+  this->RequestScalars = imageData->GetPointData()->GetScalars();
+  if (numberOfThreads <= 0)
+    {
+    numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+    }
+  this->NumberOfThreads = std::min(numberOfThreads, VTK_MAX_THREADS);
+  this->AbortRequested = false;
+  this->Finished = false;
+  this->Succeeded = false;
+  this->ThreadId = this->Threader->SpawnThread(vtkInternal::Compute, this);
+  if (this->ThreadId < 0)
+    {
+    this->ReleaseRequest();
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeHistogram::vtkInternal::Collect()
+{
+  if (this->ThreadId < 0)
+    {
+    return;
+    }
+  this->Lock->Lock();
+  bool finished = this->Finished;
+  this->Lock->Unlock();
+  if (!finished)
+    {
+    return;
+    }
+  this->Threader->TerminateThread(this->ThreadId);
+  this->ThreadId = -1;
+  if (this->Succeeded)
+    {
+    this->Histogram = this->Request;
+    this->Origin = this->RequestOrigin;
+    this->BinWidth = this->RequestBinWidth;
+    this->Counts.swap(this->RequestCounts);
+    this->CumulativeCounts.resize(this->Counts.size());
+    vtkIdType cumulativeCount = 0;
+    for (size_t binIdx = 0; binIdx < this->Counts.size(); ++binIdx)
+      {
+      cumulativeCount += this->Counts[binIdx];
+      this->CumulativeCounts[binIdx] = cumulativeCount;
+      }
+    this->Range[0] = this->ChunkRanges.empty() ? vtkMath::Nan() : this->ChunkRanges[0];
+    this->Range[1] = this->ChunkRanges.empty() ? vtkMath::Nan() : this->ChunkRanges[1];
+    }
+  this->ReleaseRequest();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeHistogram::vtkInternal::Abort()
+{
+  if (this->ThreadId < 0)
+    {
+    return;
+    }
+  this->Lock->Lock();
+  this->AbortRequested = true;
+  this->Lock->Unlock();
+  this->Threader->TerminateThread(this->ThreadId);
+  this->ThreadId = -1;
+  this->ReleaseRequest();
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDataProbeHistogram::vtkInternal::IsAbortRequested()
+{
+  this->Lock->Lock();
+  bool abortRequested = this->AbortRequested;
+  this->Lock->Unlock();
+  return abortRequested;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeHistogram::vtkInternal::ReleaseRequest()
+{
+  this->ChunkRanges.clear();
+  std::vector<vtkIdType>().swap(this->ChunkCounts);
+  std::vector<vtkIdType>().swap(this->RequestCounts);
+  this->RequestScalars = 0;
+  this->Request = HistogramInfo();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeHistogram::vtkInternal::GetChunk(
+  int chunkIdx, int numberOfChunks, vtkIdType& first, vtkIdType& last)const
+{
+  const vtkIdType numberOfTuples = this->RequestScalars->GetNumberOfTuples();
+  first = numberOfTuples * chunkIdx / numberOfChunks;
+  last = numberOfTuples * (chunkIdx + 1) / numberOfChunks;
+}
+
+//---------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkSlicerDataProbeHistogram::vtkInternal::ComputeChunkRange(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkInternal* self = static_cast<vtkInternal*>(threadInfo->UserData);
+  vtkIdType first = 0;
+  vtkIdType last = 0;
+  self->GetChunk(threadInfo->ThreadID, threadInfo->NumberOfThreads, first, last);
+  double* range = &self->ChunkRanges[2 * threadInfo->ThreadID];
+  vtkDataArray* scalars = self->RequestScalars;
+  switch (scalars->GetDataType())
+    {
+    vtkTemplateMacro(vtkSlicerDataProbeComputeRange(
+      static_cast<VTK_TT*>(scalars->GetVoidPointer(0)), scalars->GetNumberOfComponents(),
+      first, last, range));
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//---------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkSlicerDataProbeHistogram::vtkInternal::FillChunkHistogram(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkInternal* self = static_cast<vtkInternal*>(threadInfo->UserData);
+  vtkIdType first = 0;
+  vtkIdType last = 0;
+  self->GetChunk(threadInfo->ThreadID, threadInfo->NumberOfThreads, first, last);
+  vtkIdType* counts =
+    &self->ChunkCounts[static_cast<size_t>(threadInfo->ThreadID) * self->RequestNumberOfBins];
+  vtkDataArray* scalars = self->RequestScalars;
+  switch (scalars->GetDataType())
+    {
+    vtkTemplateMacro(vtkSlicerDataProbeFillHistogram(
+      static_cast<VTK_TT*>(scalars->GetVoidPointer(0)), scalars->GetNumberOfComponents(),
+      first, last, self->RequestOrigin, self->RequestBinWidth, self->RequestNumberOfBins,
+      counts));
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//---------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkSlicerDataProbeHistogram::vtkInternal::Compute(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkInternal* self = static_cast<vtkInternal*>(threadInfo->UserData);
+  bool succeeded = self->ComputeHistogram();
+  self->Lock->Lock();
+  self->Succeeded = succeeded;
+  self->Finished = true;
+  self->Lock->Unlock();
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDataProbeHistogram::vtkInternal::ComputeHistogram()
+{
+  const vtkIdType numberOfTuples = this->RequestScalars->GetNumberOfTuples();
+  const int numberOfChunks = static_cast<int>(
+    std::max(std::min(static_cast<vtkIdType>(this->NumberOfThreads), numberOfTuples),
+             static_cast<vtkIdType>(1)));
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(numberOfChunks);
+
+  // Range of the finite values
+  this->ChunkRanges.resize(2 * numberOfChunks);
+  for (int chunkIdx = 0; chunkIdx < numberOfChunks; ++chunkIdx)
+    {
+    this->ChunkRanges[2 * chunkIdx] = VTK_DOUBLE_MAX;
+    this->ChunkRanges[2 * chunkIdx + 1] = -VTK_DOUBLE_MAX;
+    }
+  threader->SetSingleMethod(vtkInternal::ComputeChunkRange, this);
+  threader->SingleMethodExecute();
+  double range[2] = {VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX};
+  for (int chunkIdx = 0; chunkIdx < numberOfChunks; ++chunkIdx)
+    {
+    range[0] = std::min(range[0], this->ChunkRanges[2 * chunkIdx]);
+    range[1] = std::max(range[1], this->ChunkRanges[2 * chunkIdx + 1]);
+    }
+  this->ChunkRanges.resize(2);
+  this->ChunkRanges[0] = range[0];
+  this->ChunkRanges[1] = range[1];
+  if (range[0] > range[1])
+    {
+    // No value to count
+    this->ChunkRanges.clear();
+    this->RequestNumberOfBins = 1;
+    this->RequestCounts.assign(1, 0);
+    return !this->IsAbortRequested();
+    }
+  if (this->IsAbortRequested())
+    {
+    return false;
+    }
+
+  // Bins, one per value for integers when possible
+  const int dataType = this->RequestScalars->GetDataType();
+  const bool isInteger = dataType != VTK_FLOAT && dataType != VTK_DOUBLE;
+  if (isInteger && range[1] - range[0] < this->Request.NumberOfBins)
+    {
+    this->RequestNumberOfBins = static_cast<int>(range[1] - range[0]) + 1;
+    this->RequestOrigin = range[0] - 0.5;
+    this->RequestBinWidth = 1.;
+    }
+  else
+    {
+    this->RequestNumberOfBins = this->Request.NumberOfBins;
+    this->RequestOrigin = range[0];
+    this->RequestBinWidth = range[1] > range[0] ?
+      (range[1] - range[0]) / this->RequestNumberOfBins : 1.;
+    }
+
+  // Partial histograms, merged afterwards
+  this->ChunkCounts.assign(static_cast<size_t>(numberOfChunks) * this->RequestNumberOfBins, 0);
+  threader->SetSingleMethod(vtkInternal::FillChunkHistogram, this);
+  threader->SingleMethodExecute();
+  this->RequestCounts.assign(this->RequestNumberOfBins, 0);
+  for (int chunkIdx = 0; chunkIdx < numberOfChunks; ++chunkIdx)
+    {
+    const vtkIdType* chunkCounts =
+      &this->ChunkCounts[static_cast<size_t>(chunkIdx) * this->RequestNumberOfBins];
+    for (int binIdx = 0; binIdx < this->RequestNumberOfBins; ++binIdx)
+      {
+      this->RequestCounts[binIdx] += chunkCounts[binIdx];
+      }
+    }
+  std::vector<vtkIdType>().swap(this->ChunkCounts);
+  return !this->IsAbortRequested();
+}
+
+//----------------------------------------------------------------------------
+// vtkSlicerDataProbeHistogram methods
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerDataProbeHistogram);
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeHistogram::vtkSlicerDataProbeHistogram()
+{
+  this->NumberOfBins = 4096;
+  this->NumberOfThreads = 0;
+  this->Internal = new vtkInternal;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeHistogram::~vtkSlicerDataProbeHistogram()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeHistogram::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfBins: " << this->NumberOfBins << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "NumberOfVoxels: " << this->GetNumberOfVoxels() << "\n";
+  os << indent << "Computing: " << this->IsComputing() << "\n";
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeHistogram::Update(vtkImageData* imageData)
+{
+  this->Internal->Collect();
+  if (this->IsUpToDate(imageData))
+    {
+    return true;
+    }
+  vtkDataArray* scalars = imageData ? imageData->GetPointData()->GetScalars() : 0;
+  if (!scalars || scalars->GetNumberOfTuples() == 0)
+    {
+    this->Reset();
+    return false;
+    }
+  if (this->IsComputing()
+      && this->Internal->Request.Matches(imageData)
+      && this->Internal->Request.NumberOfBins == this->NumberOfBins)
+    {
+    return false;
+    }
+  this->Internal->Start(imageData, this->NumberOfBins, this->NumberOfThreads);
+  return false;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeHistogram::IsUpToDate(vtkImageData* imageData)const
+{
+  return !this->Internal->Counts.empty()
+    && this->Internal->Histogram.Matches(imageData)
+    && this->Internal->Histogram.NumberOfBins == this->NumberOfBins;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeHistogram::IsComputing()const
+{
+  return this->Internal->ThreadId >= 0;
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkSlicerDataProbeHistogram::GetImageData()const
+{
+  return this->IsComputing() ?
+    this->Internal->Request.ImageData.GetPointer() : this->Internal->Histogram.ImageData.GetPointer();
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeHistogram::GetNumberOfVoxels()const
+{
+  return this->Internal->CumulativeCounts.empty() ? 0 : this->Internal->CumulativeCounts.back();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeHistogram::GetRange(double range[2])const
+{
+  range[0] = this->Internal->Range[0];
+  range[1] = this->Internal->Range[1];
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDataProbeHistogram::GetPercentile(double value)const
+{
+  const vtkIdType numberOfVoxels = this->GetNumberOfVoxels();
+  if (numberOfVoxels == 0 || vtkMath::IsNan(value))
+    {
+    return vtkMath::Nan();
+    }
+  const double position = (value - this->Internal->Origin) / this->Internal->BinWidth;
+  if (position <= 0.)
+    {
+    return 0.;
+    }
+  if (position >= this->Internal->Counts.size())
+    {
+    return 100.;
+    }
+  const size_t binIdx = static_cast<size_t>(position);
+  const vtkIdType lowerCount = binIdx > 0 ? this->Internal->CumulativeCounts[binIdx - 1] : 0;
+  return 100. * (lowerCount + (position - binIdx) * this->Internal->Counts[binIdx]) / numberOfVoxels;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDataProbeHistogram::GetValue(double percentile)const
+{
+  const vtkIdType numberOfVoxels = this->GetNumberOfVoxels();
+  if (numberOfVoxels == 0 || vtkMath::IsNan(percentile))
+    {
+    return vtkMath::Nan();
+    }
+  const double count = std::min(std::max(percentile, 0.), 100.) * numberOfVoxels / 100.;
+  const std::vector<vtkIdType>& cumulativeCounts = this->Internal->CumulativeCounts;
+  // First bin reaching the count
+  size_t binIdx = std::lower_bound(cumulativeCounts.begin(), cumulativeCounts.end(),
+                                   static_cast<vtkIdType>(std::ceil(count))) - cumulativeCounts.begin();
+  binIdx = std::min(binIdx, cumulativeCounts.size() - 1);
+  const vtkIdType lowerCount = binIdx > 0 ? cumulativeCounts[binIdx - 1] : 0;
+  const vtkIdType binCount = this->Internal->Counts[binIdx];
+  const double binFraction = binCount > 0 ?
+    std::min(std::max((count - lowerCount) / binCount, 0.), 1.) : 0.;
+  return this->Internal->Origin + (binIdx + binFraction) * this->Internal->BinWidth;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeHistogram::GetWindowLevel(double lowerPercentile, double upperPercentile,
+                                                 double& window, double& level)const
+{
+  if (this->GetNumberOfVoxels() == 0)
+    {
+    return false;
+    }
+  const double lowerValue = this->GetValue(std::min(lowerPercentile, upperPercentile));
+  const double upperValue = this->GetValue(std::max(lowerPercentile, upperPercentile));
+  window = upperValue - lowerValue;
+  level = 0.5 * (lowerValue + upperValue);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeHistogram::Reset()
+{
+  this->Internal->Abort();
+  this->Internal->Histogram = vtkInternal::HistogramInfo();
+  this->Internal->Origin = 0.;
+  this->Internal->BinWidth = 1.;
+  this->Internal->Range[0] = vtkMath::Nan();
+  this->Internal->Range[1] = vtkMath::Nan();
+  std::vector<vtkIdType>().swap(this->Internal->Counts);
+  std::vector<vtkIdType>().swap(this->Internal->CumulativeCounts);
+}
@@ -0,0 +1,117 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerDataProbeHistogram_h
+#define __vtkSlicerDataProbeHistogram_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkSlicerDataProbeModuleLogicExport.h"
+
+class vtkImageData;
+
+/// \ingroup Slicer_QtModules_DataProbe
+/// Histogram and cumulative distribution of the first component of an image.
+///
+/// The histogram is computed in a background thread started by Update(),
+/// the voxels being split among threads that fill partial histograms. Once
+/// available, the percentile of a value is read from the cumulative
+/// distribution in constant time, interpolating within its bin, and the
+/// value of a percentile is found by a binary search over the bins.
+/// Integer images whose range fits in the number of bins get one bin per
+/// value, their percentiles are then exact.
+/// NaN values are ignored. Infinite values do not extend the range of the
+/// bins, they are counted in the first or last bin.
+/// \sa vtkSlicerDataProbeLogic::ProbePercentile
+class VTK_SLICER_DATAPROBE_MODULE_LOGIC_EXPORT vtkSlicerDataProbeHistogram :
+  public vtkObject
+{
+public:
+  static vtkSlicerDataProbeHistogram *New();
+  vtkTypeMacro(vtkSlicerDataProbeHistogram,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Number of bins of the histogram.
+  /// Default is 4096.
+  vtkSetClampMacro(NumberOfBins, int, 16, 1048576);
+  vtkGetMacro(NumberOfBins, int);
+
+  /// Number of threads filling the partial histograms, 0 to use the default
+  /// number of threads of vtkMultiThreader.
+  /// Default is 0.
+  vtkSetClampMacro(NumberOfThreads, int, 0, VTK_INT_MAX);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Return true if the histogram of \a imageData is available. Otherwise
+  /// start computing it in the background, aborting any other computation,
+  /// and return false.
+  /// Must be called from the thread that reads the histogram.
+  bool Update(vtkImageData* imageData);
+
+  /// Return true if the histogram has been computed from the current
+  /// scalars of \a imageData.
+  bool IsUpToDate(vtkImageData* imageData)const;
+
+  /// Return true if a histogram is being computed in the background.
+  bool IsComputing()const;
+
+  /// Return the image the histogram has been computed from, or is being
+  /// computed from, if it still exists.
+  vtkImageData* GetImageData()const;
+
+  /// Return the number of voxels counted in the histogram.
+  vtkIdType GetNumberOfVoxels()const;
+
+  /// Return the range of the counted values.
+  void GetRange(double range[2])const;
+
+  /// Return the percentage of the voxels whose value is lower than \a value,
+  /// in [0, 100], vtkMath::Nan() if the histogram is empty. The voxels of the
+  /// bin of \a value are interpolated linearly, so that with one bin per
+  /// value, half of the voxels equal to \a value are counted.
+  double GetPercentile(double value)const;
+
+  /// Return the value below which \a percentile percent of the voxels are,
+  /// vtkMath::Nan() if the histogram is empty.
+  double GetValue(double percentile)const;
+
+  /// Suggest a window/level covering the values between the percentiles
+  /// \a lowerPercentile and \a upperPercentile.
+  /// Return false if the histogram is empty.
+  bool GetWindowLevel(double lowerPercentile, double upperPercentile,
+                      double& window, double& level)const;
+
+  /// Abort the computation, if any, and release the histogram.
+  void Reset();
+
+protected:
+  vtkSlicerDataProbeHistogram();
+  virtual ~vtkSlicerDataProbeHistogram();
+
+  int NumberOfBins;
+  int NumberOfThreads;
+
+private:
+  vtkSlicerDataProbeHistogram(const vtkSlicerDataProbeHistogram&); // Not implemented
+  void operator=(const vtkSlicerDataProbeHistogram&);              // Not implemented
+
+  class vtkInternal;
+  vtkInternal * Internal;
+};
+
+#endif
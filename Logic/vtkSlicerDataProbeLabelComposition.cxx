@@ -0,0 +1,457 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeLabelComposition.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+//----------------------------------------------------------------------------
+namespace
+{
+
+/// Order the entries of a counting table by decreasing count, then by
+/// increasing label.
+struct vtkSlicerDataProbeMoreVoxels
+{
+  const std::vector<vtkIdType>* Counts;
+
+  bool operator()(int index, int otherIndex)const
+  {
+    const vtkIdType count = (*this->Counts)[index];
+    const vtkIdType otherCount = (*this->Counts)[otherIndex];
+    return count > otherCount || (count == otherCount && index < otherIndex);
+  }
+};
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+class vtkSlicerDataProbeLabelComposition::vtkInternal
+{
+public:
+  vtkInternal();
+
+  /// Set the window from the half width of its rows, invalidating the
+  /// counts if it changed.
+  void SetWindow(const int radius[3], const std::vector<int>& halfWidths);
+
+  /// Return the half width of the row (dj, dk) of the window, -1 if the
+  /// row is empty or outside of the window.
+  int GetHalfWidth(int dj, int dk)const;
+
+  /// Clear the counts of the listed labels.
+  void ClearCounts();
+
+  /// Add \a delta to the count of the voxels [i0, i1] of \a row.
+  template <class T>
+  void CountSpan(const T* row, int numberOfComponents, int i0, int i1, int delta);
+
+  /// Add \a delta to the count of the voxels of [a0, a1] outside of [b0, b1].
+  template <class T>
+  void CountSpanDifference(const T* row, int numberOfComponents, int a0, int a1, int b0, int b1, int delta);
+
+  /// Count the window centered on \a center, moving it from Center if
+  /// \a incremental is true.
+  template <class T>
+  void UpdateRows(const T* scalars, int numberOfComponents, const int center[3], bool incremental);
+
+  /// Drop the labels no longer counted and sort the others.
+  void SortLabels();
+
+  /// Largest half extents of the window along I, J and K.
+  int WindowRadius[3];
+  /// Half width along I of the rows (dj, dk), J fastest.
+  std::vector<int> HalfWidths;
+
+  vtkWeakPointer<vtkImageData> ImageData;
+  unsigned long ImageMTime;
+  int Dimensions[3];
+  int Center[3];
+  bool Valid;
+  bool LastUpdateIncremental;
+
+  /// Label value of the first entry of the counting table.
+  int LabelOffset;
+  std::vector<vtkIdType> Counts;
+  /// Whether each entry of the counting table is in Labels.
+  std::vector<unsigned char> Listed;
+  /// Entries of the counting table of the labels within the window.
+  std::vector<int> Labels;
+  vtkIdType NumberOfVoxels;
+};
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeLabelComposition::vtkInternal::vtkInternal()
+{
+  this->ImageMTime = 0;
+  this->Valid = false;
+  this->LastUpdateIncremental = false;
+  this->LabelOffset = 0;
+  this->NumberOfVoxels = 0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->WindowRadius[axis] = 0;
+    this->Dimensions[axis] = 0;
+    this->Center[axis] = 0;
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLabelComposition::vtkInternal::SetWindow(const int radius[3],
+                                                               const std::vector<int>& halfWidths)
+{
+  if (std::equal(radius, radius + 3, this->WindowRadius) && halfWidths == this->HalfWidths)
+    {
+    return;
+    }
+  std::copy(radius, radius + 3, this->WindowRadius);
+  this->HalfWidths = halfWidths;
+  this->Valid = false;
+}
+
+//----------------------------------------------------------------------------
+inline int vtkSlicerDataProbeLabelComposition::vtkInternal::GetHalfWidth(int dj, int dk)const
+{
+  if (abs(dj) > this->WindowRadius[1] || abs(dk) > this->WindowRadius[2])
+    {
+    return -1;
+    }
+  return this->HalfWidths[(dk + this->WindowRadius[2]) * (2 * this->WindowRadius[1] + 1) +
+                          dj + this->WindowRadius[1]];
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLabelComposition::vtkInternal::ClearCounts()
+{
+  for (std::vector<int>::const_iterator it = this->Labels.begin(); it != this->Labels.end(); ++it)
+    {
+    this->Counts[*it] = 0;
+    this->Listed[*it] = 0;
+    }
+  this->Labels.clear();
+  this->NumberOfVoxels = 0;
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+inline void vtkSlicerDataProbeLabelComposition::vtkInternal::CountSpan(
+  const T* row, int numberOfComponents, int i0, int i1, int delta)
+{
+  if (i0 > i1)
+    {
+    return;
+    }
+  const size_t numberOfEntries = this->Counts.size();
+  const T* voxel = row + static_cast<vtkIdType>(i0) * numberOfComponents;
+  for (int i = i0; i <= i1; ++i, voxel += numberOfComponents)
+    {
+    // Same rounding as vtkSlicerDataProbeLogic::ProbePixel()
+    const size_t index = static_cast<size_t>(static_cast<int>(*voxel) - this->LabelOffset);
+    if (index >= numberOfEntries)
+      {
+      continue;
+      }
+    this->Counts[index] += delta;
+    if (!this->Listed[index])
+      {
+      this->Listed[index] = 1;
+      this->Labels.push_back(static_cast<int>(index));
+      }
+    }
+  this->NumberOfVoxels += static_cast<vtkIdType>(delta) * (i1 - i0 + 1);
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+inline void vtkSlicerDataProbeLabelComposition::vtkInternal::CountSpanDifference(
+  const T* row, int numberOfComponents, int a0, int a1, int b0, int b1, int delta)
+{
+  if (b0 > b1)
+    {
+    this->CountSpan(row, numberOfComponents, a0, a1, delta);
+    return;
+    }
+  this->CountSpan(row, numberOfComponents, a0, std::min(a1, b0 - 1), delta);
+  this->CountSpan(row, numberOfComponents, std::max(a0, b1 + 1), a1, delta);
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void vtkSlicerDataProbeLabelComposition::vtkInternal::UpdateRows(
+  const T* scalars, int numberOfComponents, const int center[3], bool incremental)
+{
+  const int* dims = this->Dimensions;
+  const int* radius = this->WindowRadius;
+  const int* previous = this->Center;
+  if (!incremental)
+    {
+    this->ClearCounts();
+    }
+  // Rows of the previous and the new window, each row being read only
+  // where the two windows differ
+  const int rowRange[2] = {
+    std::max(incremental ? std::min(previous[1], center[1]) - radius[1] : center[1] - radius[1], 0),
+    std::min(incremental ? std::max(previous[1], center[1]) + radius[1] : center[1] + radius[1], dims[1] - 1)};
+  const int sliceRange[2] = {
+    std::max(incremental ? std::min(previous[2], center[2]) - radius[2] : center[2] - radius[2], 0),
+    std::min(incremental ? std::max(previous[2], center[2]) + radius[2] : center[2] + radius[2], dims[2] - 1)};
+  for (int k = sliceRange[0]; k <= sliceRange[1]; ++k)
+    {
+    for (int j = rowRange[0]; j <= rowRange[1]; ++j)
+      {
+      const T* row = scalars + (static_cast<vtkIdType>(k) * dims[1] + j) * dims[0] * numberOfComponents;
+      const int halfWidth = this->GetHalfWidth(j - center[1], k - center[2]);
+      const int span[2] = {
+        halfWidth < 0 ? 0 : std::max(center[0] - halfWidth, 0),
+        halfWidth < 0 ? -1 : std::min(center[0] + halfWidth, dims[0] - 1)};
+      if (!incremental)
+        {
+        this->CountSpan(row, numberOfComponents, span[0], span[1], 1);
+        continue;
+        }
+      const int previousHalfWidth = this->GetHalfWidth(j - previous[1], k - previous[2]);
+      const int previousSpan[2] = {
+        previousHalfWidth < 0 ? 0 : std::max(previous[0] - previousHalfWidth, 0),
+        previousHalfWidth < 0 ? -1 : std::min(previous[0] + previousHalfWidth, dims[0] - 1)};
+      this->CountSpanDifference(row, numberOfComponents, previousSpan[0], previousSpan[1], span[0], span[1], -1);
+      this->CountSpanDifference(row, numberOfComponents, span[0], span[1], previousSpan[0], previousSpan[1], 1);
+      }
+    }
+  std::copy(center, center + 3, this->Center);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLabelComposition::vtkInternal::SortLabels()
+{
+  std::vector<int>::iterator end = this->Labels.begin();
+  for (std::vector<int>::const_iterator it = this->Labels.begin(); it != this->Labels.end(); ++it)
+    {
+    if (this->Counts[*it] > 0)
+      {
+      *(end++) = *it;
+      }
+    else
+      {
+      this->Listed[*it] = 0;
+      }
+    }
+  this->Labels.erase(end, this->Labels.end());
+  vtkSlicerDataProbeMoreVoxels moreVoxels = {&this->Counts};
+  std::sort(this->Labels.begin(), this->Labels.end(), moreVoxels);
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerDataProbeLabelComposition);
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeLabelComposition::vtkSlicerDataProbeLabelComposition()
+{
+  this->Internal = new vtkInternal;
+  this->SetCubeWindow(1);
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeLabelComposition::~vtkSlicerDataProbeLabelComposition()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLabelComposition::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "WindowRadius: " << this->Internal->WindowRadius[0] << " "
+     << this->Internal->WindowRadius[1] << " " << this->Internal->WindowRadius[2] << "\n";
+  os << indent << "NumberOfVoxels: " << this->GetNumberOfVoxels() << "\n";
+  os << indent << "NumberOfLabels: " << this->GetNumberOfLabels() << "\n";
+  os << indent << "LastUpdateIncremental: " << this->GetLastUpdateIncremental() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLabelComposition::SetCubeWindow(int radius)
+{
+  radius = std::max(radius, 0);
+  const int windowRadius[3] = {radius, radius, radius};
+  this->Internal->SetWindow(windowRadius, std::vector<int>((2 * radius + 1) * (2 * radius + 1), radius));
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLabelComposition::SetBallWindow(const double radius[3])
+{
+  double semiAxes[3];
+  int windowRadius[3];
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    semiAxes[axis] = std::max(radius[axis], 0.0);
+    windowRadius[axis] = static_cast<int>(floor(semiAxes[axis]));
+    }
+  // Voxel (di, dj, dk) is inside if (di/ri)^2 + (dj/rj)^2 + (dk/rk)^2 <= 1,
+  // dj and dk being 0 if rj or rk is lower than 1
+  std::vector<int> halfWidths;
+  halfWidths.reserve((2 * windowRadius[1] + 1) * (2 * windowRadius[2] + 1));
+  for (int dk = -windowRadius[2]; dk <= windowRadius[2]; ++dk)
+    {
+    const double z = dk != 0 ? dk / semiAxes[2] : 0.0;
+    for (int dj = -windowRadius[1]; dj <= windowRadius[1]; ++dj)
+      {
+      const double y = dj != 0 ? dj / semiAxes[1] : 0.0;
+      const double remainder = 1.0 - y * y - z * z;
+      halfWidths.push_back(remainder < 0.0 ? -1 : static_cast<int>(floor(semiAxes[0] * sqrt(remainder) + 1e-9)));
+      }
+    }
+  this->Internal->SetWindow(windowRadius, halfWidths);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLabelComposition::Reset()
+{
+  this->Internal->ImageData = 0;
+  this->Internal->Valid = false;
+  this->Internal->LastUpdateIncremental = false;
+  std::vector<vtkIdType>().swap(this->Internal->Counts);
+  std::vector<unsigned char>().swap(this->Internal->Listed);
+  this->Internal->Labels.clear();
+  this->Internal->NumberOfVoxels = 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeLabelComposition::Update(vtkImageData* imageData, const int center[3])
+{
+  vtkDataArray* scalars = imageData ? imageData->GetPointData()->GetScalars() : 0;
+  if (!scalars || scalars->GetNumberOfTuples() == 0)
+    {
+    this->Reset();
+    return false;
+    }
+  vtkInternal* internal = this->Internal;
+
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+  double range[2] = {0.0, 0.0};
+  scalars->GetRange(range, 0);
+  if (!(range[0] <= range[1]) ||
+      floor(range[1]) - floor(range[0]) >= static_cast<double>(MAXIMUM_NUMBER_OF_LABELS))
+    {
+    this->Reset();
+    return false;
+    }
+  const int labelOffset = static_cast<int>(floor(range[0]));
+  const size_t numberOfEntries = static_cast<size_t>(static_cast<int>(floor(range[1])) - labelOffset + 1);
+  const unsigned long imageMTime = std::max(imageData->GetMTime(), scalars->GetMTime());
+
+  // Same labels of the same image, and a window moved by less than its size
+  bool incremental = internal->Valid && internal->ImageData.GetPointer() == imageData &&
+    internal->ImageMTime == imageMTime && internal->LabelOffset == labelOffset &&
+    internal->Counts.size() == numberOfEntries;
+  for (int axis = 0; axis < 3 && incremental; ++axis)
+    {
+    incremental = internal->Dimensions[axis] == dims[axis] &&
+      abs(center[axis] - internal->Center[axis]) <= internal->WindowRadius[axis];
+    }
+
+  if (internal->LabelOffset != labelOffset || internal->Counts.size() != numberOfEntries)
+    {
+    internal->LabelOffset = labelOffset;
+    internal->Counts.assign(numberOfEntries, 0);
+    internal->Listed.assign(numberOfEntries, 0);
+    internal->Labels.clear();
+    }
+  internal->ImageData = imageData;
+  internal->ImageMTime = imageMTime;
+  std::copy(dims, dims + 3, internal->Dimensions);
+  internal->LastUpdateIncremental = incremental;
+
+  void* scalarPointer = scalars->GetVoidPointer(0);
+  const int numberOfComponents = scalars->GetNumberOfComponents();
+  switch (scalars->GetDataType())
+    {
+    vtkTemplateMacro(internal->UpdateRows(static_cast<const VTK_TT*>(scalarPointer), numberOfComponents,
+                                          center, incremental));
+    default:
+      this->Reset();
+      return false;
+    }
+  internal->SortLabels();
+  internal->Valid = true;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkSlicerDataProbeLabelComposition::GetImageData()const
+{
+  return this->Internal->ImageData;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeLabelComposition::GetLastUpdateIncremental()const
+{
+  return this->Internal->LastUpdateIncremental;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeLabelComposition::GetNumberOfVoxels()const
+{
+  return this->Internal->NumberOfVoxels;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDataProbeLabelComposition::GetNumberOfLabels()const
+{
+  return static_cast<int>(this->Internal->Labels.size());
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDataProbeLabelComposition::GetLabel(int labelIdx)const
+{
+  if (labelIdx < 0 || labelIdx >= this->GetNumberOfLabels())
+    {
+    return 0;
+    }
+  return this->Internal->Labels[labelIdx] + this->Internal->LabelOffset;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeLabelComposition::GetLabelNumberOfVoxels(int labelIdx)const
+{
+  if (labelIdx < 0 || labelIdx >= this->GetNumberOfLabels())
+    {
+    return 0;
+    }
+  return this->Internal->Counts[this->Internal->Labels[labelIdx]];
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDataProbeLabelComposition::GetLabelFraction(int labelIdx)const
+{
+  if (this->Internal->NumberOfVoxels == 0)
+    {
+    return 0.0;
+    }
+  return static_cast<double>(this->GetLabelNumberOfVoxels(labelIdx)) / this->Internal->NumberOfVoxels;
+}
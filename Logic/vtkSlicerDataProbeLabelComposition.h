@@ -0,0 +1,102 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerDataProbeLabelComposition_h
+#define __vtkSlicerDataProbeLabelComposition_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkSlicerDataProbeModuleLogicExport.h"
+
+class vtkImageData;
+
+/// \ingroup Slicer_QtModules_DataProbe
+/// Labels of the voxels of a label map within a window around a voxel, and
+/// their number of voxels.
+///
+/// The window is a cube or an ellipsoid, stored as the half width along I
+/// of each of its rows along I. Voxels are counted in a flat table indexed
+/// by label value, spanning the scalar range of the label map. When the
+/// window moves by less than its size, only the voxels entering and leaving
+/// each row are read from the image, e.g. 2 voxels per row for a move of
+/// one voxel along I.
+/// Voxels outside of the image are not counted.
+/// \sa vtkSlicerDataProbeLogic::ProbeLabelComposition
+class VTK_SLICER_DATAPROBE_MODULE_LOGIC_EXPORT vtkSlicerDataProbeLabelComposition :
+  public vtkObject
+{
+public:
+  static vtkSlicerDataProbeLabelComposition *New();
+  vtkTypeMacro(vtkSlicerDataProbeLabelComposition,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Maximum number of entries of the counting table: label maps whose
+  /// scalar range is wider are not supported.
+  static const int MAXIMUM_NUMBER_OF_LABELS = 65536;
+
+  /// Set the window to the (2 * radius + 1)^3 voxels centered on the
+  /// updated voxel.
+  /// Default is a radius of 1.
+  void SetCubeWindow(int radius);
+
+  /// Set the window to the voxels within the ellipsoid of semi-axes
+  /// \a radius, in voxels along I, J and K, centered on the updated voxel.
+  void SetBallWindow(const double radius[3]);
+
+  /// Count the labels of the first component of \a imageData within the
+  /// window centered on the voxel \a center. The update is incremental if
+  /// the same window of the same image was updated last and it moved by
+  /// less than its size along each axis. Return false if the image has no
+  /// scalars or if its scalar range is too wide.
+  bool Update(vtkImageData* imageData, const int center[3]);
+
+  /// Return the image of the last update, if it still exists.
+  vtkImageData* GetImageData()const;
+
+  /// Return true if the last update was incremental.
+  bool GetLastUpdateIncremental()const;
+
+  /// Number of voxels of the window within the image.
+  vtkIdType GetNumberOfVoxels()const;
+
+  /// Return the number of distinct labels within the window. They are
+  /// sorted by decreasing number of voxels.
+  int GetNumberOfLabels()const;
+
+  /// Return the value of the label \a labelIdx, its number of voxels and
+  /// the fraction of the window voxels it covers, in [0, 1].
+  int GetLabel(int labelIdx)const;
+  vtkIdType GetLabelNumberOfVoxels(int labelIdx)const;
+  double GetLabelFraction(int labelIdx)const;
+
+  /// Release the counting table and clear the composition.
+  void Reset();
+
+protected:
+  vtkSlicerDataProbeLabelComposition();
+  virtual ~vtkSlicerDataProbeLabelComposition();
+
+private:
+  vtkSlicerDataProbeLabelComposition(const vtkSlicerDataProbeLabelComposition&); // Not implemented
+  void operator=(const vtkSlicerDataProbeLabelComposition&);                     // Not implemented
+
+  class vtkInternal;
+  vtkInternal * Internal;
+};
+
+#endif
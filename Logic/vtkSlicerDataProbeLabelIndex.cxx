@@ -0,0 +1,460 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeLabelIndex.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
+//----------------------------------------------------------------------------
+class vtkSlicerDataProbeLabelIndex::vtkInternal
+{
+public:
+  vtkInternal();
+
+  struct Statistics
+  {
+    Statistics();
+    void Add(const Statistics& other);
+    void Subtract(const Statistics& other);
+    void AddBounds(const Statistics& other);
+
+    vtkIdType Count;
+    double Sum[3];
+    int Bounds[6];
+  };
+  typedef std::map<int, Statistics> StatisticsMapType;
+
+  /// Scan the K slices [firstSlice, lastSlice] into SliceStatistics using
+  /// \a numberOfThreads threads.
+  bool ComputeSlices(vtkImageData* imageData, int firstSlice, int lastSlice, int numberOfThreads);
+
+  static VTK_THREAD_RETURN_TYPE ComputeSlicesThread(void* arg);
+
+  template <class T>
+  static void ComputeSlice(const T* scalars, const int dims[3], int numberOfComponents,
+                           int k, StatisticsMapType& statistics);
+
+  vtkWeakPointer<vtkImageData> ImageData;
+  void* Scalars;
+  unsigned long ScalarsMTime;
+  int Dimensions[3];
+
+  std::vector<StatisticsMapType> SliceStatistics;
+  StatisticsMapType Totals;
+
+  // Shared with the threads
+  vtkImageData* ComputedImageData;
+  int FirstSlice;
+  int LastSlice;
+};
+
+//---------------------------------------------------------------------------
+// vtkInternal methods
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeLabelIndex::vtkInternal::Statistics::Statistics()
+{
+  this->Count = 0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Sum[axis] = 0.0;
+    this->Bounds[2 * axis] = VTK_INT_MAX;
+    this->Bounds[2 * axis + 1] = VTK_INT_MIN;
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeLabelIndex::vtkInternal::Statistics::Add(const Statistics& other)
+{
+  this->Count += other.Count;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Sum[axis] += other.Sum[axis];
+    }
+  this->AddBounds(other);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeLabelIndex::vtkInternal::Statistics::Subtract(const Statistics& other)
+{
+  // Bounds can't be subtracted, they are recomputed by the caller.
+  this->Count -= other.Count;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Sum[axis] -= other.Sum[axis];
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeLabelIndex::vtkInternal::Statistics::AddBounds(const Statistics& other)
+{
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Bounds[2 * axis] = std::min(this->Bounds[2 * axis], other.Bounds[2 * axis]);
+    this->Bounds[2 * axis + 1] = std::max(this->Bounds[2 * axis + 1], other.Bounds[2 * axis + 1]);
+    }
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeLabelIndex::vtkInternal::vtkInternal()
+{
+  this->Scalars = 0;
+  this->ScalarsMTime = 0;
+  this->ComputedImageData = 0;
+  this->FirstSlice = 0;
+  this->LastSlice = -1;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Dimensions[axis] = 0;
+    }
+}
+
+//---------------------------------------------------------------------------
+template <class T>
+void vtkSlicerDataProbeLabelIndex::vtkInternal::ComputeSlice(
+  const T* scalars, const int dims[3], int numberOfComponents, int k, StatisticsMapType& statistics)
+{
+  statistics.clear();
+  const T* voxel = scalars + static_cast<vtkIdType>(k) * dims[0] * dims[1] * numberOfComponents;
+  for (int j = 0; j < dims[1]; ++j)
+    {
+    // Labels come in runs along I: the statistics of the run are
+    // accumulated locally and flushed when the label changes.
+    int runLabel = static_cast<int>(*voxel);
+    int runStart = 0;
+    for (int i = 0; i <= dims[0]; ++i, voxel += numberOfComponents)
+      {
+      const bool endOfRow = (i == dims[0]);
+      const int label = endOfRow ? runLabel : static_cast<int>(*voxel);
+      if (!endOfRow && label == runLabel)
+        {
+        continue;
+        }
+      Statistics& labelStatistics = statistics[runLabel];
+      const vtkIdType runLength = i - runStart;
+      labelStatistics.Count += runLength;
+      labelStatistics.Sum[0] += 0.5 * (runStart + i - 1) * runLength;
+      labelStatistics.Sum[1] += static_cast<double>(j) * runLength;
+      labelStatistics.Sum[2] += static_cast<double>(k) * runLength;
+      labelStatistics.Bounds[0] = std::min(labelStatistics.Bounds[0], runStart);
+      labelStatistics.Bounds[1] = std::max(labelStatistics.Bounds[1], i - 1);
+      labelStatistics.Bounds[2] = std::min(labelStatistics.Bounds[2], j);
+      labelStatistics.Bounds[3] = std::max(labelStatistics.Bounds[3], j);
+      labelStatistics.Bounds[4] = std::min(labelStatistics.Bounds[4], k);
+      labelStatistics.Bounds[5] = std::max(labelStatistics.Bounds[5], k);
+      runLabel = label;
+      runStart = i;
+      }
+    // The loop went one voxel past the row
+    voxel -= numberOfComponents;
+    }
+}
+
+//---------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkSlicerDataProbeLabelIndex::vtkInternal::ComputeSlicesThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkInternal* self = static_cast<vtkInternal*>(threadInfo->UserData);
+  vtkImageData* imageData = self->ComputedImageData;
+  vtkDataArray* scalars = imageData->GetPointData()->GetScalars();
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+  // Slices are interleaved among threads, each thread writes its own slices.
+  for (int k = self->FirstSlice + threadInfo->ThreadID; k <= self->LastSlice;
+       k += threadInfo->NumberOfThreads)
+    {
+    switch (scalars->GetDataType())
+      {
+      vtkTemplateMacro(vtkInternal::ComputeSlice(
+        static_cast<VTK_TT*>(scalars->GetVoidPointer(0)), dims, scalars->GetNumberOfComponents(),
+        k, self->SliceStatistics[k]));
+      }
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDataProbeLabelIndex::vtkInternal::ComputeSlices(
+  vtkImageData* imageData, int firstSlice, int lastSlice, int numberOfThreads)
+{
+  vtkDataArray* scalars = imageData->GetPointData()->GetScalars();
+  switch (scalars->GetDataType())
+    {
+    vtkTemplateMacro(break);
+    default:
+      return false;
+    }
+  this->ComputedImageData = imageData;
+  this->FirstSlice = firstSlice;
+  this->LastSlice = lastSlice;
+
+  vtkNew<vtkMultiThreader> threader;
+  if (numberOfThreads <= 0)
+    {
+    numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+    }
+  numberOfThreads = std::min(std::min(numberOfThreads, lastSlice - firstSlice + 1), VTK_MAX_THREADS);
+  threader->SetNumberOfThreads(std::max(numberOfThreads, 1));
+  threader->SetSingleMethod(vtkInternal::ComputeSlicesThread, this);
+  threader->SingleMethodExecute();
+
+  this->ComputedImageData = 0;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// vtkSlicerDataProbeLabelIndex methods
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerDataProbeLabelIndex);
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeLabelIndex::vtkSlicerDataProbeLabelIndex()
+{
+  this->NumberOfThreads = 0;
+  this->Internal = new vtkInternal;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeLabelIndex::~vtkSlicerDataProbeLabelIndex()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLabelIndex::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "NumberOfLabels: " << this->GetNumberOfLabels() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLabelIndex::Reset()
+{
+  this->Internal->ImageData = 0;
+  this->Internal->Scalars = 0;
+  this->Internal->ScalarsMTime = 0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Internal->Dimensions[axis] = 0;
+    }
+  std::vector<vtkInternal::StatisticsMapType>().swap(this->Internal->SliceStatistics);
+  this->Internal->Totals.clear();
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkSlicerDataProbeLabelIndex::GetImageData()const
+{
+  return this->Internal->ImageData.GetPointer();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeLabelIndex::IsUpToDate(vtkImageData* imageData)const
+{
+  if (!imageData || imageData != this->Internal->ImageData.GetPointer())
+    {
+    return false;
+    }
+  vtkDataArray* scalars = imageData->GetPointData()->GetScalars();
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+  return scalars
+    && scalars->GetVoidPointer(0) == this->Internal->Scalars
+    && std::max(scalars->GetMTime(), imageData->GetMTime()) == this->Internal->ScalarsMTime
+    && dims[0] == this->Internal->Dimensions[0]
+    && dims[1] == this->Internal->Dimensions[1]
+    && dims[2] == this->Internal->Dimensions[2];
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeLabelIndex::Update(vtkImageData* imageData)
+{
+  if (this->IsUpToDate(imageData))
+    {
+    return true;
+    }
+  this->Reset();
+  vtkDataArray* scalars = imageData ? imageData->GetPointData()->GetScalars() : 0;
+  if (!scalars || scalars->GetNumberOfTuples() == 0)
+    {
+    return false;
+    }
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+  this->Internal->SliceStatistics.resize(dims[2]);
+  if (!this->Internal->ComputeSlices(imageData, 0, dims[2] - 1, this->NumberOfThreads))
+    {
+    this->Reset();
+    return false;
+    }
+
+  // Merge the slices
+  for (int k = 0; k < dims[2]; ++k)
+    {
+    const vtkInternal::StatisticsMapType& sliceStatistics = this->Internal->SliceStatistics[k];
+    for (vtkInternal::StatisticsMapType::const_iterator it = sliceStatistics.begin();
+         it != sliceStatistics.end(); ++it)
+      {
+      this->Internal->Totals[it->first].Add(it->second);
+      }
+    }
+
+  this->Internal->ImageData = imageData;
+  this->Internal->Scalars = scalars->GetVoidPointer(0);
+  this->Internal->ScalarsMTime = std::max(scalars->GetMTime(), imageData->GetMTime());
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Internal->Dimensions[axis] = dims[axis];
+    }
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeLabelIndex::UpdateExtent(vtkImageData* imageData, const int extent[6])
+{
+  vtkDataArray* scalars = imageData ? imageData->GetPointData()->GetScalars() : 0;
+  int dims[3] = {0, 0, 0};
+  if (imageData)
+    {
+    imageData->GetDimensions(dims);
+    }
+  if (!scalars
+      || imageData != this->Internal->ImageData.GetPointer()
+      || scalars->GetVoidPointer(0) != this->Internal->Scalars
+      || dims[0] != this->Internal->Dimensions[0]
+      || dims[1] != this->Internal->Dimensions[1]
+      || dims[2] != this->Internal->Dimensions[2])
+    {
+    return this->Update(imageData);
+    }
+  const int firstSlice = std::max(extent[4], 0);
+  const int lastSlice = std::min(extent[5], dims[2] - 1);
+  if (firstSlice <= lastSlice)
+    {
+    // Remove the old partial statistics of the slices from the totals
+    vtkInternal::StatisticsMapType& totals = this->Internal->Totals;
+    std::set<int> modifiedLabels;
+    for (int k = firstSlice; k <= lastSlice; ++k)
+      {
+      const vtkInternal::StatisticsMapType& sliceStatistics = this->Internal->SliceStatistics[k];
+      for (vtkInternal::StatisticsMapType::const_iterator it = sliceStatistics.begin();
+           it != sliceStatistics.end(); ++it)
+        {
+        totals[it->first].Subtract(it->second);
+        modifiedLabels.insert(it->first);
+        }
+      }
+    if (!this->Internal->ComputeSlices(imageData, firstSlice, lastSlice, this->NumberOfThreads))
+      {
+      this->Reset();
+      return false;
+      }
+    // Add the new ones
+    for (int k = firstSlice; k <= lastSlice; ++k)
+      {
+      const vtkInternal::StatisticsMapType& sliceStatistics = this->Internal->SliceStatistics[k];
+      for (vtkInternal::StatisticsMapType::const_iterator it = sliceStatistics.begin();
+           it != sliceStatistics.end(); ++it)
+        {
+        totals[it->first].Add(it->second);
+        modifiedLabels.insert(it->first);
+        }
+      }
+    // The bounds of the modified labels may have shrunk: rebuild them from
+    // the partial statistics of all the slices.
+    for (std::set<int>::const_iterator labelIt = modifiedLabels.begin();
+         labelIt != modifiedLabels.end(); ++labelIt)
+      {
+      vtkInternal::StatisticsMapType::iterator totalIt = totals.find(*labelIt);
+      if (totalIt->second.Count <= 0)
+        {
+        totals.erase(totalIt);
+        continue;
+        }
+      vtkInternal::Statistics bounds;
+      for (int k = totalIt->second.Bounds[4]; k <= totalIt->second.Bounds[5]; ++k)
+        {
+        const vtkInternal::StatisticsMapType& sliceStatistics = this->Internal->SliceStatistics[k];
+        vtkInternal::StatisticsMapType::const_iterator sliceIt = sliceStatistics.find(*labelIt);
+        if (sliceIt != sliceStatistics.end())
+          {
+          bounds.AddBounds(sliceIt->second);
+          }
+        }
+      std::copy(bounds.Bounds, bounds.Bounds + 6, totalIt->second.Bounds);
+      }
+    }
+  this->Internal->ScalarsMTime = std::max(scalars->GetMTime(), imageData->GetMTime());
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDataProbeLabelIndex::GetNumberOfLabels()const
+{
+  return static_cast<int>(this->Internal->Totals.size());
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeLabelIndex::GetNumberOfVoxels(int label)const
+{
+  vtkInternal::StatisticsMapType::const_iterator it = this->Internal->Totals.find(label);
+  return it != this->Internal->Totals.end() ? it->second.Count : 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeLabelIndex::GetCentroid(int label, double centroid[3])const
+{
+  vtkInternal::StatisticsMapType::const_iterator it = this->Internal->Totals.find(label);
+  if (it == this->Internal->Totals.end() || it->second.Count <= 0)
+    {
+    return false;
+    }
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    centroid[axis] = it->second.Sum[axis] / it->second.Count;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeLabelIndex::GetBounds(int label, int bounds[6])const
+{
+  vtkInternal::StatisticsMapType::const_iterator it = this->Internal->Totals.find(label);
+  if (it == this->Internal->Totals.end() || it->second.Count <= 0)
+    {
+    return false;
+    }
+  std::copy(it->second.Bounds, it->second.Bounds + 6, bounds);
+  return true;
+}
@@ -0,0 +1,98 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerDataProbeLabelIndex_h
+#define __vtkSlicerDataProbeLabelIndex_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkSlicerDataProbeModuleLogicExport.h"
+
+class vtkImageData;
+
+/// \ingroup Slicer_QtModules_DataProbe
+/// Voxel count, centroid and bounding box of each label of a label map.
+///
+/// Statistics are first computed for each K slice, the slices being
+/// distributed over threads, and then merged into the label totals.
+/// The partial statistics of the slices are kept so that, after an edit,
+/// only the slices of the modified extent are scanned again: their old
+/// partial statistics are subtracted from the totals and the new ones added.
+/// \sa vtkSlicerDataProbeLogic::ProbeLabelStatistics
+class VTK_SLICER_DATAPROBE_MODULE_LOGIC_EXPORT vtkSlicerDataProbeLabelIndex :
+  public vtkObject
+{
+public:
+  static vtkSlicerDataProbeLabelIndex *New();
+  vtkTypeMacro(vtkSlicerDataProbeLabelIndex,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Number of threads used to scan the slices, 0 to use the default number
+  /// of threads of vtkMultiThreader.
+  /// Default is 0.
+  vtkSetClampMacro(NumberOfThreads, int, 0, VTK_INT_MAX);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Build the index of \a imageData if it is not up-to-date.
+  /// Return false if the image has no scalars.
+  bool Update(vtkImageData* imageData);
+
+  /// Update the index of \a imageData after the voxels of \a extent have been
+  /// modified. Only the K slices of \a extent are scanned if the index was
+  /// built for \a imageData, otherwise the whole index is built.
+  bool UpdateExtent(vtkImageData* imageData, const int extent[6]);
+
+  /// Return true if the index has been built from the current scalars of
+  /// \a imageData.
+  bool IsUpToDate(vtkImageData* imageData)const;
+
+  /// Return the image the index has been built from, if it still exists.
+  vtkImageData* GetImageData()const;
+
+  /// Return the number of distinct labels, including the background.
+  int GetNumberOfLabels()const;
+
+  /// Return the number of voxels of \a label, 0 if there is none.
+  vtkIdType GetNumberOfVoxels(int label)const;
+
+  /// Return the mean IJK position of the voxels of \a label.
+  /// Return false if there is no voxel of \a label.
+  bool GetCentroid(int label, double centroid[3])const;
+
+  /// Return the IJK extent (i min, i max, j min, ...) containing all the
+  /// voxels of \a label. Return false if there is no voxel of \a label.
+  bool GetBounds(int label, int bounds[6])const;
+
+  /// Release the index.
+  void Reset();
+
+protected:
+  vtkSlicerDataProbeLabelIndex();
+  virtual ~vtkSlicerDataProbeLabelIndex();
+
+  int NumberOfThreads;
+
+private:
+  vtkSlicerDataProbeLabelIndex(const vtkSlicerDataProbeLabelIndex&); // Not implemented
+  void operator=(const vtkSlicerDataProbeLabelIndex&);               // Not implemented
+
+  class vtkInternal;
+  vtkInternal * Internal;
+};
+
+#endif
@@ -21,27 +21,874 @@
 ==============================================================================*/
 
 // DataProbe includes
+#include "vtkMRMLDataProbeResultNode.h"
+#include "vtkSlicerDataProbeBatchEngine.h"
+#include "vtkSlicerDataProbeBlockMinMax.h"
+#include "vtkSlicerDataProbeComponentIndex.h"
+#include "vtkSlicerDataProbeDistanceMap.h"
+#include "vtkSlicerDataProbeHistogram.h"
+#include "vtkSlicerDataProbeLabelComposition.h"
+#include "vtkSlicerDataProbeLabelIndex.h"
 #include "vtkSlicerDataProbeLogic.h"
+#include "vtkSlicerDataProbePathTrace.h"
+#include "vtkSlicerDataProbePointLocator.h"
+#include "vtkSlicerDataProbeSharedMemoryStream.h"
+#include "vtkSlicerDataProbeSliceChecksums.h"
+#include "vtkSlicerDataProbeTensorScalarCache.h"
+#include "vtkSlicerDataProbeTransformCache.h"
+#include "vtkSlicerDataProbeViewportStatistics.h"
 
 // MRML includes
 #include <vtkMRMLColorNode.h>
 #include <vtkMRMLDiffusionTensorVolumeDisplayNode.h>
 #include <vtkMRMLDiffusionTensorVolumeNode.h>
 #include <vtkMRMLDisplayNode.h>
+#include <vtkMRMLModelNode.h>
+#include <vtkMRMLScalarVolumeDisplayNode.h>
 #include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLTransformNode.h>
+
+// MRMLLogic includes
+#include <vtkMRMLSliceLayerLogic.h>
 
 // vtkTeem includes
 #include "vtkDiffusionTensorMathematics.h"
 
 // VTK includes
+#include <vtkCellData.h>
+#include <vtkCellType.h>
 #include <vtkFloatArray.h>
+#include <vtkGeneralTransform.h>
+#include <vtkIdList.h>
 #include <vtkImageData.h>
+#include <vtkImageReslice.h>
+#include <vtkIntArray.h>
 #include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMultiThreader.h>
 #include <vtkNew.h>
 #include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkTransform.h>
+#include <vtkWeakPointer.h>
 
 // STD includes
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Neighborhood helpers
+
+//----------------------------------------------------------------------------
+/// Copy the (2 * radius + 1)^3 neighborhood of the voxel \a center into
+/// \a neighborhood, I fastest. Voxels outside of the image are clamped to
+/// the closest border voxel.
+template <class T>
+void vtkSlicerDataProbeGatherNeighborhood(const T* scalars, const int dims[3], int numberOfComponents,
+                                         int component, const int center[3], int radius,
+                                         double* neighborhood)
+{
+  const vtkIdType incrementY = static_cast<vtkIdType>(dims[0]) * numberOfComponents;
+  const vtkIdType incrementZ = incrementY * dims[1];
+  for (int dk = -radius; dk <= radius; ++dk)
+    {
+    const int k = std::min(std::max(center[2] + dk, 0), dims[2] - 1);
+    for (int dj = -radius; dj <= radius; ++dj)
+      {
+      const int j = std::min(std::max(center[1] + dj, 0), dims[1] - 1);
+      const T* row = scalars + k * incrementZ + j * incrementY + component;
+      for (int di = -radius; di <= radius; ++di)
+        {
+        const int i = std::min(std::max(center[0] + di, 0), dims[0] - 1);
+        *(neighborhood++) = static_cast<double>(row[i * numberOfComponents]);
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeGatherNeighborhood(vtkImageData* imageData, int component,
+                                         const int center[3], int radius, double* neighborhood)
+{
+  void* scalars = imageData->GetScalarPointer();
+  if (!scalars || component >= imageData->GetNumberOfScalarComponents())
+    {
+    return false;
+    }
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+  int numberOfComponents = imageData->GetNumberOfScalarComponents();
+  switch (imageData->GetScalarType())
+    {
+    vtkTemplateMacro(vtkSlicerDataProbeGatherNeighborhood(
+      static_cast<VTK_TT*>(scalars), dims, numberOfComponents, component, center, radius, neighborhood));
+    default:
+      return false;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+/// Fill the 1D correlation weights of derivative order 0, 1 and 2 of
+/// \a kernel and return its radius.
+int vtkSlicerDataProbeDerivativeWeights(int kernel, double weights[3][5])
+{
+  if (kernel == vtkSlicerDataProbeLogic::GAUSSIAN_KERNEL)
+    {
+    // Sampled Gaussian derivatives, sigma = 1 voxel, normalized so that
+    // they are exact for polynomials of degree 2.
+    const int radius = 2;
+    double sum = 0.0;
+    for (int x = -radius; x <= radius; ++x)
+      {
+      weights[0][x + radius] = exp(-0.5 * x * x);
+      sum += weights[0][x + radius];
+      }
+    double secondMoment = 0.0;
+    for (int x = -radius; x <= radius; ++x)
+      {
+      weights[0][x + radius] /= sum;
+      secondMoment += x * x * weights[0][x + radius];
+      }
+    double secondOrderNorm = 0.0;
+    for (int x = -radius; x <= radius; ++x)
+      {
+      secondOrderNorm += (x * x - secondMoment) * weights[0][x + radius] * x * x / 2.0;
+      }
+    for (int x = -radius; x <= radius; ++x)
+      {
+      weights[1][x + radius] = x * weights[0][x + radius] / secondMoment;
+      weights[2][x + radius] = (x * x - secondMoment) * weights[0][x + radius] / secondOrderNorm;
+      }
+    return radius;
+    }
+  // Central differences
+  const double centralDifferences[3][3] = {{0.0, 1.0, 0.0}, {-0.5, 0.0, 0.5}, {1.0, -2.0, 1.0}};
+  for (int order = 0; order < 3; ++order)
+    {
+    for (int x = 0; x < 3; ++x)
+      {
+      weights[order][x] = centralDifferences[order][x];
+      }
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+/// Apply the separable derivative weights to \a neighborhood and compute
+/// the gradient and the Hessian in IJK.
+void vtkSlicerDataProbeComputeDerivatives(const double* neighborhood, int radius,
+                                          const double weights[3][5],
+                                          double gradient[3], double hessian[3][3])
+{
+  const int size = 2 * radius + 1;
+  const double* w0 = weights[0];
+  const double* w1 = weights[1];
+  const double* w2 = weights[2];
+  double gx = 0.0, gy = 0.0, gz = 0.0;
+  double hxx = 0.0, hyy = 0.0, hzz = 0.0, hxy = 0.0, hxz = 0.0, hyz = 0.0;
+  for (int k = 0; k < size; ++k)
+    {
+    for (int j = 0; j < size; ++j)
+      {
+      const double* row = neighborhood + (k * size + j) * size;
+      // Rows are filtered along I once for the three derivative orders
+      double r0 = 0.0, r1 = 0.0, r2 = 0.0;
+      for (int i = 0; i < size; ++i)
+        {
+        r0 += w0[i] * row[i];
+        r1 += w1[i] * row[i];
+        r2 += w2[i] * row[i];
+        }
+      gx  += r1 * w0[j] * w0[k];
+      gy  += r0 * w1[j] * w0[k];
+      gz  += r0 * w0[j] * w1[k];
+      hxx += r2 * w0[j] * w0[k];
+      hyy += r0 * w2[j] * w0[k];
+      hzz += r0 * w0[j] * w2[k];
+      hxy += r1 * w1[j] * w0[k];
+      hxz += r1 * w0[j] * w1[k];
+      hyz += r0 * w1[j] * w1[k];
+      }
+    }
+  gradient[0] = gx;
+  gradient[1] = gy;
+  gradient[2] = gz;
+  hessian[0][0] = hxx; hessian[0][1] = hxy; hessian[0][2] = hxz;
+  hessian[1][0] = hxy; hessian[1][1] = hyy; hessian[1][2] = hyz;
+  hessian[2][0] = hxz; hessian[2][1] = hyz; hessian[2][2] = hzz;
+}
+
+//----------------------------------------------------------------------------
+/// Fill \a jacobian with R * S^-1, R holding the IJK axis directions of
+/// \a volumeNode and S its spacing: the gradient with respect to RAS of a
+/// function of IJK is jacobian * (its gradient with respect to IJK).
+void vtkSlicerDataProbeIJKToRASDerivatives(vtkMRMLVolumeNode* volumeNode, double jacobian[3][3])
+{
+  vtkNew<vtkMatrix4x4> directions;
+  volumeNode->GetIJKToRASDirectionMatrix(directions.GetPointer());
+  const double* spacing = volumeNode->GetSpacing();
+  for (int row = 0; row < 3; ++row)
+    {
+    for (int column = 0; column < 3; ++column)
+      {
+      jacobian[row][column] = directions->GetElement(row, column) /
+        (spacing[column] != 0.0 ? spacing[column] : 1.0);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Displacement field helpers
+
+//----------------------------------------------------------------------------
+/// Compute the derivatives, with respect to IJK, of the first three
+/// components of the voxel \a voxel at \a ijk: gradient[c][axis] is the
+/// derivative of the component c along \a axis. Central differences are
+/// used, one-sided ones on the borders of the image.
+template <class T>
+inline void vtkSlicerDataProbeDisplacementGradient(const T* voxel, const int ijk[3], const int dims[3],
+                                                   const vtkIdType increments[3], double gradient[3][3])
+{
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    const bool hasPrevious = ijk[axis] > 0;
+    const bool hasNext = ijk[axis] < dims[axis] - 1;
+    const T* previous = hasPrevious ? voxel - increments[axis] : voxel;
+    const T* next = hasNext ? voxel + increments[axis] : voxel;
+    const double scale = hasPrevious && hasNext ? 0.5 : (hasPrevious || hasNext ? 1.0 : 0.0);
+    gradient[0][axis] = scale * (static_cast<double>(next[0]) - static_cast<double>(previous[0]));
+    gradient[1][axis] = scale * (static_cast<double>(next[1]) - static_cast<double>(previous[1]));
+    gradient[2][axis] = scale * (static_cast<double>(next[2]) - static_cast<double>(previous[2]));
+    }
+}
+
+//----------------------------------------------------------------------------
+/// Compute the deformation gradient F = I + du/dRAS from the IJK gradient
+/// of the displacement and the transposed IJK to RAS derivatives.
+inline void vtkSlicerDataProbeDeformationGradient(const double gradientIJK[3][3], const double jacobianT[3][3],
+                                                  double deformation[3][3])
+{
+  for (int row = 0; row < 3; ++row)
+    {
+    for (int column = 0; column < 3; ++column)
+      {
+      deformation[row][column] = (row == column ? 1.0 : 0.0) +
+        gradientIJK[row][0] * jacobianT[0][column] +
+        gradientIJK[row][1] * jacobianT[1][column] +
+        gradientIJK[row][2] * jacobianT[2][column];
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+inline double vtkSlicerDataProbeDeterminant3x3(const double m[3][3])
+{
+  return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+         m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+         m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+//----------------------------------------------------------------------------
+/// Folding found in a slab of a displacement field.
+struct vtkSlicerDataProbeFoldingResult
+{
+  vtkIdType NumberOfVoxels;
+  vtkIdType NumberOfFoldedVoxels;
+  double MinimumDeterminant;
+  int MinimumIJK[3];
+  int FoldedExtent[6];
+
+  vtkSlicerDataProbeFoldingResult()
+    : NumberOfVoxels(0), NumberOfFoldedVoxels(0), MinimumDeterminant(VTK_DOUBLE_MAX)
+  {
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      this->MinimumIJK[axis] = -1;
+      this->FoldedExtent[2 * axis] = VTK_INT_MAX;
+      this->FoldedExtent[2 * axis + 1] = -1;
+      }
+  }
+
+  void Merge(const vtkSlicerDataProbeFoldingResult& other)
+  {
+    this->NumberOfVoxels += other.NumberOfVoxels;
+    this->NumberOfFoldedVoxels += other.NumberOfFoldedVoxels;
+    if (other.MinimumDeterminant < this->MinimumDeterminant)
+      {
+      this->MinimumDeterminant = other.MinimumDeterminant;
+      std::copy(other.MinimumIJK, other.MinimumIJK + 3, this->MinimumIJK);
+      }
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      this->FoldedExtent[2 * axis] = std::min(this->FoldedExtent[2 * axis], other.FoldedExtent[2 * axis]);
+      this->FoldedExtent[2 * axis + 1] =
+        std::max(this->FoldedExtent[2 * axis + 1], other.FoldedExtent[2 * axis + 1]);
+      }
+  }
+};
+
+//----------------------------------------------------------------------------
+/// Scan the Jacobian determinant of the voxels of \a extent of a
+/// displacement field, the slices of the extent being split among threads.
+struct vtkSlicerDataProbeFoldingTask
+{
+  void* Scalars;
+  int ScalarType;
+  int Dimensions[3];
+  vtkIdType Increments[3];
+  int Extent[6];
+  double JacobianT[3][3];
+  std::vector<vtkSlicerDataProbeFoldingResult> Results;
+
+  template <class T>
+  void ScanSlices(const T* scalars, int firstSlice, int lastSlice, vtkSlicerDataProbeFoldingResult& result)const
+  {
+    const int* extent = this->Extent;
+    for (int k = firstSlice; k <= lastSlice; ++k)
+      {
+      for (int j = extent[2]; j <= extent[3]; ++j)
+        {
+        int ijk[3] = {extent[0], j, k};
+        const T* voxel = scalars + ijk[0] * this->Increments[0] + j * this->Increments[1] + k * this->Increments[2];
+        for (; ijk[0] <= extent[1]; ++ijk[0], voxel += this->Increments[0])
+          {
+          double gradient[3][3];
+          vtkSlicerDataProbeDisplacementGradient(voxel, ijk, this->Dimensions, this->Increments, gradient);
+          double deformation[3][3];
+          vtkSlicerDataProbeDeformationGradient(gradient, this->JacobianT, deformation);
+          const double determinant = vtkSlicerDataProbeDeterminant3x3(deformation);
+          if (determinant < result.MinimumDeterminant)
+            {
+            result.MinimumDeterminant = determinant;
+            std::copy(ijk, ijk + 3, result.MinimumIJK);
+            }
+          if (determinant <= 0.0)
+            {
+            ++result.NumberOfFoldedVoxels;
+            for (int axis = 0; axis < 3; ++axis)
+              {
+              result.FoldedExtent[2 * axis] = std::min(result.FoldedExtent[2 * axis], ijk[axis]);
+              result.FoldedExtent[2 * axis + 1] = std::max(result.FoldedExtent[2 * axis + 1], ijk[axis]);
+              }
+            }
+          }
+        result.NumberOfVoxels += extent[1] - extent[0] + 1;
+        }
+      }
+  }
+
+  static VTK_THREAD_RETURN_TYPE Execute(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    vtkSlicerDataProbeFoldingTask* self = static_cast<vtkSlicerDataProbeFoldingTask*>(threadInfo->UserData);
+    const int numberOfSlices = self->Extent[5] - self->Extent[4] + 1;
+    const int firstSlice = self->Extent[4] + numberOfSlices * threadInfo->ThreadID / threadInfo->NumberOfThreads;
+    const int lastSlice = self->Extent[4] + numberOfSlices * (threadInfo->ThreadID + 1) / threadInfo->NumberOfThreads - 1;
+    vtkSlicerDataProbeFoldingResult& result = self->Results[threadInfo->ThreadID];
+    switch (self->ScalarType)
+      {
+      vtkTemplateMacro(self->ScanSlices(static_cast<const VTK_TT*>(self->Scalars), firstSlice, lastSlice, result));
+      default:
+        break;
+      }
+    return VTK_THREAD_RETURN_VALUE;
+  }
+};
+
+//----------------------------------------------------------------------------
+// Voxel traversal
+
+//----------------------------------------------------------------------------
+/// 3D-DDA traversal (Amanatides & Woo) of the voxels crossed by a segment
+/// given in IJK coordinates, voxel centers being at integer coordinates.
+class vtkSlicerDataProbeVoxelTraversal
+{
+public:
+  /// Clip the segment [start, end] to the image of dimensions \a dims and
+  /// move to its first voxel. Return false if the segment misses the image.
+  bool Initialize(const double start[3], const double end[3], const int dims[3])
+    {
+    double t0 = 0.0;
+    double t1 = 1.0;
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      this->Start[axis] = start[axis];
+      this->Direction[axis] = end[axis] - start[axis];
+      this->Dimensions[axis] = dims[axis];
+      const double lower = -0.5;
+      const double upper = dims[axis] - 0.5;
+      if (this->Direction[axis] == 0.0)
+        {
+        if (start[axis] < lower || start[axis] >= upper)
+          {
+          return false;
+          }
+        continue;
+        }
+      double ta = (lower - start[axis]) / this->Direction[axis];
+      double tb = (upper - start[axis]) / this->Direction[axis];
+      t0 = std::max(t0, std::min(ta, tb));
+      t1 = std::min(t1, std::max(ta, tb));
+      }
+    if (t0 > t1)
+      {
+      return false;
+      }
+    this->StartParameter = t0;
+    this->EndParameter = t1;
+    return this->Restart(t0);
+    }
+
+  /// Move to the voxel containing the point at parameter \a t of the segment.
+  /// Return false if \a t is past the end of the clipped segment.
+  bool Restart(double t)
+    {
+    if (t > this->EndParameter)
+      {
+      return false;
+      }
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      const double position = this->Start[axis] + t * this->Direction[axis];
+      this->Voxel[axis] = std::min(std::max(
+        static_cast<int>(floor(position + 0.5)), 0), this->Dimensions[axis] - 1);
+      if (this->Direction[axis] > 0.0)
+        {
+        this->Step[axis] = 1;
+        this->NextBoundary[axis] = (this->Voxel[axis] + 0.5 - this->Start[axis]) / this->Direction[axis];
+        this->BoundaryDelta[axis] = 1.0 / this->Direction[axis];
+        }
+      else if (this->Direction[axis] < 0.0)
+        {
+        this->Step[axis] = -1;
+        this->NextBoundary[axis] = (this->Voxel[axis] - 0.5 - this->Start[axis]) / this->Direction[axis];
+        this->BoundaryDelta[axis] = -1.0 / this->Direction[axis];
+        }
+      else
+        {
+        this->Step[axis] = 0;
+        this->NextBoundary[axis] = VTK_DOUBLE_MAX;
+        this->BoundaryDelta[axis] = VTK_DOUBLE_MAX;
+        }
+      }
+    return true;
+    }
+
+  /// Move to the next voxel crossed by the segment.
+  /// Return false when the end of the segment is reached.
+  bool Next()
+    {
+    int axis = this->ExitAxis();
+    if (this->NextBoundary[axis] > this->EndParameter)
+      {
+      return false;
+      }
+    this->Voxel[axis] += this->Step[axis];
+    if (this->Voxel[axis] < 0 || this->Voxel[axis] >= this->Dimensions[axis])
+      {
+      return false;
+      }
+    this->NextBoundary[axis] += this->BoundaryDelta[axis];
+    return true;
+    }
+
+  /// Parameters of the segment at which the image is entered and exited.
+  double GetStartParameter()const
+    {
+    return this->StartParameter;
+    }
+  double GetEndParameter()const
+    {
+    return this->EndParameter;
+    }
+
+  /// Parameter of the segment at which the current voxel is exited.
+  double GetExitParameter()const
+    {
+    return std::min(this->NextBoundary[this->ExitAxis()], this->EndParameter);
+    }
+
+  const int* GetVoxel()const
+    {
+    return this->Voxel;
+    }
+
+  /// Length of the segment direction in voxels.
+  double GetLength()const
+    {
+    return sqrt(vtkMath::Dot(this->Direction, this->Direction));
+    }
+
+  void GetPoint(double t, double point[3])const
+    {
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      point[axis] = this->Start[axis] + t * this->Direction[axis];
+      }
+    }
+
+protected:
+  int ExitAxis()const
+    {
+    int axis = this->NextBoundary[0] < this->NextBoundary[1] ? 0 : 1;
+    return this->NextBoundary[axis] < this->NextBoundary[2] ? axis : 2;
+    }
+
+  double Start[3];
+  double Direction[3];
+  int Dimensions[3];
+  double StartParameter;
+  double EndParameter;
+  int Voxel[3];
+  int Step[3];
+  double NextBoundary[3];
+  double BoundaryDelta[3];
+};
+
+//----------------------------------------------------------------------------
+/// Read the component \a component of the voxels \a voxelOffsets.
+template <class T>
+void vtkSlicerDataProbeReadVoxels(const T* scalars, int numberOfComponents, int component,
+                                  const std::vector<vtkIdType>& voxelOffsets, std::vector<double>& values)
+{
+  values.resize(voxelOffsets.size());
+  const T* componentScalars = scalars + component;
+  for (size_t voxelIdx = 0; voxelIdx < voxelOffsets.size(); ++voxelIdx)
+    {
+    values[voxelIdx] = static_cast<double>(componentScalars[voxelOffsets[voxelIdx] * numberOfComponents]);
+    }
+}
+
+//----------------------------------------------------------------------------
+/// March along the ray traversed by \a voxels, visiting only the blocks
+/// traversed by \a blocks that may contain the searched voxel.
+/// Both traversals must share the same segment parameterization.
+/// Return true if a voxel is found.
+template <class T>
+bool vtkSlicerDataProbeMarchRay(const T* scalars, int numberOfComponents, const int dims[3],
+                                vtkSlicerDataProbeVoxelTraversal& blocks,
+                                vtkSlicerDataProbeVoxelTraversal& voxels,
+                                vtkSlicerDataProbeBlockMinMax* blockMinMax,
+                                int mode, double threshold,
+                                int hitVoxel[3], double& hitValue, double& hitParameter)
+{
+  const bool maximumMode = (mode == vtkSlicerDataProbeLogic::MAXIMUM_RAY_MODE);
+  bool found = false;
+  double blockEntry = blocks.GetStartParameter();
+  do
+    {
+    const double blockExit = blocks.GetExitParameter();
+    const int* block = blocks.GetVoxel();
+    const double blockMaximum = blockMinMax->GetBlockMaximum(block[0], block[1], block[2]);
+    const bool visit = maximumMode ? (!found || blockMaximum > hitValue) : blockMaximum >= threshold;
+    double voxelEntry = std::max(blockEntry, voxels.GetStartParameter());
+    if (visit && voxelEntry < blockExit && voxels.Restart(voxelEntry))
+      {
+      for (;;)
+        {
+        const int* voxel = voxels.GetVoxel();
+        const double value = static_cast<double>(scalars[
+          (voxel[0] + dims[0] * (voxel[1] + static_cast<vtkIdType>(dims[1]) * voxel[2])) * numberOfComponents]);
+        const double voxelExit = voxels.GetExitParameter();
+        if (maximumMode ? (!found || value > hitValue) : value >= threshold)
+          {
+          found = true;
+          hitValue = value;
+          hitParameter = 0.5 * (voxelEntry + voxelExit);
+          hitVoxel[0] = voxel[0];
+          hitVoxel[1] = voxel[1];
+          hitVoxel[2] = voxel[2];
+          if (!maximumMode)
+            {
+            return true;
+            }
+          }
+        if (voxelExit >= blockExit || !voxels.Next())
+          {
+          break;
+          }
+        voxelEntry = voxelExit;
+        }
+      }
+    blockEntry = blockExit;
+    }
+  while (blocks.Next());
+  return found;
+}
+
+//----------------------------------------------------------------------------
+/// Return the entry of \a entries associated with \a imageData, 0 if there
+/// is none.
+template <class T>
+T* vtkSlicerDataProbeFindImageEntry(std::vector<vtkSmartPointer<T> >& entries, vtkImageData* imageData)
+{
+  for (size_t entryIdx = 0; imageData && entryIdx < entries.size(); ++entryIdx)
+    {
+    if (entries[entryIdx]->GetImageData() == imageData)
+      {
+      return entries[entryIdx];
+      }
+    }
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+/// Return the entry of \a entries associated with \a imageData. If there is
+/// none, the entry of a deleted image is reused or a new entry is added.
+/// The entry is not updated.
+template <class T>
+T* vtkSlicerDataProbeGetImageEntry(std::vector<vtkSmartPointer<T> >& entries, vtkImageData* imageData)
+{
+  T* freeEntry = 0;
+  for (size_t entryIdx = 0; entryIdx < entries.size(); ++entryIdx)
+    {
+    T* entry = entries[entryIdx];
+    if (entry->GetImageData() == imageData)
+      {
+      return entry;
+      }
+    if (!freeEntry && !entry->GetImageData())
+      {
+      freeEntry = entry;
+      }
+    }
+  if (!freeEntry)
+    {
+    entries.push_back(vtkSmartPointer<T>::New());
+    freeEntry = entries.back();
+    }
+  return freeEntry;
+}
+
+//----------------------------------------------------------------------------
+// Layer comparison helpers
+
+//----------------------------------------------------------------------------
+/// Sums over the pairs of reference and moving values of a neighborhood.
+struct vtkSlicerDataProbeLayerSums
+{
+  vtkSlicerDataProbeLayerSums();
+
+  vtkIdType Count;
+  double Sum[2];
+  double SumOfSquares[2];
+  double SumOfProducts;
+  double SumOfSquaredDifferences;
+};
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeLayerSums::vtkSlicerDataProbeLayerSums()
+{
+  this->Count = 0;
+  this->Sum[0] = this->Sum[1] = 0.0;
+  this->SumOfSquares[0] = this->SumOfSquares[1] = 0.0;
+  this->SumOfProducts = 0.0;
+  this->SumOfSquaredDifferences = 0.0;
+}
+
+//----------------------------------------------------------------------------
+/// Interpolate trilinearly the first component of \a scalars at \a ijk.
+/// Return false if \a ijk is outside of the image.
+template <class T>
+bool vtkSlicerDataProbeInterpolate(const T* scalars, const int dims[3], int numberOfComponents,
+                                   const double ijk[3], double& value)
+{
+  int base[3];
+  int next[3];
+  double fraction[3];
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    if (!(ijk[axis] >= 0.0 && ijk[axis] <= dims[axis] - 1))
+      {
+      return false;
+      }
+    base[axis] = static_cast<int>(ijk[axis]);
+    next[axis] = std::min(base[axis] + 1, dims[axis] - 1);
+    fraction[axis] = ijk[axis] - base[axis];
+    }
+  const vtkIdType incrementY = static_cast<vtkIdType>(dims[0]) * numberOfComponents;
+  const vtkIdType incrementZ = incrementY * dims[1];
+  const vtkIdType offsetI[2] = {base[0] * numberOfComponents, next[0] * numberOfComponents};
+  const vtkIdType offsetJ[2] = {base[1] * incrementY, next[1] * incrementY};
+  const vtkIdType offsetK[2] = {base[2] * incrementZ, next[2] * incrementZ};
+  value = 0.0;
+  for (int dk = 0; dk < 2; ++dk)
+    {
+    const double weightK = dk ? fraction[2] : 1.0 - fraction[2];
+    for (int dj = 0; dj < 2; ++dj)
+      {
+      const double weightJK = weightK * (dj ? fraction[1] : 1.0 - fraction[1]);
+      const T* row = scalars + offsetK[dk] + offsetJ[dj];
+      value += weightJK * ((1.0 - fraction[0]) * static_cast<double>(row[offsetI[0]]) +
+                           fraction[0] * static_cast<double>(row[offsetI[1]]));
+      }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+/// Pair the reference neighborhood \a referenceValues, gathered around
+/// \a center by vtkSlicerDataProbeGatherNeighborhood(), with the moving image
+/// interpolated at the positions mapped by \a referenceToMoving (IJK to IJK)
+/// and accumulate the pairs in \a sums. Reference voxels outside of the
+/// reference image and positions outside of the moving image are skipped.
+/// \a centerValue receives the moving value paired with \a center, NaN if
+/// it is outside of the moving image.
+template <class T>
+void vtkSlicerDataProbeCompareNeighborhood(const T* movingScalars, const int movingDims[3],
+                                           int numberOfComponents, const double* referenceValues,
+                                           const int referenceDims[3], const int center[3], int radius,
+                                           const double referenceToMoving[3][4],
+                                           double& centerValue, vtkSlicerDataProbeLayerSums& sums)
+{
+  centerValue = vtkMath::Nan();
+  const double* referenceValue = referenceValues;
+  for (int dk = -radius; dk <= radius; ++dk)
+    {
+    for (int dj = -radius; dj <= radius; ++dj)
+      {
+      for (int di = -radius; di <= radius; ++di, ++referenceValue)
+        {
+        const int voxel[3] = {center[0] + di, center[1] + dj, center[2] + dk};
+        if (voxel[0] < 0 || voxel[0] >= referenceDims[0] ||
+            voxel[1] < 0 || voxel[1] >= referenceDims[1] ||
+            voxel[2] < 0 || voxel[2] >= referenceDims[2])
+          {
+          continue;
+          }
+        double movingIJK[3];
+        for (int row = 0; row < 3; ++row)
+          {
+          movingIJK[row] = referenceToMoving[row][0] * voxel[0] + referenceToMoving[row][1] * voxel[1] +
+                           referenceToMoving[row][2] * voxel[2] + referenceToMoving[row][3];
+          }
+        double movingValue = 0.0;
+        if (!vtkSlicerDataProbeInterpolate(movingScalars, movingDims, numberOfComponents,
+                                           movingIJK, movingValue))
+          {
+          continue;
+          }
+        if (di == 0 && dj == 0 && dk == 0)
+          {
+          centerValue = movingValue;
+          }
+        const double difference = movingValue - *referenceValue;
+        ++sums.Count;
+        sums.Sum[0] += *referenceValue;
+        sums.Sum[1] += movingValue;
+        sums.SumOfSquares[0] += *referenceValue * *referenceValue;
+        sums.SumOfSquares[1] += movingValue * movingValue;
+        sums.SumOfProducts += *referenceValue * movingValue;
+        sums.SumOfSquaredDifferences += difference * difference;
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Label decoding helpers
+
+//----------------------------------------------------------------------------
+/// Return the index of the lowest set bit of \a bits, which must not be 0.
+inline int vtkSlicerDataProbeLowestSetBit(vtkTypeUInt64 bits)
+{
+#if defined(__GNUC__)
+  return __builtin_ctzll(bits);
+#elif defined(_MSC_VER) && defined(_WIN64)
+  unsigned long bitIdx = 0;
+  _BitScanForward64(&bitIdx, bits);
+  return static_cast<int>(bitIdx);
+#else
+  int bitIdx = 0;
+  for (; !(bits & 1); bits >>= 1)
+    {
+    ++bitIdx;
+    }
+  return bitIdx;
+#endif
+}
+
+//----------------------------------------------------------------------------
+/// Append to \a segments the segments stored in the \a numberOfComponents
+/// components of \a voxel, see vtkSlicerDataProbeLogic::LabelEncoding.
+/// Floating point scalars can't be bit-packed, they are decoded as layers.
+template <class T>
+void vtkSlicerDataProbeDecodeSegments(const T* voxel, int numberOfComponents, bool bitPacked,
+                                      std::vector<int>& segments)
+{
+  if (!bitPacked || !std::numeric_limits<T>::is_integer)
+    {
+    for (int componentIdx = 0; componentIdx < numberOfComponents; ++componentIdx)
+      {
+      const int label = static_cast<int>(voxel[componentIdx]);
+      if (label != 0)
+        {
+        segments.push_back(label);
+        }
+      }
+    return;
+    }
+  const int bitsPerComponent = static_cast<int>(8 * sizeof(T));
+  const vtkTypeUInt64 componentMask = bitsPerComponent >= 64 ?
+    ~static_cast<vtkTypeUInt64>(0) : (static_cast<vtkTypeUInt64>(1) << bitsPerComponent) - 1;
+  for (int componentIdx = 0; componentIdx < numberOfComponents; ++componentIdx)
+    {
+    vtkTypeUInt64 bits = static_cast<vtkTypeUInt64>(voxel[componentIdx]) & componentMask;
+    for (; bits; bits &= bits - 1)
+      {
+      segments.push_back(componentIdx * bitsPerComponent + vtkSlicerDataProbeLowestSetBit(bits) + 1);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeAbsoluteLess(double a, double b)
+{
+  return fabs(a) < fabs(b);
+}
+
+//----------------------------------------------------------------------------
+/// Return the fractional anisotropy of the symmetric \a tensor.
+double vtkSlicerDataProbeFractionalAnisotropy(const double tensor[9])
+{
+  double matrix[3][3];
+  for (int row = 0; row < 3; ++row)
+    {
+    for (int column = 0; column < 3; ++column)
+      {
+      matrix[row][column] = tensor[3 * row + column];
+      }
+    }
+  double eigenvalues[3];
+  double eigenvectors[3][3];
+  vtkMath::Diagonalize3x3(matrix, eigenvalues, eigenvectors);
+  const double mean = (eigenvalues[0] + eigenvalues[1] + eigenvalues[2]) / 3.0;
+  const double norm2 = eigenvalues[0] * eigenvalues[0] + eigenvalues[1] * eigenvalues[1] +
+    eigenvalues[2] * eigenvalues[2];
+  if (norm2 <= 0.0)
+    {
+    return 0.0;
+    }
+  const double deviation2 = (eigenvalues[0] - mean) * (eigenvalues[0] - mean) +
+    (eigenvalues[1] - mean) * (eigenvalues[1] - mean) + (eigenvalues[2] - mean) * (eigenvalues[2] - mean);
+  return sqrt(1.5 * deviation2 / norm2);
+}
+
+} // end of anonymous namespace
 
 //----------------------------------------------------------------------------
 class vtkSlicerDataProbeLogic::vtkInternal
@@ -52,210 +899,2348 @@ public:
 
   void ResetProbe();
 
-  vtkSmartPointer<vtkDiffusionTensorMathematics> DTIMath;
-  vtkSmartPointer<vtkImageData> SinglePixelImage;
-  vtkSmartPointer<vtkFloatArray> TensorData;
+  /// Set the probe values and description from the label \a labelIndex
+  /// of \a scalarVolumeNode and return the probe status.
+  int ProbeLabel(vtkMRMLScalarVolumeNode* scalarVolumeNode, double labelIndex);
 
-  int PixelProbeStatus;
-  std::string PixelDescription;
+  /// Set the probe segments, values and description from the overlapping
+  /// segments of the voxel \a ijk of \a scalarVolumeNode.
+  int ProbeLabelSegments(vtkMRMLScalarVolumeNode* scalarVolumeNode, vtkImageData* imageData,
+                         const int ijk[3], bool bitPacked);
 
-  int PixelNumberOfComponents;
+  /// Return the name of the color \a colorIndex of \a colorNode. The names
+  /// of the last color node are cached until it is modified.
+  std::string GetLabelName(vtkMRMLColorNode* colorNode, int colorIndex);
 
-  int NumberOfPixelValues;
+  /// Probe the label of \a volumeNode at \a ijk and the labels within the
+  /// (2 * cubeRadius + 1)^3 window around it or, if \a ballRadius is not 0,
+  /// within the ellipsoid of semi-axes \a ballRadius voxels.
+  int ProbeLabelComposition(vtkMRMLVolumeNode* volumeNode, double ijk[3], int cubeRadius,
+                            const double* ballRadius);
+
+  /// Return the image data of \a volumeNode if it is a scalar volume and if
+  /// \a ijk is within its frame. Otherwise set the probe status and return 0.
+  vtkImageData* GetProbedImageData(vtkMRMLVolumeNode* volumeNode, const double ijk[3]);
+
+  /// Map the IJK position \a ijk of \a volumeNode into world coordinates.
+  static void IJKToWorld(vtkMRMLVolumeNode* volumeNode, const double ijk[3], double ras[3]);
+
+  /// Return the pipeline computing the scalar invariants of a single tensor,
+  /// creating it on first use.
+  vtkDiffusionTensorMathematics* GetDTIMath();
+
+  /// Fill \a referenceToMoving with the mapping of the IJK coordinates of
+  /// \a referenceNode into the IJK coordinates of \a movingNode. The cached
+  /// composed matrix is used for linear transforms, otherwise the mapping is
+  /// linearized around the reference voxel \a center.
+  void GetLayerMapping(vtkMRMLVolumeNode* referenceNode, vtkMRMLVolumeNode* movingNode,
+                       const int center[3], double referenceToMoving[3][4]);
+
+  /// Return the up-to-date block extrema of \a imageData, computing them
+  /// if needed. Return 0 if they can't be computed.
+  vtkSlicerDataProbeBlockMinMax* GetBlockMinMax(vtkImageData* imageData);
+
+  /// Find the slices of the label map \a volumeNode modified since the
+  /// indexes were last updated, by comparing their checksums, and pass them
+  /// to LabelMapModified().
+  void UpdateModifiedLabelMap(vtkMRMLScalarVolumeNode* volumeNode);
+
+  /// Map the world position \a ras into the local coordinates of the
+  /// polydata of \a modelNode.
+  static void WorldToModel(vtkMRMLModelNode* modelNode, const double ras[3], double localPosition[3]);
+
+  /// Return the radius, in the local coordinates of \a modelNode, of a
+  /// sphere containing the world sphere of \a radius centered on \a ras.
+  static double WorldToModelRadius(vtkMRMLModelNode* modelNode, const double ras[3], double radius);
+
+  struct ProbedFiber
+  {
+    vtkIdType CellId;
+    vtkIdType PointId;
+    double Distance;
+    double Value;
+
+    /// Group the points by fiber, closest first.
+    bool operator<(const ProbedFiber& other)const
+    {
+      return this->CellId < other.CellId || (this->CellId == other.CellId && this->Distance < other.Distance);
+    }
+    bool operator==(const ProbedFiber& other)const
+    {
+      return this->CellId == other.CellId;
+    }
+    static bool CloserThan(const ProbedFiber& fiber, const ProbedFiber& other)
+    {
+      return fiber.Distance < other.Distance;
+    }
+  };
+
+  vtkSmartPointer<vtkDiffusionTensorMathematics> DTIMath;
+  vtkSmartPointer<vtkImageData> SinglePixelImage;
+  vtkSmartPointer<vtkFloatArray> TensorData;
+  vtkSmartPointer<vtkSlicerDataProbeTensorScalarCache> TensorScalarCache;
+  vtkSmartPointer<vtkSlicerDataProbeTransformCache> TransformCache;
+  vtkSmartPointer<vtkSlicerDataProbeBatchEngine> BatchEngine;
+  vtkSmartPointer<vtkSlicerDataProbeSharedMemoryStream> SharedMemoryStream;
+  vtkWeakPointer<vtkMRMLDataProbeResultNode> ResultNode;
+
+  int PixelProbeStatus;
+  std::string PixelDescription;
+
+  int PixelNumberOfComponents;
+
+  std::vector<int> PixelSegments;
+  std::vector<std::string> PixelSegmentNames;
+
+  vtkWeakPointer<vtkMRMLColorNode> LabelNamesColorNode;
+  unsigned long LabelNamesMTime;
+  std::vector<std::string> LabelNames;
+
+  int NumberOfPixelValues;
   static const int MAX_NUMBER_OF_PIXEL_VALUES = 3;
   double PixelValues[MAX_NUMBER_OF_PIXEL_VALUES];
+  int PixelVoxel[3];
+
+  double DisplayedWindowLevelValue;
+  bool DisplayedColorValid;
+  double DisplayedColor[4];
+
+  double Gradient[3];
+  double GradientMagnitude;
+  double HessianEigenvalues[3];
+  double IsophoteCurvature;
+
+  std::vector<vtkIdType> PathVoxelOffsets;
+  std::vector<int> PathVoxelIJKs;
+  std::vector<double> PathValues;
+
+  std::vector<vtkSmartPointer<vtkSlicerDataProbeBlockMinMax> > BlockMinMaxes;
+  double RayHitRAS[3];
+  int RayHitIJK[3];
+
+  std::vector<vtkSmartPointer<vtkSlicerDataProbeSliceChecksums> > SliceChecksums;
+  std::vector<vtkSmartPointer<vtkSlicerDataProbeLabelIndex> > LabelIndexes;
+  vtkIdType LabelNumberOfVoxels;
+  double LabelVolume;
+  double LabelCentroid[3];
+  int LabelBounds[6];
+
+  std::vector<vtkSmartPointer<vtkSlicerDataProbeComponentIndex> > ComponentIndexes;
+  unsigned int ComponentId;
+  vtkIdType ComponentNumberOfVoxels;
+  double ComponentVolume;
+  double ComponentCentroid[3];
+
+  std::vector<vtkSmartPointer<vtkSlicerDataProbeLabelComposition> > LabelCompositions;
+  std::vector<int> NeighborhoodLabels;
+  std::vector<double> NeighborhoodLabelFractions;
+  std::vector<std::string> NeighborhoodLabelNames;
+
+  std::vector<vtkSmartPointer<vtkSlicerDataProbeDistanceMap> > DistanceMaps;
+  double BoundaryDistance;
+
+  std::vector<vtkSmartPointer<vtkSlicerDataProbeHistogram> > Histograms;
+  double Percentile;
+
+  double LayerDifference;
+  double LayerRatio;
+  double LayerCorrelation;
+  double LayerRMSDifference;
+
+  double Displacement[3];
+  double JacobianDeterminant;
+  double PrincipalStrains[3];
+  vtkSlicerDataProbeFoldingResult Folding;
+
+  std::vector<vtkSmartPointer<vtkSlicerDataProbePointLocator> > PointLocators;
+  double ModelDistance;
+  vtkIdType ModelPointId;
+  vtkIdType ModelCellId;
+
+  vtkSmartPointer<vtkIdList> FiberPointIds;
+  vtkSmartPointer<vtkIdList> ModelCellIds;
+  std::vector<ProbedFiber> ProbedFibers;
+
+  std::vector<vtkSmartPointer<vtkSlicerDataProbeViewportStatistics> > ViewportStatistics;
+  vtkSlicerDataProbeViewportStatistics* ProbedViewportStatistics;
 
   vtkSlicerDataProbeLogic*      External;
 };
 
 //---------------------------------------------------------------------------
-// vtkInternal methods
+// vtkInternal methods
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeLogic::vtkInternal::vtkInternal(
+    vtkSlicerDataProbeLogic* _external)
+{
+  this->External = _external;
+  this->LabelNamesMTime = 0;
+
+  // The DTI pipeline, the tensor scalar cache, the batch engine and the
+  // shared memory stream are created on first use, see GetDTIMath(),
+  // GetTensorScalarCache(), GetBatchEngine() and GetSharedMemoryStream().
+  this->TransformCache = vtkSmartPointer<vtkSlicerDataProbeTransformCache>::New();
+  this->FiberPointIds = vtkSmartPointer<vtkIdList>::New();
+  this->ModelCellIds = vtkSmartPointer<vtkIdList>::New();
+
+  this->ResetProbe();
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeLogic::vtkInternal::~vtkInternal()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::vtkInternal::ResetProbe()
+{
+  this->NumberOfPixelValues = 0;
+  this->PixelNumberOfComponents = 0;
+  for (int pixelValueIdx = 0; pixelValueIdx < MAX_NUMBER_OF_PIXEL_VALUES; ++pixelValueIdx)
+    {
+    this->PixelValues[pixelValueIdx] = vtkMath::Nan();
+    }
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->PixelVoxel[axis] = -1;
+    }
+  this->PixelDescription.clear();
+  this->PixelSegments.clear();
+  this->PixelSegmentNames.clear();
+  this->PixelProbeStatus = vtkSlicerDataProbeLogic::UNKNOWN;
+  this->DisplayedWindowLevelValue = vtkMath::Nan();
+  this->DisplayedColorValid = false;
+  for (int componentIdx = 0; componentIdx < 4; ++componentIdx)
+    {
+    this->DisplayedColor[componentIdx] = 0.0;
+    }
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Gradient[axis] = vtkMath::Nan();
+    this->HessianEigenvalues[axis] = vtkMath::Nan();
+    }
+  this->GradientMagnitude = vtkMath::Nan();
+  this->IsophoteCurvature = vtkMath::Nan();
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->RayHitRAS[axis] = vtkMath::Nan();
+    this->RayHitIJK[axis] = -1;
+    }
+  this->ModelDistance = vtkMath::Nan();
+  this->ModelPointId = -1;
+  this->ModelCellId = -1;
+  this->ProbedFibers.clear();
+  this->LabelNumberOfVoxels = 0;
+  this->LabelVolume = vtkMath::Nan();
+  this->ComponentId = 0;
+  this->ComponentNumberOfVoxels = 0;
+  this->ComponentVolume = vtkMath::Nan();
+  this->NeighborhoodLabels.clear();
+  this->NeighborhoodLabelFractions.clear();
+  this->NeighborhoodLabelNames.clear();
+  this->BoundaryDistance = vtkMath::Nan();
+  this->Percentile = vtkMath::Nan();
+  this->LayerDifference = vtkMath::Nan();
+  this->LayerRatio = vtkMath::Nan();
+  this->LayerCorrelation = vtkMath::Nan();
+  this->LayerRMSDifference = vtkMath::Nan();
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Displacement[axis] = vtkMath::Nan();
+    this->PrincipalStrains[axis] = vtkMath::Nan();
+    }
+  this->JacobianDeterminant = vtkMath::Nan();
+  this->Folding = vtkSlicerDataProbeFoldingResult();
+  this->ProbedViewportStatistics = 0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->LabelCentroid[axis] = vtkMath::Nan();
+    this->ComponentCentroid[axis] = vtkMath::Nan();
+    this->LabelBounds[2 * axis] = 0;
+    this->LabelBounds[2 * axis + 1] = -1;
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkSlicerDataProbeLogic::vtkInternal::GetProbedImageData(
+  vtkMRMLVolumeNode* volumeNode, const double ijk[3])
+{
+  vtkMRMLScalarVolumeNode * scalarVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode);
+  if (!scalarVolumeNode)
+    {
+    this->PixelProbeStatus = PROBE_ERROR_NO_SCALAR_VOLUME;
+    return 0;
+    }
+
+  vtkImageData * imageData = scalarVolumeNode->GetImageData();
+  if(!imageData)
+    {
+    this->PixelProbeStatus = PROBE_ERROR_NO_IMAGE_DATA;
+    return 0;
+    }
+
+  int dims[3] = {-1, -1, -1};
+  imageData->GetDimensions(dims);
+  for (int dimIdx = 0; dimIdx < 3; ++dimIdx)
+    {
+    if(ijk[dimIdx] < 0 || ijk[dimIdx] >= dims[dimIdx])
+      {
+      this->PixelProbeStatus = PROBE_ERROR_OUT_OF_FRAME;
+      return 0;
+      }
+    }
+  return imageData;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::vtkInternal::GetLayerMapping(
+  vtkMRMLVolumeNode* referenceNode, vtkMRMLVolumeNode* movingNode,
+  const int center[3], double referenceToMoving[3][4])
+{
+  vtkNew<vtkMatrix4x4> ijkToIJK;
+  if (this->TransformCache->GetIJKToIJKMatrix(referenceNode, movingNode, ijkToIJK.GetPointer()))
+    {
+    for (int row = 0; row < 3; ++row)
+      {
+      for (int column = 0; column < 4; ++column)
+        {
+        referenceToMoving[row][column] = ijkToIJK->GetElement(row, column);
+        }
+      }
+    return;
+    }
+  // Map the center and its 3 IJK neighbors, the columns are the differences
+  double mapped[4][3];
+  for (int pointIdx = 0; pointIdx < 4; ++pointIdx)
+    {
+    double ijk[3] = {static_cast<double>(center[0]), static_cast<double>(center[1]),
+                     static_cast<double>(center[2])};
+    if (pointIdx > 0)
+      {
+      ijk[pointIdx - 1] += 1.0;
+      }
+    double ras[3] = {0.0, 0.0, 0.0};
+    vtkInternal::IJKToWorld(referenceNode, ijk, ras);
+    this->TransformCache->TransformRASToIJK(movingNode, ras, mapped[pointIdx]);
+    }
+  for (int row = 0; row < 3; ++row)
+    {
+    referenceToMoving[row][3] = mapped[0][row];
+    for (int column = 0; column < 3; ++column)
+      {
+      referenceToMoving[row][column] = mapped[column + 1][row] - mapped[0][row];
+      referenceToMoving[row][3] -= referenceToMoving[row][column] * center[column];
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkDiffusionTensorMathematics* vtkSlicerDataProbeLogic::vtkInternal::GetDTIMath()
+{
+  if (this->DTIMath)
+    {
+    return this->DTIMath;
+    }
+  this->SinglePixelImage = vtkSmartPointer<vtkImageData>::New();
+  this->SinglePixelImage->SetExtent(0, 0, 0, 0, 0, 0);
+  this->SinglePixelImage->AllocateScalars();
+
+  this->TensorData = vtkSmartPointer<vtkFloatArray>::New();
+  this->TensorData->SetNumberOfComponents(9);
+  this->TensorData->SetNumberOfTuples(this->SinglePixelImage->GetNumberOfPoints());
+  this->SinglePixelImage->GetPointData()->SetTensors(this->TensorData);
+
+  this->DTIMath = vtkSmartPointer<vtkDiffusionTensorMathematics>::New();
+  this->DTIMath->SetInput(this->SinglePixelImage);
+  return this->DTIMath;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::vtkInternal::IJKToWorld(
+  vtkMRMLVolumeNode* volumeNode, const double ijk[3], double ras[3])
+{
+  vtkNew<vtkMatrix4x4> ijkToRAS;
+  volumeNode->GetIJKToRASMatrix(ijkToRAS.GetPointer());
+  double ijkw[4] = {ijk[0], ijk[1], ijk[2], 1.0};
+  double rasw[4] = {0.0, 0.0, 0.0, 1.0};
+  ijkToRAS->MultiplyPoint(ijkw, rasw);
+  ras[0] = rasw[0];
+  ras[1] = rasw[1];
+  ras[2] = rasw[2];
+  vtkMRMLTransformNode * transformNode = volumeNode->GetParentTransformNode();
+  if (transformNode)
+    {
+    vtkNew<vtkGeneralTransform> localToWorld;
+    transformNode->GetTransformToWorld(localToWorld.GetPointer());
+    localToWorld->TransformPoint(rasw, ras);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::vtkInternal::UpdateModifiedLabelMap(vtkMRMLScalarVolumeNode* volumeNode)
+{
+  vtkImageData * imageData = volumeNode->GetImageData();
+  int modifiedExtent[6];
+  if (vtkSlicerDataProbeGetImageEntry(this->SliceChecksums, imageData)->Update(imageData, modifiedExtent))
+    {
+    this->External->LabelMapModified(volumeNode, modifiedExtent);
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeBlockMinMax* vtkSlicerDataProbeLogic::vtkInternal::GetBlockMinMax(vtkImageData* imageData)
+{
+  vtkSlicerDataProbeBlockMinMax* blockMinMax =
+    vtkSlicerDataProbeGetImageEntry(this->BlockMinMaxes, imageData);
+  return blockMinMax->Update(imageData) ? blockMinMax : 0;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::vtkInternal::ProbeLabel(
+  vtkMRMLScalarVolumeNode* scalarVolumeNode, double labelIndex)
+{
+  std::string labelName;
+  int labelProbeStatus = LABEL_VOLUME;
+  vtkMRMLColorNode * colorNode = scalarVolumeNode->GetDisplayNode() ?
+    scalarVolumeNode->GetDisplayNode()->GetColorNode() : 0;
+  if (colorNode)
+    {
+    labelName = this->GetLabelName(colorNode, static_cast<int>(labelIndex));
+    }
+  else
+    {
+    labelProbeStatus = PROBE_WARNING_LABEL_VOLUME_UNKNOWN_LABELNAME;
+    }
+  this->PixelNumberOfComponents = 1;
+  this->PixelValues[0] = labelIndex;
+  this->PixelDescription = labelName;
+  this->PixelProbeStatus = labelProbeStatus | PROBE_SUCCESS;
+  return this->PixelProbeStatus;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::vtkInternal::ProbeLabelSegments(
+  vtkMRMLScalarVolumeNode* scalarVolumeNode, vtkImageData* imageData, const int ijk[3], bool bitPacked)
+{
+  void* voxel = imageData->GetScalarPointer(ijk[0], ijk[1], ijk[2]);
+  switch (imageData->GetScalarType())
+    {
+    vtkTemplateMacro(vtkSlicerDataProbeDecodeSegments(
+      static_cast<VTK_TT*>(voxel), imageData->GetNumberOfScalarComponents(),
+      bitPacked, this->PixelSegments));
+    }
+  int labelProbeStatus = LABEL_VOLUME;
+  vtkMRMLColorNode * colorNode = scalarVolumeNode->GetDisplayNode() ?
+    scalarVolumeNode->GetDisplayNode()->GetColorNode() : 0;
+  if (!colorNode)
+    {
+    labelProbeStatus = PROBE_WARNING_LABEL_VOLUME_UNKNOWN_LABELNAME;
+    }
+  for (size_t segmentIdx = 0; segmentIdx < this->PixelSegments.size(); ++segmentIdx)
+    {
+    std::string segmentName =
+      colorNode ? this->GetLabelName(colorNode, this->PixelSegments[segmentIdx]) : std::string();
+    this->PixelSegmentNames.push_back(segmentName);
+    if (segmentIdx > 0)
+      {
+      this->PixelDescription += ", ";
+      }
+    this->PixelDescription += segmentName;
+    }
+  this->PixelNumberOfComponents = 1;
+  this->PixelValues[0] = this->PixelSegments.empty() ? 0. : this->PixelSegments[0];
+  this->PixelProbeStatus = labelProbeStatus | PROBE_SUCCESS;
+  return this->PixelProbeStatus;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerDataProbeLogic::vtkInternal::GetLabelName(
+  vtkMRMLColorNode* colorNode, int colorIndex)
+{
+  if (colorNode != this->LabelNamesColorNode.GetPointer()
+      || colorNode->GetMTime() != this->LabelNamesMTime)
+    {
+    this->LabelNamesColorNode = colorNode;
+    this->LabelNamesMTime = colorNode->GetMTime();
+    this->LabelNames.resize(std::max(colorNode->GetNumberOfColors(), 0));
+    for (size_t nameIdx = 0; nameIdx < this->LabelNames.size(); ++nameIdx)
+      {
+      const char* colorName = colorNode->GetColorName(static_cast<int>(nameIdx));
+      this->LabelNames[nameIdx] = colorName ? colorName : "";
+      }
+    }
+  if (colorIndex < 0 || colorIndex >= static_cast<int>(this->LabelNames.size()))
+    {
+    return std::string();
+    }
+  return this->LabelNames[colorIndex];
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::vtkInternal::ProbeLabelComposition(
+  vtkMRMLVolumeNode* volumeNode, double ijk[3], int cubeRadius, const double* ballRadius)
+{
+  int probeStatus = this->External->ProbePixel(volumeNode, ijk);
+  if ((probeStatus & LABEL_VOLUME) != LABEL_VOLUME || !(probeStatus & PROBE_SUCCESS))
+    {
+    return probeStatus;
+    }
+  if (vtkSlicerDataProbeLogic::GetLabelEncoding(volumeNode) != SINGLE_LABEL_ENCODING)
+    {
+    return PROBE_ERROR_UNSUPPORTED_LABEL_ENCODING;
+    }
+  vtkMRMLScalarVolumeNode * scalarVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode);
+  vtkImageData * imageData = scalarVolumeNode->GetImageData();
+  vtkSlicerDataProbeLabelComposition * composition =
+    vtkSlicerDataProbeGetImageEntry(this->LabelCompositions, imageData);
+  if (ballRadius)
+    {
+    composition->SetBallWindow(ballRadius);
+    }
+  else
+    {
+    composition->SetCubeWindow(cubeRadius);
+    }
+  // Same voxel as ProbePixel()
+  int center[3] = {static_cast<int>(ijk[0]), static_cast<int>(ijk[1]), static_cast<int>(ijk[2])};
+  if (!composition->Update(imageData, center))
+    {
+    return probeStatus;
+    }
+
+  vtkMRMLColorNode * colorNode = scalarVolumeNode->GetDisplayNode() ?
+    scalarVolumeNode->GetDisplayNode()->GetColorNode() : 0;
+  const int numberOfLabels = composition->GetNumberOfLabels();
+  for (int labelIdx = 0; labelIdx < numberOfLabels; ++labelIdx)
+    {
+    const int label = composition->GetLabel(labelIdx);
+    this->NeighborhoodLabels.push_back(label);
+    this->NeighborhoodLabelFractions.push_back(composition->GetLabelFraction(labelIdx));
+    this->NeighborhoodLabelNames.push_back(colorNode ? this->GetLabelName(colorNode, label) : std::string());
+    }
+  return probeStatus;
+}
+
+//----------------------------------------------------------------------------
+// vtkSlicerDataProbeLogic methods
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerDataProbeLogic);
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeLogic::vtkSlicerDataProbeLogic()
+{
+  this->Internal = new vtkInternal(this);
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeLogic::~vtkSlicerDataProbeLogic()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbePixel(vtkMRMLVolumeNode* volumeNode, double ijk[3])
+{
+  return this->ProbePixel(volumeNode, ijk[0], ijk[1], ijk[2]);
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbePixel(vtkMRMLVolumeNode* volumeNode, double i, double j, double k)
+{
+  this->Internal->ResetProbe();
+
+  double ijk[3] = {i, j, k};
+  vtkImageData * imageData = this->Internal->GetProbedImageData(volumeNode, ijk);
+  if (!imageData)
+    {
+    return this->Internal->PixelProbeStatus;
+    }
+  vtkMRMLScalarVolumeNode * scalarVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode);
+
+  if (scalarVolumeNode->GetLabelMap())
+    {
+    int* voxel = this->Internal->PixelVoxel;
+    voxel[0] = static_cast<int>(i);
+    voxel[1] = static_cast<int>(j);
+    voxel[2] = static_cast<int>(k);
+    int labelEncoding = vtkSlicerDataProbeLogic::GetLabelEncoding(scalarVolumeNode);
+    if (labelEncoding != SINGLE_LABEL_ENCODING)
+      {
+      return this->Internal->ProbeLabelSegments(scalarVolumeNode, imageData, voxel,
+                                                labelEncoding == BIT_PACKED_LABEL_ENCODING);
+      }
+    double labelIndex = imageData->GetScalarComponentAsDouble(voxel[0], voxel[1], voxel[2], 0);
+    return this->Internal->ProbeLabel(scalarVolumeNode, labelIndex);
+    }
+  else if(vtkMRMLDiffusionTensorVolumeNode * dtiVolumeNode =
+     vtkMRMLDiffusionTensorVolumeNode::SafeDownCast(scalarVolumeNode))
+    {
+    vtkIdType pointIdx = imageData->FindPoint(i, j, k);
+    if (pointIdx == -1)
+      {
+      this->Internal->PixelProbeStatus = PROBE_ERROR_OUT_OF_FRAME;
+      return this->Internal->PixelProbeStatus;
+      }
+    vtkPointData* pointData = imageData->GetPointData();
+    if (!pointData)
+      {
+      this->Internal->PixelProbeStatus = PROBE_ERROR_DTI_NO_POINT_DATA;
+      return this->Internal->PixelProbeStatus;
+      }
+    vtkDataArray * tensors = pointData->GetTensors();
+    if (!tensors)
+      {
+      this->Internal->PixelProbeStatus = PROBE_ERROR_DTI_NO_TENSOR_DATA;
+      return this->Internal->PixelProbeStatus;
+      }
+    vtkMRMLDiffusionTensorVolumeDisplayNode * dtiVolumeDisplayNode =
+        vtkMRMLDiffusionTensorVolumeDisplayNode::SafeDownCast(dtiVolumeNode->GetScalarVolumeDisplayNode());
+
+    std::string scalarInvariant = "ColorOrientation";
+    int operation = vtkDiffusionTensorMathematics::VTK_TENS_COLOR_ORIENTATION;
+    if (dtiVolumeDisplayNode)
+      {
+      operation = dtiVolumeDisplayNode->GetScalarInvariant();
+      scalarInvariant = dtiVolumeDisplayNode->GetScalarInvariantAsString();
+      }
+
+    int dims[3] = {0, 0, 0};
+    imageData->GetDimensions(dims);
+    const vtkIdType sliceSize = static_cast<vtkIdType>(dims[0]) * dims[1];
+    int* voxel = this->Internal->PixelVoxel;
+    voxel[0] = static_cast<int>(pointIdx % dims[0]);
+    voxel[1] = static_cast<int>((pointIdx % sliceSize) / dims[0]);
+    voxel[2] = static_cast<int>(pointIdx / sliceSize);
+
+    double value = vtkMath::Nan();
+    vtkSlicerDataProbeTensorScalarCache * tensorScalarCache = this->GetTensorScalarCache();
+    if (tensorScalarCache->GetMemoryLimit() > 0)
+      {
+      // Same voxel as the tensor read below
+      value = tensorScalarCache->GetScalar(imageData, operation, voxel[0], voxel[1], voxel[2]);
+      }
+    else
+      {
+      double tensor[9] = {0.0, 0.0, 0.0,
+                          0.0, 0.0, 0.0,
+                          0.0, 0.0, 0.0};
+      tensors->GetTuple(pointIdx, tensor);
+
+      float tensorAsFloat[9];
+      for(int idx = 0; idx < 9; ++idx)
+        {
+        tensorAsFloat[idx] = static_cast<float>(tensor[idx]);
+        }
+      value = this->CalculateTensorScalars(tensorAsFloat, operation);
+      }
+    this->Internal->PixelNumberOfComponents = 1;
+    this->Internal->PixelValues[0] = value;
+    this->Internal->PixelDescription = scalarInvariant;
+    this->Internal->PixelProbeStatus = PROBE_SUCCESS_DTI_VOLUME;
+    return this->Internal->PixelProbeStatus;
+    }
+  else
+    {
+    int numberOfComponents = imageData->GetNumberOfScalarComponents();
+    int numberOfPixelValues = vtkInternal::MAX_NUMBER_OF_PIXEL_VALUES;
+    if (numberOfComponents < vtkInternal::MAX_NUMBER_OF_PIXEL_VALUES)
+      {
+      numberOfPixelValues = numberOfComponents;
+      }
+    // Closest voxel, the positions within half a voxel past the last one
+    // reading the last one
+    int dims[3] = {0, 0, 0};
+    imageData->GetDimensions(dims);
+    int* voxel = this->Internal->PixelVoxel;
+    voxel[0] = std::min(vtkMath::Round(i), dims[0] - 1);
+    voxel[1] = std::min(vtkMath::Round(j), dims[1] - 1);
+    voxel[2] = std::min(vtkMath::Round(k), dims[2] - 1);
+    for (int componentIdx = 0; componentIdx < numberOfPixelValues; ++componentIdx)
+      {
+      this->Internal->PixelValues[componentIdx] = imageData->GetScalarComponentAsDouble(
+            voxel[0], voxel[1], voxel[2], componentIdx);
+      }
+    this->Internal->PixelNumberOfComponents = numberOfComponents;
+    this->Internal->PixelProbeStatus = PROBE_SUCCESS_SCALAR_VOLUME;
+    return this->Internal->PixelProbeStatus;
+    }
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbeRAS(vtkMRMLVolumeNode* volumeNode, double ras[3])
+{
+  double ijk[3] = {0.0, 0.0, 0.0};
+  if (!this->ConvertRASToIJK(volumeNode, ras, ijk))
+    {
+    this->Internal->ResetProbe();
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_SCALAR_VOLUME;
+    return this->Internal->PixelProbeStatus;
+    }
+  return this->ProbePixel(volumeNode, ijk);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDataProbeLogic::ConvertRASToIJK(vtkMRMLVolumeNode* volumeNode, double ras[3], double ijk[3])
+{
+  return this->Internal->TransformCache->TransformRASToIJK(volumeNode, ras, ijk);
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeTransformCache* vtkSlicerDataProbeLogic::GetTransformCache()const
+{
+  return this->Internal->TransformCache;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeBatchEngine* vtkSlicerDataProbeLogic::GetBatchEngine()const
+{
+  if (!this->Internal->BatchEngine)
+    {
+    this->Internal->BatchEngine = vtkSmartPointer<vtkSlicerDataProbeBatchEngine>::New();
+    this->Internal->BatchEngine->SetTransformCache(this->Internal->TransformCache);
+    }
+  return this->Internal->BatchEngine;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLDataProbeResultNode* vtkSlicerDataProbeLogic::GetResultNode()
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (!scene || !this->Internal->ResultNode || this->Internal->ResultNode->GetScene() != scene ||
+      !scene->IsNodePresent(this->Internal->ResultNode))
+    {
+    return 0;
+    }
+  return this->Internal->ResultNode;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLDataProbeResultNode* vtkSlicerDataProbeLogic::AddResultNode()
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (!scene)
+    {
+    return 0;
+    }
+  if (vtkMRMLDataProbeResultNode * resultNode = this->GetResultNode())
+    {
+    return resultNode;
+    }
+  this->Internal->ResultNode = vtkMRMLDataProbeResultNode::SafeDownCast(
+    scene->GetNthNodeByClass(0, "vtkMRMLDataProbeResultNode"));
+  if (!this->Internal->ResultNode)
+    {
+    vtkNew<vtkMRMLDataProbeResultNode> resultNode;
+    resultNode->SetName("DataProbeResult");
+    scene->AddNode(resultNode.GetPointer());
+    this->Internal->ResultNode = resultNode.GetPointer();
+    }
+  return this->Internal->ResultNode;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeSharedMemoryStream* vtkSlicerDataProbeLogic::GetSharedMemoryStream()const
+{
+  if (!this->Internal->SharedMemoryStream)
+    {
+    this->Internal->SharedMemoryStream = vtkSmartPointer<vtkSlicerDataProbeSharedMemoryStream>::New();
+    }
+  return this->Internal->SharedMemoryStream;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::SetMRMLSceneInternal(vtkMRMLScene* newScene)
+{
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkMRMLScene::EndImportEvent);
+  events->InsertNextValue(vtkMRMLScene::EndCloseEvent);
+  this->SetAndObserveMRMLSceneEventsInternal(newScene, events.GetPointer());
+  this->AddResultNode();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::OnMRMLSceneEndImport()
+{
+  this->AddResultNode();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::OnMRMLSceneEndClose()
+{
+  this->AddResultNode();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::RegisterNodes()
+{
+  if (!this->GetMRMLScene())
+    {
+    return;
+    }
+  vtkNew<vtkMRMLDataProbeResultNode> resultNode;
+  this->GetMRMLScene()->RegisterNodeClass(resultNode.GetPointer());
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbeDisplayedPixel(vtkMRMLSliceLayerLogic* sliceLayerLogic,
+                                                 double x, double y, double z)
+{
+  this->Internal->ResetProbe();
+
+  vtkMRMLScalarVolumeNode * scalarVolumeNode = sliceLayerLogic ?
+    vtkMRMLScalarVolumeNode::SafeDownCast(sliceLayerLogic->GetVolumeNode()) : 0;
+  if (!scalarVolumeNode)
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_SCALAR_VOLUME;
+    return this->Internal->PixelProbeStatus;
+    }
+
+  if (vtkMRMLDiffusionTensorVolumeNode::SafeDownCast(scalarVolumeNode))
+    {
+    // The layer reslice outputs tensors, the displayed invariant is computed
+    // further down the display pipeline.
+    double xyzw[4] = {x, y, z, 1.0};
+    double ijkw[4] = {0.0, 0.0, 0.0, 1.0};
+    sliceLayerLogic->GetXYToIJKTransform()->GetMatrix()->MultiplyPoint(xyzw, ijkw);
+    return this->ProbePixel(scalarVolumeNode, ijkw[0], ijkw[1], ijkw[2]);
+    }
+
+  vtkImageReslice * reslice = sliceLayerLogic->GetReslice();
+  vtkImageData * reslicedImage = reslice ? reslice->GetOutput() : 0;
+  if (!reslicedImage || !reslicedImage->GetPointData()->GetScalars())
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_DISPLAYED_DATA;
+    return this->Internal->PixelProbeStatus;
+    }
+
+  int xyz[3] = {vtkMath::Round(x), vtkMath::Round(y), vtkMath::Round(z)};
+  int extent[6] = {0, -1, 0, -1, 0, -1};
+  reslicedImage->GetExtent(extent);
+  for (int dimIdx = 0; dimIdx < 3; ++dimIdx)
+    {
+    if (xyz[dimIdx] < extent[2 * dimIdx] || xyz[dimIdx] > extent[2 * dimIdx + 1])
+      {
+      this->Internal->PixelProbeStatus = PROBE_ERROR_OUT_OF_FRAME;
+      return this->Internal->PixelProbeStatus;
+      }
+    }
+
+  // Displayed color, after window/level and color mapping
+  vtkImageData * displayedImage = sliceLayerLogic->GetImageData();
+  if (displayedImage && displayedImage->GetPointData()->GetScalars())
+    {
+    int displayedExtent[6] = {0, -1, 0, -1, 0, -1};
+    displayedImage->GetExtent(displayedExtent);
+    if (xyz[0] >= displayedExtent[0] && xyz[0] <= displayedExtent[1] &&
+        xyz[1] >= displayedExtent[2] && xyz[1] <= displayedExtent[3] &&
+        xyz[2] >= displayedExtent[4] && xyz[2] <= displayedExtent[5])
+      {
+      int numberOfColorComponents = displayedImage->GetNumberOfScalarComponents();
+      for (int componentIdx = 0; componentIdx < 4; ++componentIdx)
+        {
+        this->Internal->DisplayedColor[componentIdx] = componentIdx < numberOfColorComponents ?
+          displayedImage->GetScalarComponentAsDouble(xyz[0], xyz[1], xyz[2], componentIdx) : 255.;
+        }
+      if (numberOfColorComponents < 3)
+        {
+        // Luminance
+        this->Internal->DisplayedColor[1] = this->Internal->DisplayedColor[0];
+        this->Internal->DisplayedColor[2] = this->Internal->DisplayedColor[0];
+        }
+      this->Internal->DisplayedColorValid = true;
+      }
+    }
+
+  if (scalarVolumeNode->GetLabelMap())
+    {
+    double labelIndex = reslicedImage->GetScalarComponentAsDouble(xyz[0], xyz[1], xyz[2], 0);
+    return this->Internal->ProbeLabel(scalarVolumeNode, labelIndex);
+    }
+
+  int numberOfComponents = reslicedImage->GetNumberOfScalarComponents();
+  int numberOfPixelValues = vtkInternal::MAX_NUMBER_OF_PIXEL_VALUES;
+  if (numberOfComponents < vtkInternal::MAX_NUMBER_OF_PIXEL_VALUES)
+    {
+    numberOfPixelValues = numberOfComponents;
+    }
+  for (int componentIdx = 0; componentIdx < numberOfPixelValues; ++componentIdx)
+    {
+    this->Internal->PixelValues[componentIdx] =
+      reslicedImage->GetScalarComponentAsDouble(xyz[0], xyz[1], xyz[2], componentIdx);
+    }
+
+  vtkMRMLScalarVolumeDisplayNode * displayNode = scalarVolumeNode->GetScalarVolumeDisplayNode();
+  if (displayNode && numberOfComponents > 0 && displayNode->GetWindow() > 0.0)
+    {
+    double window = displayNode->GetWindow();
+    double lower = displayNode->GetLevel() - window / 2.0;
+    double value = (this->Internal->PixelValues[0] - lower) / window * 255.0;
+    this->Internal->DisplayedWindowLevelValue = value < 0.0 ? 0.0 : (value > 255.0 ? 255.0 : value);
+    }
+
+  this->Internal->PixelNumberOfComponents = numberOfComponents;
+  this->Internal->PixelProbeStatus = PROBE_SUCCESS_SCALAR_VOLUME;
+  return this->Internal->PixelProbeStatus;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerDataProbeLogic::GetDisplayedWindowLevelValue()const
+{
+  return this->Internal->DisplayedWindowLevelValue;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDataProbeLogic::GetDisplayedColor(double rgba[4])const
+{
+  for (int componentIdx = 0; componentIdx < 4; ++componentIdx)
+    {
+    rgba[componentIdx] = this->Internal->DisplayedColor[componentIdx];
+    }
+  return this->Internal->DisplayedColorValid;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbeViewportStatistics(vtkMRMLSliceLayerLogic* sliceLayerLogic,
+                                                     int sampleStride)
+{
+  this->Internal->ResetProbe();
+
+  vtkMRMLScalarVolumeNode * scalarVolumeNode = sliceLayerLogic ?
+    vtkMRMLScalarVolumeNode::SafeDownCast(sliceLayerLogic->GetVolumeNode()) : 0;
+  if (!scalarVolumeNode || vtkMRMLDiffusionTensorVolumeNode::SafeDownCast(scalarVolumeNode))
+    {
+    return PROBE_ERROR_NO_SCALAR_VOLUME;
+    }
+  vtkImageReslice * reslice = sliceLayerLogic->GetReslice();
+  vtkImageData * reslicedImage = reslice ? reslice->GetOutput() : 0;
+  if (!reslicedImage || !reslicedImage->GetPointData()->GetScalars())
+    {
+    return PROBE_ERROR_NO_DISPLAYED_DATA;
+    }
+
+  vtkSlicerDataProbeViewportStatistics * statistics =
+    vtkSlicerDataProbeGetImageEntry(this->Internal->ViewportStatistics, reslicedImage);
+  vtkTransform * xyToIJK = sliceLayerLogic->GetXYToIJKTransform();
+  if (!statistics->Update(reslicedImage, xyToIJK ? xyToIJK->GetMatrix() : 0,
+                          scalarVolumeNode->GetImageData(), sampleStride))
+    {
+    return PROBE_ERROR_NO_DISPLAYED_DATA;
+    }
+  this->Internal->ProbedViewportStatistics = statistics;
+  return scalarVolumeNode->GetLabelMap() ? PROBE_SUCCESS_LABEL_VOLUME : PROBE_SUCCESS_SCALAR_VOLUME;
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeViewportStatistics* vtkSlicerDataProbeLogic::GetViewportStatistics()const
+{
+  return this->Internal->ProbedViewportStatistics;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbeDerivatives(vtkMRMLVolumeNode* volumeNode, double ijk[3], int kernel)
+{
+  this->Internal->ResetProbe();
+
+  vtkImageData * imageData = this->Internal->GetProbedImageData(volumeNode, ijk);
+  if (!imageData)
+    {
+    return this->Internal->PixelProbeStatus;
+    }
+  if (vtkMRMLDiffusionTensorVolumeNode::SafeDownCast(volumeNode))
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_SCALAR_VOLUME;
+    return this->Internal->PixelProbeStatus;
+    }
+
+  double weights[3][5];
+  int radius = vtkSlicerDataProbeDerivativeWeights(kernel, weights);
+  int center[3] = {vtkMath::Round(ijk[0]), vtkMath::Round(ijk[1]), vtkMath::Round(ijk[2])};
+  double neighborhood[5 * 5 * 5];
+  if (!vtkSlicerDataProbeGatherNeighborhood(imageData, 0, center, radius, neighborhood))
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_IMAGE_DATA;
+    return this->Internal->PixelProbeStatus;
+    }
+
+  double gradientIJK[3] = {0.0, 0.0, 0.0};
+  double hessianIJK[3][3];
+  vtkSlicerDataProbeComputeDerivatives(neighborhood, radius, weights, gradientIJK, hessianIJK);
+
+  // Derivatives with respect to RAS: J = R * S^-1 where R holds the IJK axis
+  // directions and S the spacing. gradient = J * g, hessian = J * H * J^T
+  double jacobian[3][3];
+  vtkSlicerDataProbeIJKToRASDerivatives(volumeNode, jacobian);
+  double hessianTimesJacobianT[3][3];
+  double hessian[3][3];
+  double jacobianT[3][3];
+  vtkMath::Transpose3x3(jacobian, jacobianT);
+  vtkMath::Multiply3x3(hessianIJK, jacobianT, hessianTimesJacobianT);
+  vtkMath::Multiply3x3(jacobian, hessianTimesJacobianT, hessian);
+  vtkMath::Multiply3x3(jacobian, gradientIJK, this->Internal->Gradient);
+
+  double* gradient = this->Internal->Gradient;
+  double squaredMagnitude = vtkMath::Dot(gradient, gradient);
+  this->Internal->GradientMagnitude = sqrt(squaredMagnitude);
+
+  double eigenvectors[3][3];
+  vtkMath::Diagonalize3x3(hessian, this->Internal->HessianEigenvalues, eigenvectors);
+  std::sort(this->Internal->HessianEigenvalues, this->Internal->HessianEigenvalues + 3,
+            vtkSlicerDataProbeAbsoluteLess);
+
+  // Divergence of the normalized gradient, i.e. the sum of the principal
+  // curvatures of the isophote going through the voxel.
+  if (this->Internal->GradientMagnitude > 1e-12)
+    {
+    double hessianTimesGradient[3];
+    vtkMath::Multiply3x3(hessian, gradient, hessianTimesGradient);
+    double trace = hessian[0][0] + hessian[1][1] + hessian[2][2];
+    this->Internal->IsophoteCurvature =
+      (squaredMagnitude * trace - vtkMath::Dot(gradient, hessianTimesGradient)) /
+      (squaredMagnitude * this->Internal->GradientMagnitude);
+    }
+
+  int halfSize = radius;
+  int size = 2 * radius + 1;
+  this->Internal->PixelValues[0] = neighborhood[(halfSize * size + halfSize) * size + halfSize];
+  this->Internal->PixelNumberOfComponents = 1;
+  this->Internal->PixelProbeStatus = PROBE_SUCCESS_SCALAR_VOLUME;
+  return this->Internal->PixelProbeStatus;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbePath(vtkMRMLVolumeNode* volumeNode,
+                                       double startIJK[3], double endIJK[3],
+                                       vtkSlicerDataProbePathTrace* trace)
+{
+  this->Internal->ResetProbe();
+
+  vtkMRMLScalarVolumeNode * scalarVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode);
+  if (!scalarVolumeNode || !trace ||
+      vtkMRMLDiffusionTensorVolumeNode::SafeDownCast(volumeNode))
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_SCALAR_VOLUME;
+    return this->Internal->PixelProbeStatus;
+    }
+  vtkImageData * imageData = scalarVolumeNode->GetImageData();
+  if (!imageData || !imageData->GetScalarPointer())
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_IMAGE_DATA;
+    return this->Internal->PixelProbeStatus;
+    }
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+
+  // Rasterize the whole segment first, then read all the voxels at once.
+  vtkSlicerDataProbeVoxelTraversal traversal;
+  if (!traversal.Initialize(startIJK, endIJK, dims))
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_OUT_OF_FRAME;
+    return this->Internal->PixelProbeStatus;
+    }
+  std::vector<vtkIdType>& voxelOffsets = this->Internal->PathVoxelOffsets;
+  std::vector<int>& voxelIJKs = this->Internal->PathVoxelIJKs;
+  voxelOffsets.clear();
+  voxelIJKs.clear();
+  do
+    {
+    const int* voxel = traversal.GetVoxel();
+    voxelOffsets.push_back(voxel[0] + dims[0] * (voxel[1] + static_cast<vtkIdType>(dims[1]) * voxel[2]));
+    voxelIJKs.insert(voxelIJKs.end(), voxel, voxel + 3);
+    }
+  while (traversal.Next());
+
+  std::vector<double>& values = this->Internal->PathValues;
+  switch (imageData->GetScalarType())
+    {
+    vtkTemplateMacro(vtkSlicerDataProbeReadVoxels(
+      static_cast<VTK_TT*>(imageData->GetScalarPointer()), imageData->GetNumberOfScalarComponents(),
+      0, voxelOffsets, values));
+    default:
+      this->Internal->PixelProbeStatus = PROBE_ERROR_NO_IMAGE_DATA;
+      return this->Internal->PixelProbeStatus;
+    }
+  for (size_t voxelIdx = 0; voxelIdx < values.size(); ++voxelIdx)
+    {
+    trace->AddSample(&voxelIJKs[3 * voxelIdx], values[voxelIdx]);
+    }
+  trace->Modified();
+
+  // The last sample is the voxel at the end of the segment
+  this->Internal->PixelNumberOfComponents = 1;
+  this->Internal->PixelValues[0] = values.back();
+  this->Internal->PixelProbeStatus = scalarVolumeNode->GetLabelMap() ?
+    PROBE_SUCCESS_LABEL_VOLUME : PROBE_SUCCESS_SCALAR_VOLUME;
+  return this->Internal->PixelProbeStatus;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbeRay(vtkMRMLVolumeNode* volumeNode,
+                                      double startRAS[3], double endRAS[3],
+                                      int mode, double threshold)
+{
+  this->Internal->ResetProbe();
+
+  vtkMRMLScalarVolumeNode * scalarVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode);
+  if (!scalarVolumeNode || vtkMRMLDiffusionTensorVolumeNode::SafeDownCast(volumeNode))
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_SCALAR_VOLUME;
+    return this->Internal->PixelProbeStatus;
+    }
+  vtkImageData * imageData = scalarVolumeNode->GetImageData();
+  vtkSlicerDataProbeBlockMinMax * blockMinMax = imageData ? this->Internal->GetBlockMinMax(imageData) : 0;
+  if (!blockMinMax)
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_IMAGE_DATA;
+    return this->Internal->PixelProbeStatus;
+    }
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+
+  double startIJK[3] = {0.0, 0.0, 0.0};
+  double endIJK[3] = {0.0, 0.0, 0.0};
+  this->ConvertRASToIJK(volumeNode, startRAS, startIJK);
+  this->ConvertRASToIJK(volumeNode, endRAS, endIJK);
+
+  // Voxel (i, j, k) belongs to block (i, j, k) / BlockSize. In block
+  // coordinates, block centers are at integer coordinates like voxels.
+  const int blockSize = blockMinMax->GetBlockSize();
+  double startBlock[3] = {0.0, 0.0, 0.0};
+  double endBlock[3] = {0.0, 0.0, 0.0};
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    startBlock[axis] = (startIJK[axis] + 0.5) / blockSize - 0.5;
+    endBlock[axis] = (endIJK[axis] + 0.5) / blockSize - 0.5;
+    }
+  vtkSlicerDataProbeVoxelTraversal voxels;
+  vtkSlicerDataProbeVoxelTraversal blocks;
+  if (!voxels.Initialize(startIJK, endIJK, dims) ||
+      !blocks.Initialize(startBlock, endBlock, blockMinMax->GetBlockDimensions()))
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_OUT_OF_FRAME;
+    return this->Internal->PixelProbeStatus;
+    }
+
+  bool found = false;
+  double hitValue = 0.0;
+  double hitParameter = 0.0;
+  int* hitIJK = this->Internal->RayHitIJK;
+  switch (imageData->GetScalarType())
+    {
+    vtkTemplateMacro(found = vtkSlicerDataProbeMarchRay(
+      static_cast<VTK_TT*>(imageData->GetScalarPointer()), imageData->GetNumberOfScalarComponents(),
+      dims, blocks, voxels, blockMinMax, mode, threshold, hitIJK, hitValue, hitParameter));
+    default:
+      this->Internal->PixelProbeStatus = PROBE_ERROR_NO_IMAGE_DATA;
+      return this->Internal->PixelProbeStatus;
+    }
+  if (!found)
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_RAY_HIT;
+    return this->Internal->PixelProbeStatus;
+    }
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Internal->RayHitRAS[axis] = startRAS[axis] + hitParameter * (endRAS[axis] - startRAS[axis]);
+    }
+
+  if (scalarVolumeNode->GetLabelMap())
+    {
+    return this->Internal->ProbeLabel(scalarVolumeNode, hitValue);
+    }
+  this->Internal->PixelNumberOfComponents = 1;
+  this->Internal->PixelValues[0] = hitValue;
+  this->Internal->PixelProbeStatus = PROBE_SUCCESS_SCALAR_VOLUME;
+  return this->Internal->PixelProbeStatus;
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeLabelIndex* vtkSlicerDataProbeLogic::GetLabelIndex(vtkMRMLVolumeNode* volumeNode)
+{
+  vtkMRMLScalarVolumeNode * scalarVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode);
+  vtkImageData * imageData = scalarVolumeNode ? scalarVolumeNode->GetImageData() : 0;
+  if (!imageData || !scalarVolumeNode->GetLabelMap() ||
+      vtkSlicerDataProbeLogic::GetLabelEncoding(scalarVolumeNode) != SINGLE_LABEL_ENCODING)
+    {
+    return 0;
+    }
+  vtkSlicerDataProbeLabelIndex * labelIndex =
+    vtkSlicerDataProbeGetImageEntry(this->Internal->LabelIndexes, imageData);
+  if (!labelIndex->IsUpToDate(imageData))
+    {
+    this->Internal->UpdateModifiedLabelMap(scalarVolumeNode);
+    }
+  return labelIndex->Update(imageData) ? labelIndex : 0;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::LabelMapModified(vtkMRMLVolumeNode* volumeNode, int extent[6])
+{
+  vtkMRMLScalarVolumeNode * scalarVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode);
+  vtkImageData * imageData = scalarVolumeNode ? scalarVolumeNode->GetImageData() : 0;
+  if (!imageData || !scalarVolumeNode->GetLabelMap())
+    {
+    return;
+    }
+  // Indexes not built yet are built on first use
+  if (vtkSlicerDataProbeLabelIndex * labelIndex =
+      vtkSlicerDataProbeFindImageEntry(this->Internal->LabelIndexes, imageData))
+    {
+    labelIndex->UpdateExtent(imageData, extent);
+    }
+  if (vtkSlicerDataProbeComponentIndex * componentIndex =
+      vtkSlicerDataProbeFindImageEntry(this->Internal->ComponentIndexes, imageData))
+    {
+    componentIndex->UpdateExtent(imageData, extent);
+    }
+  if (extent[0] > extent[1] || extent[2] > extent[3] || extent[4] > extent[5])
+    {
+    return;
+    }
+  if (vtkSlicerDataProbeDistanceMap * distanceMap =
+      vtkSlicerDataProbeFindImageEntry(this->Internal->DistanceMaps, imageData))
+    {
+    distanceMap->Reset();
+    }
+  if (vtkSlicerDataProbeLabelComposition * labelComposition =
+      vtkSlicerDataProbeFindImageEntry(this->Internal->LabelCompositions, imageData))
+    {
+    labelComposition->Reset();
+    }
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbeLabelStatistics(vtkMRMLVolumeNode* volumeNode, double ijk[3])
+{
+  int probeStatus = this->ProbePixel(volumeNode, ijk);
+  if ((probeStatus & LABEL_VOLUME) != LABEL_VOLUME || !(probeStatus & PROBE_SUCCESS))
+    {
+    return probeStatus;
+    }
+  if (vtkSlicerDataProbeLogic::GetLabelEncoding(volumeNode) != SINGLE_LABEL_ENCODING)
+    {
+    return PROBE_ERROR_UNSUPPORTED_LABEL_ENCODING;
+    }
+  vtkSlicerDataProbeLabelIndex * labelIndex = this->GetLabelIndex(volumeNode);
+  if (!labelIndex)
+    {
+    return probeStatus;
+    }
+  int label = static_cast<int>(this->Internal->PixelValues[0]);
+  double centroidIJK[3] = {0.0, 0.0, 0.0};
+  if (!labelIndex->GetCentroid(label, centroidIJK))
+    {
+    return probeStatus;
+    }
+  labelIndex->GetBounds(label, this->Internal->LabelBounds);
+  this->Internal->LabelNumberOfVoxels = labelIndex->GetNumberOfVoxels(label);
+  double* spacing = volumeNode->GetSpacing();
+  this->Internal->LabelVolume = this->Internal->LabelNumberOfVoxels * spacing[0] * spacing[1] * spacing[2];
+  vtkInternal::IJKToWorld(volumeNode, centroidIJK, this->Internal->LabelCentroid);
+  return probeStatus;
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeComponentIndex* vtkSlicerDataProbeLogic::GetComponentIndex(vtkMRMLVolumeNode* volumeNode)
+{
+  vtkMRMLScalarVolumeNode * scalarVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode);
+  vtkImageData * imageData = scalarVolumeNode ? scalarVolumeNode->GetImageData() : 0;
+  if (!imageData || !scalarVolumeNode->GetLabelMap() ||
+      vtkSlicerDataProbeLogic::GetLabelEncoding(scalarVolumeNode) != SINGLE_LABEL_ENCODING)
+    {
+    return 0;
+    }
+  vtkSlicerDataProbeComponentIndex * componentIndex =
+    vtkSlicerDataProbeGetImageEntry(this->Internal->ComponentIndexes, imageData);
+  if (!componentIndex->IsUpToDate(imageData))
+    {
+    this->Internal->UpdateModifiedLabelMap(scalarVolumeNode);
+    }
+  return componentIndex->Update(imageData) ? componentIndex : 0;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbeComponent(vtkMRMLVolumeNode* volumeNode, double ijk[3])
+{
+  int probeStatus = this->ProbePixel(volumeNode, ijk);
+  if ((probeStatus & LABEL_VOLUME) != LABEL_VOLUME || !(probeStatus & PROBE_SUCCESS))
+    {
+    return probeStatus;
+    }
+  int componentStatus = this->ProbeComponent(volumeNode, this->Internal->PixelVoxel,
+                                             static_cast<int>(this->Internal->PixelValues[0]));
+  return componentStatus == PROBE_SUCCESS_LABEL_VOLUME ? probeStatus : componentStatus;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbeComponent(vtkMRMLVolumeNode* volumeNode, const int voxel[3], int label)
+{
+  this->Internal->ComponentId = 0;
+  this->Internal->ComponentNumberOfVoxels = 0;
+  this->Internal->ComponentVolume = vtkMath::Nan();
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Internal->ComponentCentroid[axis] = vtkMath::Nan();
+    }
+  vtkMRMLScalarVolumeNode * scalarVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode);
+  if (!scalarVolumeNode || !scalarVolumeNode->GetLabelMap())
+    {
+    return PROBE_ERROR_NO_SCALAR_VOLUME;
+    }
+  if (vtkSlicerDataProbeLogic::GetLabelEncoding(volumeNode) != SINGLE_LABEL_ENCODING)
+    {
+    return PROBE_ERROR_UNSUPPORTED_LABEL_ENCODING;
+    }
+  vtkSlicerDataProbeComponentIndex * componentIndex = this->GetComponentIndex(volumeNode);
+  if (!componentIndex)
+    {
+    return PROBE_SUCCESS_LABEL_VOLUME;
+    }
+  // The component must have the probed label
+  unsigned int componentId = componentIndex->GetComponentId(voxel[0], voxel[1], voxel[2]);
+  double centroidIJK[3] = {0.0, 0.0, 0.0};
+  if (componentId == 0 || componentIndex->GetComponentLabel(componentId) != label ||
+      !componentIndex->GetComponentCentroid(componentId, centroidIJK))
+    {
+    return PROBE_SUCCESS_LABEL_VOLUME;
+    }
+  this->Internal->ComponentId = componentId;
+  this->Internal->ComponentNumberOfVoxels = componentIndex->GetComponentNumberOfVoxels(componentId);
+  double* spacing = volumeNode->GetSpacing();
+  this->Internal->ComponentVolume =
+    this->Internal->ComponentNumberOfVoxels * spacing[0] * spacing[1] * spacing[2];
+  vtkInternal::IJKToWorld(volumeNode, centroidIJK, this->Internal->ComponentCentroid);
+  return PROBE_SUCCESS_LABEL_VOLUME;
+}
+
+//---------------------------------------------------------------------------
+unsigned int vtkSlicerDataProbeLogic::GetComponentId()const
+{
+  return this->Internal->ComponentId;
+}
+
+//---------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeLogic::GetComponentNumberOfVoxels()const
+{
+  return this->Internal->ComponentNumberOfVoxels;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerDataProbeLogic::GetComponentVolume()const
+{
+  return this->Internal->ComponentVolume;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::GetComponentCentroid(double ras[3])const
+{
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    ras[axis] = this->Internal->ComponentCentroid[axis];
+    }
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbeLabelComposition(vtkMRMLVolumeNode* volumeNode, double ijk[3], int radius)
+{
+  return this->Internal->ProbeLabelComposition(volumeNode, ijk, radius, 0);
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbeLabelCompositionWithinRadius(vtkMRMLVolumeNode* volumeNode, double ijk[3],
+                                                               double radius)
+{
+  // Semi-axes of the ball in voxels
+  double ballRadius[3] = {0.0, 0.0, 0.0};
+  const double* spacing = volumeNode ? volumeNode->GetSpacing() : 0;
+  for (int axis = 0; spacing && axis < 3; ++axis)
+    {
+    ballRadius[axis] = spacing[axis] > 0.0 ? radius / spacing[axis] : 0.0;
+    }
+  return this->Internal->ProbeLabelComposition(volumeNode, ijk, 0, ballRadius);
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::GetNumberOfNeighborhoodLabels()const
+{
+  return static_cast<int>(this->Internal->NeighborhoodLabels.size());
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::GetNeighborhoodLabel(int nth)const
+{
+  if (nth < 0 || nth >= this->GetNumberOfNeighborhoodLabels())
+    {
+    return 0;
+    }
+  return this->Internal->NeighborhoodLabels[nth];
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerDataProbeLogic::GetNeighborhoodLabelFraction(int nth)const
+{
+  if (nth < 0 || nth >= this->GetNumberOfNeighborhoodLabels())
+    {
+    return vtkMath::Nan();
+    }
+  return this->Internal->NeighborhoodLabelFractions[nth];
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerDataProbeLogic::GetNeighborhoodLabelName(int nth)const
+{
+  if (nth < 0 || nth >= this->GetNumberOfNeighborhoodLabels())
+    {
+    return std::string();
+    }
+  return this->Internal->NeighborhoodLabelNames[nth];
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbeBoundaryDistance(vtkMRMLVolumeNode* volumeNode, double ijk[3], int label)
+{
+  int probeStatus = this->ProbePixel(volumeNode, ijk);
+  if ((probeStatus & LABEL_VOLUME) != LABEL_VOLUME || !(probeStatus & PROBE_SUCCESS))
+    {
+    return probeStatus;
+    }
+  int distanceStatus = this->ProbeBoundaryDistance(volumeNode, this->Internal->PixelVoxel, label);
+  return distanceStatus == PROBE_SUCCESS_LABEL_VOLUME ? probeStatus : distanceStatus;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbeBoundaryDistance(vtkMRMLVolumeNode* volumeNode, const int voxel[3],
+                                                   int label)
+{
+  this->Internal->BoundaryDistance = vtkMath::Nan();
+  vtkMRMLScalarVolumeNode * scalarVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode);
+  vtkImageData * imageData = scalarVolumeNode ? scalarVolumeNode->GetImageData() : 0;
+  if (!imageData || !scalarVolumeNode->GetLabelMap())
+    {
+    return PROBE_ERROR_NO_SCALAR_VOLUME;
+    }
+  if (vtkSlicerDataProbeLogic::GetLabelEncoding(volumeNode) != SINGLE_LABEL_ENCODING)
+    {
+    return PROBE_ERROR_UNSUPPORTED_LABEL_ENCODING;
+    }
+  vtkSlicerDataProbeDistanceMap * distanceMap =
+    vtkSlicerDataProbeGetImageEntry(this->Internal->DistanceMaps, imageData);
+  if (!distanceMap->Update(imageData, label, volumeNode->GetSpacing()))
+    {
+    return distanceMap->IsComputing() ? PROBE_ERROR_DISTANCE_MAP_NOT_READY : PROBE_SUCCESS_LABEL_VOLUME;
+    }
+  this->Internal->BoundaryDistance = distanceMap->GetDistance(voxel[0], voxel[1], voxel[2]);
+  return PROBE_SUCCESS_LABEL_VOLUME;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerDataProbeLogic::GetBoundaryDistance()const
+{
+  return this->Internal->BoundaryDistance;
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeHistogram* vtkSlicerDataProbeLogic::GetHistogram(vtkMRMLVolumeNode* volumeNode)
+{
+  vtkMRMLScalarVolumeNode * scalarVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode);
+  vtkImageData * imageData = scalarVolumeNode ? scalarVolumeNode->GetImageData() : 0;
+  if (!imageData)
+    {
+    return 0;
+    }
+  vtkSlicerDataProbeHistogram * histogram =
+    vtkSlicerDataProbeGetImageEntry(this->Internal->Histograms, imageData);
+  return histogram->Update(imageData) ? histogram : 0;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbePercentile(vtkMRMLVolumeNode* volumeNode, double ijk[3])
+{
+  int probeStatus = this->ProbePixel(volumeNode, ijk);
+  if ((probeStatus & SCALAR_VOLUME) != SCALAR_VOLUME || !(probeStatus & PROBE_SUCCESS)
+      || (probeStatus & DTI_VOLUME) == DTI_VOLUME)
+    {
+    return probeStatus;
+    }
+  vtkSlicerDataProbeHistogram * histogram = this->GetHistogram(volumeNode);
+  if (!histogram)
+    {
+    return PROBE_ERROR_HISTOGRAM_NOT_READY;
+    }
+  this->Internal->Percentile = histogram->GetPercentile(this->Internal->PixelValues[0]);
+  return probeStatus;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerDataProbeLogic::GetPercentile()const
+{
+  return this->Internal->Percentile;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbeLayerDifference(vtkMRMLVolumeNode* backgroundNode,
+                                                  vtkMRMLVolumeNode* foregroundNode,
+                                                  double ras[3], int radius)
+{
+  int probeStatus = this->ProbeRAS(backgroundNode, ras);
+  if (!(probeStatus & PROBE_SUCCESS))
+    {
+    return probeStatus;
+    }
+  vtkMRMLScalarVolumeNode * foregroundScalarNode = vtkMRMLScalarVolumeNode::SafeDownCast(foregroundNode);
+  if ((probeStatus & DTI_VOLUME) == DTI_VOLUME || !foregroundScalarNode
+      || vtkMRMLDiffusionTensorVolumeNode::SafeDownCast(foregroundNode))
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_SCALAR_VOLUME;
+    return this->Internal->PixelProbeStatus;
+    }
+  vtkImageData * foregroundImageData = foregroundScalarNode->GetImageData();
+  if (!foregroundImageData || !foregroundImageData->GetScalarPointer())
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_IMAGE_DATA;
+    return this->Internal->PixelProbeStatus;
+    }
+
+  // Reference neighborhood, in the background grid
+  double ijk[3] = {0.0, 0.0, 0.0};
+  this->ConvertRASToIJK(backgroundNode, ras, ijk);
+  int center[3] = {vtkMath::Round(ijk[0]), vtkMath::Round(ijk[1]), vtkMath::Round(ijk[2])};
+  vtkImageData * backgroundImageData = backgroundNode->GetImageData();
+  int backgroundDims[3] = {0, 0, 0};
+  backgroundImageData->GetDimensions(backgroundDims);
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    center[axis] = std::min(std::max(center[axis], 0), backgroundDims[axis] - 1);
+    }
+  radius = std::min(std::max(radius, 0), 2);
+  const int neighborhoodSize = 2 * radius + 1;
+  double referenceValues[5 * 5 * 5];
+  if (!vtkSlicerDataProbeGatherNeighborhood(backgroundImageData, 0, center, radius, referenceValues))
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_IMAGE_DATA;
+    return this->Internal->PixelProbeStatus;
+    }
+
+  // Single pass over the pairs, the foreground being interpolated at the
+  // background voxels
+  double referenceToMoving[3][4];
+  this->Internal->GetLayerMapping(backgroundNode, foregroundNode, center, referenceToMoving);
+  int foregroundDims[3] = {0, 0, 0};
+  foregroundImageData->GetDimensions(foregroundDims);
+  double foregroundValue = vtkMath::Nan();
+  vtkSlicerDataProbeLayerSums sums;
+  switch (foregroundImageData->GetScalarType())
+    {
+    vtkTemplateMacro(vtkSlicerDataProbeCompareNeighborhood(
+      static_cast<VTK_TT*>(foregroundImageData->GetScalarPointer()), foregroundDims,
+      foregroundImageData->GetNumberOfScalarComponents(), referenceValues, backgroundDims,
+      center, radius, referenceToMoving, foregroundValue, sums));
+    default:
+      this->Internal->PixelProbeStatus = PROBE_ERROR_NO_SCALAR_VOLUME;
+      return this->Internal->PixelProbeStatus;
+    }
+  if (vtkMath::IsNan(foregroundValue))
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_OUT_OF_FRAME;
+    return this->Internal->PixelProbeStatus;
+    }
+
+  const double backgroundValue = referenceValues[(neighborhoodSize * neighborhoodSize + neighborhoodSize + 1) * radius];
+  this->Internal->LayerDifference = foregroundValue - backgroundValue;
+  this->Internal->LayerRatio = backgroundValue != 0.0 ? foregroundValue / backgroundValue : vtkMath::Nan();
+  const double count = static_cast<double>(sums.Count);
+  this->Internal->LayerRMSDifference = sqrt(sums.SumOfSquaredDifferences / count);
+  const double covariance = sums.SumOfProducts - sums.Sum[0] * sums.Sum[1] / count;
+  const double variance0 = sums.SumOfSquares[0] - sums.Sum[0] * sums.Sum[0] / count;
+  const double variance1 = sums.SumOfSquares[1] - sums.Sum[1] * sums.Sum[1] / count;
+  if (sums.Count > 1 && variance0 > 0.0 && variance1 > 0.0)
+    {
+    this->Internal->LayerCorrelation =
+      std::min(std::max(covariance / sqrt(variance0 * variance1), -1.0), 1.0);
+    }
+  return probeStatus;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerDataProbeLogic::GetLayerDifference()const
+{
+  return this->Internal->LayerDifference;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerDataProbeLogic::GetLayerRatio()const
+{
+  return this->Internal->LayerRatio;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerDataProbeLogic::GetLayerCorrelation()const
+{
+  return this->Internal->LayerCorrelation;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerDataProbeLogic::GetLayerRMSDifference()const
+{
+  return this->Internal->LayerRMSDifference;
+}
+
+//---------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeLogic::GetLabelNumberOfVoxels()const
+{
+  return this->Internal->LabelNumberOfVoxels;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerDataProbeLogic::GetLabelVolume()const
+{
+  return this->Internal->LabelVolume;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::GetLabelCentroid(double ras[3])const
+{
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    ras[axis] = this->Internal->LabelCentroid[axis];
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::GetLabelBounds(int bounds[6])const
+{
+  std::copy(this->Internal->LabelBounds, this->Internal->LabelBounds + 6, bounds);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::vtkInternal::WorldToModel(vtkMRMLModelNode* modelNode, const double ras[3],
+                                                       double localPosition[3])
+{
+  std::copy(ras, ras + 3, localPosition);
+  vtkMRMLTransformNode * transformNode = modelNode->GetParentTransformNode();
+  if (transformNode)
+    {
+    vtkNew<vtkGeneralTransform> worldToLocal;
+    transformNode->GetTransformToWorld(worldToLocal.GetPointer());
+    worldToLocal->Inverse();
+    worldToLocal->TransformPoint(ras, localPosition);
+    }
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerDataProbeLogic::vtkInternal::WorldToModelRadius(vtkMRMLModelNode* modelNode, const double ras[3],
+                                                               double radius)
+{
+  vtkMRMLTransformNode * transformNode = modelNode->GetParentTransformNode();
+  if (!transformNode)
+    {
+    return radius;
+    }
+  // The images of the radii along the world axes bound the local ellipsoid
+  // of a linear transform: its largest semi-axis is at most their norm.
+  vtkNew<vtkGeneralTransform> worldToLocal;
+  transformNode->GetTransformToWorld(worldToLocal.GetPointer());
+  worldToLocal->Inverse();
+  double localCenter[3];
+  worldToLocal->TransformPoint(ras, localCenter);
+  double localRadius2 = 0.0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    double worldPoint[3] = {ras[0], ras[1], ras[2]};
+    worldPoint[axis] += radius;
+    double localPoint[3];
+    worldToLocal->TransformPoint(worldPoint, localPoint);
+    localRadius2 += vtkMath::Distance2BetweenPoints(localPoint, localCenter);
+    }
+  return sqrt(localRadius2);
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbePointLocator* vtkSlicerDataProbeLogic::GetPointLocator(vtkMRMLModelNode* modelNode)
+{
+  vtkPolyData * polyData = modelNode ? modelNode->GetPolyData() : 0;
+  if (!polyData)
+    {
+    return 0;
+    }
+  // Locators are kept per polydata, entries of deleted polydata are reused.
+  vtkSlicerDataProbePointLocator* pointLocator = 0;
+  std::vector<vtkSmartPointer<vtkSlicerDataProbePointLocator> >& pointLocators =
+    this->Internal->PointLocators;
+  for (size_t entryIdx = 0; entryIdx < pointLocators.size(); ++entryIdx)
+    {
+    vtkSlicerDataProbePointLocator* entry = pointLocators[entryIdx];
+    if (entry->GetPolyData() == polyData)
+      {
+      pointLocator = entry;
+      break;
+      }
+    if (!pointLocator && !entry->GetPolyData())
+      {
+      pointLocator = entry;
+      }
+    }
+  if (!pointLocator)
+    {
+    pointLocators.push_back(vtkSmartPointer<vtkSlicerDataProbePointLocator>::New());
+    pointLocator = pointLocators.back();
+    }
+  return pointLocator->Update(polyData) ? pointLocator : 0;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbeModel(vtkMRMLModelNode* modelNode, double ras[3], double maximumDistance)
+{
+  this->Internal->ResetProbe();
+
+  if (!modelNode)
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_MODEL;
+    return this->Internal->PixelProbeStatus;
+    }
+  vtkSlicerDataProbePointLocator * pointLocator = this->GetPointLocator(modelNode);
+  if (!pointLocator)
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_POLY_DATA;
+    return this->Internal->PixelProbeStatus;
+    }
+
+  // The locator is expressed in the local coordinates of the model
+  double localPosition[3] = {ras[0], ras[1], ras[2]};
+  vtkInternal::WorldToModel(modelNode, ras, localPosition);
+
+  double distance2 = 0.0;
+  vtkIdType pointId = pointLocator->FindClosestPoint(localPosition, distance2);
+  if (pointId < 0)
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_POLY_DATA;
+    return this->Internal->PixelProbeStatus;
+    }
+  this->Internal->ModelDistance = sqrt(distance2);
+  this->Internal->ModelPointId = pointId;
+  this->Internal->ModelCellId = pointLocator->GetPointCellId(pointId);
+  if (this->Internal->ModelDistance > maximumDistance)
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_MODEL_TOO_FAR;
+    return this->Internal->PixelProbeStatus;
+    }
+
+  vtkPolyData * polyData = modelNode->GetPolyData();
+  vtkDataArray * scalars = polyData->GetPointData()->GetScalars();
+  vtkIdType tupleIdx = pointId;
+  if (!scalars && this->Internal->ModelCellId >= 0)
+    {
+    scalars = polyData->GetCellData()->GetScalars();
+    tupleIdx = this->Internal->ModelCellId;
+    }
+  if (!scalars || tupleIdx >= scalars->GetNumberOfTuples())
+    {
+    this->Internal->PixelProbeStatus = PROBE_SUCCESS_MODEL_NO_SCALARS;
+    return this->Internal->PixelProbeStatus;
+    }
+  int numberOfComponents = scalars->GetNumberOfComponents();
+  int numberOfPixelValues = std::min(numberOfComponents, static_cast<int>(vtkInternal::MAX_NUMBER_OF_PIXEL_VALUES));
+  for (int componentIdx = 0; componentIdx < numberOfPixelValues; ++componentIdx)
+    {
+    this->Internal->PixelValues[componentIdx] = scalars->GetComponent(tupleIdx, componentIdx);
+    }
+  this->Internal->PixelNumberOfComponents = numberOfComponents;
+  this->Internal->PixelDescription = scalars->GetName() ? scalars->GetName() : "";
+  this->Internal->PixelProbeStatus = PROBE_SUCCESS_MODEL;
+  return this->Internal->PixelProbeStatus;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbeModelIntersection(vtkMRMLModelNode* modelNode, double ras[3],
+                                                    double planeNormal[3], double maximumDistance)
+{
+  double normal[3] = {planeNormal[0], planeNormal[1], planeNormal[2]};
+  if (vtkMath::Normalize(normal) == 0.0)
+    {
+    return this->ProbeModel(modelNode, ras, maximumDistance);
+    }
+  this->Internal->ResetProbe();
+
+  if (!modelNode)
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_MODEL;
+    return this->Internal->PixelProbeStatus;
+    }
+  vtkSlicerDataProbePointLocator * pointLocator = this->GetPointLocator(modelNode);
+  if (!pointLocator)
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_POLY_DATA;
+    return this->Internal->PixelProbeStatus;
+    }
+
+  // Cells within the distance have a point within the distance plus the
+  // longest edge, searched in the local coordinates of the model.
+  double localPosition[3] = {ras[0], ras[1], ras[2]};
+  vtkInternal::WorldToModel(modelNode, ras, localPosition);
+  double searchRadius = vtkInternal::WorldToModelRadius(modelNode, ras, maximumDistance)
+    + pointLocator->GetMaximumEdgeLength();
+  vtkIdList * pointIds = this->Internal->FiberPointIds;
+  vtkIdList * pointCellIds = this->Internal->ModelCellIds;
+  pointLocator->FindPointsWithinRadius(searchRadius, localPosition, pointIds);
+  std::vector<vtkIdType> cellIds;
+  for (vtkIdType idx = 0; idx < pointIds->GetNumberOfIds(); ++idx)
+    {
+    pointLocator->GetPointCells(pointIds->GetId(idx), pointCellIds);
+    for (vtkIdType cellIdx = 0; cellIdx < pointCellIds->GetNumberOfIds(); ++cellIdx)
+      {
+      cellIds.push_back(pointCellIds->GetId(cellIdx));
+      }
+    }
+  std::sort(cellIds.begin(), cellIds.end());
+  cellIds.erase(std::unique(cellIds.begin(), cellIds.end()), cellIds.end());
+
+  // Crossing of the edges with the plane closest to the probed position,
+  // the edges being mapped to world coordinates.
+  vtkPolyData * polyData = modelNode->GetPolyData();
+  vtkNew<vtkGeneralTransform> localToWorld;
+  vtkMRMLTransformNode * transformNode = modelNode->GetParentTransformNode();
+  if (transformNode)
+    {
+    transformNode->GetTransformToWorld(localToWorld.GetPointer());
+    }
+  double closestDistance = VTK_DOUBLE_MAX;
+  vtkIdType closestEdge[2] = {-1, -1};
+  double closestEdgeParameter = 0.0;
+  for (size_t cellIdx = 0; cellIdx < cellIds.size(); ++cellIdx)
+    {
+    const int cellType = polyData->GetCellType(cellIds[cellIdx]);
+    // Number of points between the ends of the edges of the cell
+    int edgeSteps[2] = {1, 0};
+    bool closed = false;
+    if (cellType == VTK_TRIANGLE || cellType == VTK_QUAD || cellType == VTK_POLYGON)
+      {
+      closed = true;
+      }
+    else if (cellType == VTK_TRIANGLE_STRIP)
+      {
+      edgeSteps[1] = 2;
+      }
+    else if (cellType != VTK_LINE && cellType != VTK_POLY_LINE)
+      {
+      continue;
+      }
+    vtkIdType numberOfCellPoints = 0;
+    vtkIdType* cellPointIds = 0;
+    polyData->GetCellPoints(cellIds[cellIdx], numberOfCellPoints, cellPointIds);
+    for (vtkIdType cellPointIdx = 0; cellPointIdx < numberOfCellPoints; ++cellPointIdx)
+      {
+      for (int stepIdx = 0; stepIdx < 2 && edgeSteps[stepIdx] > 0; ++stepIdx)
+        {
+        vtkIdType otherCellPointIdx = cellPointIdx + edgeSteps[stepIdx];
+        if (otherCellPointIdx >= numberOfCellPoints)
+          {
+          if (!closed || numberOfCellPoints < 3)
+            {
+            continue;
+            }
+          otherCellPointIdx -= numberOfCellPoints;
+          }
+        const vtkIdType edge[2] = {cellPointIds[cellPointIdx], cellPointIds[otherCellPointIdx]};
+        double ends[2][3];
+        double signedDistances[2];
+        for (int endIdx = 0; endIdx < 2; ++endIdx)
+          {
+          polyData->GetPoint(edge[endIdx], ends[endIdx]);
+          if (transformNode)
+            {
+            localToWorld->TransformPoint(ends[endIdx], ends[endIdx]);
+            }
+          double offset[3] = {ends[endIdx][0] - ras[0], ends[endIdx][1] - ras[1], ends[endIdx][2] - ras[2]};
+          signedDistances[endIdx] = vtkMath::Dot(offset, normal);
+          }
+        if ((signedDistances[0] > 0.0 && signedDistances[1] > 0.0) ||
+            (signedDistances[0] < 0.0 && signedDistances[1] < 0.0))
+          {
+          continue;
+          }
+        double edgeVector[3] = {ends[1][0] - ends[0][0], ends[1][1] - ends[0][1], ends[1][2] - ends[0][2]};
+        double edgeParameter = 0.0;
+        if (signedDistances[0] != signedDistances[1])
+          {
+          edgeParameter = signedDistances[0] / (signedDistances[0] - signedDistances[1]);
+          }
+        else if (vtkMath::Dot(edgeVector, edgeVector) > 0.0)
+          {
+          // Edge within the plane: its point closest to the probed position
+          double offset[3] = {ras[0] - ends[0][0], ras[1] - ends[0][1], ras[2] - ends[0][2]};
+          edgeParameter = std::min(std::max(
+            vtkMath::Dot(offset, edgeVector) / vtkMath::Dot(edgeVector, edgeVector), 0.0), 1.0);
+          }
+        double crossing[3];
+        for (int axis = 0; axis < 3; ++axis)
+          {
+          crossing[axis] = ends[0][axis] + edgeParameter * edgeVector[axis];
+          }
+        const double distance = sqrt(vtkMath::Distance2BetweenPoints(crossing, ras));
+        if (distance < closestDistance)
+          {
+          closestDistance = distance;
+          closestEdge[0] = edge[0];
+          closestEdge[1] = edge[1];
+          closestEdgeParameter = edgeParameter;
+          this->Internal->ModelCellId = cellIds[cellIdx];
+          }
+        }
+      }
+    }
+  if (closestEdge[0] < 0)
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_MODEL_TOO_FAR;
+    return this->Internal->PixelProbeStatus;
+    }
+  this->Internal->ModelDistance = closestDistance;
+  this->Internal->ModelPointId = closestEdgeParameter < 0.5 ? closestEdge[0] : closestEdge[1];
+  if (this->Internal->ModelDistance > maximumDistance)
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_MODEL_TOO_FAR;
+    return this->Internal->PixelProbeStatus;
+    }
+
+  // Point scalars interpolated along the crossing edge, or the cell scalars
+  vtkDataArray * scalars = polyData->GetPointData()->GetScalars();
+  if (scalars && (closestEdge[0] >= scalars->GetNumberOfTuples() ||
+                  closestEdge[1] >= scalars->GetNumberOfTuples()))
+    {
+    scalars = 0;
+    }
+  vtkDataArray * cellScalars = scalars ? 0 : polyData->GetCellData()->GetScalars();
+  if (cellScalars && this->Internal->ModelCellId >= cellScalars->GetNumberOfTuples())
+    {
+    cellScalars = 0;
+    }
+  if (!scalars && !cellScalars)
+    {
+    this->Internal->PixelProbeStatus = PROBE_SUCCESS_MODEL_NO_SCALARS;
+    return this->Internal->PixelProbeStatus;
+    }
+  vtkDataArray * probedScalars = scalars ? scalars : cellScalars;
+  int numberOfComponents = probedScalars->GetNumberOfComponents();
+  int numberOfPixelValues = std::min(numberOfComponents, static_cast<int>(vtkInternal::MAX_NUMBER_OF_PIXEL_VALUES));
+  for (int componentIdx = 0; componentIdx < numberOfPixelValues; ++componentIdx)
+    {
+    this->Internal->PixelValues[componentIdx] = scalars ?
+      (1.0 - closestEdgeParameter) * scalars->GetComponent(closestEdge[0], componentIdx) +
+      closestEdgeParameter * scalars->GetComponent(closestEdge[1], componentIdx) :
+      cellScalars->GetComponent(this->Internal->ModelCellId, componentIdx);
+    }
+  this->Internal->PixelNumberOfComponents = numberOfComponents;
+  this->Internal->PixelDescription = probedScalars->GetName() ? probedScalars->GetName() : "";
+  this->Internal->PixelProbeStatus = PROBE_SUCCESS_MODEL;
+  return this->Internal->PixelProbeStatus;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerDataProbeLogic::GetModelDistance()const
+{
+  return this->Internal->ModelDistance;
+}
+
+//---------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeLogic::GetModelPointId()const
+{
+  return this->Internal->ModelPointId;
+}
+
+//---------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeLogic::GetModelCellId()const
+{
+  return this->Internal->ModelCellId;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbeFiberBundle(vtkMRMLModelNode* fiberBundleNode, double ras[3], double radius)
+{
+  this->Internal->ResetProbe();
+
+  if (!fiberBundleNode)
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_MODEL;
+    return this->Internal->PixelProbeStatus;
+    }
+  vtkSlicerDataProbePointLocator * pointLocator = this->GetPointLocator(fiberBundleNode);
+  if (!pointLocator)
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_POLY_DATA;
+    return this->Internal->PixelProbeStatus;
+    }
+  // The points are searched in the local coordinates of the bundle within
+  // a radius bounding the world sphere, their distances are measured in
+  // world coordinates.
+  double localPosition[3] = {ras[0], ras[1], ras[2]};
+  vtkInternal::WorldToModel(fiberBundleNode, ras, localPosition);
+  vtkNew<vtkGeneralTransform> localToWorld;
+  vtkMRMLTransformNode * transformNode = fiberBundleNode->GetParentTransformNode();
+  if (transformNode)
+    {
+    transformNode->GetTransformToWorld(localToWorld.GetPointer());
+    }
+
+  // Closest point of each streamline within the radius
+  vtkPolyData * polyData = fiberBundleNode->GetPolyData();
+  vtkIdList * pointIds = this->Internal->FiberPointIds;
+  pointLocator->FindPointsWithinRadius(vtkInternal::WorldToModelRadius(fiberBundleNode, ras, radius),
+                                       localPosition, pointIds);
+  std::vector<vtkInternal::ProbedFiber>& fibers = this->Internal->ProbedFibers;
+  for (vtkIdType idx = 0; idx < pointIds->GetNumberOfIds(); ++idx)
+    {
+    vtkInternal::ProbedFiber fiber;
+    fiber.PointId = pointIds->GetId(idx);
+    fiber.CellId = pointLocator->GetPointCellId(fiber.PointId);
+    if (fiber.CellId < 0)
+      {
+      continue;
+      }
+    double point[3];
+    polyData->GetPoint(fiber.PointId, point);
+    if (transformNode)
+      {
+      localToWorld->TransformPoint(point, point);
+      }
+    fiber.Distance = sqrt(vtkMath::Distance2BetweenPoints(point, ras));
+    if (fiber.Distance > radius)
+      {
+      continue;
+      }
+    fiber.Value = vtkMath::Nan();
+    fibers.push_back(fiber);
+    }
+  std::sort(fibers.begin(), fibers.end());
+  fibers.erase(std::unique(fibers.begin(), fibers.end()), fibers.end());
+  std::sort(fibers.begin(), fibers.end(), vtkInternal::ProbedFiber::CloserThan);
+  if (fibers.empty())
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_MODEL_TOO_FAR;
+    return this->Internal->PixelProbeStatus;
+    }
+  this->Internal->ModelDistance = fibers[0].Distance;
+  this->Internal->ModelPointId = fibers[0].PointId;
+  this->Internal->ModelCellId = fibers[0].CellId;
+
+  // Point scalars, or the anisotropy of the tensors tracked along the fibers
+  vtkDataArray * scalars = polyData->GetPointData()->GetScalars();
+  vtkDataArray * tensors = scalars ? 0 : polyData->GetPointData()->GetTensors();
+  if (tensors && tensors->GetNumberOfComponents() != 9)
+    {
+    tensors = 0;
+    }
+  if (!scalars && !tensors)
+    {
+    this->Internal->PixelProbeStatus = PROBE_SUCCESS_MODEL_NO_SCALARS;
+    return this->Internal->PixelProbeStatus;
+    }
+  for (size_t fiberIdx = 0; fiberIdx < fibers.size(); ++fiberIdx)
+    {
+    vtkInternal::ProbedFiber& fiber = fibers[fiberIdx];
+    if (scalars && fiber.PointId < scalars->GetNumberOfTuples())
+      {
+      fiber.Value = scalars->GetComponent(fiber.PointId, 0);
+      }
+    else if (tensors && fiber.PointId < tensors->GetNumberOfTuples())
+      {
+      fiber.Value = vtkSlicerDataProbeFractionalAnisotropy(tensors->GetTuple(fiber.PointId));
+      }
+    }
+  this->Internal->PixelValues[0] = fibers[0].Value;
+  this->Internal->PixelNumberOfComponents = 1;
+  this->Internal->PixelDescription = scalars ? (scalars->GetName() ? scalars->GetName() : "") : "FA";
+  this->Internal->PixelProbeStatus = PROBE_SUCCESS_MODEL;
+  return this->Internal->PixelProbeStatus;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::GetNumberOfProbedFibers()const
+{
+  return static_cast<int>(this->Internal->ProbedFibers.size());
+}
+
+//---------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeLogic::GetProbedFiberCellId(int fiberIdx)const
+{
+  if (fiberIdx < 0 || fiberIdx >= this->GetNumberOfProbedFibers())
+    {
+    return -1;
+    }
+  return this->Internal->ProbedFibers[fiberIdx].CellId;
+}
+
+//---------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeLogic::GetProbedFiberPointId(int fiberIdx)const
+{
+  if (fiberIdx < 0 || fiberIdx >= this->GetNumberOfProbedFibers())
+    {
+    return -1;
+    }
+  return this->Internal->ProbedFibers[fiberIdx].PointId;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerDataProbeLogic::GetProbedFiberDistance(int fiberIdx)const
+{
+  if (fiberIdx < 0 || fiberIdx >= this->GetNumberOfProbedFibers())
+    {
+    return vtkMath::Nan();
+    }
+  return this->Internal->ProbedFibers[fiberIdx].Distance;
+}
 
 //---------------------------------------------------------------------------
-vtkSlicerDataProbeLogic::vtkInternal::vtkInternal(
-    vtkSlicerDataProbeLogic* _external)
+double vtkSlicerDataProbeLogic::GetProbedFiberValue(int fiberIdx)const
 {
-  this->External = _external;
+  if (fiberIdx < 0 || fiberIdx >= this->GetNumberOfProbedFibers())
+    {
+    return vtkMath::Nan();
+    }
+  return this->Internal->ProbedFibers[fiberIdx].Value;
+}
 
-  this->DTIMath = vtkSmartPointer<vtkDiffusionTensorMathematics>::New();
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::GetRayHitRAS(double ras[3])const
+{
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    ras[axis] = this->Internal->RayHitRAS[axis];
+    }
+}
 
-  this->SinglePixelImage = vtkSmartPointer<vtkImageData>::New();
-  this->SinglePixelImage->SetExtent(0, 0, 0, 0, 0, 0);
-  this->SinglePixelImage->AllocateScalars();
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::GetRayHitIJK(int ijk[3])const
+{
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    ijk[axis] = this->Internal->RayHitIJK[axis];
+    }
+}
 
-  this->TensorData = vtkSmartPointer<vtkFloatArray>::New();
-  this->TensorData->SetNumberOfComponents(9);
-  this->TensorData->SetNumberOfTuples(this->SinglePixelImage->GetNumberOfPoints());
-  this->SinglePixelImage->GetPointData()->SetTensors(this->TensorData);
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::GetGradient(double gradient[3])const
+{
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    gradient[axis] = this->Internal->Gradient[axis];
+    }
+}
 
-  this->DTIMath->SetInput(this->SinglePixelImage);
+//---------------------------------------------------------------------------
+double vtkSlicerDataProbeLogic::GetGradientMagnitude()const
+{
+  return this->Internal->GradientMagnitude;
+}
 
-  this->ResetProbe();
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::GetHessianEigenvalues(double eigenvalues[3])const
+{
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    eigenvalues[axis] = this->Internal->HessianEigenvalues[axis];
+    }
 }
 
 //---------------------------------------------------------------------------
-vtkSlicerDataProbeLogic::vtkInternal::~vtkInternal()
+double vtkSlicerDataProbeLogic::GetIsophoteCurvature()const
 {
+  return this->Internal->IsophoteCurvature;
 }
 
-//----------------------------------------------------------------------------
-void vtkSlicerDataProbeLogic::vtkInternal::ResetProbe()
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::ProbeDisplacement(vtkMRMLVolumeNode* volumeNode, double ijk[3])
 {
-  this->NumberOfPixelValues = 0;
-  this->PixelNumberOfComponents = 0;
-  for (int pixelValueIdx = 0; pixelValueIdx < MAX_NUMBER_OF_PIXEL_VALUES; ++pixelValueIdx)
+  this->Internal->ResetProbe();
+
+  vtkImageData * imageData = this->Internal->GetProbedImageData(volumeNode, ijk);
+  if (!imageData)
     {
-    this->PixelValues[pixelValueIdx] = vtkMath::Nan();
+    return this->Internal->PixelProbeStatus;
+    }
+  if (vtkMRMLDiffusionTensorVolumeNode::SafeDownCast(volumeNode) ||
+      imageData->GetNumberOfScalarComponents() < 3 || !imageData->GetScalarPointer())
+    {
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_DISPLACEMENT_FIELD;
+    return this->Internal->PixelProbeStatus;
     }
-  this->PixelDescription.clear();
-  this->PixelProbeStatus = vtkSlicerDataProbeLogic::UNKNOWN;
-}
 
-//----------------------------------------------------------------------------
-// vtkSlicerDataProbeLogic methods
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+  const int numberOfComponents = imageData->GetNumberOfScalarComponents();
+  const vtkIdType increments[3] = {numberOfComponents, static_cast<vtkIdType>(numberOfComponents) * dims[0],
+                                   static_cast<vtkIdType>(numberOfComponents) * dims[0] * dims[1]};
+  // Same voxel as ProbePixel(), the closest one
+  int center[3] = {std::min(vtkMath::Round(ijk[0]), dims[0] - 1), std::min(vtkMath::Round(ijk[1]), dims[1] - 1),
+                   std::min(vtkMath::Round(ijk[2]), dims[2] - 1)};
+  const vtkIdType offset = center[0] * increments[0] + center[1] * increments[1] + center[2] * increments[2];
+  double gradientIJK[3][3];
+  switch (imageData->GetScalarType())
+    {
+    vtkTemplateMacro(
+      const VTK_TT* voxel = static_cast<const VTK_TT*>(imageData->GetScalarPointer()) + offset;
+      vtkSlicerDataProbeDisplacementGradient(voxel, center, dims, increments, gradientIJK);
+      for (int component = 0; component < 3; ++component)
+        {
+        this->Internal->Displacement[component] = static_cast<double>(voxel[component]);
+        });
+    default:
+      this->Internal->PixelProbeStatus = PROBE_ERROR_NO_IMAGE_DATA;
+      return this->Internal->PixelProbeStatus;
+    }
 
-//----------------------------------------------------------------------------
-vtkStandardNewMacro(vtkSlicerDataProbeLogic);
+  double jacobian[3][3];
+  vtkSlicerDataProbeIJKToRASDerivatives(volumeNode, jacobian);
+  double jacobianT[3][3];
+  vtkMath::Transpose3x3(jacobian, jacobianT);
+  double deformation[3][3];
+  vtkSlicerDataProbeDeformationGradient(gradientIJK, jacobianT, deformation);
+  this->Internal->JacobianDeterminant = vtkSlicerDataProbeDeterminant3x3(deformation);
 
-//----------------------------------------------------------------------------
-vtkSlicerDataProbeLogic::vtkSlicerDataProbeLogic()
+  // Green-Lagrange strain tensor E = (F^T F - I) / 2
+  double deformationT[3][3];
+  double strain[3][3];
+  vtkMath::Transpose3x3(deformation, deformationT);
+  vtkMath::Multiply3x3(deformationT, deformation, strain);
+  for (int row = 0; row < 3; ++row)
+    {
+    for (int column = 0; column < 3; ++column)
+      {
+      strain[row][column] = 0.5 * (strain[row][column] - (row == column ? 1.0 : 0.0));
+      }
+    }
+  double eigenvectors[3][3];
+  vtkMath::Diagonalize3x3(strain, this->Internal->PrincipalStrains, eigenvectors);
+  std::sort(this->Internal->PrincipalStrains, this->Internal->PrincipalStrains + 3, std::greater<double>());
+
+  for (int component = 0; component < 3; ++component)
+    {
+    this->Internal->PixelValues[component] = this->Internal->Displacement[component];
+    }
+  this->Internal->PixelNumberOfComponents = 3;
+  this->Internal->PixelProbeStatus = PROBE_SUCCESS_SCALAR_VOLUME;
+  return this->Internal->PixelProbeStatus;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::GetDisplacement(double displacement[3])const
 {
-  this->Internal = new vtkInternal(this);
+  std::copy(this->Internal->Displacement, this->Internal->Displacement + 3, displacement);
 }
 
-//----------------------------------------------------------------------------
-vtkSlicerDataProbeLogic::~vtkSlicerDataProbeLogic()
+//---------------------------------------------------------------------------
+double vtkSlicerDataProbeLogic::GetDisplacementMagnitude()const
 {
-  delete this->Internal;
+  return vtkMath::Norm(this->Internal->Displacement);
 }
 
-//----------------------------------------------------------------------------
-void vtkSlicerDataProbeLogic::PrintSelf(ostream& os, vtkIndent indent)
+//---------------------------------------------------------------------------
+double vtkSlicerDataProbeLogic::GetJacobianDeterminant()const
 {
-  this->Superclass::PrintSelf(os, indent);
+  return this->Internal->JacobianDeterminant;
 }
 
 //---------------------------------------------------------------------------
-int vtkSlicerDataProbeLogic::ProbePixel(vtkMRMLVolumeNode* volumeNode, double ijk[3])
+void vtkSlicerDataProbeLogic::GetPrincipalStrains(double strains[3])const
 {
-  return this->ProbePixel(volumeNode, ijk[0], ijk[1], ijk[2]);
+  std::copy(this->Internal->PrincipalStrains, this->Internal->PrincipalStrains + 3, strains);
 }
 
 //---------------------------------------------------------------------------
-int vtkSlicerDataProbeLogic::ProbePixel(vtkMRMLVolumeNode* volumeNode, double i, double j, double k)
+int vtkSlicerDataProbeLogic::ProbeFolding(vtkMRMLVolumeNode* volumeNode, int extent[6])
 {
   this->Internal->ResetProbe();
 
   vtkMRMLScalarVolumeNode * scalarVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode);
-  if (!scalarVolumeNode)
+  vtkImageData * imageData = scalarVolumeNode ? scalarVolumeNode->GetImageData() : 0;
+  if (!imageData || !imageData->GetScalarPointer())
     {
-    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_SCALAR_VOLUME;
+    this->Internal->PixelProbeStatus = scalarVolumeNode ? PROBE_ERROR_NO_IMAGE_DATA : PROBE_ERROR_NO_SCALAR_VOLUME;
     return this->Internal->PixelProbeStatus;
     }
-
-  vtkImageData * imageData = scalarVolumeNode->GetImageData();
-  if(!imageData)
+  if (vtkMRMLDiffusionTensorVolumeNode::SafeDownCast(volumeNode) || imageData->GetNumberOfScalarComponents() < 3)
     {
-    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_IMAGE_DATA;
+    this->Internal->PixelProbeStatus = PROBE_ERROR_NO_DISPLACEMENT_FIELD;
     return this->Internal->PixelProbeStatus;
     }
 
-  int dims[3] = {-1, -1, -1};
-  double ijk[3] = {i, j, k};
-  imageData->GetDimensions(dims);
-  for (int dimIdx = 0; dimIdx < 3; ++dimIdx)
+  vtkSlicerDataProbeFoldingTask task;
+  task.Scalars = imageData->GetScalarPointer();
+  task.ScalarType = imageData->GetScalarType();
+  imageData->GetDimensions(task.Dimensions);
+  const int numberOfComponents = imageData->GetNumberOfScalarComponents();
+  task.Increments[0] = numberOfComponents;
+  task.Increments[1] = task.Increments[0] * task.Dimensions[0];
+  task.Increments[2] = task.Increments[1] * task.Dimensions[1];
+  for (int axis = 0; axis < 3; ++axis)
     {
-    if(ijk[dimIdx] < 0 || ijk[dimIdx] >= dims[dimIdx])
+    task.Extent[2 * axis] = std::max(extent[2 * axis], 0);
+    task.Extent[2 * axis + 1] = std::min(extent[2 * axis + 1], task.Dimensions[axis] - 1);
+    if (task.Extent[2 * axis] > task.Extent[2 * axis + 1])
       {
       this->Internal->PixelProbeStatus = PROBE_ERROR_OUT_OF_FRAME;
       return this->Internal->PixelProbeStatus;
       }
     }
+  double jacobian[3][3];
+  vtkSlicerDataProbeIJKToRASDerivatives(volumeNode, jacobian);
+  vtkMath::Transpose3x3(jacobian, task.JacobianT);
 
-  if (scalarVolumeNode->GetLabelMap())
+  // Each thread scans a slab of slices, no Jacobian volume is allocated
+  vtkNew<vtkMultiThreader> threader;
+  int numberOfThreads = std::min(vtkMultiThreader::GetGlobalDefaultNumberOfThreads(), VTK_MAX_THREADS);
+  numberOfThreads = std::max(std::min(numberOfThreads, task.Extent[5] - task.Extent[4] + 1), 1);
+  task.Results.resize(numberOfThreads);
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(vtkSlicerDataProbeFoldingTask::Execute, &task);
+  threader->SingleMethodExecute();
+  for (int threadIdx = 0; threadIdx < numberOfThreads; ++threadIdx)
     {
-    std::string labelName;
-    int labelProbeStatus = LABEL_VOLUME;
-    double labelIndex = imageData->GetScalarComponentAsDouble(i, j, k, 0);
-    vtkMRMLColorNode * colorNode = scalarVolumeNode->GetDisplayNode()->GetColorNode();
-    if (colorNode)
-      {
-      labelName = colorNode->GetColorName(static_cast<int>(labelIndex));
-      }
-    else
-      {
-      labelProbeStatus = PROBE_WARNING_LABEL_VOLUME_UNKNOWN_LABELNAME;
-      }
-    this->Internal->PixelNumberOfComponents = 1;
-    this->Internal->PixelValues[0] = labelIndex;
-    this->Internal->PixelDescription = labelName;
-    this->Internal->PixelProbeStatus = labelProbeStatus | PROBE_SUCCESS;
-    return this->Internal->PixelProbeStatus;
+    this->Internal->Folding.Merge(task.Results[threadIdx]);
     }
-  else if(vtkMRMLDiffusionTensorVolumeNode * dtiVolumeNode =
-     vtkMRMLDiffusionTensorVolumeNode::SafeDownCast(scalarVolumeNode))
-    {
-    vtkIdType pointIdx = imageData->FindPoint(i, j, k);
-    if (pointIdx == -1)
-      {
-      this->Internal->PixelProbeStatus = PROBE_ERROR_OUT_OF_FRAME;
-      return this->Internal->PixelProbeStatus;
-      }
-    vtkPointData* pointData = imageData->GetPointData();
-    if (!pointData)
-      {
-      this->Internal->PixelProbeStatus = PROBE_ERROR_DTI_NO_POINT_DATA;
-      return this->Internal->PixelProbeStatus;
-      }
-    vtkDataArray * tensors = pointData->GetTensors();
-    if (!tensors)
-      {
-      this->Internal->PixelProbeStatus = PROBE_ERROR_DTI_NO_TENSOR_DATA;
-      return this->Internal->PixelProbeStatus;
-      }
-    double tensor[9] = {0.0, 0.0, 0.0,
-                        0.0, 0.0, 0.0,
-                        0.0, 0.0, 0.0};
-    tensors->GetTuple(pointIdx, tensor);
 
-    float tensorAsFloat[9];
-    for(int idx = 0; idx < 9; ++idx)
-      {
-      tensorAsFloat[idx] = static_cast<float>(tensor[idx]);
-      }
+  this->Internal->PixelProbeStatus = PROBE_SUCCESS_SCALAR_VOLUME;
+  return this->Internal->PixelProbeStatus;
+}
 
-    vtkMRMLDiffusionTensorVolumeDisplayNode * dtiVolumeDisplayNode =
-        vtkMRMLDiffusionTensorVolumeDisplayNode::SafeDownCast(dtiVolumeNode->GetScalarVolumeDisplayNode());
+//---------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeLogic::GetFoldingNumberOfVoxels()const
+{
+  return this->Internal->Folding.NumberOfVoxels;
+}
 
-    std::string scalarInvariant = "ColorOrientation";
-    int operation = vtkDiffusionTensorMathematics::VTK_TENS_COLOR_ORIENTATION;
-    if (dtiVolumeDisplayNode)
-      {
-      operation = dtiVolumeDisplayNode->GetScalarInvariant();
-      scalarInvariant = dtiVolumeDisplayNode->GetScalarInvariantAsString();
-      }
-    this->Internal->PixelNumberOfComponents = 1;
-    this->Internal->PixelValues[0] = this->CalculateTensorScalars(tensorAsFloat, operation);
-    this->Internal->PixelDescription = scalarInvariant;
-    this->Internal->PixelProbeStatus = PROBE_SUCCESS_DTI_VOLUME;
-    return this->Internal->PixelProbeStatus;
-    }
-  else
+//---------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeLogic::GetNumberOfFoldedVoxels()const
+{
+  return this->Internal->Folding.NumberOfFoldedVoxels;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerDataProbeLogic::GetMinimumJacobianDeterminant()const
+{
+  return this->Internal->Folding.NumberOfVoxels > 0 ?
+    this->Internal->Folding.MinimumDeterminant : vtkMath::Nan();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::GetMinimumJacobianDeterminantIJK(int ijk[3])const
+{
+  std::copy(this->Internal->Folding.MinimumIJK, this->Internal->Folding.MinimumIJK + 3, ijk);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::GetFoldedExtent(int extent[6])const
+{
+  const vtkSlicerDataProbeFoldingResult& folding = this->Internal->Folding;
+  for (int axis = 0; axis < 3; ++axis)
     {
-    int numberOfComponents = imageData->GetNumberOfScalarComponents();
-    int numberOfPixelValues = vtkInternal::MAX_NUMBER_OF_PIXEL_VALUES;
-    if (numberOfComponents < vtkInternal::MAX_NUMBER_OF_PIXEL_VALUES)
-      {
-      numberOfPixelValues = numberOfComponents;
-      }
-    for (int componentIdx = 0; componentIdx < numberOfPixelValues; ++componentIdx)
-      {
-      this->Internal->PixelValues[componentIdx] = imageData->GetScalarComponentAsDouble(
-            vtkMath::Round(i), vtkMath::Round(j), vtkMath::Round(k), componentIdx);
-      }
-    this->Internal->PixelNumberOfComponents = numberOfComponents;
-    this->Internal->PixelProbeStatus = PROBE_SUCCESS_SCALAR_VOLUME;
-    return this->Internal->PixelProbeStatus;
+    extent[2 * axis] = folding.NumberOfFoldedVoxels > 0 ? folding.FoldedExtent[2 * axis] : 0;
+    extent[2 * axis + 1] = folding.NumberOfFoldedVoxels > 0 ? folding.FoldedExtent[2 * axis + 1] : -1;
     }
 }
 
@@ -290,6 +3275,15 @@ double vtkSlicerDataProbeLogic::GetPixelValue(int nth)const
     }
 }
 
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::GetPixelVoxel(int voxel[3])const
+{
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    voxel[axis] = this->Internal->PixelVoxel[axis];
+    }
+}
+
 //---------------------------------------------------------------------------
 int vtkSlicerDataProbeLogic::GetPixelProbeStatus()const
 {
@@ -302,23 +3296,108 @@ std::string vtkSlicerDataProbeLogic::GetPixelProbeStatusAsString()const
   return Self::GetDataProbeStatusEnumAsString(this->Internal->PixelProbeStatus);
 }
 
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::GetNumberOfPixelSegments()const
+{
+  return static_cast<int>(this->Internal->PixelSegments.size());
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::GetPixelSegment(int nth)const
+{
+  if (nth < 0 || nth >= this->GetNumberOfPixelSegments())
+    {
+    return 0;
+    }
+  return this->Internal->PixelSegments[nth];
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerDataProbeLogic::GetPixelSegmentName(int nth)const
+{
+  if (nth < 0 || nth >= this->GetNumberOfPixelSegments())
+    {
+    return std::string();
+    }
+  return this->Internal->PixelSegmentNames[nth];
+}
+
+//---------------------------------------------------------------------------
+const char* vtkSlicerDataProbeLogic::GetLabelEncodingAttributeName()
+{
+  return "DataProbe.LabelEncoding";
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerDataProbeLogic::GetLabelEncoding(vtkMRMLVolumeNode* volumeNode)
+{
+  const char* encoding = volumeNode ?
+    volumeNode->GetAttribute(vtkSlicerDataProbeLogic::GetLabelEncodingAttributeName()) : 0;
+  if (!encoding)
+    {
+    return SINGLE_LABEL_ENCODING;
+    }
+  if (!strcmp(encoding, "BitPacked"))
+    {
+    return BIT_PACKED_LABEL_ENCODING;
+    }
+  if (!strcmp(encoding, "Layered"))
+    {
+    return LAYERED_LABEL_ENCODING;
+    }
+  return SINGLE_LABEL_ENCODING;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeLogic::SetLabelEncoding(vtkMRMLVolumeNode* volumeNode, int encoding)
+{
+  if (!volumeNode)
+    {
+    return;
+    }
+  const char* attributeName = vtkSlicerDataProbeLogic::GetLabelEncodingAttributeName();
+  switch (encoding)
+    {
+    case BIT_PACKED_LABEL_ENCODING:
+      volumeNode->SetAttribute(attributeName, "BitPacked");
+      break;
+    case LAYERED_LABEL_ENCODING:
+      volumeNode->SetAttribute(attributeName, "Layered");
+      break;
+    default:
+      volumeNode->SetAttribute(attributeName, "Single");
+      break;
+    }
+}
+
 //---------------------------------------------------------------------------
 std::string vtkSlicerDataProbeLogic::GetPixelDescription()const
 {
   return this->Internal->PixelDescription;
 }
 
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeTensorScalarCache* vtkSlicerDataProbeLogic::GetTensorScalarCache()const
+{
+  if (!this->Internal->TensorScalarCache)
+    {
+    this->Internal->TensorScalarCache = vtkSmartPointer<vtkSlicerDataProbeTensorScalarCache>::New();
+    }
+  return this->Internal->TensorScalarCache;
+}
+
 //---------------------------------------------------------------------------
 double vtkSlicerDataProbeLogic::CalculateTensorScalars(float tensor[9], int operation)
 {
+  vtkDiffusionTensorMathematics * dtiMath = this->Internal->GetDTIMath();
   this->Internal->TensorData->SetTupleValue(0, tensor);
   this->Internal->TensorData->Modified();
   this->Internal->SinglePixelImage->Modified();
 
-  this->Internal->DTIMath->SetOperation(operation);
-  this->Internal->DTIMath->Update();
+  dtiMath->SetOperation(operation);
+  dtiMath->Update();
 
-  vtkImageData * output = this->Internal->DTIMath->GetOutput();
+  vtkImageData * output = dtiMath->GetOutput();
 
   double value = vtkMath::Nan();
   if (output && output->GetNumberOfScalarComponents() > 0)
@@ -367,6 +3446,50 @@ const char* vtkSlicerDataProbeLogic::GetDataProbeStatusEnumAsString(int probeSta
     {
     return "No tensor data";
     }
+  else if (probeStatus ==  PROBE_ERROR_NO_DISPLAYED_DATA)
+    {
+    return "No displayed data";
+    }
+  else if (probeStatus ==  PROBE_ERROR_NO_RAY_HIT)
+    {
+    return "Nothing along the ray";
+    }
+  else if (probeStatus ==  PROBE_SUCCESS_MODEL)
+    {
+    return "Successfully probed  Model";
+    }
+  else if (probeStatus ==  PROBE_SUCCESS_MODEL_NO_SCALARS)
+    {
+    return "No scalars";
+    }
+  else if (probeStatus ==  PROBE_ERROR_NO_MODEL)
+    {
+    return "No model";
+    }
+  else if (probeStatus ==  PROBE_ERROR_NO_POLY_DATA)
+    {
+    return "No poly data";
+    }
+  else if (probeStatus ==  PROBE_ERROR_MODEL_TOO_FAR)
+    {
+    return "Too far from model";
+    }
+  else if (probeStatus ==  PROBE_ERROR_DISTANCE_MAP_NOT_READY)
+    {
+    return "Computing distances";
+    }
+  else if (probeStatus ==  PROBE_ERROR_HISTOGRAM_NOT_READY)
+    {
+    return "Computing histogram";
+    }
+  else if (probeStatus ==  PROBE_ERROR_NO_DISPLACEMENT_FIELD)
+    {
+    return "No displacement field";
+    }
+  else if (probeStatus ==  PROBE_ERROR_UNSUPPORTED_LABEL_ENCODING)
+    {
+    return "Overlapping labels not supported";
+    }
 
   return "Unknown";
 }
@@ -33,7 +33,22 @@
 
 #include "vtkSlicerDataProbeModuleLogicExport.h"
 
+class vtkMRMLDataProbeResultNode;
+class vtkMRMLModelNode;
+class vtkMRMLSliceLayerLogic;
 class vtkMRMLVolumeNode;
+class vtkSlicerDataProbeBatchEngine;
+class vtkSlicerDataProbeComponentIndex;
+class vtkSlicerDataProbeDistanceMap;
+class vtkSlicerDataProbeHistogram;
+class vtkSlicerDataProbeLabelComposition;
+class vtkSlicerDataProbeLabelIndex;
+class vtkSlicerDataProbePathTrace;
+class vtkSlicerDataProbePointLocator;
+class vtkSlicerDataProbeSharedMemoryStream;
+class vtkSlicerDataProbeTensorScalarCache;
+class vtkSlicerDataProbeTransformCache;
+class vtkSlicerDataProbeViewportStatistics;
 
 /// \ingroup Slicer_QtModules_DataProbe
 class VTK_SLICER_DATAPROBE_MODULE_LOGIC_EXPORT vtkSlicerDataProbeLogic :
@@ -57,27 +72,477 @@ public:
     SCALAR_VOLUME = 0x4,
     LABEL_VOLUME  = 0x8  | SCALAR_VOLUME,
     DTI_VOLUME    = 0x10 | SCALAR_VOLUME,
+    MODEL         = 0x20,
 
     PROBE_WARNING_LABEL_VOLUME_UNKNOWN_LABELNAME = 0x100,
+    PROBE_WARNING_MODEL_NO_SCALARS = 0x200,
 
     PROBE_SUCCESS_DTI_VOLUME    = DTI_VOLUME    | PROBE_SUCCESS,
     PROBE_SUCCESS_SCALAR_VOLUME = SCALAR_VOLUME | PROBE_SUCCESS,
     PROBE_SUCCESS_LABEL_VOLUME  = LABEL_VOLUME  | PROBE_SUCCESS,
     PROBE_SUCCESS_LABEL_VOLUME_UNKNOWN_LABELNAME = PROBE_WARNING_LABEL_VOLUME_UNKNOWN_LABELNAME | LABEL_VOLUME | PROBE_SUCCESS,
+    PROBE_SUCCESS_MODEL         = MODEL         | PROBE_SUCCESS,
+    PROBE_SUCCESS_MODEL_NO_SCALARS = PROBE_WARNING_MODEL_NO_SCALARS | MODEL | PROBE_SUCCESS,
 
     PROBE_ERROR_NO_SCALAR_VOLUME   = 0x1  * 10000 | PROBE_ERROR,
     PROBE_ERROR_NO_IMAGE_DATA      = 0x2  * 10000 | SCALAR_VOLUME | PROBE_ERROR,
     PROBE_ERROR_OUT_OF_FRAME       = 0x4  * 10000 | SCALAR_VOLUME | PROBE_ERROR,
     PROBE_ERROR_DTI_NO_POINT_DATA  = 0x8  * 10000 | DTI_VOLUME | PROBE_ERROR,
-    PROBE_ERROR_DTI_NO_TENSOR_DATA = 0x10 * 10000 | DTI_VOLUME | PROBE_ERROR
+    PROBE_ERROR_DTI_NO_TENSOR_DATA = 0x10 * 10000 | DTI_VOLUME | PROBE_ERROR,
+    PROBE_ERROR_NO_DISPLAYED_DATA  = 0x20 * 10000 | SCALAR_VOLUME | PROBE_ERROR,
+    PROBE_ERROR_NO_RAY_HIT         = 0x40 * 10000 | SCALAR_VOLUME | PROBE_ERROR,
+    PROBE_ERROR_NO_MODEL           = 0x80 * 10000 | PROBE_ERROR,
+    PROBE_ERROR_NO_POLY_DATA       = 0x100 * 10000 | MODEL | PROBE_ERROR,
+    PROBE_ERROR_MODEL_TOO_FAR      = 0x200 * 10000 | MODEL | PROBE_ERROR,
+    PROBE_ERROR_DISTANCE_MAP_NOT_READY = 0x400 * 10000 | LABEL_VOLUME | PROBE_ERROR,
+    PROBE_ERROR_HISTOGRAM_NOT_READY = 0x800 * 10000 | SCALAR_VOLUME | PROBE_ERROR,
+    PROBE_ERROR_NO_DISPLACEMENT_FIELD = 0x1000 * 10000 | SCALAR_VOLUME | PROBE_ERROR,
+    PROBE_ERROR_UNSUPPORTED_LABEL_ENCODING = 0x2000 * 10000 | LABEL_VOLUME | PROBE_ERROR
+  };
+
+  /// Storage of the labels of a label map, see GetLabelEncoding():
+  ///  - SINGLE_LABEL_ENCODING: the first component of a voxel is its label.
+  ///  - BIT_PACKED_LABEL_ENCODING: each bit of the voxel components flags an
+  ///    overlapping segment, bit b of component c being the segment
+  ///    c * (number of bits per component) + b + 1. For example a 64-bit
+  ///    scalar, or 4 components of 16 bits, holds up to 64 segments.
+  ///  - LAYERED_LABEL_ENCODING: each component is a layer holding the label
+  ///    of one segment, 0 being empty.
+  /// Segment indices are the color indices of the segment names.
+  enum LabelEncoding
+  {
+    SINGLE_LABEL_ENCODING = 0,
+    BIT_PACKED_LABEL_ENCODING,
+    LAYERED_LABEL_ENCODING
+  };
+
+  enum DerivativeKernel
+  {
+    /// Central finite differences, 3x3x3 neighborhood
+    CENTRAL_DIFFERENCE_KERNEL = 0,
+    /// Gaussian derivatives of standard deviation 1 voxel, 5x5x5 neighborhood
+    GAUSSIAN_KERNEL
+  };
+
+  enum RayProbeMode
+  {
+    /// First voxel along the ray whose value is greater or equal to the threshold
+    FIRST_ABOVE_THRESHOLD_RAY_MODE = 0,
+    /// Voxel of maximum value along the ray
+    MAXIMUM_RAY_MODE
   };
 
   /// Return a descriptive string associated with given \a probeStatus
   static const char* GetDataProbeStatusEnumAsString(int probeStatus);
 
+  /// Probe the pixel \a ijk of \a volumeNode.
+  /// For label maps storing overlapping segments (see LabelEncoding), all
+  /// the segments of the voxel are decoded, the pixel value being the first
+  /// one and the description the list of their names.
+  /// \sa GetNumberOfPixelSegments, GetPixelSegment, GetPixelSegmentName
   int ProbePixel(vtkMRMLVolumeNode* volumeNode, double ijk[3]);
   int ProbePixel(vtkMRMLVolumeNode* volumeNode, double i, double j, double k);
 
+  /// Probe the pixel of \a volumeNode found at the world position \a ras.
+  /// All the transforms above the volume, linear or not, are taken into account.
+  /// \sa ConvertRASToIJK, ProbePixel
+  int ProbeRAS(vtkMRMLVolumeNode* volumeNode, double ras[3]);
+
+  /// Map the world position \a ras into the IJK coordinates of \a volumeNode.
+  /// The composite transform of the volume is cached, see GetTransformCache().
+  /// Return false if the volume is invalid.
+  bool ConvertRASToIJK(vtkMRMLVolumeNode* volumeNode, double ras[3], double ijk[3]);
+
+  /// Return the cache of world to IJK mappings used by ConvertRASToIJK().
+  vtkSlicerDataProbeTransformCache* GetTransformCache()const;
+
+  /// Return the engine sampling sets of points in sets of volumes at once,
+  /// sharing the transform cache of the logic.
+  vtkSlicerDataProbeBatchEngine* GetBatchEngine()const;
+
+  /// Return the node publishing the latest probe result of the module,
+  /// 0 if it is not in the scene. The node is added when the scene is set,
+  /// imported or closed, probing never adds it.
+  /// \sa AddResultNode
+  vtkMRMLDataProbeResultNode* GetResultNode();
+
+  /// Return the result node of the scene, adding it if there is none.
+  /// Return 0 if there is no scene.
+  vtkMRMLDataProbeResultNode* AddResultNode();
+
+  /// Return the shared memory stream the results can be published into for
+  /// other processes. It is closed until opened.
+  vtkSlicerDataProbeSharedMemoryStream* GetSharedMemoryStream()const;
+
+  /// Probe the value displayed by \a sliceLayerLogic at the slice XYZ position
+  /// (\a x, \a y, \a z).
+  /// The value is read from the output of the layer reslice, it is then
+  /// interpolated the same way the slice is displayed and no additional access
+  /// to the volume is needed. DTI volumes are probed using ProbePixel().
+  /// \sa GetDisplayedWindowLevelValue, GetDisplayedColor
+  int ProbeDisplayedPixel(vtkMRMLSliceLayerLogic* sliceLayerLogic, double x, double y, double z);
+
+  /// Return the first component of the value probed by ProbeDisplayedPixel()
+  /// mapped by the window/level of the volume display node, in [0, 255].
+  /// It will return vtkMath::Nan() if the value could not be mapped.
+  double GetDisplayedWindowLevelValue()const;
+
+  /// Return the RGBA color, in [0, 255], displayed at the position probed by
+  /// ProbeDisplayedPixel(). Return false if the color is not available.
+  bool GetDisplayedColor(double rgba[4])const;
+
+  /// Compute the statistics of the values displayed by \a sliceLayerLogic,
+  /// over the pixels of its reslice output within the volume. The statistics
+  /// of each layer are kept and updated incrementally when the slice is
+  /// panned, see vtkSlicerDataProbeViewportStatistics.
+  /// If \a sampleStride is greater than 1 and the statistics can't be
+  /// updated incrementally, an approximate result is computed quickly from
+  /// every \a sampleStride pixel along X and Y, for example while the cursor
+  /// moves fast.
+  /// DTI volumes are not supported.
+  /// \sa GetViewportStatistics
+  int ProbeViewportStatistics(vtkMRMLSliceLayerLogic* sliceLayerLogic, int sampleStride = 1);
+
+  /// Return the statistics computed by ProbeViewportStatistics(), 0 if it
+  /// failed.
+  vtkSlicerDataProbeViewportStatistics* GetViewportStatistics()const;
+
+  /// Probe the first component of \a volumeNode and its local derivatives
+  /// at \a ijk, using the stencil \a kernel applied directly on the voxels
+  /// surrounding \a ijk. Derivatives are expressed in RAS and millimeters.
+  /// \sa DerivativeKernel, GetGradient, GetGradientMagnitude,
+  /// GetHessianEigenvalues, GetIsophoteCurvature
+  int ProbeDerivatives(vtkMRMLVolumeNode* volumeNode, double ijk[3],
+                       int kernel = CENTRAL_DIFFERENCE_KERNEL);
+
+  /// Return the gradient computed by ProbeDerivatives().
+  void GetGradient(double gradient[3])const;
+  double GetGradientMagnitude()const;
+
+  /// Return the eigenvalues of the Hessian computed by ProbeDerivatives(),
+  /// sorted by increasing absolute value.
+  void GetHessianEigenvalues(double eigenvalues[3])const;
+
+  /// Return the curvature of the isophote at the point probed by
+  /// ProbeDerivatives(), i.e. the sum of its principal curvatures.
+  /// It will return vtkMath::Nan() if the gradient vanishes.
+  double GetIsophoteCurvature()const;
+
+  /// Probe the displacement field \a volumeNode, whose first three
+  /// components are the displacement in millimeters along R, A and S, at
+  /// the voxel \a ijk. The deformation gradient F = I + du/dRAS is computed
+  /// with central differences on the 6 neighbors of the voxel, read directly
+  /// from the image buffer (one-sided differences on the image borders).
+  /// The displacement is the probed pixel value.
+  /// PROBE_ERROR_NO_DISPLACEMENT_FIELD is returned if the volume has less
+  /// than 3 components.
+  /// \sa GetDisplacement, GetJacobianDeterminant, GetPrincipalStrains, ProbeFolding
+  int ProbeDisplacement(vtkMRMLVolumeNode* volumeNode, double ijk[3]);
+
+  /// Return the displacement probed by ProbeDisplacement() and its norm.
+  void GetDisplacement(double displacement[3])const;
+  double GetDisplacementMagnitude()const;
+
+  /// Return the determinant of the deformation gradient computed by
+  /// ProbeDisplacement(): greater than 1 for an expansion, lower than 1 for
+  /// a contraction and lower or equal to 0 where the deformation folds.
+  double GetJacobianDeterminant()const;
+
+  /// Return the eigenvalues of the Green-Lagrange strain tensor
+  /// (F^T F - I) / 2 computed by ProbeDisplacement(), in decreasing order.
+  void GetPrincipalStrains(double strains[3])const;
+
+  /// Scan the Jacobian determinant of the displacement field \a volumeNode
+  /// over the voxels of the IJK \a extent, clamped to the image, like
+  /// ProbeDisplacement() does for a single voxel. Voxels whose determinant
+  /// is lower or equal to 0 are counted as folded. The slices of the extent
+  /// are split among the threads of vtkMultiThreader and only the summary
+  /// is kept, no Jacobian volume is allocated.
+  /// \sa GetNumberOfFoldedVoxels, GetMinimumJacobianDeterminant, GetFoldedExtent
+  int ProbeFolding(vtkMRMLVolumeNode* volumeNode, int extent[6]);
+
+  /// Return the number of voxels scanned by ProbeFolding() and the number
+  /// of folded ones.
+  vtkIdType GetFoldingNumberOfVoxels()const;
+  vtkIdType GetNumberOfFoldedVoxels()const;
+
+  /// Return the lowest determinant found by ProbeFolding() and its voxel,
+  /// vtkMath::Nan() and (-1, -1, -1) if nothing was scanned.
+  double GetMinimumJacobianDeterminant()const;
+  void GetMinimumJacobianDeterminantIJK(int ijk[3])const;
+
+  /// Return the IJK bounding box of the folded voxels found by
+  /// ProbeFolding(), an empty extent (0, -1, ...) if there is none.
+  void GetFoldedExtent(int extent[6])const;
+
+  /// Probe the first component of all the voxels of \a volumeNode crossed by
+  /// the segment going from \a startIJK to \a endIJK and append them to \a trace.
+  /// The segment is rasterized with a 3D-DDA and all its voxels are read in
+  /// a single pass, the cost does not depend on the number of mouse events.
+  /// On success, the value of the last voxel is the probed pixel value.
+  /// \sa vtkSlicerDataProbePathTrace
+  int ProbePath(vtkMRMLVolumeNode* volumeNode, double startIJK[3], double endIJK[3],
+                vtkSlicerDataProbePathTrace* trace);
+
+  /// Probe the first component of \a volumeNode along the ray going from the
+  /// world position \a startRAS to \a endRAS, for example the ray cast from
+  /// the cursor of a 3D view.
+  /// Depending on \a mode, the first voxel whose value is greater or equal to
+  /// \a threshold or the voxel of maximum value is reported as the probed pixel.
+  /// Blocks of voxels that can't contain the searched voxel are skipped using
+  /// their cached extrema, see vtkSlicerDataProbeBlockMinMax.
+  /// The ray end points are mapped into IJK taking into account the transforms
+  /// of the volume, the ray is then marched along a straight line in IJK.
+  /// \sa RayProbeMode, GetRayHitRAS, GetRayHitIJK
+  int ProbeRay(vtkMRMLVolumeNode* volumeNode, double startRAS[3], double endRAS[3],
+               int mode = FIRST_ABOVE_THRESHOLD_RAY_MODE, double threshold = 0.0);
+
+  /// Return the world position, on the ray, and the voxel found by ProbeRay().
+  void GetRayHitRAS(double ras[3])const;
+  void GetRayHitIJK(int ijk[3])const;
+
+  /// Compare the first components of \a foregroundNode and \a backgroundNode
+  /// around the world position \a ras, for example to check a registration.
+  /// The background voxel closest to \a ras and its neighbors within
+  /// \a radius voxels (clamped to [0, 2]) are paired with the foreground
+  /// interpolated at the same positions, in a single pass over the
+  /// neighborhood. The IJK to IJK mapping between the volumes comes from the
+  /// transform cache, it is linearized around the voxel if the volumes are
+  /// transformed non-linearly.
+  /// The background pixel is probed like ProbeRAS().
+  /// \sa GetLayerDifference, GetLayerRatio, GetLayerCorrelation,
+  /// GetLayerRMSDifference
+  int ProbeLayerDifference(vtkMRMLVolumeNode* backgroundNode, vtkMRMLVolumeNode* foregroundNode,
+                           double ras[3], int radius = 1);
+
+  /// Return the foreground minus the background value and the foreground
+  /// divided by the background value at the voxel probed by
+  /// ProbeLayerDifference(), vtkMath::Nan() if not available.
+  double GetLayerDifference()const;
+  double GetLayerRatio()const;
+
+  /// Return the normalized cross-correlation, in [-1, 1], and the root mean
+  /// square difference of the neighborhoods compared by
+  /// ProbeLayerDifference(), vtkMath::Nan() if not available.
+  double GetLayerCorrelation()const;
+  double GetLayerRMSDifference()const;
+
+  /// Probe the scalars of \a modelNode at the vertex closest to the world
+  /// position \a ras. Point scalars are reported if any, otherwise the
+  /// scalars of the first cell using the vertex. The name of the scalar
+  /// array is the pixel description.
+  /// If the vertex is farther than \a maximumDistance (in millimeters),
+  /// PROBE_ERROR_MODEL_TOO_FAR is returned.
+  /// The point locator of each model is built on first use and rebuilt only
+  /// when its polydata is modified.
+  /// \sa GetModelDistance, GetModelPointId, GetModelCellId, GetPointLocator
+  int ProbeModel(vtkMRMLModelNode* modelNode, double ras[3],
+                 double maximumDistance = VTK_DOUBLE_MAX);
+
+  /// Probe the scalars of \a modelNode where its lines and surfaces cross
+  /// the plane through the world position \a ras of normal \a planeNormal,
+  /// e.g. a slice plane, at the crossing closest to \a ras. Point scalars
+  /// are interpolated along the crossing edge, otherwise the scalars of its
+  /// cell are reported. Only the cells near \a ras, found with the point
+  /// locator of the model, are intersected.
+  /// If there is no crossing within \a maximumDistance (in millimeters),
+  /// PROBE_ERROR_MODEL_TOO_FAR is returned. If \a planeNormal is null, the
+  /// closest vertex is probed instead, see ProbeModel().
+  /// \sa GetModelDistance, GetModelPointId, GetModelCellId
+  int ProbeModelIntersection(vtkMRMLModelNode* modelNode, double ras[3],
+                             double planeNormal[3], double maximumDistance);
+
+  /// Return the distance, in millimeters, between the position probed by
+  /// ProbeModel() and the closest vertex, or by ProbeModelIntersection()
+  /// and the closest crossing, vtkMath::Nan() if not available.
+  double GetModelDistance()const;
+
+  /// Return the closest vertex found by ProbeModel() and its first cell, or
+  /// the end of the crossing edge closest to the crossing found by
+  /// ProbeModelIntersection() and its cell, or -1.
+  vtkIdType GetModelPointId()const;
+  vtkIdType GetModelCellId()const;
+
+  /// Return the up-to-date point locator of \a modelNode, building it if
+  /// needed. Return 0 if the model has no points.
+  vtkSlicerDataProbePointLocator* GetPointLocator(vtkMRMLModelNode* modelNode);
+
+  /// Probe the streamlines of \a fiberBundleNode, e.g. a
+  /// vtkMRMLFiberBundleNode, passing within \a radius millimeters of the
+  /// world position \a ras. The lines of its polydata are the streamlines,
+  /// the point closest to \a ras of each of them is reported with its first
+  /// point scalar component or, if there is none, the fractional anisotropy
+  /// of its tensor. The values of the closest streamline are the probed
+  /// pixel values, see GetModelDistance(), GetModelPointId() and
+  /// GetModelCellId(), and the name of the scalar array the pixel
+  /// description. The streamline points are indexed by the point locator of
+  /// the bundle, see GetPointLocator().
+  /// PROBE_ERROR_MODEL_TOO_FAR is returned if no streamline passes within
+  /// the radius.
+  /// \sa GetNumberOfProbedFibers
+  int ProbeFiberBundle(vtkMRMLModelNode* fiberBundleNode, double ras[3], double radius);
+
+  /// Return the number of streamlines found by ProbeFiberBundle(). They are
+  /// sorted by increasing distance to the probed position.
+  int GetNumberOfProbedFibers()const;
+
+  /// Return the cell id of the streamline \a fiberIdx found by
+  /// ProbeFiberBundle(), and its point closest to the probed position, or -1.
+  vtkIdType GetProbedFiberCellId(int fiberIdx)const;
+  vtkIdType GetProbedFiberPointId(int fiberIdx)const;
+
+  /// Return the distance, in millimeters, between the probed position and
+  /// the streamline \a fiberIdx, and the scalar at its closest point.
+  /// It will return vtkMath::Nan() if not available.
+  double GetProbedFiberDistance(int fiberIdx)const;
+  double GetProbedFiberValue(int fiberIdx)const;
+
+  /// Probe the label of \a volumeNode at \a ijk like ProbePixel() and
+  /// collect the statistics of that label over the whole label map.
+  /// The statistics come from the label index of the volume, built on first
+  /// use and updated by LabelMapModified().
+  /// PROBE_ERROR_UNSUPPORTED_LABEL_ENCODING is returned if the label map
+  /// stores overlapping segments, see GetLabelEncoding().
+  /// \sa GetLabelNumberOfVoxels, GetLabelVolume, GetLabelCentroid, GetLabelBounds
+  int ProbeLabelStatistics(vtkMRMLVolumeNode* volumeNode, double ijk[3]);
+
+  /// Return the statistics collected by ProbeLabelStatistics().
+  vtkIdType GetLabelNumberOfVoxels()const;
+  /// Volume in cubic millimeters.
+  double GetLabelVolume()const;
+  /// World position of the mean of the label voxels.
+  void GetLabelCentroid(double ras[3])const;
+  /// IJK extent containing all the label voxels.
+  void GetLabelBounds(int bounds[6])const;
+
+  /// Probe the label of \a volumeNode at \a ijk like ProbePixel() and
+  /// collect the statistics of the connected component (6-connectivity) of
+  /// the probed voxel. Components come from the component index of the
+  /// volume, built on first use and updated by LabelMapModified().
+  /// PROBE_ERROR_UNSUPPORTED_LABEL_ENCODING is returned if the label map
+  /// stores overlapping segments, see GetLabelEncoding().
+  /// \sa GetComponentId, GetComponentNumberOfVoxels, GetComponentVolume,
+  /// GetComponentCentroid
+  int ProbeComponent(vtkMRMLVolumeNode* volumeNode, double ijk[3]);
+
+  /// Collect the statistics of the component of the voxel \a voxel of the
+  /// label map \a volumeNode like ProbeComponent(), without probing the
+  /// voxel again: \a label is its label, e.g. probed by
+  /// ProbeLabelStatistics(), and no component is found if the component
+  /// index has another label there. The pixel values are left untouched.
+  /// Return PROBE_SUCCESS_LABEL_VOLUME or an error.
+  /// \sa GetPixelVoxel
+  int ProbeComponent(vtkMRMLVolumeNode* volumeNode, const int voxel[3], int label);
+
+  /// Return the component found by ProbeComponent(), 0 if none.
+  unsigned int GetComponentId()const;
+  vtkIdType GetComponentNumberOfVoxels()const;
+  /// Volume in cubic millimeters.
+  double GetComponentVolume()const;
+  /// World position of the mean of the component voxels.
+  void GetComponentCentroid(double ras[3])const;
+
+  /// Probe the label of \a volumeNode at \a ijk like ProbePixel() and the
+  /// labels of the (2 * radius + 1)^3 voxels around it, e.g. to inspect the
+  /// partial volume on the boundary of labels. Voxels outside of the image
+  /// are not counted. The labels are counted by the label composition of
+  /// the volume, updated incrementally as the window moves, see
+  /// vtkSlicerDataProbeLabelComposition.
+  /// PROBE_ERROR_UNSUPPORTED_LABEL_ENCODING is returned if the label map
+  /// stores overlapping segments, see GetLabelEncoding().
+  /// \sa GetNumberOfNeighborhoodLabels, GetNeighborhoodLabel,
+  /// GetNeighborhoodLabelFraction, GetNeighborhoodLabelName
+  int ProbeLabelComposition(vtkMRMLVolumeNode* volumeNode, double ijk[3], int radius = 1);
+
+  /// Probe the labels of the voxels within \a radius millimeters of the
+  /// center of the voxel \a ijk, like ProbeLabelComposition().
+  int ProbeLabelCompositionWithinRadius(vtkMRMLVolumeNode* volumeNode, double ijk[3], double radius);
+
+  /// Return the labels found by ProbeLabelComposition(), sorted by
+  /// decreasing number of voxels, the fraction of the window voxels they
+  /// cover, in [0, 1], and their names.
+  int GetNumberOfNeighborhoodLabels()const;
+  int GetNeighborhoodLabel(int nth)const;
+  double GetNeighborhoodLabelFraction(int nth)const;
+  std::string GetNeighborhoodLabelName(int nth)const;
+
+  /// Return the up-to-date component index of the label map \a volumeNode,
+  /// building it if needed. Return 0 if \a volumeNode is not a label map
+  /// or stores overlapping segments.
+  vtkSlicerDataProbeComponentIndex* GetComponentIndex(vtkMRMLVolumeNode* volumeNode);
+
+  /// Probe the label of \a volumeNode at \a ijk like ProbePixel() and the
+  /// signed distance, in millimeters, from the voxel to the boundary of
+  /// \a label, negative inside the label.
+  /// The distance map of the label is computed in the background on first
+  /// use, PROBE_ERROR_DISTANCE_MAP_NOT_READY is returned until it is
+  /// available. The maps of the last probed labels are kept per volume.
+  /// PROBE_ERROR_UNSUPPORTED_LABEL_ENCODING is returned if the label map
+  /// stores overlapping segments, see GetLabelEncoding().
+  /// \sa GetBoundaryDistance, vtkSlicerDataProbeDistanceMap
+  int ProbeBoundaryDistance(vtkMRMLVolumeNode* volumeNode, double ijk[3], int label);
+
+  /// Probe the signed distance from the voxel \a voxel of the label map
+  /// \a volumeNode to the boundary of \a label like
+  /// ProbeBoundaryDistance(), without probing the voxel again. The pixel
+  /// values are left untouched.
+  /// Return PROBE_SUCCESS_LABEL_VOLUME or an error.
+  /// \sa GetPixelVoxel
+  int ProbeBoundaryDistance(vtkMRMLVolumeNode* volumeNode, const int voxel[3], int label);
+
+  /// Return the distance found by ProbeBoundaryDistance(),
+  /// vtkMath::Nan() if not available.
+  double GetBoundaryDistance()const;
+
+  /// Probe the pixel \a ijk of the scalar volume \a volumeNode like
+  /// ProbePixel() and the percentile of its value, i.e. the percentage of
+  /// the volume voxels of lower value.
+  /// The histogram of the volume is computed in the background on first use
+  /// and when the image is modified, PROBE_ERROR_HISTOGRAM_NOT_READY is
+  /// returned until it is available.
+  /// \sa GetPercentile, GetHistogram
+  int ProbePercentile(vtkMRMLVolumeNode* volumeNode, double ijk[3]);
+
+  /// Return the percentile found by ProbePercentile(), in [0, 100],
+  /// vtkMath::Nan() if not available.
+  double GetPercentile()const;
+
+  /// Return the up-to-date histogram of the scalar volume \a volumeNode, for
+  /// example to suggest a window/level. If it is not available, start
+  /// computing it in the background and return 0.
+  /// \sa vtkSlicerDataProbeHistogram::GetWindowLevel
+  vtkSlicerDataProbeHistogram* GetHistogram(vtkMRMLVolumeNode* volumeNode);
+
+  /// Update the label and component indexes of \a volumeNode after the
+  /// voxels of \a extent (IJK) have been modified, for example by an editor
+  /// effect. Only the slices of the extent are scanned again. The distance
+  /// map of the volume is released.
+  /// It is called by GetLabelIndex() and GetComponentIndex() when the label
+  /// map has been modified, with the slices whose checksum changed, see
+  /// vtkSlicerDataProbeSliceChecksums. Calling it directly after an edit
+  /// saves comparing the checksums.
+  void LabelMapModified(vtkMRMLVolumeNode* volumeNode, int extent[6]);
+
+  /// Return the up-to-date label index of the label map \a volumeNode,
+  /// building it if needed. Return 0 if \a volumeNode is not a label map
+  /// or stores overlapping segments.
+  vtkSlicerDataProbeLabelIndex* GetLabelIndex(vtkMRMLVolumeNode* volumeNode);
+
+  /// Return the segments found by ProbePixel() at a voxel of a label map
+  /// storing overlapping segments, and their names.
+  /// \sa LabelEncoding
+  int GetNumberOfPixelSegments()const;
+  int GetPixelSegment(int nth)const;
+  std::string GetPixelSegmentName(int nth)const;
+
+  /// Name of the volume node attribute selecting the encoding of a label
+  /// map: "BitPacked", "Layered" or "Single" (default if unset).
+  static const char* GetLabelEncodingAttributeName();
+
+  /// Return or set the LabelEncoding of the label map \a volumeNode.
+  static int GetLabelEncoding(vtkMRMLVolumeNode* volumeNode);
+  static void SetLabelEncoding(vtkMRMLVolumeNode* volumeNode, int encoding);
+
   /// Return the number of components associated with the probed pixel.
   /// It will return 0 if the probe status is set to DataProbeStatus::FAILURE
   /// \sa ProbePixel, GetProbeStatus, GetPixelProbeStatusAsString
@@ -96,6 +561,11 @@ public:
   /// \sa ProbePixel, GetMaxGetNumberOfPixelValues, GetNumberOfPixelValues
   double GetPixelValue(int nth)const;
 
+  /// Return the IJK voxel read by ProbePixel(): the voxel of the truncated
+  /// position for label maps, the closest voxel otherwise.
+  /// It will return (-1, -1, -1) if no voxel has been read.
+  void GetPixelVoxel(int voxel[3])const;
+
   /// Return the probe status set after function ProbePixel is called.
   /// \sa ProbePixel, \sa DataProbeStatus
   int GetPixelProbeStatus()const;
@@ -109,10 +579,26 @@ public:
   ///
   double CalculateTensorScalars(float tensor[9], int operation);
 
+  /// Return the cache of DTI scalar maps used when probing DTI volumes.
+  /// Its memory limit can be adjusted, a limit of 0 disables the cache and
+  /// each probed tensor is then processed individually.
+  /// \sa CalculateTensorScalars
+  vtkSlicerDataProbeTensorScalarCache* GetTensorScalarCache()const;
+
 protected:
   vtkSlicerDataProbeLogic();
   virtual ~vtkSlicerDataProbeLogic();
 
+  /// Observe the imports and closes of the scene and add the result node.
+  virtual void SetMRMLSceneInternal(vtkMRMLScene* newScene);
+
+  /// Register vtkMRMLDataProbeResultNode.
+  virtual void RegisterNodes();
+
+  /// Add the result node back, see AddResultNode().
+  virtual void OnMRMLSceneEndImport();
+  virtual void OnMRMLSceneEndClose();
+
 private:
 
   vtkSlicerDataProbeLogic(const vtkSlicerDataProbeLogic&); // Not implemented
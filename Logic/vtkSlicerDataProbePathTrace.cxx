@@ -0,0 +1,142 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbePathTrace.h"
+
+// VTK includes
+#include <vtkDoubleArray.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerDataProbePathTrace);
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbePathTrace::vtkSlicerDataProbePathTrace()
+{
+  this->Values = vtkDoubleArray::New();
+  this->Values->SetName("Values");
+  this->IJKs = vtkIntArray::New();
+  this->IJKs->SetName("IJK");
+  this->IJKs->SetNumberOfComponents(3);
+  this->Minimum = VTK_DOUBLE_MAX;
+  this->Maximum = -VTK_DOUBLE_MAX;
+  this->Sum = 0.0;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbePathTrace::~vtkSlicerDataProbePathTrace()
+{
+  this->Values->Delete();
+  this->IJKs->Delete();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbePathTrace::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfSamples: " << this->GetNumberOfSamples() << "\n";
+  os << indent << "Minimum: " << this->GetMinimum() << "\n";
+  os << indent << "Maximum: " << this->GetMaximum() << "\n";
+  os << indent << "Mean: " << this->GetMean() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbePathTrace::Reset()
+{
+  this->Values->Reset();
+  this->IJKs->Reset();
+  this->Minimum = VTK_DOUBLE_MAX;
+  this->Maximum = -VTK_DOUBLE_MAX;
+  this->Sum = 0.0;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbePathTrace::AddSample(const int ijk[3], double value)
+{
+  vtkIdType numberOfSamples = this->GetNumberOfSamples();
+  if (numberOfSamples > 0)
+    {
+    const int* lastIJK = this->IJKs->GetPointer(3 * (numberOfSamples - 1));
+    if (lastIJK[0] == ijk[0] && lastIJK[1] == ijk[1] && lastIJK[2] == ijk[2])
+      {
+      return;
+      }
+    }
+  this->Values->InsertNextValue(value);
+  this->IJKs->InsertNextValue(ijk[0]);
+  this->IJKs->InsertNextValue(ijk[1]);
+  this->IJKs->InsertNextValue(ijk[2]);
+  this->Minimum = std::min(this->Minimum, value);
+  this->Maximum = std::max(this->Maximum, value);
+  this->Sum += value;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbePathTrace::GetNumberOfSamples()const
+{
+  return this->Values->GetNumberOfTuples();
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDataProbePathTrace::GetValue(vtkIdType sampleIdx)const
+{
+  if (sampleIdx < 0 || sampleIdx >= this->GetNumberOfSamples())
+    {
+    return vtkMath::Nan();
+    }
+  return this->Values->GetValue(sampleIdx);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbePathTrace::GetIJK(vtkIdType sampleIdx, int ijk[3])const
+{
+  if (sampleIdx < 0 || sampleIdx >= this->GetNumberOfSamples())
+    {
+    ijk[0] = ijk[1] = ijk[2] = -1;
+    return;
+    }
+  const int* sampleIJK = this->IJKs->GetPointer(3 * sampleIdx);
+  ijk[0] = sampleIJK[0];
+  ijk[1] = sampleIJK[1];
+  ijk[2] = sampleIJK[2];
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDataProbePathTrace::GetMinimum()const
+{
+  return this->GetNumberOfSamples() > 0 ? this->Minimum : vtkMath::Nan();
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDataProbePathTrace::GetMaximum()const
+{
+  return this->GetNumberOfSamples() > 0 ? this->Maximum : vtkMath::Nan();
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDataProbePathTrace::GetMean()const
+{
+  vtkIdType numberOfSamples = this->GetNumberOfSamples();
+  return numberOfSamples > 0 ? this->Sum / numberOfSamples : vtkMath::Nan();
+}
@@ -0,0 +1,78 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerDataProbePathTrace_h
+#define __vtkSlicerDataProbePathTrace_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkSlicerDataProbeModuleLogicExport.h"
+
+class vtkDoubleArray;
+class vtkIntArray;
+
+/// \ingroup Slicer_QtModules_DataProbe
+/// Voxels and values accumulated along a probed path.
+/// Samples are appended by vtkSlicerDataProbeLogic::ProbePath(), running
+/// minimum, maximum and mean are maintained as samples are added.
+/// \sa vtkSlicerDataProbeLogic::ProbePath
+class VTK_SLICER_DATAPROBE_MODULE_LOGIC_EXPORT vtkSlicerDataProbePathTrace :
+  public vtkObject
+{
+public:
+  static vtkSlicerDataProbePathTrace *New();
+  vtkTypeMacro(vtkSlicerDataProbePathTrace,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Remove all the samples.
+  void Reset();
+
+  /// Append the value of the voxel \a ijk.
+  /// The sample is ignored if it is the same voxel as the last sample, so
+  /// that consecutive segments sharing an end point are not sampled twice.
+  void AddSample(const int ijk[3], double value);
+
+  vtkIdType GetNumberOfSamples()const;
+  double GetValue(vtkIdType sampleIdx)const;
+  void GetIJK(vtkIdType sampleIdx, int ijk[3])const;
+
+  /// Sampled values and voxels (3 components).
+  vtkGetObjectMacro(Values, vtkDoubleArray);
+  vtkGetObjectMacro(IJKs, vtkIntArray);
+
+  /// Statistics of all the samples, vtkMath::Nan() if there is no sample.
+  double GetMinimum()const;
+  double GetMaximum()const;
+  double GetMean()const;
+
+protected:
+  vtkSlicerDataProbePathTrace();
+  virtual ~vtkSlicerDataProbePathTrace();
+
+  vtkDoubleArray* Values;
+  vtkIntArray* IJKs;
+  double Minimum;
+  double Maximum;
+  double Sum;
+
+private:
+  vtkSlicerDataProbePathTrace(const vtkSlicerDataProbePathTrace&); // Not implemented
+  void operator=(const vtkSlicerDataProbePathTrace&);              // Not implemented
+};
+
+#endif
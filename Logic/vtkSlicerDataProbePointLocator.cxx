@@ -0,0 +1,566 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbePointLocator.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkIdList.h>
+#include <vtkMath.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Return the latest modification time of the points and cells of \a polyData.
+unsigned long vtkSlicerDataProbePolyDataMTime(vtkPolyData* polyData)
+{
+  unsigned long mtime = polyData->GetMTime();
+  vtkCellArray* cells[4] = {polyData->GetVerts(), polyData->GetLines(),
+                            polyData->GetPolys(), polyData->GetStrips()};
+  for (int cellsIdx = 0; cellsIdx < 4; ++cellsIdx)
+    {
+    if (cells[cellsIdx])
+      {
+      mtime = std::max(mtime, cells[cellsIdx]->GetMTime());
+      }
+    }
+  return mtime;
+}
+
+//----------------------------------------------------------------------------
+inline void vtkSlicerDataProbeGetBucket(const double x[3], const double origin[3], const double bucketSize[3],
+                                        const int dimensions[3], int bucket[3])
+{
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    const double position = (x[axis] - origin[axis]) / bucketSize[axis];
+    bucket[axis] = position <= 0.0 ? 0 : std::min(static_cast<int>(position), dimensions[axis] - 1);
+    }
+}
+
+//----------------------------------------------------------------------------
+/// Points of a locator being built, each thread processing a contiguous
+/// range of point ids.
+struct vtkSlicerDataProbeBucketingTask
+{
+  vtkPoints* Points;
+  vtkIdType NumberOfPoints;
+  const double* Origin;
+  const double* BucketSize;
+  const int* Dimensions;
+  /// Bucket of each point, then its position in the sorted arrays.
+  vtkIdType* PointBuckets;
+  vtkIdType* SortedPointIds;
+  float* SortedCoordinates;
+
+  void GetRange(const vtkMultiThreader::ThreadInfo* threadInfo, vtkIdType& begin, vtkIdType& end)const
+  {
+    begin = this->NumberOfPoints * threadInfo->ThreadID / threadInfo->NumberOfThreads;
+    end = this->NumberOfPoints * (threadInfo->ThreadID + 1) / threadInfo->NumberOfThreads;
+  }
+
+  static VTK_THREAD_RETURN_TYPE ComputeBuckets(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    const vtkSlicerDataProbeBucketingTask* self =
+      static_cast<const vtkSlicerDataProbeBucketingTask*>(threadInfo->UserData);
+    vtkIdType begin = 0;
+    vtkIdType end = 0;
+    self->GetRange(threadInfo, begin, end);
+    for (vtkIdType pointId = begin; pointId < end; ++pointId)
+      {
+      double point[3];
+      self->Points->GetPoint(pointId, point);
+      int bucket[3];
+      vtkSlicerDataProbeGetBucket(point, self->Origin, self->BucketSize, self->Dimensions, bucket);
+      self->PointBuckets[pointId] = bucket[0] + self->Dimensions[0] *
+        (bucket[1] + static_cast<vtkIdType>(self->Dimensions[1]) * bucket[2]);
+      }
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  static VTK_THREAD_RETURN_TYPE CopyPoints(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    const vtkSlicerDataProbeBucketingTask* self =
+      static_cast<const vtkSlicerDataProbeBucketingTask*>(threadInfo->UserData);
+    vtkIdType begin = 0;
+    vtkIdType end = 0;
+    self->GetRange(threadInfo, begin, end);
+    for (vtkIdType pointId = begin; pointId < end; ++pointId)
+      {
+      const vtkIdType position = self->PointBuckets[pointId];
+      double point[3];
+      self->Points->GetPoint(pointId, point);
+      self->SortedPointIds[position] = pointId;
+      self->SortedCoordinates[3 * position] = static_cast<float>(point[0]);
+      self->SortedCoordinates[3 * position + 1] = static_cast<float>(point[1]);
+      self->SortedCoordinates[3 * position + 2] = static_cast<float>(point[2]);
+      }
+    return VTK_THREAD_RETURN_VALUE;
+  }
+};
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerDataProbePointLocator);
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbePointLocator::vtkSlicerDataProbePointLocator()
+{
+  this->NumberOfPointsPerBucket = 4;
+  this->NumberOfThreads = 0;
+  this->PolyDataMTime = 0;
+  this->BuiltNumberOfPointsPerBucket = 0;
+  this->MaximumEdgeLength = 0.0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Dimensions[axis] = 0;
+    this->Origin[axis] = 0.0;
+    this->BucketSize[axis] = 1.0;
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbePointLocator::~vtkSlicerDataProbePointLocator()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbePointLocator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfPointsPerBucket: " << this->NumberOfPointsPerBucket << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "Dimensions: " << this->Dimensions[0] << " "
+     << this->Dimensions[1] << " " << this->Dimensions[2] << "\n";
+  os << indent << "NumberOfPoints: " << this->SortedPointIds.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbePointLocator::Reset()
+{
+  this->PolyData = 0;
+  this->PolyDataMTime = 0;
+  this->BuiltNumberOfPointsPerBucket = 0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Dimensions[axis] = 0;
+    }
+  std::vector<vtkIdType>().swap(this->BucketStarts);
+  std::vector<vtkIdType>().swap(this->SortedPointIds);
+  std::vector<float>().swap(this->SortedCoordinates);
+  std::vector<vtkIdType>().swap(this->PointCellStarts);
+  std::vector<vtkIdType>().swap(this->PointCells);
+  this->MaximumEdgeLength = 0.0;
+}
+
+//----------------------------------------------------------------------------
+vtkPolyData* vtkSlicerDataProbePointLocator::GetPolyData()const
+{
+  return this->PolyData.GetPointer();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbePointLocator::IsUpToDate(vtkPolyData* polyData)const
+{
+  return polyData
+    && polyData == this->PolyData.GetPointer()
+    && this->BuiltNumberOfPointsPerBucket == this->NumberOfPointsPerBucket
+    && vtkSlicerDataProbePolyDataMTime(polyData) == this->PolyDataMTime;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbePointLocator::Update(vtkPolyData* polyData)
+{
+  if (this->IsUpToDate(polyData))
+    {
+    return true;
+    }
+  this->Reset();
+  vtkPoints* points = polyData ? polyData->GetPoints() : 0;
+  const vtkIdType numberOfPoints = points ? points->GetNumberOfPoints() : 0;
+  if (numberOfPoints == 0)
+    {
+    return false;
+    }
+
+  // Grid covering the bounds, with buckets as cubic as possible. Flat axes
+  // get a single bucket.
+  double bounds[6];
+  points->GetBounds(bounds);
+  const vtkIdType targetNumberOfBuckets =
+    std::max(static_cast<vtkIdType>(1), numberOfPoints / this->NumberOfPointsPerBucket);
+  double extents[3];
+  double volume = 1.0;
+  int numberOfNonFlatAxes = 0;
+  const double diagonal = sqrt(
+    (bounds[1] - bounds[0]) * (bounds[1] - bounds[0]) +
+    (bounds[3] - bounds[2]) * (bounds[3] - bounds[2]) +
+    (bounds[5] - bounds[4]) * (bounds[5] - bounds[4]));
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    extents[axis] = bounds[2 * axis + 1] - bounds[2 * axis];
+    if (extents[axis] > 1e-6 * diagonal)
+      {
+      volume *= extents[axis];
+      ++numberOfNonFlatAxes;
+      }
+    }
+  const double bucketLength = numberOfNonFlatAxes > 0 ?
+    pow(volume / targetNumberOfBuckets, 1.0 / numberOfNonFlatAxes) : 1.0;
+  vtkIdType numberOfBuckets = 1;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    if (extents[axis] > 1e-6 * diagonal)
+      {
+      this->Dimensions[axis] = std::min(std::max(
+        static_cast<int>(ceil(extents[axis] / bucketLength)), 1), 1024);
+      }
+    else
+      {
+      this->Dimensions[axis] = 1;
+      }
+    // Enlarge the grid slightly so that the points on the upper bounds
+    // fall in the last bucket.
+    const double margin = std::max(1e-6 * diagonal, 1e-9);
+    this->Origin[axis] = bounds[2 * axis] - margin;
+    this->BucketSize[axis] = (extents[axis] + 2.0 * margin) / this->Dimensions[axis];
+    numberOfBuckets *= this->Dimensions[axis];
+    }
+
+  // Counting sort of the points by bucket. Reading the points and copying
+  // them is split among the threads, counting is a cheap sequential pass
+  // that keeps the points of a bucket in increasing id order.
+  std::vector<vtkIdType> pointBuckets(numberOfPoints);
+  this->SortedPointIds.resize(numberOfPoints);
+  this->SortedCoordinates.resize(3 * numberOfPoints);
+  vtkSlicerDataProbeBucketingTask task;
+  task.Points = points;
+  task.NumberOfPoints = numberOfPoints;
+  task.Origin = this->Origin;
+  task.BucketSize = this->BucketSize;
+  task.Dimensions = this->Dimensions;
+  task.PointBuckets = &pointBuckets[0];
+  task.SortedPointIds = &this->SortedPointIds[0];
+  task.SortedCoordinates = &this->SortedCoordinates[0];
+  vtkNew<vtkMultiThreader> threader;
+  int numberOfThreads = this->NumberOfThreads > 0 ?
+    this->NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  numberOfThreads = std::min(numberOfThreads, VTK_MAX_THREADS);
+  // Below 64k points per thread, starting the threads costs more than it saves
+  numberOfThreads = static_cast<int>(std::max(std::min(
+    static_cast<vtkIdType>(numberOfThreads), numberOfPoints / 65536), static_cast<vtkIdType>(1)));
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(vtkSlicerDataProbeBucketingTask::ComputeBuckets, &task);
+  threader->SingleMethodExecute();
+
+  this->BucketStarts.assign(numberOfBuckets + 1, 0);
+  for (vtkIdType pointId = 0; pointId < numberOfPoints; ++pointId)
+    {
+    ++this->BucketStarts[pointBuckets[pointId] + 1];
+    }
+  for (vtkIdType bucketIdx = 0; bucketIdx < numberOfBuckets; ++bucketIdx)
+    {
+    this->BucketStarts[bucketIdx + 1] += this->BucketStarts[bucketIdx];
+    }
+  std::vector<vtkIdType> insertPositions(this->BucketStarts.begin(), this->BucketStarts.end() - 1);
+  for (vtkIdType pointId = 0; pointId < numberOfPoints; ++pointId)
+    {
+    pointBuckets[pointId] = insertPositions[pointBuckets[pointId]]++;
+    }
+  threader->SetSingleMethod(vtkSlicerDataProbeBucketingTask::CopyPoints, &task);
+  threader->SingleMethodExecute();
+
+  // Cells using each point, cells being numbered as in vtkPolyData:
+  // vertices, lines, polygons then strips. The first pass counts them and
+  // measures the edges, the second one fills the lists.
+  this->PointCellStarts.assign(numberOfPoints + 1, 0);
+  this->MaximumEdgeLength = 0.0;
+  vtkCellArray* cells[4] = {polyData->GetVerts(), polyData->GetLines(),
+                            polyData->GetPolys(), polyData->GetStrips()};
+  for (int cellsIdx = 0; cellsIdx < 4; ++cellsIdx)
+    {
+    if (!cells[cellsIdx])
+      {
+      continue;
+      }
+    vtkIdType numberOfCellPoints = 0;
+    vtkIdType* cellPointIds = 0;
+    for (cells[cellsIdx]->InitTraversal(); cells[cellsIdx]->GetNextCell(numberOfCellPoints, cellPointIds);)
+      {
+      for (vtkIdType cellPointIdx = 0; cellPointIdx < numberOfCellPoints; ++cellPointIdx)
+        {
+        const vtkIdType pointId = cellPointIds[cellPointIdx];
+        if (pointId < 0 || pointId >= numberOfPoints)
+          {
+          continue;
+          }
+        ++this->PointCellStarts[pointId + 1];
+        // Edges to the next point, the closing edge of polygons and the
+        // third edge of the triangles of strips
+        vtkIdType edgePointIdxs[2] = {cellPointIdx + 1, -1};
+        if (cellsIdx == 2 && edgePointIdxs[0] == numberOfCellPoints)
+          {
+          edgePointIdxs[0] = 0;
+          }
+        if (cellsIdx == 3)
+          {
+          edgePointIdxs[1] = cellPointIdx + 2;
+          }
+        for (int edgeIdx = 0; cellsIdx > 0 && edgeIdx < 2; ++edgeIdx)
+          {
+          const vtkIdType otherPointId = edgePointIdxs[edgeIdx] >= 0 && edgePointIdxs[edgeIdx] < numberOfCellPoints ?
+            cellPointIds[edgePointIdxs[edgeIdx]] : -1;
+          if (otherPointId >= 0 && otherPointId < numberOfPoints)
+            {
+            double point[3];
+            double otherPoint[3];
+            points->GetPoint(pointId, point);
+            points->GetPoint(otherPointId, otherPoint);
+            this->MaximumEdgeLength = std::max(this->MaximumEdgeLength,
+              sqrt(vtkMath::Distance2BetweenPoints(point, otherPoint)));
+            }
+          }
+        }
+      }
+    }
+  for (vtkIdType pointId = 0; pointId < numberOfPoints; ++pointId)
+    {
+    this->PointCellStarts[pointId + 1] += this->PointCellStarts[pointId];
+    }
+  this->PointCells.resize(this->PointCellStarts[numberOfPoints]);
+  std::vector<vtkIdType> cellInsertPositions(this->PointCellStarts.begin(), this->PointCellStarts.end() - 1);
+  vtkIdType cellId = 0;
+  for (int cellsIdx = 0; cellsIdx < 4; ++cellsIdx)
+    {
+    if (!cells[cellsIdx])
+      {
+      continue;
+      }
+    vtkIdType numberOfCellPoints = 0;
+    vtkIdType* cellPointIds = 0;
+    for (cells[cellsIdx]->InitTraversal();
+         cells[cellsIdx]->GetNextCell(numberOfCellPoints, cellPointIds); ++cellId)
+      {
+      for (vtkIdType cellPointIdx = 0; cellPointIdx < numberOfCellPoints; ++cellPointIdx)
+        {
+        const vtkIdType pointId = cellPointIds[cellPointIdx];
+        if (pointId >= 0 && pointId < numberOfPoints)
+          {
+          this->PointCells[cellInsertPositions[pointId]++] = cellId;
+          }
+        }
+      }
+    }
+
+  this->PolyData = polyData;
+  this->PolyDataMTime = vtkSlicerDataProbePolyDataMTime(polyData);
+  this->BuiltNumberOfPointsPerBucket = this->NumberOfPointsPerBucket;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbePointLocator::GetBucket(const double x[3], int bucket[3])const
+{
+  vtkSlicerDataProbeGetBucket(x, this->Origin, this->BucketSize, this->Dimensions, bucket);
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbePointLocator::FindClosestPoint(const double x[3], double& distance2)const
+{
+  distance2 = VTK_DOUBLE_MAX;
+  if (this->SortedPointIds.empty())
+    {
+    return -1;
+    }
+  int center[3];
+  this->GetBucket(x, center);
+  const int maxRadius = std::max(std::max(this->Dimensions[0], this->Dimensions[1]), this->Dimensions[2]);
+
+  vtkIdType closestPosition = -1;
+  for (int radius = 0; radius <= maxRadius; ++radius)
+    {
+    // Visit the shell of buckets at Chebyshev distance 'radius' from the center.
+    int lower[3];
+    int upper[3];
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      lower[axis] = std::max(center[axis] - radius, 0);
+      upper[axis] = std::min(center[axis] + radius, this->Dimensions[axis] - 1);
+      }
+    for (int k = lower[2]; k <= upper[2]; ++k)
+      {
+      const bool kOnShell = (k == center[2] - radius || k == center[2] + radius);
+      for (int j = lower[1]; j <= upper[1]; ++j)
+        {
+        const bool jkOnShell = kOnShell || j == center[1] - radius || j == center[1] + radius;
+        const vtkIdType rowOffset = this->Dimensions[0] * (j + static_cast<vtkIdType>(this->Dimensions[1]) * k);
+        for (int i = lower[0]; i <= upper[0]; ++i)
+          {
+          if (!jkOnShell && i != center[0] - radius && i != center[0] + radius)
+            {
+            // Interior bucket, visited at a smaller radius: jump to the shell.
+            if (center[0] + radius > upper[0])
+              {
+              break;
+              }
+            i = center[0] + radius - 1;
+            continue;
+            }
+          const vtkIdType bucketIdx = rowOffset + i;
+          const vtkIdType end = this->BucketStarts[bucketIdx + 1];
+          for (vtkIdType position = this->BucketStarts[bucketIdx]; position < end; ++position)
+            {
+            const float* point = &this->SortedCoordinates[3 * position];
+            const double dx = point[0] - x[0];
+            const double dy = point[1] - x[1];
+            const double dz = point[2] - x[2];
+            const double pointDistance2 = dx * dx + dy * dy + dz * dz;
+            if (pointDistance2 < distance2)
+              {
+              distance2 = pointDistance2;
+              closestPosition = position;
+              }
+            }
+          }
+        }
+      }
+
+    // Points of larger shells are farther than the faces of the current
+    // cube of buckets. Faces on the grid border have no bucket beyond.
+    double gap = VTK_DOUBLE_MAX;
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      if (center[axis] - radius > 0)
+        {
+        gap = std::min(gap, x[axis] -
+          (this->Origin[axis] + (center[axis] - radius) * this->BucketSize[axis]));
+        }
+      if (center[axis] + radius < this->Dimensions[axis] - 1)
+        {
+        gap = std::min(gap,
+          (this->Origin[axis] + (center[axis] + radius + 1) * this->BucketSize[axis]) - x[axis]);
+        }
+      }
+    if (gap == VTK_DOUBLE_MAX || (closestPosition >= 0 && gap * gap >= distance2))
+      {
+      break;
+      }
+    }
+  return closestPosition >= 0 ? this->SortedPointIds[closestPosition] : -1;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbePointLocator::FindPointsWithinRadius(double radius, const double x[3],
+                                                           vtkIdList* result)const
+{
+  if (!result)
+    {
+    return;
+    }
+  result->Reset();
+  if (this->SortedPointIds.empty() || radius < 0.0)
+    {
+    return;
+    }
+  // Buckets overlapping the bounding box of the sphere
+  int lower[3];
+  int upper[3];
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    if (x[axis] + radius < this->Origin[axis] ||
+        x[axis] - radius > this->Origin[axis] + this->Dimensions[axis] * this->BucketSize[axis])
+      {
+      return;
+      }
+    }
+  const double lowerCorner[3] = {x[0] - radius, x[1] - radius, x[2] - radius};
+  const double upperCorner[3] = {x[0] + radius, x[1] + radius, x[2] + radius};
+  this->GetBucket(lowerCorner, lower);
+  this->GetBucket(upperCorner, upper);
+
+  const double radius2 = radius * radius;
+  for (int k = lower[2]; k <= upper[2]; ++k)
+    {
+    for (int j = lower[1]; j <= upper[1]; ++j)
+      {
+      const vtkIdType rowOffset = this->Dimensions[0] * (j + static_cast<vtkIdType>(this->Dimensions[1]) * k);
+      // The buckets of a row are contiguous in the sorted arrays
+      const vtkIdType end = this->BucketStarts[rowOffset + upper[0] + 1];
+      for (vtkIdType position = this->BucketStarts[rowOffset + lower[0]]; position < end; ++position)
+        {
+        const float* point = &this->SortedCoordinates[3 * position];
+        const double dx = point[0] - x[0];
+        const double dy = point[1] - x[1];
+        const double dz = point[2] - x[2];
+        if (dx * dx + dy * dy + dz * dz <= radius2)
+          {
+          result->InsertNextId(this->SortedPointIds[position]);
+          }
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbePointLocator::GetPointCellId(vtkIdType pointId)const
+{
+  if (pointId < 0 || pointId + 1 >= static_cast<vtkIdType>(this->PointCellStarts.size()))
+    {
+    return -1;
+    }
+  return this->PointCellStarts[pointId] < this->PointCellStarts[pointId + 1] ?
+    this->PointCells[this->PointCellStarts[pointId]] : -1;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbePointLocator::GetPointCells(vtkIdType pointId, vtkIdList* cellIds)const
+{
+  if (!cellIds)
+    {
+    return;
+    }
+  cellIds->Reset();
+  if (pointId < 0 || pointId + 1 >= static_cast<vtkIdType>(this->PointCellStarts.size()))
+    {
+    return;
+    }
+  for (vtkIdType position = this->PointCellStarts[pointId]; position < this->PointCellStarts[pointId + 1];
+       ++position)
+    {
+    cellIds->InsertNextId(this->PointCells[position]);
+    }
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDataProbePointLocator::GetMaximumEdgeLength()const
+{
+  return this->MaximumEdgeLength;
+}
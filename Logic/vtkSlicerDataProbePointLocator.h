@@ -0,0 +1,132 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerDataProbePointLocator_h
+#define __vtkSlicerDataProbePointLocator_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkWeakPointer.h>
+
+#include "vtkSlicerDataProbeModuleLogicExport.h"
+
+// STD includes
+#include <vector>
+
+class vtkIdList;
+class vtkPolyData;
+
+/// \ingroup Slicer_QtModules_DataProbe
+/// Static uniform grid locator of the points of a polydata.
+///
+/// Points are sorted by bucket and their coordinates are copied in that
+/// order into a flat array, a bucket being a contiguous range of it. The
+/// closest point is searched in shells of buckets of increasing size around
+/// the query, the search stops as soon as no unvisited bucket can contain a
+/// closer point.
+///
+/// The locator is built once and rebuilt by Update() only when the points
+/// or cells of the polydata are modified. The points are bucketed and
+/// copied by several threads, which matters for the millions of points of
+/// fiber bundles. Queries do not modify the locator and can be issued
+/// concurrently.
+/// \sa vtkSlicerDataProbeLogic::ProbeModel, vtkSlicerDataProbeLogic::ProbeFiberBundle
+class VTK_SLICER_DATAPROBE_MODULE_LOGIC_EXPORT vtkSlicerDataProbePointLocator :
+  public vtkObject
+{
+public:
+  static vtkSlicerDataProbePointLocator *New();
+  vtkTypeMacro(vtkSlicerDataProbePointLocator,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Average number of points per bucket.
+  /// Default is 4.
+  vtkSetClampMacro(NumberOfPointsPerBucket, int, 1, 256);
+  vtkGetMacro(NumberOfPointsPerBucket, int);
+
+  /// Number of threads building the locator, 0 to use the default number
+  /// of threads of vtkMultiThreader. Small polydata are built by a single
+  /// thread.
+  /// Default is 0.
+  vtkSetClampMacro(NumberOfThreads, int, 0, VTK_INT_MAX);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Build the locator of \a polyData if it is not up-to-date.
+  /// Return false if the polydata has no points.
+  bool Update(vtkPolyData* polyData);
+
+  /// Return true if the locator has been built from the current points and
+  /// cells of \a polyData.
+  bool IsUpToDate(vtkPolyData* polyData)const;
+
+  /// Return the polydata the locator has been built from, if it still exists.
+  vtkPolyData* GetPolyData()const;
+
+  /// Return the id of the point closest to \a x and its squared distance
+  /// in \a distance2. Return -1 if the locator is empty.
+  vtkIdType FindClosestPoint(const double x[3], double& distance2)const;
+
+  /// Fill \a result with the ids of the points within \a radius of \a x,
+  /// in no particular order.
+  void FindPointsWithinRadius(double radius, const double x[3], vtkIdList* result)const;
+
+  /// Return the id of the first cell using the point \a pointId, or -1.
+  vtkIdType GetPointCellId(vtkIdType pointId)const;
+
+  /// Fill \a cellIds with the ids of the cells using the point \a pointId.
+  void GetPointCells(vtkIdType pointId, vtkIdList* cellIds)const;
+
+  /// Return the length of the longest edge of the lines, polygons and
+  /// strips. A cell passing within a distance d of a position has a point
+  /// within d plus that length of it.
+  double GetMaximumEdgeLength()const;
+
+  /// Release the locator.
+  void Reset();
+
+protected:
+  vtkSlicerDataProbePointLocator();
+  virtual ~vtkSlicerDataProbePointLocator();
+
+  void GetBucket(const double x[3], int bucket[3])const;
+
+  int NumberOfPointsPerBucket;
+  int NumberOfThreads;
+  vtkWeakPointer<vtkPolyData> PolyData;
+  unsigned long PolyDataMTime;
+  int BuiltNumberOfPointsPerBucket;
+
+  int Dimensions[3];
+  double Origin[3];
+  double BucketSize[3];
+  /// Index, in SortedPointIds, of the first point of each bucket.
+  std::vector<vtkIdType> BucketStarts;
+  std::vector<vtkIdType> SortedPointIds;
+  /// Coordinates of the points, in SortedPointIds order.
+  std::vector<float> SortedCoordinates;
+  /// Cells using each point, those of the point p being
+  /// PointCells[PointCellStarts[p]] to PointCells[PointCellStarts[p + 1] - 1].
+  std::vector<vtkIdType> PointCellStarts;
+  std::vector<vtkIdType> PointCells;
+  double MaximumEdgeLength;
+
+private:
+  vtkSlicerDataProbePointLocator(const vtkSlicerDataProbePointLocator&); // Not implemented
+  void operator=(const vtkSlicerDataProbePointLocator&);                 // Not implemented
+};
+
+#endif
@@ -0,0 +1,301 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkMRMLDataProbeResultNode.h"
+#include "vtkSlicerDataProbeSharedMemoryStream.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+// POSIX includes
+# include <fcntl.h>
+# include <signal.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <unistd.h>
+#endif
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Order the stores to the shared memory as seen by the consumers.
+inline void vtkSlicerDataProbeMemoryBarrier()
+{
+#ifndef _WIN32
+  __sync_synchronize();
+#endif
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeCopyName(char* destination, const char* source)
+{
+  if (!source)
+    {
+    destination[0] = '\0';
+    return;
+    }
+  strncpy(destination, source, vtkSlicerDataProbeSharedMemoryStream::MaximumNameLength - 1);
+  destination[vtkSlicerDataProbeSharedMemoryStream::MaximumNameLength - 1] = '\0';
+}
+
+#ifndef _WIN32
+//----------------------------------------------------------------------------
+/// Return true if the shared memory object \a name is a stream whose
+/// producer process no longer exists. Objects that can't be read, that are
+/// not streams or whose producer runs are not stale.
+bool vtkSlicerDataProbeIsStaleStream(const char* name)
+{
+  typedef vtkSlicerDataProbeSharedMemoryStream::StreamHeader StreamHeader;
+  int fileDescriptor = shm_open(name, O_RDONLY, 0);
+  if (fileDescriptor < 0)
+    {
+    return false;
+    }
+  struct stat status;
+  void* memory = MAP_FAILED;
+  if (fstat(fileDescriptor, &status) == 0 &&
+      status.st_size >= static_cast<off_t>(sizeof(StreamHeader)))
+    {
+    memory = mmap(0, sizeof(StreamHeader), PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    }
+  close(fileDescriptor);
+  if (memory == MAP_FAILED)
+    {
+    return false;
+    }
+  const StreamHeader* header = static_cast<const StreamHeader*>(memory);
+  const pid_t producer = static_cast<pid_t>(header->ProducerProcessId);
+  const bool stale = memcmp(header->Magic, "DPSTREAM", sizeof(header->Magic)) == 0 &&
+    producer > 0 && kill(producer, 0) != 0 && errno == ESRCH;
+  munmap(memory, sizeof(StreamHeader));
+  return stale;
+}
+#endif
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+class vtkSlicerDataProbeSharedMemoryStream::vtkInternal
+{
+public:
+  vtkInternal();
+
+  int FileDescriptor;
+  void* Memory;
+  size_t Size;
+  StreamHeader* Header;
+  Record* Records;
+  vtkTypeUInt64 Mask;
+};
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeSharedMemoryStream::vtkInternal::vtkInternal()
+  : FileDescriptor(-1), Memory(0), Size(0), Header(0), Records(0), Mask(0)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerDataProbeSharedMemoryStream);
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeSharedMemoryStream::vtkSlicerDataProbeSharedMemoryStream()
+{
+  this->Name = 0;
+  this->Internal = new vtkInternal;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeSharedMemoryStream::~vtkSlicerDataProbeSharedMemoryStream()
+{
+  this->Close();
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeSharedMemoryStream::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Name: " << (this->Name ? this->Name : "(none)") << "\n";
+  os << indent << "Capacity: " << this->GetCapacity() << "\n";
+  os << indent << "NumberOfPublishedResults: " << this->GetNumberOfPublishedResults() << "\n";
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeSharedMemoryStream::Open(const char* name, int capacity)
+{
+  this->Close();
+#ifdef _WIN32
+  (void)capacity;
+  vtkErrorMacro(<< "Open: shared memory streams are not supported on this platform, "
+                << (name ? name : "(null)") << " is not opened");
+  return false;
+#else
+  if (!name || name[0] != '/' || strlen(name) > 251 || strchr(name + 1, '/'))
+    {
+    vtkErrorMacro(<< "Open: invalid shared memory name " << (name ? name : "(null)"));
+    return false;
+    }
+  vtkTypeUInt64 roundedCapacity = 1;
+  while (roundedCapacity < static_cast<vtkTypeUInt64>(capacity) && roundedCapacity < (1u << 20))
+    {
+    roundedCapacity <<= 1;
+    }
+  const size_t size = sizeof(StreamHeader) + roundedCapacity * sizeof(Record);
+
+  int fileDescriptor = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fileDescriptor < 0 && errno == EEXIST && vtkSlicerDataProbeIsStaleStream(name))
+    {
+    // Left by a crashed session, it would keep its old size and content
+    shm_unlink(name);
+    fileDescriptor = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    }
+  if (fileDescriptor < 0)
+    {
+    vtkErrorMacro(<< "Open: can't create " << name << ": " << strerror(errno));
+    return false;
+    }
+  void* memory = MAP_FAILED;
+  if (ftruncate(fileDescriptor, static_cast<off_t>(size)) == 0)
+    {
+    memory = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+    }
+  if (memory == MAP_FAILED)
+    {
+    vtkErrorMacro(<< "Open: can't map " << size << " bytes of " << name << ": " << strerror(errno));
+    close(fileDescriptor);
+    shm_unlink(name);
+    return false;
+    }
+
+  // The object is zero-filled by ftruncate, all the sequences are even.
+  this->Internal->FileDescriptor = fileDescriptor;
+  this->Internal->Memory = memory;
+  this->Internal->Size = size;
+  this->Internal->Header = static_cast<StreamHeader*>(memory);
+  this->Internal->Records = reinterpret_cast<Record*>(static_cast<char*>(memory) + sizeof(StreamHeader));
+  this->Internal->Mask = roundedCapacity - 1;
+  StreamHeader* header = this->Internal->Header;
+  header->Version = Version;
+  header->RecordSize = sizeof(Record);
+  header->Capacity = static_cast<vtkTypeUInt32>(roundedCapacity);
+  header->ProducerProcessId = static_cast<vtkTypeUInt32>(getpid());
+  header->WriteIndex = 0;
+  // Consumers wait for the magic before reading the other fields
+  vtkSlicerDataProbeMemoryBarrier();
+  memcpy(header->Magic, "DPSTREAM", sizeof(header->Magic));
+  this->SetName(name);
+  return true;
+#endif
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeSharedMemoryStream::Close()
+{
+  if (!this->IsOpen())
+    {
+    return;
+    }
+#ifndef _WIN32
+  munmap(this->Internal->Memory, this->Internal->Size);
+  close(this->Internal->FileDescriptor);
+  // Consumers keep their mapping until they unmap it
+  shm_unlink(this->Name);
+#endif
+  this->Internal->FileDescriptor = -1;
+  this->Internal->Memory = 0;
+  this->Internal->Size = 0;
+  this->Internal->Header = 0;
+  this->Internal->Records = 0;
+  this->Internal->Mask = 0;
+  this->SetName(0);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeSharedMemoryStream::IsOpen()const
+{
+  return this->Internal->Header != 0;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDataProbeSharedMemoryStream::GetCapacity()const
+{
+  return this->IsOpen() ? static_cast<int>(this->Internal->Mask + 1) : 0;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkSlicerDataProbeSharedMemoryStream::GetNumberOfPublishedResults()const
+{
+  return this->IsOpen() ? this->Internal->Header->WriteIndex : 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeSharedMemoryStream::Publish(vtkMRMLDataProbeResultNode* resultNode)
+{
+  StreamHeader* header = this->Internal->Header;
+  if (!header)
+    {
+    return;
+    }
+  // Single producer, nobody else writes the index
+  const vtkTypeUInt64 index = header->WriteIndex;
+  Record& record = this->Internal->Records[index & this->Internal->Mask];
+
+  record.Sequence = 2 * index + 1;
+  vtkSlicerDataProbeMemoryBarrier();
+
+  record.Time = vtkTimerLog::GetUniversalTime();
+  record.Valid = resultNode && resultNode->GetValid() ? 1 : 0;
+  vtkSlicerDataProbeCopyName(record.ViewName, record.Valid ? resultNode->GetViewName() : 0);
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    record.RAS[axis] = record.Valid ? resultNode->GetRAS()[axis] : 0.0;
+    }
+  for (int layer = 0; layer < NumberOfLayers; ++layer)
+    {
+    LayerRecord& layerRecord = record.Layers[layer];
+    if (!record.Valid)
+      {
+      layerRecord.VolumeNodeID[0] = '\0';
+      layerRecord.IJK[0] = layerRecord.IJK[1] = layerRecord.IJK[2] = -1.0;
+      layerRecord.Status = 0;
+      layerRecord.NumberOfValues = 0;
+      continue;
+      }
+    vtkSlicerDataProbeCopyName(layerRecord.VolumeNodeID, resultNode->GetLayerVolumeNodeID(layer));
+    resultNode->GetLayerIJK(layer, layerRecord.IJK);
+    layerRecord.Status = resultNode->GetLayerStatus(layer);
+    layerRecord.NumberOfValues = resultNode->GetLayerNumberOfValues(layer);
+    for (int valueIdx = 0; valueIdx < layerRecord.NumberOfValues; ++valueIdx)
+      {
+      layerRecord.Values[valueIdx] = resultNode->GetLayerValue(layer, valueIdx);
+      }
+    }
+
+  vtkSlicerDataProbeMemoryBarrier();
+  record.Sequence = 2 * index + 2;
+  vtkSlicerDataProbeMemoryBarrier();
+  header->WriteIndex = index + 1;
+}
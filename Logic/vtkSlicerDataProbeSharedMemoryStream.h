@@ -0,0 +1,150 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerDataProbeSharedMemoryStream_h
+#define __vtkSlicerDataProbeSharedMemoryStream_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkType.h>
+
+#include "vtkSlicerDataProbeModuleLogicExport.h"
+
+class vtkMRMLDataProbeResultNode;
+
+/// \ingroup Slicer_QtModules_DataProbe
+/// Ring buffer of probe results in POSIX shared memory, for consumer
+/// processes on the same machine.
+///
+/// The shared memory object starts with a StreamHeader followed by Capacity
+/// Record slots. There is a single producer, Publish() writes the result
+/// number n into the slot n % Capacity and then sets WriteIndex to n + 1.
+/// Each slot is protected by a sequence lock: Sequence is odd while the slot
+/// is written and equal to 2 * (n + 1) once the result n is complete.
+///
+/// Consumers map the object read-only, take no lock and copy nothing: to
+/// read the result n, read Sequence, issue an acquire barrier, read the
+/// fields in place, issue another barrier and read Sequence again. The
+/// fields are consistent if both reads are 2 * (n + 1), otherwise the slot
+/// was overwritten and the consumer fell more than Capacity results behind.
+///
+/// All the fields have a fixed size and offset, in native byte order.
+/// Not supported on Windows, Open() then fails.
+/// \sa vtkSlicerDataProbeLogic::GetSharedMemoryStream
+class VTK_SLICER_DATAPROBE_MODULE_LOGIC_EXPORT vtkSlicerDataProbeSharedMemoryStream :
+  public vtkObject
+{
+public:
+  static vtkSlicerDataProbeSharedMemoryStream *New();
+  vtkTypeMacro(vtkSlicerDataProbeSharedMemoryStream,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  enum
+    {
+    Version = 1,
+    NumberOfLayers = 3,
+    MaximumNumberOfValues = 3,
+    MaximumNameLength = 32
+    };
+
+  /// 128 bytes, WriteIndex on its own cache line.
+  struct StreamHeader
+  {
+    /// "DPSTREAM"
+    char Magic[8];
+    vtkTypeUInt32 Version;
+    vtkTypeUInt32 RecordSize;
+    vtkTypeUInt32 Capacity;
+    /// Process ID of the producer.
+    vtkTypeUInt32 ProducerProcessId;
+    char Padding0[40];
+    /// Number of published results.
+    volatile vtkTypeUInt64 WriteIndex;
+    char Padding1[56];
+  };
+
+  struct LayerRecord
+  {
+    /// Null terminated, truncated if longer.
+    char VolumeNodeID[MaximumNameLength];
+    double IJK[3];
+    /// vtkSlicerDataProbeLogic::DataProbeStatus, 0 if the layer is empty.
+    vtkTypeInt32 Status;
+    vtkTypeInt32 NumberOfValues;
+    double Values[MaximumNumberOfValues];
+  };
+
+  /// 384 bytes, slots don't share cache lines.
+  struct Record
+  {
+    volatile vtkTypeUInt64 Sequence;
+    /// vtkTimerLog::GetUniversalTime() when published.
+    double Time;
+    /// 0 when the cursor left the views.
+    vtkTypeUInt32 Valid;
+    vtkTypeUInt32 Reserved;
+    char ViewName[MaximumNameLength];
+    double RAS[3];
+    /// Indexed by vtkMRMLDataProbeResultNode::Layers.
+    LayerRecord Layers[NumberOfLayers];
+    char Padding[40];
+  };
+
+  /// Create the shared memory object \a name ("/" followed by at most 250
+  /// characters) holding \a capacity results, rounded up to a power of two.
+  /// The object is only accessible to the user. If it already exists, it is
+  /// replaced only if it is a stream whose producer process no longer runs,
+  /// e.g. after a crash; otherwise Open() fails.
+  /// The stream is closed first if it was open. Return false on error.
+  bool Open(const char* name, int capacity = 4096);
+
+  /// Unmap and unlink the shared memory object.
+  void Close();
+
+  bool IsOpen()const;
+
+  /// Name of the open shared memory object, 0 if closed.
+  vtkGetStringMacro(Name);
+
+  /// Number of result slots, 0 if closed.
+  int GetCapacity()const;
+
+  /// Number of results published since the stream was opened.
+  vtkTypeUInt64 GetNumberOfPublishedResults()const;
+
+  /// Append the content of \a resultNode, or an invalid result if
+  /// \a resultNode is 0. Nothing is done if the stream is closed.
+  /// Neither allocates nor locks, meant to be called on every probe.
+  void Publish(vtkMRMLDataProbeResultNode* resultNode);
+
+protected:
+  vtkSlicerDataProbeSharedMemoryStream();
+  virtual ~vtkSlicerDataProbeSharedMemoryStream();
+
+  vtkSetStringMacro(Name);
+
+  char* Name;
+
+private:
+  vtkSlicerDataProbeSharedMemoryStream(const vtkSlicerDataProbeSharedMemoryStream&); // Not implemented
+  void operator=(const vtkSlicerDataProbeSharedMemoryStream&);                       // Not implemented
+
+  class vtkInternal;
+  vtkInternal * Internal;
+};
+
+#endif
@@ -0,0 +1,238 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeSliceChecksums.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Slices whose checksum is computed by the threads, each thread computing
+/// every NumberOfThreads-th slice.
+struct vtkSlicerDataProbeSliceChecksumTask
+{
+  const unsigned char* Scalars;
+  size_t SliceSize;
+  int NumberOfSlices;
+  vtkTypeUInt64* Checksums;
+
+  static VTK_THREAD_RETURN_TYPE ComputeChecksums(void* arg)
+  {
+    vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+    const vtkSlicerDataProbeSliceChecksumTask* self =
+      static_cast<const vtkSlicerDataProbeSliceChecksumTask*>(threadInfo->UserData);
+    for (int sliceIdx = threadInfo->ThreadID; sliceIdx < self->NumberOfSlices;
+         sliceIdx += threadInfo->NumberOfThreads)
+      {
+      // Multiply-xorshift hash of the 8-byte words of the slice, then of
+      // its remaining bytes.
+      const unsigned char* bytes = self->Scalars + sliceIdx * self->SliceSize;
+      const size_t numberOfWords = self->SliceSize / sizeof(vtkTypeUInt64);
+      vtkTypeUInt64 checksum = 0xcbf29ce484222325ULL;
+      for (size_t wordIdx = 0; wordIdx < numberOfWords; ++wordIdx)
+        {
+        vtkTypeUInt64 word;
+        memcpy(&word, bytes + wordIdx * sizeof(vtkTypeUInt64), sizeof(vtkTypeUInt64));
+        checksum = (checksum ^ word) * 0x9e3779b97f4a7c15ULL;
+        checksum ^= checksum >> 29;
+        }
+      for (size_t byteIdx = numberOfWords * sizeof(vtkTypeUInt64); byteIdx < self->SliceSize; ++byteIdx)
+        {
+        checksum = (checksum ^ bytes[byteIdx]) * 0x100000001b3ULL;
+        }
+      self->Checksums[sliceIdx] = checksum;
+      }
+    return VTK_THREAD_RETURN_VALUE;
+  }
+};
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerDataProbeSliceChecksums);
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeSliceChecksums::vtkSlicerDataProbeSliceChecksums()
+{
+  this->NumberOfThreads = 0;
+  this->Scalars = 0;
+  this->ScalarsMTime = 0;
+  this->ScalarType = 0;
+  this->NumberOfComponents = 0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Dimensions[axis] = 0;
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeSliceChecksums::~vtkSlicerDataProbeSliceChecksums()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeSliceChecksums::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "NumberOfSlices: " << this->Checksums.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeSliceChecksums::Reset()
+{
+  this->ImageData = 0;
+  this->Scalars = 0;
+  this->ScalarsMTime = 0;
+  this->ScalarType = 0;
+  this->NumberOfComponents = 0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Dimensions[axis] = 0;
+    }
+  std::vector<vtkTypeUInt64>().swap(this->Checksums);
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkSlicerDataProbeSliceChecksums::GetImageData()const
+{
+  return this->ImageData.GetPointer();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeSliceChecksums::IsComputedFrom(vtkImageData* imageData)const
+{
+  if (!imageData || imageData != this->ImageData.GetPointer())
+    {
+    return false;
+    }
+  vtkDataArray* scalars = imageData->GetPointData()->GetScalars();
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+  return scalars
+    && scalars->GetVoidPointer(0) == this->Scalars
+    && scalars->GetDataType() == this->ScalarType
+    && scalars->GetNumberOfComponents() == this->NumberOfComponents
+    && dims[0] == this->Dimensions[0]
+    && dims[1] == this->Dimensions[1]
+    && dims[2] == this->Dimensions[2];
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeSliceChecksums::IsUpToDate(vtkImageData* imageData)const
+{
+  if (!this->IsComputedFrom(imageData))
+    {
+    return false;
+    }
+  vtkDataArray* scalars = imageData->GetPointData()->GetScalars();
+  return std::max(scalars->GetMTime(), imageData->GetMTime()) == this->ScalarsMTime;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeSliceChecksums::Update(vtkImageData* imageData, int modifiedExtent[6])
+{
+  // Empty extent
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    modifiedExtent[2 * axis] = 0;
+    modifiedExtent[2 * axis + 1] = -1;
+    }
+  if (this->IsUpToDate(imageData))
+    {
+    return true;
+    }
+  const bool compared = this->IsComputedFrom(imageData);
+  if (!compared)
+    {
+    this->Reset();
+    }
+  vtkDataArray* scalars = imageData ? imageData->GetPointData()->GetScalars() : 0;
+  int dims[3] = {0, 0, 0};
+  if (imageData)
+    {
+    imageData->GetDimensions(dims);
+    }
+  const vtkIdType numberOfVoxels = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  if (!scalars || numberOfVoxels == 0 || scalars->GetNumberOfTuples() < numberOfVoxels)
+    {
+    this->Reset();
+    return false;
+    }
+
+  std::vector<vtkTypeUInt64> checksums(dims[2]);
+  vtkSlicerDataProbeSliceChecksumTask task;
+  task.Scalars = static_cast<const unsigned char*>(scalars->GetVoidPointer(0));
+  task.SliceSize = static_cast<size_t>(dims[0]) * dims[1] *
+    scalars->GetNumberOfComponents() * scalars->GetDataTypeSize();
+  task.NumberOfSlices = dims[2];
+  task.Checksums = &checksums[0];
+  int numberOfThreads = this->NumberOfThreads > 0 ?
+    this->NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  numberOfThreads = std::min(std::min(numberOfThreads, VTK_MAX_THREADS), dims[2]);
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(std::max(numberOfThreads, 1));
+  threader->SetSingleMethod(vtkSlicerDataProbeSliceChecksumTask::ComputeChecksums, &task);
+  threader->SingleMethodExecute();
+
+  if (compared)
+    {
+    for (int k = 0; k < dims[2]; ++k)
+      {
+      if (checksums[k] != this->Checksums[k])
+        {
+        if (modifiedExtent[4] > modifiedExtent[5])
+          {
+          modifiedExtent[4] = k;
+          }
+        modifiedExtent[5] = k;
+        }
+      }
+    if (modifiedExtent[4] <= modifiedExtent[5])
+      {
+      modifiedExtent[0] = 0;
+      modifiedExtent[1] = dims[0] - 1;
+      modifiedExtent[2] = 0;
+      modifiedExtent[3] = dims[1] - 1;
+      }
+    }
+
+  this->Checksums.swap(checksums);
+  this->ImageData = imageData;
+  this->Scalars = scalars->GetVoidPointer(0);
+  this->ScalarsMTime = std::max(scalars->GetMTime(), imageData->GetMTime());
+  this->ScalarType = scalars->GetDataType();
+  this->NumberOfComponents = scalars->GetNumberOfComponents();
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Dimensions[axis] = dims[axis];
+    }
+  return compared;
+}
@@ -0,0 +1,96 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerDataProbeSliceChecksums_h
+#define __vtkSlicerDataProbeSliceChecksums_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkWeakPointer.h>
+
+#include "vtkSlicerDataProbeModuleLogicExport.h"
+
+// STD includes
+#include <vector>
+
+class vtkImageData;
+
+/// \ingroup Slicer_QtModules_DataProbe
+/// Checksum of each K slice of an image, to find the slices modified since
+/// the last update.
+///
+/// Editors modify label maps in place and only invoke a ModifiedEvent on
+/// the image, without the modified extent. Comparing the checksums of the
+/// slices is a single read of the voxels, split among threads, which is
+/// much cheaper than building the label indexes again.
+/// \sa vtkSlicerDataProbeLogic::LabelMapModified
+class VTK_SLICER_DATAPROBE_MODULE_LOGIC_EXPORT vtkSlicerDataProbeSliceChecksums :
+  public vtkObject
+{
+public:
+  static vtkSlicerDataProbeSliceChecksums *New();
+  vtkTypeMacro(vtkSlicerDataProbeSliceChecksums,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Number of threads computing the checksums, 0 to use the default
+  /// number of threads of vtkMultiThreader.
+  /// Default is 0.
+  vtkSetClampMacro(NumberOfThreads, int, 0, VTK_INT_MAX);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Compute the checksums of the slices of \a imageData if they are not
+  /// up-to-date. If the previous checksums were computed from the same
+  /// scalars, \a modifiedExtent is set to the IJK extent of the slices
+  /// whose checksum changed, an empty extent if none, and true is returned.
+  /// Otherwise the checksums are only computed, to be compared at the next
+  /// update, and false is returned.
+  bool Update(vtkImageData* imageData, int modifiedExtent[6]);
+
+  /// Return true if the checksums have been computed from the current
+  /// scalars of \a imageData.
+  bool IsUpToDate(vtkImageData* imageData)const;
+
+  /// Return the image the checksums have been computed from, if it still
+  /// exists.
+  vtkImageData* GetImageData()const;
+
+  /// Release the checksums.
+  void Reset();
+
+protected:
+  vtkSlicerDataProbeSliceChecksums();
+  virtual ~vtkSlicerDataProbeSliceChecksums();
+
+  /// Return true if the checksums have been computed from the scalars of
+  /// \a imageData, whether they have been modified since or not.
+  bool IsComputedFrom(vtkImageData* imageData)const;
+
+  int NumberOfThreads;
+  vtkWeakPointer<vtkImageData> ImageData;
+  void* Scalars;
+  unsigned long ScalarsMTime;
+  int ScalarType;
+  int NumberOfComponents;
+  int Dimensions[3];
+  std::vector<vtkTypeUInt64> Checksums;
+
+private:
+  vtkSlicerDataProbeSliceChecksums(const vtkSlicerDataProbeSliceChecksums&); // Not implemented
+  void operator=(const vtkSlicerDataProbeSliceChecksums&);                   // Not implemented
+};
+
+#endif
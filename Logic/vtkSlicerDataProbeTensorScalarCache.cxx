@@ -0,0 +1,382 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeTensorScalarCache.h"
+
+// vtkTeem includes
+#include "vtkDiffusionTensorMathematics.h"
+
+// VTK includes
+#include <vtkFloatArray.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <cstring>
+#include <list>
+#include <vector>
+
+//----------------------------------------------------------------------------
+class vtkSlicerDataProbeTensorScalarCache::vtkInternal
+{
+public:
+  vtkInternal(vtkSlicerDataProbeTensorScalarCache* external);
+
+  struct ScalarMap
+  {
+    vtkWeakPointer<vtkImageData> ImageData;
+    vtkWeakPointer<vtkDataArray> Tensors;
+    unsigned long TensorsMTime;
+    int Operation;
+    int Dimensions[3];
+    std::vector<std::vector<float> > Slices;
+    std::vector<unsigned long> SliceLastAccess;
+  };
+  typedef std::list<ScalarMap> ScalarMapListType;
+
+  /// Return the up-to-date map associated with \a imageData and \a operation.
+  /// Outdated maps are released.
+  ScalarMap* GetScalarMap(vtkImageData* imageData, vtkDataArray* tensors, int operation);
+
+  /// Compute the scalar invariant of the K slice \a k into \a slice.
+  void ComputeSlice(const ScalarMap& map, int k, std::vector<float>& slice);
+
+  /// Release least recently used slices until \a bytes could be allocated
+  /// without exceeding the memory limit. Return false if \a bytes alone
+  /// exceed the limit.
+  bool ReserveMemory(vtkIdType bytes);
+
+  void ReleaseMap(ScalarMap& map);
+  static vtkIdType SliceSizeInBytes(const ScalarMap& map);
+
+  vtkSlicerDataProbeTensorScalarCache* External;
+  ScalarMapListType ScalarMaps;
+  vtkSmartPointer<vtkDiffusionTensorMathematics> DTIMath;
+  unsigned long AccessCounter;
+  vtkIdType MemorySizeInBytes;
+};
+
+//---------------------------------------------------------------------------
+// vtkInternal methods
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeTensorScalarCache::vtkInternal::vtkInternal(
+    vtkSlicerDataProbeTensorScalarCache* _external)
+{
+  this->External = _external;
+  this->AccessCounter = 0;
+  this->MemorySizeInBytes = 0;
+}
+
+//---------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeTensorScalarCache::vtkInternal::SliceSizeInBytes(const ScalarMap& map)
+{
+  return static_cast<vtkIdType>(map.Dimensions[0]) * map.Dimensions[1] * sizeof(float);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeTensorScalarCache::vtkInternal::ReleaseMap(ScalarMap& map)
+{
+  for (size_t sliceIdx = 0; sliceIdx < map.Slices.size(); ++sliceIdx)
+    {
+    if (!map.Slices[sliceIdx].empty())
+      {
+      this->MemorySizeInBytes -= vtkInternal::SliceSizeInBytes(map);
+      std::vector<float>().swap(map.Slices[sliceIdx]);
+      }
+    }
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeTensorScalarCache::vtkInternal::ScalarMap*
+vtkSlicerDataProbeTensorScalarCache::vtkInternal::GetScalarMap(
+  vtkImageData* imageData, vtkDataArray* tensors, int operation)
+{
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+
+  ScalarMap* found = 0;
+  ScalarMapListType::iterator it = this->ScalarMaps.begin();
+  while (it != this->ScalarMaps.end())
+    {
+    ScalarMap& map = *it;
+    bool outdated = (map.ImageData.GetPointer() == 0);
+    if (!outdated && map.ImageData.GetPointer() == imageData)
+      {
+      // The maps of all the invariants of the image are outdated by new tensors
+      outdated = map.Tensors.GetPointer() != tensors
+        || map.TensorsMTime != tensors->GetMTime()
+        || map.Dimensions[0] != dims[0]
+        || map.Dimensions[1] != dims[1]
+        || map.Dimensions[2] != dims[2];
+      if (!outdated && map.Operation == operation)
+        {
+        found = &map;
+        }
+      }
+    if (outdated)
+      {
+      this->ReleaseMap(map);
+      it = this->ScalarMaps.erase(it);
+      }
+    else
+      {
+      ++it;
+      }
+    }
+  if (found)
+    {
+    return found;
+    }
+
+  this->ScalarMaps.push_back(ScalarMap());
+  ScalarMap& map = this->ScalarMaps.back();
+  map.ImageData = imageData;
+  map.Tensors = tensors;
+  map.TensorsMTime = tensors->GetMTime();
+  map.Operation = operation;
+  for (int dimIdx = 0; dimIdx < 3; ++dimIdx)
+    {
+    map.Dimensions[dimIdx] = dims[dimIdx];
+    }
+  map.Slices.resize(dims[2]);
+  map.SliceLastAccess.resize(dims[2], 0);
+  return &map;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDataProbeTensorScalarCache::vtkInternal::ReserveMemory(vtkIdType bytes)
+{
+  vtkIdType limitInBytes = this->External->MemoryLimit * 1024;
+  if (bytes > limitInBytes)
+    {
+    return false;
+    }
+  while (this->MemorySizeInBytes + bytes > limitInBytes)
+    {
+    ScalarMap* lruMap = 0;
+    size_t lruSliceIdx = 0;
+    for (ScalarMapListType::iterator it = this->ScalarMaps.begin(); it != this->ScalarMaps.end(); ++it)
+      {
+      for (size_t sliceIdx = 0; sliceIdx < it->Slices.size(); ++sliceIdx)
+        {
+        if (!it->Slices[sliceIdx].empty() &&
+            (!lruMap || it->SliceLastAccess[sliceIdx] < lruMap->SliceLastAccess[lruSliceIdx]))
+          {
+          lruMap = &(*it);
+          lruSliceIdx = sliceIdx;
+          }
+        }
+      }
+    if (!lruMap)
+      {
+      break;
+      }
+    this->MemorySizeInBytes -= vtkInternal::SliceSizeInBytes(*lruMap);
+    std::vector<float>().swap(lruMap->Slices[lruSliceIdx]);
+    }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeTensorScalarCache::vtkInternal::ComputeSlice(
+  const ScalarMap& map, int k, std::vector<float>& slice)
+{
+  if (!this->DTIMath)
+    {
+    this->DTIMath = vtkSmartPointer<vtkDiffusionTensorMathematics>::New();
+    }
+
+  vtkIdType numberOfSliceVoxels = static_cast<vtkIdType>(map.Dimensions[0]) * map.Dimensions[1];
+  vtkIdType sliceOffset = numberOfSliceVoxels * k;
+
+  vtkNew<vtkImageData> sliceImage;
+  sliceImage->SetExtent(0, map.Dimensions[0] - 1, 0, map.Dimensions[1] - 1, 0, 0);
+  sliceImage->AllocateScalars();
+
+  vtkNew<vtkFloatArray> sliceTensors;
+  sliceTensors->SetNumberOfComponents(9);
+  sliceTensors->SetNumberOfTuples(numberOfSliceVoxels);
+  vtkDataArray* tensors = map.Tensors;
+  vtkFloatArray* floatTensors = vtkFloatArray::SafeDownCast(tensors);
+  if (floatTensors)
+    {
+    memcpy(sliceTensors->GetPointer(0), floatTensors->GetPointer(sliceOffset * 9),
+           numberOfSliceVoxels * 9 * sizeof(float));
+    }
+  else
+    {
+    double tensor[9];
+    for (vtkIdType voxelIdx = 0; voxelIdx < numberOfSliceVoxels; ++voxelIdx)
+      {
+      tensors->GetTuple(sliceOffset + voxelIdx, tensor);
+      sliceTensors->SetTuple(voxelIdx, tensor);
+      }
+    }
+  sliceImage->GetPointData()->SetTensors(sliceTensors.GetPointer());
+
+  // vtkDiffusionTensorMathematics is a threaded filter, the slice is
+  // processed in parallel.
+  this->DTIMath->SetInput(sliceImage.GetPointer());
+  this->DTIMath->SetOperation(map.Operation);
+  this->DTIMath->Update();
+
+  slice.assign(numberOfSliceVoxels, vtkMath::Nan());
+  vtkImageData * output = this->DTIMath->GetOutput();
+  vtkDataArray * scalars = output ? output->GetPointData()->GetScalars() : 0;
+  if (scalars && scalars->GetNumberOfTuples() == numberOfSliceVoxels)
+    {
+    for (vtkIdType voxelIdx = 0; voxelIdx < numberOfSliceVoxels; ++voxelIdx)
+      {
+      slice[voxelIdx] = static_cast<float>(scalars->GetComponent(voxelIdx, 0));
+      }
+    }
+
+  // Do not keep a reference to the slice in the pipeline.
+  this->DTIMath->SetInput(0);
+}
+
+//----------------------------------------------------------------------------
+// vtkSlicerDataProbeTensorScalarCache methods
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerDataProbeTensorScalarCache);
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeTensorScalarCache::vtkSlicerDataProbeTensorScalarCache()
+{
+  this->MemoryLimit = 256 * 1024;
+  this->Internal = new vtkInternal(this);
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeTensorScalarCache::~vtkSlicerDataProbeTensorScalarCache()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeTensorScalarCache::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "MemoryLimit: " << this->MemoryLimit << "\n";
+  os << indent << "MemorySize: " << this->GetMemorySize() << "\n";
+  os << indent << "NumberOfScalarMaps: " << this->Internal->ScalarMaps.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeTensorScalarCache::SetMemoryLimit(vtkIdType limitInKiB)
+{
+  if (limitInKiB < 0)
+    {
+    limitInKiB = 0;
+    }
+  if (this->MemoryLimit == limitInKiB)
+    {
+    return;
+    }
+  this->MemoryLimit = limitInKiB;
+  this->Internal->ReserveMemory(0);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeTensorScalarCache::GetMemorySize()const
+{
+  return this->Internal->MemorySizeInBytes / 1024;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDataProbeTensorScalarCache::GetScalar(
+  vtkImageData* imageData, int operation, int i, int j, int k)
+{
+  if (!imageData)
+    {
+    return vtkMath::Nan();
+    }
+  vtkDataArray * tensors = imageData->GetPointData() ?
+    imageData->GetPointData()->GetTensors() : 0;
+  if (!tensors || tensors->GetNumberOfComponents() != 9)
+    {
+    return vtkMath::Nan();
+    }
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+  if (i < 0 || i >= dims[0] || j < 0 || j >= dims[1] || k < 0 || k >= dims[2])
+    {
+    return vtkMath::Nan();
+    }
+  // The slices are copied from the tensor array, which must cover the image
+  if (tensors->GetNumberOfTuples() < static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2])
+    {
+    return vtkMath::Nan();
+    }
+
+  vtkInternal::ScalarMap* map = this->Internal->GetScalarMap(imageData, tensors, operation);
+  vtkIdType voxelIdx = static_cast<vtkIdType>(j) * dims[0] + i;
+
+  map->SliceLastAccess[k] = ++this->Internal->AccessCounter;
+  std::vector<float>& slice = map->Slices[k];
+  if (slice.empty())
+    {
+    if (!this->Internal->ReserveMemory(vtkInternal::SliceSizeInBytes(*map)))
+      {
+      // The slice alone does not fit within the limit, compute it without caching it.
+      std::vector<float> uncachedSlice;
+      this->Internal->ComputeSlice(*map, k, uncachedSlice);
+      return uncachedSlice[voxelIdx];
+      }
+    this->Internal->ComputeSlice(*map, k, slice);
+    this->Internal->MemorySizeInBytes += vtkInternal::SliceSizeInBytes(*map);
+    }
+  return slice[voxelIdx];
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeTensorScalarCache::RemoveImageData(vtkImageData* imageData)
+{
+  vtkInternal::ScalarMapListType::iterator it = this->Internal->ScalarMaps.begin();
+  while (it != this->Internal->ScalarMaps.end())
+    {
+    if (it->ImageData.GetPointer() == imageData || it->ImageData.GetPointer() == 0)
+      {
+      this->Internal->ReleaseMap(*it);
+      it = this->Internal->ScalarMaps.erase(it);
+      }
+    else
+      {
+      ++it;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeTensorScalarCache::RemoveAll()
+{
+  for (vtkInternal::ScalarMapListType::iterator it = this->Internal->ScalarMaps.begin();
+       it != this->Internal->ScalarMaps.end(); ++it)
+    {
+    this->Internal->ReleaseMap(*it);
+    }
+  this->Internal->ScalarMaps.clear();
+}
@@ -0,0 +1,83 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerDataProbeTensorScalarCache_h
+#define __vtkSlicerDataProbeTensorScalarCache_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkSlicerDataProbeModuleLogicExport.h"
+
+class vtkImageData;
+
+/// \ingroup Slicer_QtModules_DataProbe
+/// Lazily filled scalar maps derived from DTI volumes.
+///
+/// A map is kept for each (tensor image, scalar invariant) pair. It is filled
+/// one K slice at a time, the first time a voxel of that slice is requested,
+/// by running vtkDiffusionTensorMathematics (a threaded filter) on the whole
+/// slice. Subsequent requests on the same slice are direct array reads.
+///
+/// The maps of an image are discarded when its tensors are modified. The
+/// memory used by all the maps is bounded by \a MemoryLimit, least recently
+/// used slices being released first, whatever their image and invariant.
+class VTK_SLICER_DATAPROBE_MODULE_LOGIC_EXPORT vtkSlicerDataProbeTensorScalarCache :
+  public vtkObject
+{
+public:
+  static vtkSlicerDataProbeTensorScalarCache *New();
+  vtkTypeMacro(vtkSlicerDataProbeTensorScalarCache,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Maximum amount of memory, in kibibytes, used by all the cached slices.
+  /// Setting a limit of 0 disables the cache.
+  /// Default is 262144 (256 MiB).
+  void SetMemoryLimit(vtkIdType limitInKiB);
+  vtkGetMacro(MemoryLimit, vtkIdType);
+
+  /// Return the amount of memory, in kibibytes, currently used by the cached slices.
+  vtkIdType GetMemorySize()const;
+
+  /// Return the scalar invariant \a operation (see vtkDiffusionTensorMathematics)
+  /// of the tensor at voxel (\a i, \a j, \a k) of \a imageData.
+  /// The K slice containing the voxel is computed if it is not cached yet.
+  /// Return vtkMath::Nan() if the voxel is outside of the image, if the
+  /// image has no tensors or if they do not cover all its voxels.
+  double GetScalar(vtkImageData* imageData, int operation, int i, int j, int k);
+
+  /// Release the maps associated with \a imageData.
+  void RemoveImageData(vtkImageData* imageData);
+
+  /// Release all the maps.
+  void RemoveAll();
+
+protected:
+  vtkSlicerDataProbeTensorScalarCache();
+  virtual ~vtkSlicerDataProbeTensorScalarCache();
+
+  vtkIdType MemoryLimit;
+
+private:
+  vtkSlicerDataProbeTensorScalarCache(const vtkSlicerDataProbeTensorScalarCache&); // Not implemented
+  void operator=(const vtkSlicerDataProbeTensorScalarCache&);                      // Not implemented
+
+  class vtkInternal;
+  vtkInternal * Internal;
+};
+
+#endif
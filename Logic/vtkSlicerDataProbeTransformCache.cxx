@@ -0,0 +1,480 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeTransformCache.h"
+
+// MRML includes
+#include <vtkMRMLTransformNode.h>
+#include <vtkMRMLVolumeNode.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkGeneralTransform.h>
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <list>
+#include <utility>
+#include <vector>
+
+//----------------------------------------------------------------------------
+class vtkSlicerDataProbeTransformCache::vtkInternal
+{
+public:
+  vtkInternal(vtkSlicerDataProbeTransformCache* external);
+  ~vtkInternal();
+
+  typedef std::pair<vtkWeakPointer<vtkObject>, unsigned long> ObservationType;
+
+  struct Mapping
+  {
+    vtkWeakPointer<vtkMRMLVolumeNode> VolumeNode;
+    unsigned long VolumeMTime;
+    bool Linear;
+    /// World to IJK for linear chains, local RAS to IJK otherwise.
+    vtkSmartPointer<vtkMatrix4x4> ToIJK;
+    /// IJK to world, only set for linear chains.
+    vtkSmartPointer<vtkMatrix4x4> FromIJK;
+    /// World to local RAS, only set for non-linear chains.
+    vtkSmartPointer<vtkGeneralTransform> WorldToLocal;
+    int GridDimensions[3];
+    double GridOrigin[3];
+    double GridSpacing[3];
+    /// Local minus world positions, 3 floats per grid sample, X fastest.
+    std::vector<float> GridDisplacements;
+    std::vector<ObservationType> Observations;
+  };
+  typedef std::list<Mapping> MappingListType;
+
+  Mapping* GetMapping(vtkMRMLVolumeNode* volumeNode);
+  void BuildMapping(Mapping& mapping);
+  void BuildDisplacementGrid(Mapping& mapping);
+  bool InterpolateDisplacement(const Mapping& mapping, const double ras[3], double displacement[3])const;
+  void Observe(Mapping& mapping, vtkObject* object);
+  void ReleaseMapping(Mapping& mapping);
+
+  vtkSlicerDataProbeTransformCache* External;
+  MappingListType Mappings;
+  vtkSmartPointer<vtkCallbackCommand> CallbackCommand;
+};
+
+//---------------------------------------------------------------------------
+// vtkInternal methods
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeTransformCache::vtkInternal::vtkInternal(
+    vtkSlicerDataProbeTransformCache* _external)
+{
+  this->External = _external;
+  this->CallbackCommand = vtkSmartPointer<vtkCallbackCommand>::New();
+  this->CallbackCommand->SetClientData(_external);
+  this->CallbackCommand->SetCallback(vtkSlicerDataProbeTransformCache::ProcessTransformEvents);
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeTransformCache::vtkInternal::~vtkInternal()
+{
+  for (MappingListType::iterator it = this->Mappings.begin(); it != this->Mappings.end(); ++it)
+    {
+    this->ReleaseMapping(*it);
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeTransformCache::vtkInternal::Observe(Mapping& mapping, vtkObject* object)
+{
+  unsigned long tag = object->AddObserver(
+    vtkMRMLTransformableNode::TransformModifiedEvent, this->CallbackCommand);
+  mapping.Observations.push_back(ObservationType(object, tag));
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeTransformCache::vtkInternal::ReleaseMapping(Mapping& mapping)
+{
+  for (size_t observationIdx = 0; observationIdx < mapping.Observations.size(); ++observationIdx)
+    {
+    vtkObject* object = mapping.Observations[observationIdx].first;
+    if (object)
+      {
+      object->RemoveObserver(mapping.Observations[observationIdx].second);
+      }
+    }
+  mapping.Observations.clear();
+}
+
+//---------------------------------------------------------------------------
+vtkSlicerDataProbeTransformCache::vtkInternal::Mapping*
+vtkSlicerDataProbeTransformCache::vtkInternal::GetMapping(vtkMRMLVolumeNode* volumeNode)
+{
+  Mapping* found = 0;
+  MappingListType::iterator it = this->Mappings.begin();
+  while (it != this->Mappings.end())
+    {
+    if (it->VolumeNode.GetPointer() == 0 ||
+        (it->VolumeNode.GetPointer() == volumeNode && it->VolumeMTime != volumeNode->GetMTime()))
+      {
+      this->ReleaseMapping(*it);
+      it = this->Mappings.erase(it);
+      continue;
+      }
+    if (it->VolumeNode.GetPointer() == volumeNode)
+      {
+      found = &(*it);
+      }
+    ++it;
+    }
+  if (found)
+    {
+    return found;
+    }
+  this->Mappings.push_back(Mapping());
+  Mapping& mapping = this->Mappings.back();
+  mapping.VolumeNode = volumeNode;
+  mapping.VolumeMTime = volumeNode->GetMTime();
+  this->BuildMapping(mapping);
+  return &mapping;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeTransformCache::vtkInternal::BuildMapping(Mapping& mapping)
+{
+  vtkMRMLVolumeNode* volumeNode = mapping.VolumeNode;
+
+  this->Observe(mapping, volumeNode);
+  for (vtkMRMLTransformNode* transformNode = volumeNode->GetParentTransformNode();
+       transformNode; transformNode = transformNode->GetParentTransformNode())
+    {
+    this->Observe(mapping, transformNode);
+    }
+
+  vtkNew<vtkMatrix4x4> rasToIJK;
+  volumeNode->GetRASToIJKMatrix(rasToIJK.GetPointer());
+  mapping.ToIJK = vtkSmartPointer<vtkMatrix4x4>::New();
+  mapping.ToIJK->DeepCopy(rasToIJK.GetPointer());
+  mapping.Linear = true;
+
+  vtkMRMLTransformNode* parentTransformNode = volumeNode->GetParentTransformNode();
+  if (!parentTransformNode || parentTransformNode->IsTransformToWorldLinear())
+    {
+    if (parentTransformNode)
+      {
+      // Flatten the whole chain into a single matrix
+      vtkNew<vtkMatrix4x4> worldToLocal;
+      parentTransformNode->GetMatrixTransformToWorld(worldToLocal.GetPointer());
+      worldToLocal->Invert();
+      vtkMatrix4x4::Multiply4x4(rasToIJK.GetPointer(), worldToLocal.GetPointer(), mapping.ToIJK);
+      }
+    mapping.FromIJK = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkMatrix4x4::Invert(mapping.ToIJK, mapping.FromIJK);
+    return;
+    }
+
+  mapping.Linear = false;
+  vtkSmartPointer<vtkGeneralTransform> localToWorld = vtkSmartPointer<vtkGeneralTransform>::New();
+  parentTransformNode->GetTransformToWorld(localToWorld);
+  mapping.WorldToLocal = vtkSmartPointer<vtkGeneralTransform>::New();
+  mapping.WorldToLocal->Concatenate(localToWorld);
+  mapping.WorldToLocal->Inverse();
+  mapping.WorldToLocal->Update();
+
+  this->BuildDisplacementGrid(mapping);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerDataProbeTransformCache::vtkInternal::BuildDisplacementGrid(Mapping& mapping)
+{
+  mapping.GridDisplacements.clear();
+  vtkImageData* imageData = mapping.VolumeNode->GetImageData();
+  if (!imageData)
+    {
+    return;
+    }
+  int dims[3] = {0, 0, 0};
+  imageData->GetDimensions(dims);
+
+  // World bounding box of the volume corners mapped by the forward transform
+  vtkNew<vtkMatrix4x4> ijkToRAS;
+  mapping.VolumeNode->GetIJKToRASMatrix(ijkToRAS.GetPointer());
+  vtkAbstractTransform* localToWorld = mapping.WorldToLocal->GetInverse();
+  double bounds[6] = {VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX,
+                      VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX,
+                      VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX};
+  for (int corner = 0; corner < 8; ++corner)
+    {
+    double ijk[4] = {(corner & 1) ? dims[0] - 0.5 : -0.5,
+                     (corner & 2) ? dims[1] - 0.5 : -0.5,
+                     (corner & 4) ? dims[2] - 0.5 : -0.5,
+                     1.0};
+    double local[4] = {0.0, 0.0, 0.0, 1.0};
+    ijkToRAS->MultiplyPoint(ijk, local);
+    double world[3] = {0.0, 0.0, 0.0};
+    localToWorld->TransformPoint(local, world);
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      bounds[2 * axis] = std::min(bounds[2 * axis], world[axis]);
+      bounds[2 * axis + 1] = std::max(bounds[2 * axis + 1], world[axis]);
+      }
+    }
+
+  int gridSize = this->External->DisplacementGridSize;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    double margin = 0.1 * (bounds[2 * axis + 1] - bounds[2 * axis]);
+    bounds[2 * axis] -= margin;
+    bounds[2 * axis + 1] += margin;
+    mapping.GridDimensions[axis] = gridSize;
+    mapping.GridOrigin[axis] = bounds[2 * axis];
+    mapping.GridSpacing[axis] = (bounds[2 * axis + 1] - bounds[2 * axis]) / (gridSize - 1);
+    if (mapping.GridSpacing[axis] <= 0.0)
+      {
+      mapping.GridSpacing[axis] = 1.0;
+      }
+    }
+
+  mapping.GridDisplacements.resize(3 * static_cast<size_t>(gridSize) * gridSize * gridSize);
+  float* displacement = &mapping.GridDisplacements[0];
+  for (int k = 0; k < gridSize; ++k)
+    {
+    for (int j = 0; j < gridSize; ++j)
+      {
+      for (int i = 0; i < gridSize; ++i)
+        {
+        double world[3] = {mapping.GridOrigin[0] + i * mapping.GridSpacing[0],
+                           mapping.GridOrigin[1] + j * mapping.GridSpacing[1],
+                           mapping.GridOrigin[2] + k * mapping.GridSpacing[2]};
+        double local[3] = {0.0, 0.0, 0.0};
+        mapping.WorldToLocal->TransformPoint(world, local);
+        *(displacement++) = static_cast<float>(local[0] - world[0]);
+        *(displacement++) = static_cast<float>(local[1] - world[1]);
+        *(displacement++) = static_cast<float>(local[2] - world[2]);
+        }
+      }
+    }
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerDataProbeTransformCache::vtkInternal::InterpolateDisplacement(
+  const Mapping& mapping, const double ras[3], double displacement[3])const
+{
+  if (mapping.GridDisplacements.empty())
+    {
+    return false;
+    }
+  int base[3] = {0, 0, 0};
+  double fraction[3] = {0.0, 0.0, 0.0};
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    double position = (ras[axis] - mapping.GridOrigin[axis]) / mapping.GridSpacing[axis];
+    if (position < 0.0 || position > mapping.GridDimensions[axis] - 1)
+      {
+      return false;
+      }
+    base[axis] = std::min(static_cast<int>(position), mapping.GridDimensions[axis] - 2);
+    fraction[axis] = position - base[axis];
+    }
+  const vtkIdType increments[3] = {
+    3,
+    3 * static_cast<vtkIdType>(mapping.GridDimensions[0]),
+    3 * static_cast<vtkIdType>(mapping.GridDimensions[0]) * mapping.GridDimensions[1]};
+  const float* origin = &mapping.GridDisplacements[
+    base[0] * increments[0] + base[1] * increments[1] + base[2] * increments[2]];
+
+  displacement[0] = displacement[1] = displacement[2] = 0.0;
+  for (int corner = 0; corner < 8; ++corner)
+    {
+    int di = corner & 1;
+    int dj = (corner >> 1) & 1;
+    int dk = (corner >> 2) & 1;
+    double weight = (di ? fraction[0] : 1.0 - fraction[0])
+                  * (dj ? fraction[1] : 1.0 - fraction[1])
+                  * (dk ? fraction[2] : 1.0 - fraction[2]);
+    const float* sample = origin + di * increments[0] + dj * increments[1] + dk * increments[2];
+    displacement[0] += weight * sample[0];
+    displacement[1] += weight * sample[1];
+    displacement[2] += weight * sample[2];
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// vtkSlicerDataProbeTransformCache methods
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerDataProbeTransformCache);
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeTransformCache::vtkSlicerDataProbeTransformCache()
+{
+  this->DisplacementGridSize = 32;
+  this->Internal = new vtkInternal(this);
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeTransformCache::~vtkSlicerDataProbeTransformCache()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeTransformCache::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "DisplacementGridSize: " << this->DisplacementGridSize << "\n";
+  os << indent << "NumberOfMappings: " << this->Internal->Mappings.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeTransformCache::IsTransformedNonLinearly(vtkMRMLVolumeNode* volumeNode)
+{
+  vtkMRMLTransformNode* parentTransformNode =
+    volumeNode ? volumeNode->GetParentTransformNode() : 0;
+  return parentTransformNode && !parentTransformNode->IsTransformToWorldLinear();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeTransformCache::TransformRASToIJK(
+  vtkMRMLVolumeNode* volumeNode, const double ras[3], double ijk[3])
+{
+  if (!volumeNode)
+    {
+    return false;
+    }
+  vtkInternal::Mapping* mapping = this->Internal->GetMapping(volumeNode);
+
+  double position[4] = {ras[0], ras[1], ras[2], 1.0};
+  if (!mapping->Linear)
+    {
+    double displacement[3] = {0.0, 0.0, 0.0};
+    if (this->Internal->InterpolateDisplacement(*mapping, ras, displacement))
+      {
+      position[0] += displacement[0];
+      position[1] += displacement[1];
+      position[2] += displacement[2];
+      }
+    else
+      {
+      mapping->WorldToLocal->TransformPoint(ras, position);
+      }
+    }
+  double ijkw[4] = {0.0, 0.0, 0.0, 1.0};
+  mapping->ToIJK->MultiplyPoint(position, ijkw);
+  ijk[0] = ijkw[0];
+  ijk[1] = ijkw[1];
+  ijk[2] = ijkw[2];
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeTransformCache::GetRASToIJKMatrix(
+  vtkMRMLVolumeNode* volumeNode, vtkMatrix4x4* rasToIJK)
+{
+  if (!volumeNode || !rasToIJK)
+    {
+    return false;
+    }
+  vtkInternal::Mapping* mapping = this->Internal->GetMapping(volumeNode);
+  if (!mapping->Linear)
+    {
+    return false;
+    }
+  rasToIJK->DeepCopy(mapping->ToIJK);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeTransformCache::GetIJKToIJKMatrix(
+  vtkMRMLVolumeNode* fromVolumeNode, vtkMRMLVolumeNode* toVolumeNode, vtkMatrix4x4* ijkToIJK)
+{
+  if (!fromVolumeNode || !toVolumeNode || !ijkToIJK)
+    {
+    return false;
+    }
+  vtkInternal::Mapping* fromMapping = this->Internal->GetMapping(fromVolumeNode);
+  vtkInternal::Mapping* toMapping = this->Internal->GetMapping(toVolumeNode);
+  if (!fromMapping->Linear || !toMapping->Linear)
+    {
+    return false;
+    }
+  vtkMatrix4x4::Multiply4x4(toMapping->ToIJK, fromMapping->FromIJK, ijkToIJK);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeTransformCache::RemoveVolumeNode(vtkMRMLVolumeNode* volumeNode)
+{
+  vtkInternal::MappingListType::iterator it = this->Internal->Mappings.begin();
+  while (it != this->Internal->Mappings.end())
+    {
+    if (it->VolumeNode.GetPointer() == volumeNode || it->VolumeNode.GetPointer() == 0)
+      {
+      this->Internal->ReleaseMapping(*it);
+      it = this->Internal->Mappings.erase(it);
+      }
+    else
+      {
+      ++it;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeTransformCache::RemoveAll()
+{
+  for (vtkInternal::MappingListType::iterator it = this->Internal->Mappings.begin();
+       it != this->Internal->Mappings.end(); ++it)
+    {
+    this->Internal->ReleaseMapping(*it);
+    }
+  this->Internal->Mappings.clear();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeTransformCache::ProcessTransformEvents(
+  vtkObject* caller, unsigned long vtkNotUsed(eid), void* clientData, void* vtkNotUsed(callData))
+{
+  vtkSlicerDataProbeTransformCache* self =
+    reinterpret_cast<vtkSlicerDataProbeTransformCache*>(clientData);
+  vtkInternal::MappingListType::iterator it = self->Internal->Mappings.begin();
+  while (it != self->Internal->Mappings.end())
+    {
+    bool observed = false;
+    for (size_t observationIdx = 0; observationIdx < it->Observations.size(); ++observationIdx)
+      {
+      if (it->Observations[observationIdx].first.GetPointer() == caller)
+        {
+        observed = true;
+        break;
+        }
+      }
+    if (observed)
+      {
+      self->Internal->ReleaseMapping(*it);
+      it = self->Internal->Mappings.erase(it);
+      }
+    else
+      {
+      ++it;
+      }
+    }
+}
@@ -0,0 +1,95 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerDataProbeTransformCache_h
+#define __vtkSlicerDataProbeTransformCache_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkSlicerDataProbeModuleLogicExport.h"
+
+class vtkMatrix4x4;
+class vtkMRMLVolumeNode;
+
+/// \ingroup Slicer_QtModules_DataProbe
+/// Cache of the world to IJK mappings of volumes under parent transforms.
+///
+/// The transforms above a volume are composed once and cached:
+///  - a linear chain is flattened into a single world to IJK matrix,
+///  - a non-linear chain (grid, B-spline, ...) is sampled on a regular grid
+///    covering the volume, the world position is then mapped by trilinear
+///    interpolation of the precomputed displacements. Positions outside of
+///    the grid are mapped by evaluating the inverse transform chain.
+///
+/// The cached mapping of a volume is invalidated when the volume or any
+/// transform of its chain invokes vtkMRMLTransformableNode::TransformModifiedEvent.
+class VTK_SLICER_DATAPROBE_MODULE_LOGIC_EXPORT vtkSlicerDataProbeTransformCache :
+  public vtkObject
+{
+public:
+  static vtkSlicerDataProbeTransformCache *New();
+  vtkTypeMacro(vtkSlicerDataProbeTransformCache,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Number of samples along each axis of the displacement grids used for
+  /// non-linear transforms. Default is 32.
+  vtkSetClampMacro(DisplacementGridSize, int, 2, 256);
+  vtkGetMacro(DisplacementGridSize, int);
+
+  /// Map the world position \a ras into the IJK coordinates of \a volumeNode.
+  /// Return false if the volume is invalid.
+  bool TransformRASToIJK(vtkMRMLVolumeNode* volumeNode, const double ras[3], double ijk[3]);
+
+  /// Copy the cached world to IJK matrix of \a volumeNode into \a rasToIJK.
+  /// Return false if the volume is invalid or transformed non-linearly.
+  bool GetRASToIJKMatrix(vtkMRMLVolumeNode* volumeNode, vtkMatrix4x4* rasToIJK);
+
+  /// Compose the cached mappings of \a fromVolumeNode and \a toVolumeNode
+  /// into the matrix mapping the IJK coordinates of the first volume into
+  /// the IJK coordinates of the second one.
+  /// Return false if a volume is invalid or transformed non-linearly.
+  bool GetIJKToIJKMatrix(vtkMRMLVolumeNode* fromVolumeNode, vtkMRMLVolumeNode* toVolumeNode,
+                         vtkMatrix4x4* ijkToIJK);
+
+  /// Return true if the transforms above \a volumeNode are not all linear.
+  static bool IsTransformedNonLinearly(vtkMRMLVolumeNode* volumeNode);
+
+  /// Invalidate the mapping cached for \a volumeNode.
+  void RemoveVolumeNode(vtkMRMLVolumeNode* volumeNode);
+
+  /// Invalidate all the cached mappings.
+  void RemoveAll();
+
+protected:
+  vtkSlicerDataProbeTransformCache();
+  virtual ~vtkSlicerDataProbeTransformCache();
+
+  static void ProcessTransformEvents(vtkObject* caller, unsigned long eid,
+                                     void* clientData, void* callData);
+
+  int DisplacementGridSize;
+
+private:
+  vtkSlicerDataProbeTransformCache(const vtkSlicerDataProbeTransformCache&); // Not implemented
+  void operator=(const vtkSlicerDataProbeTransformCache&);                   // Not implemented
+
+  class vtkInternal;
+  vtkInternal * Internal;
+};
+
+#endif
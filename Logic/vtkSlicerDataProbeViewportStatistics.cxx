@@ -0,0 +1,624 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "vtkSlicerDataProbeViewportStatistics.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+//----------------------------------------------------------------------------
+class vtkSlicerDataProbeViewportStatistics::vtkInternal
+{
+public:
+  vtkInternal();
+
+  /// Clear the sums, the extrema and the histogram.
+  void ResetSums(int numberOfBins);
+  /// Recompute the sums and the extrema from the buffer.
+  void Rescan();
+  /// Recompute the extrema that are no longer in the buffer.
+  void RescanExtrema();
+
+  int GetBin(double value)const;
+  /// Count \a value in the extremum if it is equal, replace it if beyond.
+  void AddToMinimum(double value);
+  void AddToMaximum(double value);
+  void Add(float value);
+  void Remove(float value);
+
+  /// Read every \a stride pixel of [x0, x1[ x [y0, y1[ of all the slices of
+  /// \a scalars into the buffer, replacing the values they scroll over.
+  template <class T>
+  void UpdateRegion(const T* scalars, int numberOfComponents, int x0, int x1, int y0, int y1, int stride);
+
+  /// Return the whole number of pixels \a xyToIJK is panned by along X and
+  /// Y since the last update, false if it changed otherwise.
+  bool GetPan(const double xyToIJK[16], int pan[2])const;
+
+  vtkWeakPointer<vtkImageData> ImageData;
+  vtkWeakPointer<vtkImageData> VolumeImage;
+  unsigned long VolumeMTime;
+  int Dimensions[3];
+  int VolumeDimensions[3];
+  bool Masked;
+  double XYToIJK[16];
+  /// Position in the buffer of the slice pixel (0, 0).
+  int Offset[2];
+  std::vector<float> Values;
+  bool Valid;
+  bool LastUpdateIncremental;
+  int SampleStride;
+  int IncrementalUpdates;
+
+  vtkIdType Count;
+  double Sum;
+  double SumOfSquares;
+  double Minimum;
+  double Maximum;
+  /// Number of pixels equal to the extrema. Once a count drops to 0, the
+  /// extremum is only a bound until RescanExtrema().
+  vtkIdType MinimumCount;
+  vtkIdType MaximumCount;
+  std::vector<vtkIdType> Histogram;
+  double Range[2];
+  double BinScale;
+};
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeViewportStatistics::vtkInternal::vtkInternal()
+{
+  this->VolumeMTime = 0;
+  this->Masked = false;
+  this->Valid = false;
+  this->LastUpdateIncremental = false;
+  this->SampleStride = 1;
+  this->IncrementalUpdates = 0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Dimensions[axis] = 0;
+    this->VolumeDimensions[axis] = 0;
+    }
+  std::fill(this->XYToIJK, this->XYToIJK + 16, 0.0);
+  this->Offset[0] = this->Offset[1] = 0;
+  this->Range[0] = 0.0;
+  this->Range[1] = 1.0;
+  this->BinScale = 1.0;
+  this->ResetSums(0);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeViewportStatistics::vtkInternal::ResetSums(int numberOfBins)
+{
+  this->Count = 0;
+  this->Sum = 0.0;
+  this->SumOfSquares = 0.0;
+  this->Minimum = VTK_DOUBLE_MAX;
+  this->Maximum = VTK_DOUBLE_MIN;
+  this->MinimumCount = 0;
+  this->MaximumCount = 0;
+  this->Histogram.assign(numberOfBins, 0);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeViewportStatistics::vtkInternal::Rescan()
+{
+  // The histogram counts are exact, only the sums and extrema are rebuilt
+  this->Count = 0;
+  this->Sum = 0.0;
+  this->SumOfSquares = 0.0;
+  for (std::vector<float>::const_iterator it = this->Values.begin(); it != this->Values.end(); ++it)
+    {
+    const double value = *it;
+    if (value != value)
+      {
+      continue;
+      }
+    ++this->Count;
+    this->Sum += value;
+    this->SumOfSquares += value * value;
+    }
+  this->MinimumCount = 0;
+  this->MaximumCount = 0;
+  this->RescanExtrema();
+  this->IncrementalUpdates = 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeViewportStatistics::vtkInternal::RescanExtrema()
+{
+  const bool minimum = this->MinimumCount == 0;
+  const bool maximum = this->MaximumCount == 0;
+  if (!minimum && !maximum)
+    {
+    return;
+    }
+  // The histogram is exact: only the values of the first and last non-empty
+  // bins can be the extrema.
+  int firstBin = 0;
+  int lastBin = static_cast<int>(this->Histogram.size()) - 1;
+  while (firstBin <= lastBin && this->Histogram[firstBin] == 0)
+    {
+    ++firstBin;
+    }
+  while (lastBin >= firstBin && this->Histogram[lastBin] == 0)
+    {
+    --lastBin;
+    }
+  if (minimum)
+    {
+    this->Minimum = VTK_DOUBLE_MAX;
+    }
+  if (maximum)
+    {
+    this->Maximum = VTK_DOUBLE_MIN;
+    }
+  if (firstBin > lastBin)
+    {
+    return;
+    }
+  for (std::vector<float>::const_iterator it = this->Values.begin(); it != this->Values.end(); ++it)
+    {
+    const double value = *it;
+    if (value != value)
+      {
+      continue;
+      }
+    const int bin = this->GetBin(value);
+    if (minimum && bin == firstBin)
+      {
+      this->AddToMinimum(value);
+      }
+    if (maximum && bin == lastBin)
+      {
+      this->AddToMaximum(value);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+inline void vtkSlicerDataProbeViewportStatistics::vtkInternal::AddToMinimum(double value)
+{
+  if (value < this->Minimum)
+    {
+    this->Minimum = value;
+    this->MinimumCount = 1;
+    }
+  else if (value == this->Minimum)
+    {
+    ++this->MinimumCount;
+    }
+}
+
+//----------------------------------------------------------------------------
+inline void vtkSlicerDataProbeViewportStatistics::vtkInternal::AddToMaximum(double value)
+{
+  if (value > this->Maximum)
+    {
+    this->Maximum = value;
+    this->MaximumCount = 1;
+    }
+  else if (value == this->Maximum)
+    {
+    ++this->MaximumCount;
+    }
+}
+
+//----------------------------------------------------------------------------
+inline int vtkSlicerDataProbeViewportStatistics::vtkInternal::GetBin(double value)const
+{
+  int bin = static_cast<int>((value - this->Range[0]) * this->BinScale);
+  return std::min(std::max(bin, 0), static_cast<int>(this->Histogram.size()) - 1);
+}
+
+//----------------------------------------------------------------------------
+inline void vtkSlicerDataProbeViewportStatistics::vtkInternal::Add(float value)
+{
+  // NaN marks the pixels outside of the volume
+  if (value != value)
+    {
+    return;
+    }
+  const double doubleValue = value;
+  ++this->Count;
+  this->Sum += doubleValue;
+  this->SumOfSquares += doubleValue * doubleValue;
+  this->AddToMinimum(doubleValue);
+  this->AddToMaximum(doubleValue);
+  ++this->Histogram[this->GetBin(doubleValue)];
+}
+
+//----------------------------------------------------------------------------
+inline void vtkSlicerDataProbeViewportStatistics::vtkInternal::Remove(float value)
+{
+  if (value != value)
+    {
+    return;
+    }
+  const double doubleValue = value;
+  --this->Count;
+  this->Sum -= doubleValue;
+  this->SumOfSquares -= doubleValue * doubleValue;
+  // The buffer holds no value beyond the extrema
+  if (doubleValue == this->Minimum && this->MinimumCount > 0)
+    {
+    --this->MinimumCount;
+    }
+  if (doubleValue == this->Maximum && this->MaximumCount > 0)
+    {
+    --this->MaximumCount;
+    }
+  --this->Histogram[this->GetBin(doubleValue)];
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void vtkSlicerDataProbeViewportStatistics::vtkInternal::UpdateRegion(
+  const T* scalars, int numberOfComponents, int x0, int x1, int y0, int y1, int stride)
+{
+  const int* dims = this->Dimensions;
+  const double* m = this->XYToIJK;
+  const float nan = static_cast<float>(vtkMath::Nan());
+  for (int z = 0; z < dims[2]; ++z)
+    {
+    const vtkIdType sliceOffset = static_cast<vtkIdType>(z) * dims[0] * dims[1];
+    for (int y = y0; y < y1; y += stride)
+      {
+      const int bufferY = (y + this->Offset[1]) % dims[1];
+      const T* pixel = scalars + (sliceOffset + static_cast<vtkIdType>(y) * dims[0] + x0) * numberOfComponents;
+      float* bufferRow = &this->Values[sliceOffset + static_cast<vtkIdType>(bufferY) * dims[0]];
+      // IJK of the first pixel of the row, then stepped along X
+      double ijk[3];
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        ijk[axis] = m[4 * axis] * x0 + m[4 * axis + 1] * y + m[4 * axis + 2] * z + m[4 * axis + 3];
+        }
+      int bufferX = (x0 + this->Offset[0]) % dims[0];
+      for (int x = x0; x < x1; x += stride, pixel += stride * numberOfComponents)
+        {
+        bool inside = true;
+        if (this->Masked)
+          {
+          for (int axis = 0; axis < 3; ++axis)
+            {
+            inside = inside && ijk[axis] >= -0.5 && ijk[axis] <= this->VolumeDimensions[axis] - 0.5;
+            ijk[axis] += stride * m[4 * axis];
+            }
+          }
+        float& bufferValue = bufferRow[bufferX];
+        this->Remove(bufferValue);
+        bufferValue = inside ? static_cast<float>(*pixel) : nan;
+        this->Add(bufferValue);
+        bufferX += stride;
+        if (bufferX >= dims[0])
+          {
+          bufferX -= dims[0];
+          }
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeViewportStatistics::vtkInternal::GetPan(const double xyToIJK[16], int pan[2])const
+{
+  // Same orientation and spacing
+  double scale = 0.0;
+  for (int row = 0; row < 3; ++row)
+    {
+    for (int column = 0; column < 3; ++column)
+      {
+      scale = std::max(scale, fabs(xyToIJK[4 * row + column]));
+      }
+    }
+  const double tolerance = 1e-9 * std::max(scale, 1.0);
+  for (int row = 0; row < 4; ++row)
+    {
+    for (int column = 0; column < 4; ++column)
+      {
+      if (column != 3 && fabs(xyToIJK[4 * row + column] - this->XYToIJK[4 * row + column]) > tolerance)
+        {
+        return false;
+        }
+      }
+    }
+
+  // The translation moved by A * (dx, dy, 0) with whole dx and dy
+  double a[3][3];
+  double inverse[3][3];
+  double delta[3];
+  for (int row = 0; row < 3; ++row)
+    {
+    for (int column = 0; column < 3; ++column)
+      {
+      a[row][column] = xyToIJK[4 * row + column];
+      }
+    delta[row] = xyToIJK[4 * row + 3] - this->XYToIJK[4 * row + 3];
+    }
+  if (vtkMath::Determinant3x3(a) == 0.0)
+    {
+    return false;
+    }
+  vtkMath::Invert3x3(a, inverse);
+  double shift[3];
+  vtkMath::Multiply3x3(inverse, delta, shift);
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    const double expected = axis < 2 ? vtkMath::Round(shift[axis]) : 0.0;
+    if (fabs(shift[axis] - expected) > 1e-3)
+      {
+      return false;
+      }
+    if (axis < 2)
+      {
+      pan[axis] = static_cast<int>(expected);
+      }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerDataProbeViewportStatistics);
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeViewportStatistics::vtkSlicerDataProbeViewportStatistics()
+{
+  this->NumberOfBins = 128;
+  this->Internal = new vtkInternal;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerDataProbeViewportStatistics::~vtkSlicerDataProbeViewportStatistics()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeViewportStatistics::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfBins: " << this->NumberOfBins << "\n";
+  os << indent << "NumberOfVoxels: " << this->GetNumberOfVoxels() << "\n";
+  os << indent << "Mean: " << this->GetMean() << "\n";
+  os << indent << "StandardDeviation: " << this->GetStandardDeviation() << "\n";
+  os << indent << "Minimum: " << this->GetMinimum() << "\n";
+  os << indent << "Maximum: " << this->GetMaximum() << "\n";
+  os << indent << "LastUpdateIncremental: " << this->GetLastUpdateIncremental() << "\n";
+  os << indent << "SampleStride: " << this->GetSampleStride() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeViewportStatistics::Reset()
+{
+  this->Internal->ImageData = 0;
+  this->Internal->VolumeImage = 0;
+  this->Internal->Valid = false;
+  this->Internal->LastUpdateIncremental = false;
+  std::vector<float>().swap(this->Internal->Values);
+  this->Internal->ResetSums(0);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeViewportStatistics::Update(vtkImageData* sliceImage, vtkMatrix4x4* xyToIJK,
+                                                  vtkImageData* volumeImage, int sampleStride)
+{
+  sampleStride = std::max(sampleStride, 1);
+  vtkDataArray* scalars = sliceImage ? sliceImage->GetPointData()->GetScalars() : 0;
+  if (!scalars || scalars->GetNumberOfTuples() == 0)
+    {
+    this->Reset();
+    return false;
+    }
+  vtkInternal* internal = this->Internal;
+
+  int dims[3] = {0, 0, 0};
+  sliceImage->GetDimensions(dims);
+  int volumeDims[3] = {0, 0, 0};
+  double range[2] = {0.0, 1.0};
+  unsigned long volumeMTime = 0;
+  vtkDataArray* volumeScalars = volumeImage ? volumeImage->GetPointData()->GetScalars() : 0;
+  if (volumeScalars)
+    {
+    volumeImage->GetDimensions(volumeDims);
+    volumeScalars->GetRange(range, 0);
+    volumeMTime = std::max(volumeImage->GetMTime(), volumeScalars->GetMTime());
+    }
+  else
+    {
+    scalars->GetRange(range, 0);
+    }
+  if (range[1] <= range[0])
+    {
+    range[0] -= 0.5;
+    range[1] += 0.5;
+    }
+  double matrix[16];
+  std::fill(matrix, matrix + 16, 0.0);
+  if (xyToIJK)
+    {
+    vtkMatrix4x4::DeepCopy(matrix, xyToIJK);
+    }
+
+  // Pan of the same slice of the same volume
+  int pan[2] = {0, 0};
+  bool incremental = internal->Valid && internal->ImageData.GetPointer() == sliceImage &&
+    internal->Masked && xyToIJK && volumeScalars && dims[2] == 1 &&
+    internal->VolumeImage.GetPointer() == volumeImage && internal->VolumeMTime == volumeMTime &&
+    internal->Range[0] == range[0] && internal->Range[1] == range[1] &&
+    static_cast<int>(internal->Histogram.size()) == this->NumberOfBins &&
+    static_cast<vtkIdType>(internal->Values.size()) == scalars->GetNumberOfTuples();
+  for (int axis = 0; axis < 3 && incremental; ++axis)
+    {
+    incremental = internal->Dimensions[axis] == dims[axis] && internal->VolumeDimensions[axis] == volumeDims[axis];
+    }
+  incremental = incremental && internal->GetPan(matrix, pan) &&
+    abs(pan[0]) < dims[0] && abs(pan[1]) < dims[1];
+
+  internal->ImageData = sliceImage;
+  internal->VolumeImage = volumeImage;
+  internal->VolumeMTime = volumeMTime;
+  std::copy(dims, dims + 3, internal->Dimensions);
+  std::copy(volumeDims, volumeDims + 3, internal->VolumeDimensions);
+  internal->Masked = xyToIJK && volumeScalars;
+  std::copy(matrix, matrix + 16, internal->XYToIJK);
+  // The strips of a pan are few pixels, they are read exactly: only the
+  // full updates are subsampled
+  if (incremental)
+    {
+    sampleStride = 1;
+    }
+  internal->LastUpdateIncremental = incremental;
+  internal->SampleStride = sampleStride;
+  // The buffer of a subsampled update can't be panned, the pixels in
+  // between were not read
+  internal->Valid = sampleStride == 1;
+
+  // Strips to read, all the slice if not incremental
+  int regions[2][4] = {{0, dims[0], 0, dims[1]}, {0, 0, 0, 0}};
+  if (incremental)
+    {
+    // The slice pixel (x, y) is the former pixel (x + dx, y + dy)
+    internal->Offset[0] = (internal->Offset[0] + pan[0] % dims[0] + dims[0]) % dims[0];
+    internal->Offset[1] = (internal->Offset[1] + pan[1] % dims[1] + dims[1]) % dims[1];
+    // Columns scrolling in, then the rows scrolling in but these columns
+    const int columns[2] = {pan[0] > 0 ? dims[0] - pan[0] : 0, pan[0] > 0 ? dims[0] : -pan[0]};
+    const int otherColumns[2] = {pan[0] > 0 ? 0 : -pan[0], pan[0] > 0 ? dims[0] - pan[0] : dims[0]};
+    const int rows[2] = {pan[1] > 0 ? dims[1] - pan[1] : 0, pan[1] > 0 ? dims[1] : -pan[1]};
+    const int columnRegion[4] = {columns[0], columns[1], 0, dims[1]};
+    const int rowRegion[4] = {otherColumns[0], otherColumns[1], rows[0], rows[1]};
+    std::copy(columnRegion, columnRegion + 4, regions[0]);
+    std::copy(rowRegion, rowRegion + 4, regions[1]);
+    }
+  else
+    {
+    internal->Offset[0] = internal->Offset[1] = 0;
+    internal->Values.assign(scalars->GetNumberOfTuples(), static_cast<float>(vtkMath::Nan()));
+    internal->Range[0] = range[0];
+    internal->Range[1] = range[1];
+    internal->BinScale = this->NumberOfBins / (range[1] - range[0]);
+    internal->ResetSums(this->NumberOfBins);
+    internal->IncrementalUpdates = 0;
+    }
+
+  const int numberOfComponents = scalars->GetNumberOfComponents();
+  void* scalarPointer = scalars->GetVoidPointer(0);
+  for (int regionIdx = 0; regionIdx < 2; ++regionIdx)
+    {
+    const int* region = regions[regionIdx];
+    if (region[0] >= region[1] || region[2] >= region[3])
+      {
+      continue;
+      }
+    switch (scalars->GetDataType())
+      {
+      vtkTemplateMacro(internal->UpdateRegion(static_cast<const VTK_TT*>(scalarPointer), numberOfComponents,
+                                              region[0], region[1], region[2], region[3], sampleStride));
+      default:
+        vtkErrorMacro(<< "Update: unsupported scalar type " << scalars->GetDataTypeAsString());
+        this->Reset();
+        return false;
+      }
+    }
+
+  if (incremental && ++internal->IncrementalUpdates >= 256)
+    {
+    internal->Rescan();
+    }
+  else
+    {
+    internal->RescanExtrema();
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkSlicerDataProbeViewportStatistics::GetImageData()const
+{
+  return this->Internal->ImageData;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerDataProbeViewportStatistics::GetLastUpdateIncremental()const
+{
+  return this->Internal->LastUpdateIncremental;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerDataProbeViewportStatistics::GetSampleStride()const
+{
+  return this->Internal->SampleStride;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkSlicerDataProbeViewportStatistics::GetNumberOfVoxels()const
+{
+  return this->Internal->Count;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDataProbeViewportStatistics::GetMean()const
+{
+  return this->Internal->Count > 0 ? this->Internal->Sum / this->Internal->Count : vtkMath::Nan();
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDataProbeViewportStatistics::GetStandardDeviation()const
+{
+  if (this->Internal->Count <= 0)
+    {
+    return vtkMath::Nan();
+    }
+  const double mean = this->Internal->Sum / this->Internal->Count;
+  return sqrt(std::max(this->Internal->SumOfSquares / this->Internal->Count - mean * mean, 0.0));
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDataProbeViewportStatistics::GetMinimum()const
+{
+  return this->Internal->Count > 0 ? this->Internal->Minimum : vtkMath::Nan();
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerDataProbeViewportStatistics::GetMaximum()const
+{
+  return this->Internal->Count > 0 ? this->Internal->Maximum : vtkMath::Nan();
+}
+
+//----------------------------------------------------------------------------
+const vtkIdType* vtkSlicerDataProbeViewportStatistics::GetHistogram()const
+{
+  return this->Internal->Histogram.empty() ? 0 : &this->Internal->Histogram[0];
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerDataProbeViewportStatistics::GetHistogramRange(double range[2])const
+{
+  range[0] = this->Internal->Range[0];
+  range[1] = this->Internal->Range[1];
+}
@@ -0,0 +1,112 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerDataProbeViewportStatistics_h
+#define __vtkSlicerDataProbeViewportStatistics_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkSlicerDataProbeModuleLogicExport.h"
+
+class vtkImageData;
+class vtkMatrix4x4;
+
+/// \ingroup Slicer_QtModules_DataProbe
+/// Statistics of the first scalar component of a resliced slice image:
+/// number of voxels, mean, standard deviation, extrema and histogram.
+///
+/// Only the pixels mapped within the volume are counted. The values are kept
+/// in a buffer addressed modulo the slice dimensions: when the slice is
+/// panned by a whole number of pixels, the strips scrolling in take the
+/// place of the strips scrolling out, so that only those are read from the
+/// slice image and added to, or removed from, the sums and the histogram.
+/// The number of pixels equal to each extremum is counted: an extremum is
+/// only looked up again, among the pixels of the first or last non-empty
+/// histogram bin, once all of them scrolled out. The sums are recomputed
+/// from the buffer every 256 incremental updates so that the rounding
+/// errors do not accumulate.
+/// \sa vtkSlicerDataProbeLogic::ProbeViewportStatistics
+class VTK_SLICER_DATAPROBE_MODULE_LOGIC_EXPORT vtkSlicerDataProbeViewportStatistics :
+  public vtkObject
+{
+public:
+  static vtkSlicerDataProbeViewportStatistics *New();
+  vtkTypeMacro(vtkSlicerDataProbeViewportStatistics,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Number of bins of the histogram, spanning the scalar range of the
+  /// volume.
+  /// Default is 128.
+  vtkSetClampMacro(NumberOfBins, int, 1, 65536);
+  vtkGetMacro(NumberOfBins, int);
+
+  /// Update the statistics of \a sliceImage, resliced from \a volumeImage
+  /// with the slice XY to volume IJK matrix \a xyToIJK. The update is
+  /// incremental if only the translation of \a xyToIJK changed by a whole
+  /// number of pixels along X and Y since the last update of the same
+  /// slice image. Return false if the slice image has no scalars.
+  /// If \a sampleStride is greater than 1 and the update is not
+  /// incremental, only every \a sampleStride pixel along X and Y is read,
+  /// for an approximate result: the statistics and the histogram are then
+  /// those of the sampled pixels, and the next update is not incremental.
+  /// Incremental updates are always exact.
+  bool Update(vtkImageData* sliceImage, vtkMatrix4x4* xyToIJK, vtkImageData* volumeImage,
+              int sampleStride = 1);
+
+  /// Return the slice image of the last update, if it still exists.
+  vtkImageData* GetImageData()const;
+
+  /// Return true if the last update was incremental.
+  bool GetLastUpdateIncremental()const;
+
+  /// Return the sample stride of the last update, 1 if it is exact.
+  int GetSampleStride()const;
+
+  /// Number of pixels of the slice within the volume.
+  vtkIdType GetNumberOfVoxels()const;
+
+  /// Statistics of the pixels within the volume, vtkMath::Nan() if there is
+  /// none.
+  double GetMean()const;
+  double GetStandardDeviation()const;
+  double GetMinimum()const;
+  double GetMaximum()const;
+
+  /// Return the NumberOfBins counts of the histogram.
+  const vtkIdType* GetHistogram()const;
+  /// Range of values covered by the histogram.
+  void GetHistogramRange(double range[2])const;
+
+  /// Release the buffer and clear the statistics.
+  void Reset();
+
+protected:
+  vtkSlicerDataProbeViewportStatistics();
+  virtual ~vtkSlicerDataProbeViewportStatistics();
+
+  int NumberOfBins;
+
+private:
+  vtkSlicerDataProbeViewportStatistics(const vtkSlicerDataProbeViewportStatistics&); // Not implemented
+  void operator=(const vtkSlicerDataProbeViewportStatistics&);                       // Not implemented
+
+  class vtkInternal;
+  vtkInternal * Internal;
+};
+
+#endif
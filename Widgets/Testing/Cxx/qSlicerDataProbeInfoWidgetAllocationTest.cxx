@@ -0,0 +1,101 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// DataProbe includes
+#include "qSlicerDataProbeInfoWidgetReplay.h"
+
+// VTK includes
+#include <vtkMultiThreader.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+//-----------------------------------------------------------------------------
+// Allocation counting
+//
+// The global operators are replaced to count the allocations done by the
+// thread replaying the events while the counting is enabled. Allocations
+// done by the background computations of the logic are not counted.
+// The replacement applies to the whole executable, this test is therefore
+// built into its own test driver.
+namespace
+{
+bool CountAllocations = false;
+vtkMultiThreaderIDType CountedThreadId;
+unsigned long NumberOfAllocations = 0;
+
+void* AllocateCounted(size_t size)
+{
+  if (CountAllocations &&
+      vtkMultiThreader::ThreadsEqual(vtkMultiThreader::GetCurrentThreadID(), CountedThreadId))
+    {
+    ++NumberOfAllocations;
+    }
+  void* memory = malloc(size ? size : 1);
+  if (!memory)
+    {
+    throw std::bad_alloc();
+    }
+  return memory;
+}
+
+void CountMeasuredPassAllocations(bool measuring)
+{
+  if (measuring)
+    {
+    CountedThreadId = vtkMultiThreader::GetCurrentThreadID();
+    NumberOfAllocations = 0;
+    }
+  CountAllocations = measuring;
+}
+}
+
+void* operator new(size_t size)
+{
+  return AllocateCounted(size);
+}
+
+void* operator new[](size_t size)
+{
+  return AllocateCounted(size);
+}
+
+void operator delete(void* memory)
+{
+  free(memory);
+}
+
+void operator delete[](void* memory)
+{
+  free(memory);
+}
+
+//-----------------------------------------------------------------------------
+/// Replay the events of qSlicerDataProbeInfoWidgetTest and report the number
+/// of allocations of the measured pass.
+int qSlicerDataProbeInfoWidgetAllocationTest(int argc, char * argv [] )
+{
+  int result = qSlicerDataProbeInfoWidgetReplay(argc, argv, CountMeasuredPassAllocations);
+  if (result != EXIT_SUCCESS)
+    {
+    return result;
+    }
+  std::cout << "DataProbeReplay Allocations total: " << NumberOfAllocations << std::endl;
+  return EXIT_SUCCESS;
+}
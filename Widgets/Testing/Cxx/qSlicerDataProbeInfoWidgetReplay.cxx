@@ -0,0 +1,439 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QApplication>
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+#include <QWidget>
+
+// SlicerQt includes
+#include <qSlicerLayoutManager.h>
+
+// DataProbe includes
+#include "qSlicerDataProbeInfoWidget.h"
+#include "qSlicerDataProbeInfoWidgetReplay.h"
+#include "vtkSlicerDataProbeEventTrace.h"
+#include "vtkSlicerDataProbeLogic.h"
+
+// MRMLWidgets includes
+#include <qMRMLSliceView.h>
+#include <qMRMLSliceWidget.h>
+#include <qMRMLThreeDView.h>
+#include <qMRMLThreeDWidget.h>
+
+// MRML includes
+#include <vtkMRMLColorTableNode.h>
+#include <vtkMRMLDiffusionTensorDisplayPropertiesNode.h>
+#include <vtkMRMLDiffusionTensorVolumeDisplayNode.h>
+#include <vtkMRMLDiffusionTensorVolumeNode.h>
+#include <vtkMRMLLabelMapVolumeDisplayNode.h>
+#include <vtkMRMLLayoutNode.h>
+#include <vtkMRMLScalarVolumeDisplayNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLSliceCompositeNode.h>
+#include <vtkMRMLVectorVolumeDisplayNode.h>
+#include <vtkMRMLVectorVolumeNode.h>
+#include <vtkMRMLViewNode.h>
+
+// VTK includes
+#include <vtkCollection.h>
+#include <vtkCommand.h>
+#include <vtkFloatArray.h>
+#include <vtkImageData.h>
+#include <vtkInteractorObserver.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkRenderWindowInteractor.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+/// Linear congruential generator, so that the synthetic stream does not
+/// depend on the platform random number generator.
+unsigned int NextRandom(unsigned int& state)
+{
+  state = state * 1664525u + 1013904223u;
+  return state >> 8;
+}
+
+//-----------------------------------------------------------------------------
+/// Append to \a trace, for each view of \a viewNames, an Enter event at its
+/// center, \a numberOfMoves mouse moves wandering in the view and a Leave
+/// event. The events are 10 ms apart.
+void SyntheticEvents(const QStringList& viewNames, int numberOfMoves, int width, int height,
+                     unsigned int sceneFingerprint, vtkSlicerDataProbeEventTrace* trace)
+{
+  unsigned int state = 20120725u;
+  foreach(const QString& viewName, viewNames)
+    {
+    QByteArray name = viewName.toLatin1();
+    int xy[2] = {width / 2, height / 2};
+    trace->AddEvent(name.constData(), vtkSlicerDataProbeEventTrace::EnterEvent, xy,
+                    0.01 * trace->GetNumberOfEvents(), sceneFingerprint);
+    for (int moveIdx = 0; moveIdx < numberOfMoves; ++moveIdx)
+      {
+      // Small steps, with an occasional jump across the view
+      if (NextRandom(state) % 64 == 0)
+        {
+        xy[0] = NextRandom(state) % width;
+        xy[1] = NextRandom(state) % height;
+        }
+      else
+        {
+        xy[0] = std::min(std::max(xy[0] + static_cast<int>(NextRandom(state) % 9) - 4, 0), width - 1);
+        xy[1] = std::min(std::max(xy[1] + static_cast<int>(NextRandom(state) % 9) - 4, 0), height - 1);
+        }
+      trace->AddEvent(name.constData(), vtkSlicerDataProbeEventTrace::MouseMoveEvent, xy,
+                      0.01 * trace->GetNumberOfEvents(), sceneFingerprint);
+      }
+    trace->AddEvent(name.constData(), vtkSlicerDataProbeEventTrace::LeaveEvent, xy,
+                    0.01 * trace->GetNumberOfEvents(), sceneFingerprint);
+    }
+}
+
+//-----------------------------------------------------------------------------
+/// Read a recorded stream, one "<view> <Enter|MouseMove|Leave> <x> <y>" event
+/// per line, the view being an index in \a viewNames.
+bool ReadEvents(const QString& fileName, const QStringList& viewNames,
+                unsigned int sceneFingerprint, vtkSlicerDataProbeEventTrace* trace)
+{
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+    return false;
+    }
+  QTextStream stream(&file);
+  while (!stream.atEnd())
+    {
+    QStringList fields = stream.readLine().split(' ', QString::SkipEmptyParts);
+    if (fields.count() != 4)
+      {
+      continue;
+      }
+    QByteArray viewName = viewNames.value(fields[0].toInt() % viewNames.count()).toLatin1();
+    int eventType = fields[1] == "Enter" ? vtkSlicerDataProbeEventTrace::EnterEvent :
+      (fields[1] == "Leave" ? vtkSlicerDataProbeEventTrace::LeaveEvent :
+                              vtkSlicerDataProbeEventTrace::MouseMoveEvent);
+    int xy[2] = {fields[2].toInt(), fields[3].toInt()};
+    trace->AddEvent(viewName.constData(), eventType, xy, 0.01 * trace->GetNumberOfEvents(),
+                    sceneFingerprint);
+    }
+  return trace->GetNumberOfEvents() > 0;
+}
+
+//-----------------------------------------------------------------------------
+/// Invoke the events of \a trace on the interactor styles of their views,
+/// as the render window interactors do. Return the number of invoked events,
+/// the events of views missing from \a viewNames are skipped.
+int InvokeEvents(vtkSlicerDataProbeEventTrace* trace, const QStringList& viewNames,
+                 const QList<vtkInteractorObserver*>& interactorStyles)
+{
+  int numberOfInvokedEvents = 0;
+  for (vtkIdType eventIdx = 0; eventIdx < trace->GetNumberOfEvents(); ++eventIdx)
+    {
+    vtkInteractorObserver* interactorStyle =
+      interactorStyles.value(viewNames.indexOf(trace->GetEventViewName(eventIdx)));
+    if (!interactorStyle)
+      {
+      continue;
+      }
+    int eventType = trace->GetEventType(eventIdx);
+    int xy[2] = {0, 0};
+    trace->GetEventPosition(eventIdx, xy);
+    interactorStyle->GetInteractor()->SetEventPosition(xy);
+    interactorStyle->InvokeEvent(
+      eventType == vtkSlicerDataProbeEventTrace::EnterEvent ? vtkCommand::EnterEvent :
+      (eventType == vtkSlicerDataProbeEventTrace::LeaveEvent ? vtkCommand::LeaveEvent :
+                                                              vtkCommand::MouseMoveEvent));
+    ++numberOfInvokedEvents;
+    }
+  return numberOfInvokedEvents;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> CreateImage(int scalarType, int numberOfComponents)
+{
+  vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+  imageData->SetDimensions(96, 96, 64);
+  imageData->SetScalarType(scalarType);
+  imageData->SetNumberOfScalarComponents(numberOfComponents);
+  imageData->AllocateScalars();
+  unsigned int state = 42u + scalarType;
+  vtkDataArray* scalars = imageData->GetPointData()->GetScalars();
+  for (vtkIdType tupleIdx = 0; tupleIdx < scalars->GetNumberOfTuples(); ++tupleIdx)
+    {
+    for (int componentIdx = 0; componentIdx < numberOfComponents; ++componentIdx)
+      {
+      scalars->SetComponent(tupleIdx, componentIdx, NextRandom(state) % 256);
+      }
+    }
+  return imageData;
+}
+
+//-----------------------------------------------------------------------------
+template <class VolumeNodeType, class DisplayNodeType>
+VolumeNodeType* AddVolume(vtkMRMLScene* scene, const char* name, vtkImageData* imageData,
+                          vtkMRMLNode* colorNode)
+{
+  vtkNew<DisplayNodeType> displayNode;
+  scene->AddNode(displayNode.GetPointer());
+  if (colorNode)
+    {
+    displayNode->SetAndObserveColorNodeID(colorNode->GetID());
+    }
+  vtkNew<VolumeNodeType> volumeNode;
+  volumeNode->SetName(name);
+  volumeNode->SetSpacing(0.9, 0.9, 1.5);
+  volumeNode->SetAndObserveImageData(imageData);
+  scene->AddNode(volumeNode.GetPointer());
+  volumeNode->SetAndObserveDisplayNodeID(displayNode->GetID());
+  return volumeNode.GetPointer();
+}
+
+//-----------------------------------------------------------------------------
+double Percentile(const std::vector<double>& sortedValues, double percentile)
+{
+  size_t index = static_cast<size_t>(percentile / 100. * (sortedValues.size() - 1) + 0.5);
+  return sortedValues[std::min(index, sortedValues.size() - 1)];
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int qSlicerDataProbeInfoWidgetReplay(int argc, char * argv [],
+                                     qSlicerDataProbeInfoWidgetReplayCallback measuredPassCallback)
+{
+  QApplication app(argc, argv);
+
+  // Scene: scalar, label map, vector and DTI volumes
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLLayoutNode> layoutNode;
+  scene->AddNode(layoutNode.GetPointer());
+
+  vtkNew<vtkMRMLColorTableNode> greyColorNode;
+  greyColorNode->SetTypeToGrey();
+  scene->AddNode(greyColorNode.GetPointer());
+  vtkNew<vtkMRMLColorTableNode> labelColorNode;
+  labelColorNode->SetTypeToLabels();
+  scene->AddNode(labelColorNode.GetPointer());
+
+  vtkMRMLScalarVolumeNode* scalarVolumeNode =
+    AddVolume<vtkMRMLScalarVolumeNode, vtkMRMLScalarVolumeDisplayNode>(
+      scene.GetPointer(), "Scalar", CreateImage(VTK_SHORT, 1), greyColorNode.GetPointer());
+
+  vtkSmartPointer<vtkImageData> labelImage = CreateImage(VTK_UNSIGNED_CHAR, 1);
+  vtkDataArray* labels = labelImage->GetPointData()->GetScalars();
+  for (vtkIdType tupleIdx = 0; tupleIdx < labels->GetNumberOfTuples(); ++tupleIdx)
+    {
+    // Slabs of a few labels, so that components and boundaries exist
+    labels->SetTuple1(tupleIdx, (tupleIdx / (96 * 96 * 8)) % 4);
+    }
+  vtkMRMLScalarVolumeNode* labelVolumeNode =
+    AddVolume<vtkMRMLScalarVolumeNode, vtkMRMLLabelMapVolumeDisplayNode>(
+      scene.GetPointer(), "Label", labelImage, labelColorNode.GetPointer());
+  labelVolumeNode->SetLabelMap(1);
+
+  vtkMRMLVectorVolumeNode* vectorVolumeNode =
+    AddVolume<vtkMRMLVectorVolumeNode, vtkMRMLVectorVolumeDisplayNode>(
+      scene.GetPointer(), "Vector", CreateImage(VTK_UNSIGNED_CHAR, 3), 0);
+
+  vtkSmartPointer<vtkImageData> tensorImage = CreateImage(VTK_FLOAT, 1);
+  vtkNew<vtkFloatArray> tensors;
+  tensors->SetNumberOfComponents(9);
+  tensors->SetNumberOfTuples(tensorImage->GetNumberOfPoints());
+  for (vtkIdType tupleIdx = 0; tupleIdx < tensors->GetNumberOfTuples(); ++tupleIdx)
+    {
+    const float scale = 1.f + (tupleIdx % 17) / 17.f;
+    float tensor[9] = {scale, 0.1f, 0.f, 0.1f, 1.f, 0.f, 0.f, 0.f, 0.5f};
+    tensors->SetTupleValue(tupleIdx, tensor);
+    }
+  tensorImage->GetPointData()->SetTensors(tensors.GetPointer());
+  vtkNew<vtkMRMLDiffusionTensorDisplayPropertiesNode> tensorPropertiesNode;
+  scene->AddNode(tensorPropertiesNode.GetPointer());
+  vtkMRMLDiffusionTensorVolumeNode* tensorVolumeNode =
+    AddVolume<vtkMRMLDiffusionTensorVolumeNode, vtkMRMLDiffusionTensorVolumeDisplayNode>(
+      scene.GetPointer(), "DTI", tensorImage, greyColorNode.GetPointer());
+  vtkMRMLDiffusionTensorVolumeDisplayNode::SafeDownCast(tensorVolumeNode->GetDisplayNode())
+    ->SetAndObserveDiffusionTensorDisplayPropertiesNodeID(tensorPropertiesNode->GetID());
+
+  // Four-up layout
+  QWidget viewport;
+  viewport.resize(800, 600);
+  qSlicerLayoutManager layoutManager(&viewport);
+  layoutManager.setMRMLScene(scene.GetPointer());
+  layoutManager.setLayout(vtkMRMLLayoutNode::SlicerLayoutFourUpView);
+  viewport.show();
+
+  // Each view shows a different combination of layers
+  vtkSmartPointer<vtkCollection> compositeNodes;
+  compositeNodes.TakeReference(scene->GetNodesByClass("vtkMRMLSliceCompositeNode"));
+  const char* backgroundIDs[3] = {scalarVolumeNode->GetID(), tensorVolumeNode->GetID(), vectorVolumeNode->GetID()};
+  const char* foregroundIDs[3] = {vectorVolumeNode->GetID(), scalarVolumeNode->GetID(), 0};
+  for (int nodeIdx = 0; nodeIdx < compositeNodes->GetNumberOfItems(); ++nodeIdx)
+    {
+    vtkMRMLSliceCompositeNode* compositeNode =
+      vtkMRMLSliceCompositeNode::SafeDownCast(compositeNodes->GetItemAsObject(nodeIdx));
+    compositeNode->SetBackgroundVolumeID(backgroundIDs[nodeIdx % 3]);
+    compositeNode->SetForegroundVolumeID(foregroundIDs[nodeIdx % 3]);
+    compositeNode->SetForegroundOpacity(0.5);
+    compositeNode->SetLabelVolumeID(labelVolumeNode->GetID());
+    }
+
+  vtkSmartPointer<vtkSlicerDataProbeLogic> logic = vtkSmartPointer<vtkSlicerDataProbeLogic>::New();
+  logic->SetMRMLScene(scene.GetPointer());
+
+  qSlicerDataProbeInfoWidget widget;
+  widget.setMRMLScene(scene.GetPointer());
+  widget.setDataProbeLogic(logic);
+  widget.setLayoutManager(&layoutManager);
+  widget.show();
+  app.processEvents();
+
+  // Views and their interactors, in the order observed by the widget
+  QList<vtkInteractorObserver*> interactorStyles;
+  QStringList viewNames;
+  foreach(const QString& sliceViewName, layoutManager.sliceViewNames())
+    {
+    interactorStyles << layoutManager.sliceWidget(sliceViewName)->sliceView()->interactorStyle();
+    viewNames << sliceViewName;
+    }
+  for (int threeDViewIdx = 0; threeDViewIdx < layoutManager.threeDViewCount(); ++threeDViewIdx)
+    {
+    qMRMLThreeDWidget* threeDWidget = layoutManager.threeDWidget(threeDViewIdx);
+    interactorStyles << threeDWidget->threeDView()->interactorStyle();
+    viewNames << (threeDWidget->mrmlViewNode() ? threeDWidget->mrmlViewNode()->GetName() : "");
+    }
+  if (interactorStyles.isEmpty())
+    {
+    std::cerr << "Line " << __LINE__ << " - No view to replay events into" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkSlicerDataProbeEventTrace> events;
+  unsigned int sceneFingerprint = vtkSlicerDataProbeEventTrace::ComputeSceneFingerprint(scene.GetPointer());
+  if (argc > 1 && QFile::exists(argv[1]))
+    {
+    // Traces recorded by the widget are binary, see eventTraceRecording
+    bool read = QString(argv[1]).endsWith(".dptrace") ?
+      events->Read(argv[1]) : ReadEvents(argv[1], viewNames, sceneFingerprint, events.GetPointer());
+    if (!read)
+      {
+      std::cerr << "Line " << __LINE__ << " - Failed to read events from " << argv[1] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  else
+    {
+    int* size = interactorStyles.first()->GetInteractor()->GetSize();
+    SyntheticEvents(viewNames, 500, std::max(size[0], 16), std::max(size[1], 16),
+                    sceneFingerprint, events.GetPointer());
+    }
+
+  // A first pass fills the caches of the logic. The events are recorded, the
+  // recording observing the interactors, and the recorded trace is written
+  // and read back.
+  widget.setEventTraceRecording(true);
+  int numberOfInvokedEvents = InvokeEvents(events.GetPointer(), viewNames, interactorStyles);
+  widget.setEventTraceRecording(false);
+  vtkSlicerDataProbeEventTrace* recordedTrace = widget.eventTrace();
+  QString traceFileName = QDir::tempPath() + "/qSlicerDataProbeInfoWidgetTest.dptrace";
+  vtkNew<vtkSlicerDataProbeEventTrace> readTrace;
+  const vtkIdType numberOfEvents = recordedTrace->GetNumberOfEvents();
+  if (numberOfEvents == 0 || numberOfEvents != numberOfInvokedEvents ||
+      !recordedTrace->Write(traceFileName.toLatin1().constData()) ||
+      !readTrace->Read(traceFileName.toLatin1().constData()) ||
+      readTrace->GetNumberOfEvents() != numberOfEvents)
+    {
+    std::cerr << "Line " << __LINE__ << " - Failed to record " << numberOfInvokedEvents
+              << " events, got " << numberOfEvents << std::endl;
+    return EXIT_FAILURE;
+    }
+  QFile::remove(traceFileName);
+
+  // The second pass replays the recorded trace and is measured, each event
+  // being enclosed in a timer log event by the widget.
+  vtkTimerLog::ResetLog();
+  vtkTimerLog::SetMaxEntries(2 * static_cast<int>(numberOfEvents) + 16);
+  vtkTimerLog::LoggingOn();
+  if (measuredPassCallback)
+    {
+    measuredPassCallback(true);
+    }
+  int numberOfReplayedEvents = widget.replayEventTrace(readTrace.GetPointer());
+  if (measuredPassCallback)
+    {
+    measuredPassCallback(false);
+    }
+  std::vector<double> latencies;
+  double startTime = 0.;
+  bool started = false;
+  for (int entryIdx = 0; entryIdx < vtkTimerLog::GetNumberOfEvents(); ++entryIdx)
+    {
+    const char* entry = vtkTimerLog::GetEventString(entryIdx);
+    if (!entry || strncmp(entry, "DataProbe ", 10) != 0)
+      {
+      continue;
+      }
+    if (!started)
+      {
+      startTime = vtkTimerLog::GetEventWallTime(entryIdx);
+      }
+    else
+      {
+      latencies.push_back((vtkTimerLog::GetEventWallTime(entryIdx) - startTime) * 1000.);
+      }
+    started = !started;
+    }
+  vtkTimerLog::ResetLog();
+  if (numberOfReplayedEvents != numberOfEvents ||
+      latencies.size() != static_cast<size_t>(numberOfEvents))
+    {
+    std::cerr << "Line " << __LINE__ << " - Failed to replay " << numberOfEvents
+              << " events, replayed " << numberOfReplayedEvents
+              << ", timed " << latencies.size() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::sort(latencies.begin(), latencies.end());
+  double totalLatency = 0.;
+  for (size_t eventIdx = 0; eventIdx < latencies.size(); ++eventIdx)
+    {
+    totalLatency += latencies[eventIdx];
+    }
+  std::cout << "DataProbeReplay Events: " << latencies.size() << std::endl;
+  std::cout << "DataProbeReplay LatencyMs p50: " << Percentile(latencies, 50.)
+            << " p90: " << Percentile(latencies, 90.)
+            << " p99: " << Percentile(latencies, 99.)
+            << " max: " << latencies.back()
+            << " mean: " << totalLatency / latencies.size() << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,36 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qSlicerDataProbeInfoWidgetReplay_h
+#define __qSlicerDataProbeInfoWidgetReplay_h
+
+/// Called with true before the measured replay pass and with false after it.
+typedef void (*qSlicerDataProbeInfoWidgetReplayCallback)(bool measuring);
+
+/// Replay a stream of Enter, MouseMove and Leave events into the views
+/// observed by qSlicerDataProbeInfoWidget and report the per-event latency
+/// percentiles. The events are first invoked on the interactors of the
+/// views, filling the caches of the logic while the widget records them. The
+/// recorded trace is then replayed by
+/// qSlicerDataProbeInfoWidget::replayEventTrace() and measured.
+/// The scene, the layout and the synthetic stream are fixed so that the
+/// numbers can be compared between builds. A recorded stream can be given as
+/// first argument.
+int qSlicerDataProbeInfoWidgetReplay(int argc, char * argv [],
+                                     qSlicerDataProbeInfoWidgetReplayCallback measuredPassCallback);
+
+#endif
@@ -23,7 +23,11 @@
 // Qt includes
 #include <QColor>
 #include <QDebug>
+#include <QHash>
 #include <QLabel>
+#include <QStringList>
+#include <QTextDocument>
+#include <QTimer>
 
 // CTK includes
 #include <ctkPimpl.h>
@@ -35,22 +39,48 @@
 // DataProbe includes
 #include "qSlicerDataProbeInfoWidget.h"
 #include "ui_qSlicerDataProbeInfoWidget.h"
+#include "vtkMRMLDataProbeResultNode.h"
+#include "vtkSlicerDataProbeBatchEngine.h"
+#include "vtkSlicerDataProbeEventTrace.h"
 #include "vtkSlicerDataProbeLogic.h"
+#include "vtkSlicerDataProbePathTrace.h"
+#include "vtkSlicerDataProbeSharedMemoryStream.h"
+#include "vtkSlicerDataProbeTransformCache.h"
+#include "vtkSlicerDataProbeViewportStatistics.h"
 
 // MRMLLogic includes
 #include <vtkMRMLSliceLogic.h>
 
 // MRMLWidgets includes
 #include <qMRMLSliceWidget.h>
+#include <qMRMLThreeDView.h>
+#include <qMRMLThreeDWidget.h>
 
 // MRML includes
+#include <vtkMRMLModelDisplayNode.h>
+#include <vtkMRMLModelNode.h>
+#include <vtkMRMLScalarVolumeDisplayNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
 #include <vtkMRMLScene.h>
 #include <vtkMRMLSliceLayerLogic.h>
 #include <vtkMRMLSliceNode.h>
+#include <vtkMRMLViewNode.h>
 
 // VTK includes
+#include <vtkCollection.h>
+#include <vtkDoubleArray.h>
+#include <vtkIntArray.h>
 #include <vtkInteractorObserver.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkPoints.h>
+#include <vtkRenderWindowInteractor.h>
+#include <vtkRenderer.h>
+#include <vtkSmartPointer.h>
+#include <vtkTable.h>
+#include <vtkTimerLog.h>
 #include <vtkTransform.h>
+#include <vtkWeakPointer.h>
 
 //-----------------------------------------------------------------------------
 /// \ingroup Slicer_QtModules_DataProbe
@@ -67,15 +97,170 @@ public:
 
   void init();
   void resetLabels();
+  /// Stop observing the interactor styles of the views.
+  void removeObservers();
   qMRMLSliceWidget * slicerWidget(vtkInteractorObserver * interactorStyle) const;
   QList<vtkInteractorObserver*> currentLayoutSliceViewInteractorStyles() const;
-  QList<double> convertXYZToIJK(vtkMRMLSliceLayerLogic* slicerLayerLogic, const QList<double>& xyz) const;
+  qMRMLThreeDWidget * threeDWidget(vtkInteractorObserver * interactorStyle) const;
+  QList<vtkInteractorObserver*> currentLayoutThreeDViewInteractorStyles() const;
+  QList<double> convertXYZToIJK(vtkMRMLSliceLayerLogic* slicerLayerLogic,
+                                const QList<double>& xyz, const QList<double>& ras) const;
+
+  /// Name under which the events of \a interactorStyle are recorded: the
+  /// layout name of slice views, the node name of 3D views.
+  QString viewName(vtkInteractorObserver * interactorStyle) const;
+  /// Interactor style of the view \a viewName of the current layout.
+  vtkInteractorObserver * interactorStyle(const QString& viewName) const;
+  /// Append the event \a eventId of \a interactorStyle to the event trace.
+  void recordEvent(vtkInteractorObserver * interactorStyle, unsigned long eventId);
+
+  /// Format the values of the last probing done by the logic given its \a probeStatus.
+  QString probedValueAsString(int probeStatus) const;
+
+  /// Probe the voxels of \a volumeNode crossed since the last event of the
+  /// layer \a sliceLayerId and return the stroke statistics.
+  QString probePath(const QString& sliceLayerId, vtkMRMLVolumeNode* volumeNode, const QList<double>& ijk);
+
+  /// Probe the view of \a interactorStyle at the display position \a xy,
+  /// for the event \a eventId.
+  void probeView(vtkInteractorObserver * interactorStyle, unsigned long eventId, const int xy[2]);
+
+  /// Probe the volumes rendered in \a threeDWidget along the ray cast from
+  /// the display position \a xy, the first three in the B, F and L rows.
+  void probeThreeDView(qMRMLThreeDWidget* threeDWidget, const int xy[2]);
+
+  /// Volumes with a visible volume rendering display node shown in the 3D
+  /// view of \a viewNode.
+  QList<vtkMRMLVolumeNode*> renderedVolumes(vtkMRMLViewNode* viewNode);
+
+  /// Nodes of the scene of class \a className, cached until a node is added
+  /// to or removed from the scene.
+  QList<vtkMRMLNode*> nodesByClass(const char* className);
+
+  /// Value from which voxels of \a volumeNode are considered visible when
+  /// searching the first voxel along a ray.
+  double rayThreshold(vtkMRMLVolumeNode* volumeNode) const;
+
+  /// Probe the models whose intersection is displayed in the slice view of
+  /// \a sliceNode, at the world position \a ras. Only the models crossing
+  /// the slice plane within a few pixels of \a ras are reported.
+  QStringList probeModels(vtkMRMLSliceNode* sliceNode, const QList<double>& ras);
+
+  /// Probe the visible fiber bundles of the scene within FiberProbingRadius
+  /// of the world position \a ras, one line per bundle.
+  QStringList probeFiberBundles(const QList<double>& ras);
+
+  /// Format the label statistics probed by the logic for the layer \a sliceLayerId.
+  QString labelStatisticsAsString(const QString& sliceLayerId) const;
+  QString componentStatisticsAsString(const QString& sliceLayerId) const;
+  QString probePercentile(const QString& sliceLayerId, vtkMRMLVolumeNode* volumeNode,
+                          const QList<double>& ijk);
+  QString probeBoundaryDistance(const QString& sliceLayerId, vtkMRMLVolumeNode* volumeNode,
+                                const int voxel[3]);
+
+  /// Format the labels of the neighborhood of the voxel \a ijk of the label
+  /// map \a volumeNode, most frequent first, within LabelCompositionRadius
+  /// millimeters or the 3x3x3 voxels if it is 0.
+  QString probeLabelComposition(const QString& sliceLayerId, vtkMRMLVolumeNode* volumeNode,
+                                const QList<double>& ijk);
+
+  /// Format the displacement, Jacobian determinant and principal strains of
+  /// the displacement field \a volumeNode at \a ijk, an empty string if the
+  /// volume is not a displacement field.
+  QString probeDisplacement(const QString& sliceLayerId, vtkMRMLVolumeNode* volumeNode,
+                            const QList<double>& ijk);
+
+  /// Compare the foreground and background layers of \a sliceLogic at the
+  /// world position \a ras. Only the central voxels are compared if
+  /// Approximate is true.
+  QString probeLayerComparison(vtkMRMLSliceLogic* sliceLogic, const QList<double>& ras);
+
+  /// Probe the layers of the slice views other than \a sliceNode at the
+  /// world position \a ras, one line per view.
+  QStringList probeLinkedViews(vtkMRMLSliceNode* sliceNode, const QList<double>& ras);
+
+  /// Format the statistics of the values displayed by the layer \a sliceLayerId,
+  /// computed from a subset of the pixels if Approximate is true and they
+  /// can't be updated incrementally.
+  QString probeViewportStatistics(const QString& sliceLayerId, vtkMRMLSliceLayerLogic* sliceLayerLogic);
+
+  /// Return the result node of the logic, its modified events being
+  /// batched until the next timeout of the result timer.
+  vtkMRMLDataProbeResultNode* resultNode();
+
+  /// Publish the pixel probed by the logic with \a probeStatus as the
+  /// result of the layer \a sliceLayerId.
+  void setLayerResult(const QString& sliceLayerId, vtkMRMLVolumeNode* volumeNode,
+                      const double ijk[3], int probeStatus);
+
+  /// Publish the result node into the shared memory stream, if open.
+  void publishResult();
+
+  /// Decide whether the expensive readouts of the event \a eventId at \a xy
+  /// are approximated, and schedule their refinement if so.
+  void updateProgressiveState(vtkInteractorObserver * interactorStyle, unsigned long eventId,
+                              const int xy[2]);
+
+  /// Prefix \a details with "~ " if they are approximate.
+  QString markApproximate(const QString& details) const;
+
+  struct PathState
+  {
+    vtkSmartPointer<vtkSlicerDataProbePathTrace> Trace;
+    QString VolumeNodeID;
+    QList<double> LastIJK;
+  };
 
   RowsOfLayerLabelsType RowsOfLayerLabels;
   qSlicerLayoutManager * LayoutManager;
   QList<vtkInteractorObserver*> ObservedInteractorStyles;
   vtkSmartPointer<vtkSlicerDataProbeLogic> DataProbeLogic;
-
+  bool DisplayedValueProbing;
+  bool PathProbing;
+  bool MaximumRayProbing;
+  bool LabelStatisticsProbing;
+  bool ComponentProbing;
+  bool BoundaryDistanceProbing;
+  bool PercentileProbing;
+  bool LayerComparisonProbing;
+  bool LinkedProbing;
+  bool ViewportStatisticsProbing;
+  bool FiberBundleProbing;
+  double FiberProbingRadius;
+  bool DisplacementFieldProbing;
+  bool LabelCompositionProbing;
+  double LabelCompositionRadius;
+  QHash<QString, PathState> PathStates;
+  /// Nodes of the scene by class name, see nodesByClass().
+  QHash<QString, QList<vtkWeakPointer<vtkMRMLNode> > > NodesByClass;
+  /// Label whose boundary distance is probed, per slice layer.
+  QHash<QString, int> BoundaryLabels;
+  /// Fires once per frame while the result node is being updated.
+  QTimer ResultNodeTimer;
+  vtkSmartPointer<vtkSlicerDataProbeEventTrace> EventTrace;
+  bool EventTraceRecording;
+  /// Fingerprint of the scene, updated when a view is entered.
+  unsigned int SceneFingerprint;
+  /// True while replayEventTrace() drives the views.
+  bool Replaying;
+  QString SharedMemoryStreamName;
+  /// Samples the volumes of the linked views, separate from the batch
+  /// engine of the logic so that its inputs are left untouched.
+  vtkSmartPointer<vtkSlicerDataProbeBatchEngine> LinkedProbeEngine;
+  vtkSmartPointer<vtkPoints> LinkedProbePoint;
+  bool ProgressiveProbing;
+  int ProgressiveRefinementDelay;
+  /// Fires once the cursor rested for ProgressiveRefinementDelay ms after
+  /// an approximate probe, restarted by every newer event.
+  QTimer RefinementTimer;
+  /// Universal time of the last Enter or MouseMove event.
+  double LastEventTime;
+  /// True while the expensive readouts of the current event are approximated.
+  bool Approximate;
+  /// True while onRefinementTimeout() probes the last approximated position again.
+  bool Refining;
+  vtkInteractorObserver * RefinementInteractorStyle;
+  int RefinementPosition[2];
 };
 
 //-----------------------------------------------------------------------------
@@ -84,8 +269,18 @@ public:
 //-----------------------------------------------------------------------------
 qSlicerDataProbeInfoWidgetPrivate::
 qSlicerDataProbeInfoWidgetPrivate(qSlicerDataProbeInfoWidget& object)
-  : q_ptr(&object), LayoutManager(0)
+  : q_ptr(&object), LayoutManager(0), DisplayedValueProbing(false), PathProbing(false),
+    MaximumRayProbing(false), LabelStatisticsProbing(false), ComponentProbing(false),
+    BoundaryDistanceProbing(false), PercentileProbing(false), LayerComparisonProbing(false), LinkedProbing(false),
+    ViewportStatisticsProbing(false), FiberBundleProbing(false), FiberProbingRadius(2.0),
+    DisplacementFieldProbing(false), LabelCompositionProbing(false), LabelCompositionRadius(0.),
+    EventTraceRecording(false),
+    SceneFingerprint(0), Replaying(false), ProgressiveProbing(false),
+    ProgressiveRefinementDelay(150), LastEventTime(0.), Approximate(false), Refining(false),
+    RefinementInteractorStyle(0)
 {
+  this->RefinementPosition[0] = this->RefinementPosition[1] = -1;
+  this->EventTrace = vtkSmartPointer<vtkSlicerDataProbeEventTrace>::New();
 }
 
 //-----------------------------------------------------------------------------
@@ -100,6 +295,14 @@ void qSlicerDataProbeInfoWidgetPrivate::init()
   this->RowsOfLayerLabels.insert(
         "F", RowOfLayerLabelsType() << this->F_LayerName << this->F_LayerIJK << this->F_LayerValue);
   this->resetLabels();
+
+  this->ResultNodeTimer.setSingleShot(true);
+  this->ResultNodeTimer.setInterval(16);
+  QObject::connect(&this->ResultNodeTimer, SIGNAL(timeout()), q, SLOT(onResultNodeTimeout()));
+
+  this->RefinementTimer.setSingleShot(true);
+  this->RefinementTimer.setInterval(this->ProgressiveRefinementDelay);
+  QObject::connect(&this->RefinementTimer, SIGNAL(timeout()), q, SLOT(onRefinementTimeout()));
 }
 
 //-----------------------------------------------------------------------------
@@ -111,6 +314,7 @@ void qSlicerDataProbeInfoWidgetPrivate::resetLabels()
   this->ViewerRAS->clear();
   this->ViewerOrient->clear();
   this->ViewerSpacing->clear();
+  this->ProbeDetails->clear();
   foreach(RowOfLayerLabelsType row, this->RowsOfLayerLabels)
     {
     foreach(QLabel* label, row)
@@ -120,6 +324,24 @@ void qSlicerDataProbeInfoWidgetPrivate::resetLabels()
     }
 }
 
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidgetPrivate::removeObservers()
+{
+  Q_Q(qSlicerDataProbeInfoWidget);
+  foreach(vtkInteractorObserver * observedInteractorStyle, this->ObservedInteractorStyles)
+    {
+    foreach(int event, QList<int>()
+            << vtkCommand::MouseMoveEvent << vtkCommand::EnterEvent << vtkCommand::LeaveEvent)
+      {
+      q->qvtkDisconnect(observedInteractorStyle, event,
+                        q, SLOT(processEvent(vtkObject*,void*,ulong,void*)));
+      }
+    }
+  this->ObservedInteractorStyles.clear();
+  this->RefinementTimer.stop();
+  this->RefinementInteractorStyle = 0;
+}
+
 //-----------------------------------------------------------------------------
 qMRMLSliceWidget *
 qSlicerDataProbeInfoWidgetPrivate::slicerWidget(vtkInteractorObserver * interactorStyle) const
@@ -159,220 +381,1502 @@ qSlicerDataProbeInfoWidgetPrivate::currentLayoutSliceViewInteractorStyles() cons
 }
 
 //-----------------------------------------------------------------------------
-QList<double>
-qSlicerDataProbeInfoWidgetPrivate::convertXYZToIJK(vtkMRMLSliceLayerLogic* slicerLayerLogic,
-                                                   const QList<double>& xyz) const
+qMRMLThreeDWidget *
+qSlicerDataProbeInfoWidgetPrivate::threeDWidget(vtkInteractorObserver * interactorStyle) const
 {
-  vtkMRMLVolumeNode * volumeNode = slicerLayerLogic->GetVolumeNode();
-  if (!volumeNode)
+  if (!this->LayoutManager)
     {
-    return QList<double>() << 0.0 << 0.0 << 0.0;
+    return 0;
     }
-  vtkMatrix4x4 * xyToIJK = slicerLayerLogic->GetXYToIJKTransform()->GetMatrix();
-  double xyzw[4] = {xyz[0], xyz[1], xyz[2], 1.0};
-  double ijkw[4] = {0.0, 0.0, 0.0, 0.0};
-  xyToIJK->MultiplyPoint(xyzw, ijkw);
-  Q_ASSERT(ijkw[3] == 1.0);
-  return QList<double>() << ijkw[0] <<  ijkw[1] <<  ijkw[2];
+  for (int threeDViewIdx = 0; threeDViewIdx < this->LayoutManager->threeDViewCount(); ++threeDViewIdx)
+    {
+    qMRMLThreeDWidget * threeDWidget = this->LayoutManager->threeDWidget(threeDViewIdx);
+    Q_ASSERT(threeDWidget);
+    if (threeDWidget->threeDView()->interactorStyle() == interactorStyle)
+      {
+      return threeDWidget;
+      }
+    }
+  return 0;
 }
 
 //-----------------------------------------------------------------------------
-// qSlicerDataProbeInfoWidget methods
-
-//-----------------------------------------------------------------------------
-qSlicerDataProbeInfoWidget::qSlicerDataProbeInfoWidget(QWidget *_parent):
-  Superclass(_parent), d_ptr(new qSlicerDataProbeInfoWidgetPrivate(*this))
+QList<vtkInteractorObserver*>
+qSlicerDataProbeInfoWidgetPrivate::currentLayoutThreeDViewInteractorStyles() const
 {
-  Q_D(qSlicerDataProbeInfoWidget);
-  d->init();
+  QList<vtkInteractorObserver*> interactorStyles;
+  if (!this->LayoutManager)
+    {
+    return interactorStyles;
+    }
+  for (int threeDViewIdx = 0; threeDViewIdx < this->LayoutManager->threeDViewCount(); ++threeDViewIdx)
+    {
+    qMRMLThreeDWidget * threeDWidget = this->LayoutManager->threeDWidget(threeDViewIdx);
+    Q_ASSERT(threeDWidget);
+    interactorStyles << threeDWidget->threeDView()->interactorStyle();
+    }
+  return interactorStyles;
 }
 
 //-----------------------------------------------------------------------------
-qSlicerDataProbeInfoWidget::~qSlicerDataProbeInfoWidget()
+QString qSlicerDataProbeInfoWidgetPrivate::viewName(vtkInteractorObserver * interactorStyle) const
 {
+  if (qMRMLThreeDWidget * threeDWidget = this->threeDWidget(interactorStyle))
+    {
+    return threeDWidget->mrmlViewNode() ? threeDWidget->mrmlViewNode()->GetName() : "";
+    }
+  qMRMLSliceWidget * sliceWidget = this->slicerWidget(interactorStyle);
+  return sliceWidget && sliceWidget->mrmlSliceNode() ? sliceWidget->mrmlSliceNode()->GetLayoutName() : "";
 }
 
 //-----------------------------------------------------------------------------
-CTK_GET_CPP(qSlicerDataProbeInfoWidget, qSlicerLayoutManager*, layoutManager, LayoutManager)
+vtkInteractorObserver *
+qSlicerDataProbeInfoWidgetPrivate::interactorStyle(const QString& viewName) const
+{
+  foreach(vtkInteractorObserver * interactorStyle,
+          this->currentLayoutSliceViewInteractorStyles() + this->currentLayoutThreeDViewInteractorStyles())
+    {
+    if (this->viewName(interactorStyle) == viewName)
+      {
+      return interactorStyle;
+      }
+    }
+  return 0;
+}
 
 //-----------------------------------------------------------------------------
-void qSlicerDataProbeInfoWidget::setLayoutManager(qSlicerLayoutManager* layoutManager)
+void qSlicerDataProbeInfoWidgetPrivate::recordEvent(vtkInteractorObserver * interactorStyle,
+                                                    unsigned long eventId)
 {
-  Q_D(qSlicerDataProbeInfoWidget);
-
-  if (layoutManager == d->LayoutManager)
+  Q_Q(qSlicerDataProbeInfoWidget);
+  int eventType = vtkSlicerDataProbeEventTrace::MouseMoveEvent;
+  if (eventId == vtkCommand::EnterEvent)
     {
-    return;
+    // Hashing the scene is too slow for every mouse move
+    this->SceneFingerprint = vtkSlicerDataProbeEventTrace::ComputeSceneFingerprint(q->mrmlScene());
+    eventType = vtkSlicerDataProbeEventTrace::EnterEvent;
     }
-  if (d->LayoutManager)
+  else if (eventId == vtkCommand::LeaveEvent)
     {
-    disconnect(d->LayoutManager, SIGNAL(layoutChanged()), this, SLOT(onLayoutChanged()));
+    eventType = vtkSlicerDataProbeEventTrace::LeaveEvent;
     }
-  if (layoutManager)
+  int xy[2] = {0, 0};
+  if (interactorStyle && interactorStyle->GetInteractor())
     {
-    connect(layoutManager, SIGNAL(layoutChanged()), this, SLOT(onLayoutChanged()));
+    interactorStyle->GetInteractor()->GetEventPosition(xy);
     }
-  d->LayoutManager = layoutManager;
-
-  this->onLayoutChanged();
+  this->EventTrace->AddEvent(this->viewName(interactorStyle).toLatin1().constData(), eventType, xy,
+                             vtkTimerLog::GetUniversalTime(), this->SceneFingerprint);
 }
 
 //-----------------------------------------------------------------------------
-CTK_GET_CPP(qSlicerDataProbeInfoWidget, vtkSlicerDataProbeLogic*, dataProbeLogic, DataProbeLogic)
-CTK_SET_CPP(qSlicerDataProbeInfoWidget, vtkSlicerDataProbeLogic*, setDataProbeLogic, DataProbeLogic)
+double qSlicerDataProbeInfoWidgetPrivate::rayThreshold(vtkMRMLVolumeNode* volumeNode) const
+{
+  vtkMRMLScalarVolumeNode * scalarVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode);
+  if (scalarVolumeNode && scalarVolumeNode->GetLabelMap())
+    {
+    // Any label but the background
+    return 1.0;
+    }
+  vtkMRMLScalarVolumeDisplayNode * displayNode = scalarVolumeNode ?
+    scalarVolumeNode->GetScalarVolumeDisplayNode() : 0;
+  if (!displayNode)
+    {
+    return 0.0;
+    }
+  if (displayNode->GetApplyThreshold())
+    {
+    return displayNode->GetLowerThreshold();
+    }
+  return displayNode->GetLevel() - 0.5 * displayNode->GetWindow();
+}
 
 //-----------------------------------------------------------------------------
-void qSlicerDataProbeInfoWidget::onLayoutChanged()
+void qSlicerDataProbeInfoWidgetPrivate::probeThreeDView(qMRMLThreeDWidget* threeDWidget, const int xy[2])
 {
-  Q_D(qSlicerDataProbeInfoWidget);
+  this->resetLabels();
+  vtkMRMLViewNode * viewNode = threeDWidget->mrmlViewNode();
+  this->ViewerName->setText(QString("  %1  ").arg(viewNode ? viewNode->GetName() : ""));
+  this->ViewerOrient->setText("  3D");
 
-  if (!this->mrmlScene())
+  // Ray going from the near to the far clipping plane
+  vtkRenderWindowInteractor * interactor = threeDWidget->threeDView()->interactor();
+  vtkRenderer * renderer = interactor ? interactor->FindPokedRenderer(xy[0], xy[1]) : 0;
+  if (!renderer)
+    {
+    return;
+    }
+  double ray[2][3];
+  for (int pointIdx = 0; pointIdx < 2; ++pointIdx)
+    {
+    double worldPoint[4] = {0.0, 0.0, 0.0, 0.0};
+    renderer->SetDisplayPoint(xy[0], xy[1], pointIdx);
+    renderer->DisplayToWorld();
+    renderer->GetWorldPoint(worldPoint);
+    if (worldPoint[3] == 0.0)
+      {
+      return;
+      }
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      ray[pointIdx][axis] = worldPoint[axis] / worldPoint[3];
+      }
+    }
+
+  if (!this->DataProbeLogic)
     {
     return;
     }
 
-  // Remove observers
-  foreach(vtkInteractorObserver * observedInteractorStyle, d->ObservedInteractorStyles)
+  if (vtkMRMLDataProbeResultNode * resultNode = this->resultNode())
     {
-    foreach(int event, QList<int>()
-            << vtkCommand::MouseMoveEvent << vtkCommand::EnterEvent << vtkCommand::LeaveEvent)
+    resultNode->SetViewName(viewNode ? viewNode->GetName() : 0);
+    }
+
+  QStringList details;
+  bool rasDisplayed = false;
+  QList<vtkMRMLVolumeNode*> volumeNodes = this->renderedVolumes(viewNode);
+  QStringList sliceLayerIds = QStringList() << "B" << "F" << "L";
+  for (int layerIdx = 0; layerIdx < sliceLayerIds.size(); ++layerIdx)
+    {
+    QString sliceLayerId = sliceLayerIds[layerIdx];
+    vtkMRMLVolumeNode * volumeNode = layerIdx < volumeNodes.size() ? volumeNodes[layerIdx] : 0;
+    QString layerName = "None";
+    QString ijkAsString;
+    QString valueAsString;
+    int probeStatus = vtkSlicerDataProbeLogic::UNKNOWN;
+    if (volumeNode)
+      {
+      layerName = volumeNode->GetName();
+      int mode = this->MaximumRayProbing ?
+        vtkSlicerDataProbeLogic::MAXIMUM_RAY_MODE : vtkSlicerDataProbeLogic::FIRST_ABOVE_THRESHOLD_RAY_MODE;
+      probeStatus = this->DataProbeLogic->ProbeRay(
+        volumeNode, ray[0], ray[1], mode, this->rayThreshold(volumeNode));
+      valueAsString = Qt::escape(this->probedValueAsString(probeStatus));
+      if (probeStatus & vtkSlicerDataProbeLogic::PROBE_SUCCESS)
+        {
+        int ijk[3] = {0, 0, 0};
+        double ras[3] = {0.0, 0.0, 0.0};
+        this->DataProbeLogic->GetRayHitIJK(ijk);
+        this->DataProbeLogic->GetRayHitRAS(ras);
+        double ijkAsArray[3] = {static_cast<double>(ijk[0]), static_cast<double>(ijk[1]),
+                                static_cast<double>(ijk[2])};
+        this->setLayerResult(sliceLayerId, volumeNode, ijkAsArray, probeStatus);
+        ijkAsString = QString("(%1, %2, %3)").arg(ijk[0]).arg(ijk[1]).arg(ijk[2]);
+        QString rasAsString = QString("(%1, %2, %3)").
+          arg(ras[0], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1).
+          arg(ras[1], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1).
+          arg(ras[2], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1);
+        details << QString("%1 ray: RAS %2").arg(sliceLayerId).arg(rasAsString);
+        if (!rasDisplayed)
+          {
+          this->ViewerRAS->setText(QString("RAS: %1").arg(rasAsString));
+          if (vtkMRMLDataProbeResultNode * resultNode = this->resultNode())
+            {
+            resultNode->SetRAS(ras);
+            }
+          rasDisplayed = true;
+          }
+        }
+      }
+    if (!volumeNode || !(probeStatus & vtkSlicerDataProbeLogic::PROBE_SUCCESS))
       {
-      qvtkDisconnect(observedInteractorStyle, event,
-                     this, SLOT(processEvent(vtkObject*,void*,ulong,void*)));
+      this->setLayerResult(sliceLayerId, 0, 0, 0);
       }
+    this->RowsOfLayerLabels[sliceLayerId].at(0)->setText(QString("<b>%1</b>").arg(Qt::escape(layerName)));
+    this->RowsOfLayerLabels[sliceLayerId].at(1)->setText(ijkAsString);
+    this->RowsOfLayerLabels[sliceLayerId].at(2)->setText(QString("<b>%1</b>").arg(valueAsString));
     }
-  d->ObservedInteractorStyles.clear();
+  this->ProbeDetails->setText(details.join("\n"));
+}
 
-  // Add observers
-  foreach(vtkInteractorObserver * interactorStyle, d->currentLayoutSliceViewInteractorStyles())
+//-----------------------------------------------------------------------------
+QList<vtkMRMLVolumeNode*> qSlicerDataProbeInfoWidgetPrivate::renderedVolumes(vtkMRMLViewNode* viewNode)
+{
+  QList<vtkMRMLVolumeNode*> volumeNodes;
+  if (!viewNode)
     {
-    foreach(int event, QList<int>()
-            << vtkCommand::MouseMoveEvent << vtkCommand::EnterEvent << vtkCommand::LeaveEvent)
+    return volumeNodes;
+    }
+  foreach(vtkMRMLNode * node, this->nodesByClass("vtkMRMLVolumeNode"))
+    {
+    vtkMRMLVolumeNode * volumeNode = vtkMRMLVolumeNode::SafeDownCast(node);
+    for (int displayNodeIdx = 0; volumeNode && displayNodeIdx < volumeNode->GetNumberOfDisplayNodes();
+         ++displayNodeIdx)
       {
-      qvtkConnect(interactorStyle, event,
-                  this, SLOT(processEvent(vtkObject*,void*,ulong,void*)));
+      // The volume rendering display nodes are registered by the volume
+      // rendering module
+      vtkMRMLDisplayNode * displayNode = volumeNode->GetNthDisplayNode(displayNodeIdx);
+      if (displayNode && displayNode->IsA("vtkMRMLVolumeRenderingDisplayNode")
+          && displayNode->GetVisibility()
+          && (displayNode->GetNumberOfViewNodeIDs() == 0
+              || displayNode->IsViewNodeIDPresent(viewNode->GetID())))
+        {
+        volumeNodes << volumeNode;
+        break;
+        }
       }
-    d->ObservedInteractorStyles << interactorStyle;
     }
+  return volumeNodes;
 }
 
 //-----------------------------------------------------------------------------
-void qSlicerDataProbeInfoWidget::
-processEvent(vtkObject* sender, void* callData, unsigned long eventId, void* clientData)
+QList<vtkMRMLNode*> qSlicerDataProbeInfoWidgetPrivate::nodesByClass(const char* className)
 {
-  Q_D(qSlicerDataProbeInfoWidget);
-  Q_UNUSED(callData);
-  Q_UNUSED(clientData);
-  if (eventId == vtkCommand::LeaveEvent)
+  Q_Q(qSlicerDataProbeInfoWidget);
+  QList<vtkMRMLNode*> nodes;
+  if (!q->mrmlScene())
     {
-    d->resetLabels();
+    return nodes;
     }
-  else if(eventId == vtkCommand::EnterEvent || eventId == vtkCommand::MouseMoveEvent)
+  if (!this->NodesByClass.contains(className))
     {
-    // Compute RAS
-    vtkInteractorObserver * interactorStyle = vtkInteractorObserver::SafeDownCast(sender);
-    Q_ASSERT(d->ObservedInteractorStyles.indexOf(interactorStyle) != -1);
-    vtkRenderWindowInteractor * interactor = interactorStyle->GetInteractor();
-    int xy[2] = {-1, -1};
-    interactor->GetEventPosition(xy);
-    qMRMLSliceWidget * sliceWidget = d->slicerWidget(interactorStyle);
-    Q_ASSERT(sliceWidget);
-    QList<double> xyz = sliceWidget->convertDeviceToXYZ(QList<int>() << xy[0] << xy[1]);
-    QList<double> ras = sliceWidget->convertXYZToRAS(xyz);
+    QList<vtkWeakPointer<vtkMRMLNode> >& cachedNodes = this->NodesByClass[className];
+    vtkSmartPointer<vtkCollection> sceneNodes;
+    sceneNodes.TakeReference(q->mrmlScene()->GetNodesByClass(className));
+    for (int nodeIdx = 0; nodeIdx < sceneNodes->GetNumberOfItems(); ++nodeIdx)
+      {
+      cachedNodes << vtkWeakPointer<vtkMRMLNode>(vtkMRMLNode::SafeDownCast(sceneNodes->GetItemAsObject(nodeIdx)));
+      }
+    }
+  foreach(const vtkWeakPointer<vtkMRMLNode>& node, this->NodesByClass[className])
+    {
+    if (node)
+      {
+      nodes << node.GetPointer();
+      }
+    }
+  return nodes;
+}
 
-    vtkMRMLSliceLogic * sliceLogic = sliceWidget->sliceLogic();
-    vtkMRMLSliceNode * sliceNode = sliceWidget->mrmlSliceNode();
+//-----------------------------------------------------------------------------
+QString qSlicerDataProbeInfoWidgetPrivate::labelStatisticsAsString(const QString& sliceLayerId) const
+{
+  if (this->DataProbeLogic->GetLabelNumberOfVoxels() == 0)
+    {
+    return QString();
+    }
+  double centroid[3] = {0.0, 0.0, 0.0};
+  int bounds[6] = {0, -1, 0, -1, 0, -1};
+  this->DataProbeLogic->GetLabelCentroid(centroid);
+  this->DataProbeLogic->GetLabelBounds(bounds);
+  return QString("%1 label: %2 voxels, %3 mm3, centroid (%4, %5, %6), IJK [%7-%8, %9-%10, %11-%12]")
+    .arg(sliceLayerId)
+    .arg(this->DataProbeLogic->GetLabelNumberOfVoxels())
+    .arg(this->DataProbeLogic->GetLabelVolume(), /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1)
+    .arg(centroid[0], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1)
+    .arg(centroid[1], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1)
+    .arg(centroid[2], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1)
+    .arg(bounds[0]).arg(bounds[1]).arg(bounds[2]).arg(bounds[3]).arg(bounds[4]).arg(bounds[5]);
+}
 
-    // RAS
-    d->ViewerRAS->setText(QString("RAS: (%1, %2, %3)").
-                          arg(ras[0], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1).
-                          arg(ras[1], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1).
-                          arg(ras[2], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1));
+//-----------------------------------------------------------------------------
+QString qSlicerDataProbeInfoWidgetPrivate::componentStatisticsAsString(const QString& sliceLayerId) const
+{
+  if (this->DataProbeLogic->GetComponentId() == 0)
+    {
+    return QString();
+    }
+  double centroid[3] = {0.0, 0.0, 0.0};
+  this->DataProbeLogic->GetComponentCentroid(centroid);
+  return QString("%1 component: %2 voxels, %3 mm3, centroid (%4, %5, %6)")
+    .arg(sliceLayerId)
+    .arg(this->DataProbeLogic->GetComponentNumberOfVoxels())
+    .arg(this->DataProbeLogic->GetComponentVolume(), /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1)
+    .arg(centroid[0], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1)
+    .arg(centroid[1], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1)
+    .arg(centroid[2], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1);
+}
 
-    // Orientation
-    d->ViewerOrient->setText(QString("  %1").arg(sliceWidget->sliceOrientation()));
+//-----------------------------------------------------------------------------
+QString qSlicerDataProbeInfoWidgetPrivate::probeBoundaryDistance(const QString& sliceLayerId,
+                                                                 vtkMRMLVolumeNode* volumeNode,
+                                                                 const int voxel[3])
+{
+  // The hovered label is the target, the last one is kept over the background
+  int label = static_cast<int>(this->DataProbeLogic->GetPixelValue(0));
+  if (label != 0)
+    {
+    this->BoundaryLabels[sliceLayerId] = label;
+    }
+  label = this->BoundaryLabels.value(sliceLayerId, 0);
+  if (label == 0)
+    {
+    return QString();
+    }
+  int probeStatus = this->DataProbeLogic->ProbeBoundaryDistance(volumeNode, voxel, label);
+  double distance = this->DataProbeLogic->GetBoundaryDistance();
+  QString distanceAsString;
+  if (probeStatus == vtkSlicerDataProbeLogic::PROBE_ERROR_DISTANCE_MAP_NOT_READY)
+    {
+    distanceAsString = vtkSlicerDataProbeLogic::GetDataProbeStatusEnumAsString(probeStatus);
+    }
+  else if (!vtkMath::IsNan(distance))
+    {
+    distanceAsString = QString("%1 mm").arg(distance, /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1);
+    }
+  else
+    {
+    return QString();
+    }
+  return QString("%1 distance to label %2: %3").arg(sliceLayerId).arg(label).arg(distanceAsString);
+}
 
-    // Spacing
-    QString spacing = QString("%1").arg(
-          sliceLogic->GetLowestVolumeSliceSpacing()[2],
-          /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1);
-    if (sliceNode->GetSliceSpacingMode() == vtkMRMLSliceNode::PrescribedSliceSpacingMode)
+//-----------------------------------------------------------------------------
+vtkMRMLDataProbeResultNode* qSlicerDataProbeInfoWidgetPrivate::resultNode()
+{
+  vtkMRMLDataProbeResultNode * resultNode = this->DataProbeLogic ? this->DataProbeLogic->GetResultNode() : 0;
+  if (resultNode)
+    {
+    resultNode->SetDisableModifiedEvent(1);
+    if (!this->ResultNodeTimer.isActive())
       {
-      spacing = "(" + spacing + ")";
+      this->ResultNodeTimer.start();
       }
-    d->ViewerSpacing->setText(QString("Sp: %1").arg(spacing));
+    }
+  return resultNode;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidgetPrivate::setLayerResult(const QString& sliceLayerId,
+                                                       vtkMRMLVolumeNode* volumeNode,
+                                                       const double ijk[3], int probeStatus)
+{
+  vtkMRMLDataProbeResultNode * resultNode = this->resultNode();
+  if (!resultNode)
+    {
+    return;
+    }
+  int layer = sliceLayerId == "L" ? vtkMRMLDataProbeResultNode::LabelLayer :
+    (sliceLayerId == "B" ? vtkMRMLDataProbeResultNode::BackgroundLayer :
+                           vtkMRMLDataProbeResultNode::ForegroundLayer);
+  if (!volumeNode)
+    {
+    resultNode->ClearLayer(layer);
+    return;
+    }
+  double values[vtkMRMLDataProbeResultNode::MaximumNumberOfValues];
+  int numberOfValues = qMin(this->DataProbeLogic->GetNumberOfPixelValues(),
+                            static_cast<int>(vtkMRMLDataProbeResultNode::MaximumNumberOfValues));
+  for (int valueIdx = 0; valueIdx < numberOfValues; ++valueIdx)
+    {
+    values[valueIdx] = this->DataProbeLogic->GetPixelValue(valueIdx);
+    }
+  resultNode->SetLayer(layer, volumeNode->GetID(), ijk, probeStatus, numberOfValues, values,
+                       this->DataProbeLogic->GetPixelDescription().c_str());
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidgetPrivate::publishResult()
+{
+  if (this->SharedMemoryStreamName.isEmpty() || !this->DataProbeLogic)
+    {
+    return;
+    }
+  vtkSlicerDataProbeSharedMemoryStream * stream = this->DataProbeLogic->GetSharedMemoryStream();
+  if (stream->IsOpen())
+    {
+    stream->Publish(this->DataProbeLogic->GetResultNode());
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidgetPrivate::updateProgressiveState(vtkInteractorObserver * interactorStyle,
+                                                               unsigned long eventId, const int xy[2])
+{
+  if (this->Refining)
+    {
+    // Exact probe of the position the cursor rested at
+    this->Approximate = false;
+    return;
+    }
+  this->Approximate = false;
+  if (!this->ProgressiveProbing || this->Replaying)
+    {
+    this->RefinementTimer.stop();
+    return;
+    }
+  // The cursor moves fast if the previous event is more recent than the
+  // refinement delay
+  double eventTime = vtkTimerLog::GetUniversalTime();
+  this->Approximate = eventId == vtkCommand::MouseMoveEvent &&
+    (eventTime - this->LastEventTime) * 1000. < this->ProgressiveRefinementDelay;
+  this->LastEventTime = eventTime;
+  if (!this->Approximate)
+    {
+    this->RefinementTimer.stop();
+    return;
+    }
+  // Restarting the timer cancels the refinement of the previous position
+  this->RefinementInteractorStyle = interactorStyle;
+  this->RefinementPosition[0] = xy[0];
+  this->RefinementPosition[1] = xy[1];
+  this->RefinementTimer.start();
+}
+
+//-----------------------------------------------------------------------------
+QString qSlicerDataProbeInfoWidgetPrivate::markApproximate(const QString& details) const
+{
+  return this->Approximate && !details.isEmpty() ? "~ " + details : details;
+}
 
-    // Color
-    double layoutColor[3] = {0.0, 0.0, 0.0};
-    sliceNode->GetLayoutColor(layoutColor);
-    d->ViewerColor->setStyleSheet(
-          QString("QLabel {background-color : %1}").arg(
-            QColor::fromRgbF(layoutColor[0], layoutColor[1], layoutColor[2]).name()));
+//-----------------------------------------------------------------------------
+QString qSlicerDataProbeInfoWidgetPrivate::probeLayerComparison(vtkMRMLSliceLogic* sliceLogic,
+                                                                const QList<double>& ras)
+{
+  vtkMRMLVolumeNode * backgroundNode = sliceLogic->GetBackgroundLayer()->GetVolumeNode();
+  vtkMRMLVolumeNode * foregroundNode = sliceLogic->GetForegroundLayer()->GetVolumeNode();
+  if (!backgroundNode || !foregroundNode || backgroundNode == foregroundNode)
+    {
+    return QString();
+    }
+  double rasAsArray[3] = {ras[0], ras[1], ras[2]};
+  int probeStatus = this->DataProbeLogic->ProbeLayerDifference(backgroundNode, foregroundNode, rasAsArray,
+                                                               /* radius= */ this->Approximate ? 0 : 1);
+  if (!(probeStatus & vtkSlicerDataProbeLogic::PROBE_SUCCESS))
+    {
+    return QString();
+    }
+  QStringList comparison;
+  comparison << QString("F-B: %1").arg(this->DataProbeLogic->GetLayerDifference(), 0, 'g', 4);
+  double ratio = this->DataProbeLogic->GetLayerRatio();
+  if (!vtkMath::IsNan(ratio))
+    {
+    comparison << QString("F/B: %1").arg(ratio, 0, 'g', 4);
+    }
+  double correlation = this->DataProbeLogic->GetLayerCorrelation();
+  if (!vtkMath::IsNan(correlation))
+    {
+    comparison << QString("NCC: %1").arg(correlation, /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 2);
+    }
+  if (!this->Approximate)
+    {
+    comparison << QString("RMS: %1").arg(this->DataProbeLogic->GetLayerRMSDifference(), 0, 'g', 4);
+    }
+  return this->markApproximate(comparison.join(", "));
+}
 
-    // Name
-    d->ViewerName->setText(QString("  %1  ").arg(sliceNode->GetLayoutName()));
+//-----------------------------------------------------------------------------
+QStringList qSlicerDataProbeInfoWidgetPrivate::probeLinkedViews(vtkMRMLSliceNode* sliceNode,
+                                                                const QList<double>& ras)
+{
+  QStringList details;
+  if (!this->DataProbeLogic || !this->LayoutManager)
+    {
+    return details;
+    }
 
-    // Layer name, ijk and value
+  // Layers of the other views, referring to the unique volumes
+  typedef QPair<QString, int> LayerIdAndVolumeIndexType;
+  typedef QPair<QString, QList<LayerIdAndVolumeIndexType> > ViewLayersType;
+  QList<ViewLayersType> viewLayers;
+  QList<vtkMRMLVolumeNode*> volumeNodes;
+  foreach(const QString& sliceViewName, this->LayoutManager->sliceViewNames())
+    {
+    qMRMLSliceWidget * sliceWidget = this->LayoutManager->sliceWidget(sliceViewName);
+    vtkMRMLSliceLogic * sliceLogic = sliceWidget ? sliceWidget->sliceLogic() : 0;
+    if (!sliceLogic || sliceWidget->mrmlSliceNode() == sliceNode)
+      {
+      continue;
+      }
+    QList<LayerIdAndVolumeIndexType> layers;
     typedef QPair<QString, vtkMRMLSliceLayerLogic*> LayerIdAndLogicType;
     foreach(LayerIdAndLogicType layerIdAndLogic,
             (QList<LayerIdAndLogicType>()
-            << LayerIdAndLogicType("L", sliceLogic->GetLabelLayer())
             << LayerIdAndLogicType("B", sliceLogic->GetBackgroundLayer())
-            << LayerIdAndLogicType("F", sliceLogic->GetForegroundLayer())))
+            << LayerIdAndLogicType("F", sliceLogic->GetForegroundLayer())
+            << LayerIdAndLogicType("L", sliceLogic->GetLabelLayer())))
       {
-      QString sliceLayerId = layerIdAndLogic.first;
-      vtkMRMLSliceLayerLogic * sliceLayerLogic = layerIdAndLogic.second;
+      vtkMRMLVolumeNode * volumeNode = layerIdAndLogic.second ? layerIdAndLogic.second->GetVolumeNode() : 0;
+      if (!volumeNode)
+        {
+        continue;
+        }
+      int volumeIndex = volumeNodes.indexOf(volumeNode);
+      if (volumeIndex == -1)
+        {
+        volumeIndex = volumeNodes.count();
+        volumeNodes << volumeNode;
+        }
+      layers << LayerIdAndVolumeIndexType(layerIdAndLogic.first, volumeIndex);
+      }
+    if (!layers.isEmpty())
+      {
+      viewLayers << qMakePair(sliceViewName, layers);
+      }
+    }
+  if (volumeNodes.isEmpty())
+    {
+    return details;
+    }
 
-      vtkMRMLVolumeNode * volumeNode = sliceLayerLogic->GetVolumeNode();
-      QString layerName = "None";
-      QString ijkAsString;
+  // Single batch for all the views
+  if (!this->LinkedProbeEngine)
+    {
+    this->LinkedProbeEngine = vtkSmartPointer<vtkSlicerDataProbeBatchEngine>::New();
+    this->LinkedProbeEngine->SetInterpolation(vtkSlicerDataProbeBatchEngine::NearestNeighbor);
+    this->LinkedProbePoint = vtkSmartPointer<vtkPoints>::New();
+    this->LinkedProbePoint->SetNumberOfPoints(1);
+    }
+  vtkSlicerDataProbeBatchEngine * engine = this->LinkedProbeEngine;
+  engine->SetTransformCache(this->DataProbeLogic->GetTransformCache());
+  // Starting threads costs more than sampling a few voxels
+  engine->SetNumberOfThreads(volumeNodes.count() >= 8 ? 0 : 1);
+  this->LinkedProbePoint->SetPoint(0, ras[0], ras[1], ras[2]);
+  engine->RemoveAllPoints();
+  engine->AddPoints(this->LinkedProbePoint);
+  engine->RemoveAllVolumeNodes();
+  foreach(vtkMRMLVolumeNode * volumeNode, volumeNodes)
+    {
+    engine->AddVolumeNode(volumeNode);
+    }
+  if (!engine->Update())
+    {
+    return details;
+    }
+
+  vtkTable * output = engine->GetOutput();
+  foreach(const ViewLayersType& view, viewLayers)
+    {
+    QStringList layerValues;
+    foreach(const LayerIdAndVolumeIndexType& layer, view.second)
+      {
+      vtkDoubleArray * values = vtkDoubleArray::SafeDownCast(
+        output->GetColumn(engine->GetValueColumnIndex(layer.second)));
+      vtkIntArray * statuses = vtkIntArray::SafeDownCast(
+        output->GetColumn(engine->GetStatusColumnIndex(layer.second)));
+      if (!values || !statuses)
+        {
+        continue;
+        }
       QString valueAsString;
-      if (volumeNode)
+      int probeStatus = statuses->GetValue(0);
+      if (probeStatus & vtkSlicerDataProbeLogic::PROBE_SUCCESS)
+        {
+        QStringList components;
+        for (int componentIdx = 0; componentIdx < values->GetNumberOfComponents(); ++componentIdx)
+          {
+          double value = values->GetComponent(0, componentIdx);
+          components << ((probeStatus & vtkSlicerDataProbeLogic::LABEL_VOLUME) ?
+            QString::number(static_cast<int>(value)) :
+            QString::number(value, /* format = */ 'f', /* precision= */ 1));
+          }
+        valueAsString = components.join(" ");
+        }
+      else
+        {
+        valueAsString = vtkSlicerDataProbeLogic::GetDataProbeStatusEnumAsString(probeStatus);
+        }
+      layerValues << QString("%1 %2 %3").arg(layer.first)
+        .arg(volumeNodes[layer.second]->GetName()).arg(valueAsString);
+      }
+    details << QString("%1: %2").arg(view.first).arg(layerValues.join(", "));
+    }
+  return details;
+}
+
+//-----------------------------------------------------------------------------
+QString qSlicerDataProbeInfoWidgetPrivate::probeViewportStatistics(const QString& sliceLayerId,
+                                                                   vtkMRMLSliceLayerLogic* sliceLayerLogic)
+{
+  if (!this->DataProbeLogic || !sliceLayerLogic || !sliceLayerLogic->GetVolumeNode())
+    {
+    return QString();
+    }
+  // Every 4th pixel along X and Y while approximating
+  int probeStatus = this->DataProbeLogic->ProbeViewportStatistics(sliceLayerLogic, this->Approximate ? 4 : 1);
+  vtkSlicerDataProbeViewportStatistics * statistics = this->DataProbeLogic->GetViewportStatistics();
+  if (!(probeStatus & vtkSlicerDataProbeLogic::PROBE_SUCCESS) || !statistics ||
+      statistics->GetNumberOfVoxels() == 0)
+    {
+    return QString();
+    }
+  // Pans are updated exactly even while approximating
+  const int sampleStride = statistics->GetSampleStride();
+  QString viewportStatistics =
+    QString("%1 viewport: mean %2, sd %3, min %4, max %5 (%6 voxels)").arg(sliceLayerId)
+    .arg(statistics->GetMean(), /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1)
+    .arg(statistics->GetStandardDeviation(), /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1)
+    .arg(statistics->GetMinimum())
+    .arg(statistics->GetMaximum())
+    .arg(statistics->GetNumberOfVoxels() * sampleStride * sampleStride);
+  return sampleStride > 1 ? this->markApproximate(viewportStatistics) : viewportStatistics;
+}
+
+//-----------------------------------------------------------------------------
+QString qSlicerDataProbeInfoWidgetPrivate::probePercentile(const QString& sliceLayerId,
+                                                           vtkMRMLVolumeNode* volumeNode,
+                                                           const QList<double>& ijk)
+{
+  double ijkAsArray[3] = {ijk[0], ijk[1], ijk[2]};
+  int probeStatus = this->DataProbeLogic->ProbePercentile(volumeNode, ijkAsArray);
+  if (probeStatus == vtkSlicerDataProbeLogic::PROBE_ERROR_HISTOGRAM_NOT_READY)
+    {
+    return QString("%1 percentile: %2").arg(sliceLayerId).arg(
+      vtkSlicerDataProbeLogic::GetDataProbeStatusEnumAsString(probeStatus));
+    }
+  double percentile = this->DataProbeLogic->GetPercentile();
+  if (vtkMath::IsNan(percentile))
+    {
+    return QString();
+    }
+  return QString("%1 percentile: %2").arg(sliceLayerId)
+    .arg(percentile, /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1);
+}
+
+//-----------------------------------------------------------------------------
+QString qSlicerDataProbeInfoWidgetPrivate::probeLabelComposition(const QString& sliceLayerId,
+                                                                 vtkMRMLVolumeNode* volumeNode,
+                                                                 const QList<double>& ijk)
+{
+  double ijkAsArray[3] = {ijk[0], ijk[1], ijk[2]};
+  if (this->LabelCompositionRadius > 0.)
+    {
+    this->DataProbeLogic->ProbeLabelCompositionWithinRadius(volumeNode, ijkAsArray, this->LabelCompositionRadius);
+    }
+  else
+    {
+    this->DataProbeLogic->ProbeLabelComposition(volumeNode, ijkAsArray);
+    }
+  const int numberOfLabels = this->DataProbeLogic->GetNumberOfNeighborhoodLabels();
+  if (numberOfLabels == 0)
+    {
+    return QString();
+    }
+  // The 4 most frequent labels
+  QStringList labels;
+  for (int labelIdx = 0; labelIdx < qMin(numberOfLabels, 4); ++labelIdx)
+    {
+    QString labelName = QString::fromStdString(this->DataProbeLogic->GetNeighborhoodLabelName(labelIdx));
+    labels << QString("%1% %2")
+      .arg(100. * this->DataProbeLogic->GetNeighborhoodLabelFraction(labelIdx),
+           /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 0)
+      .arg(labelName.isEmpty() ? QString::number(this->DataProbeLogic->GetNeighborhoodLabel(labelIdx)) : labelName);
+    }
+  if (numberOfLabels > 4)
+    {
+    labels << QString("%1 more").arg(numberOfLabels - 4);
+    }
+  return QString("%1 neighborhood: %2").arg(sliceLayerId).arg(labels.join(", "));
+}
+
+//-----------------------------------------------------------------------------
+QString qSlicerDataProbeInfoWidgetPrivate::probeDisplacement(const QString& sliceLayerId,
+                                                             vtkMRMLVolumeNode* volumeNode,
+                                                             const QList<double>& ijk)
+{
+  double ijkAsArray[3] = {ijk[0], ijk[1], ijk[2]};
+  int probeStatus = this->DataProbeLogic->ProbeDisplacement(volumeNode, ijkAsArray);
+  if (!(probeStatus & vtkSlicerDataProbeLogic::PROBE_SUCCESS))
+    {
+    return QString();
+    }
+  double strains[3] = {0., 0., 0.};
+  this->DataProbeLogic->GetPrincipalStrains(strains);
+  return QString("%1 displacement: %2 mm, det J %3, strains %4, %5, %6").arg(sliceLayerId)
+    .arg(this->DataProbeLogic->GetDisplacementMagnitude(), /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 2)
+    .arg(this->DataProbeLogic->GetJacobianDeterminant(), /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 3)
+    .arg(strains[0], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 3)
+    .arg(strains[1], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 3)
+    .arg(strains[2], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 3);
+}
+
+//-----------------------------------------------------------------------------
+QStringList qSlicerDataProbeInfoWidgetPrivate::probeModels(vtkMRMLSliceNode* sliceNode,
+                                                           const QList<double>& ras)
+{
+  Q_Q(qSlicerDataProbeInfoWidget);
+  QStringList details;
+  if (!this->DataProbeLogic || !q->mrmlScene())
+    {
+    return details;
+    }
+
+  // Tolerance of 5 pixels
+  vtkMatrix4x4 * xyToRAS = sliceNode->GetXYToRAS();
+  double pixelSize = sqrt(xyToRAS->GetElement(0, 0) * xyToRAS->GetElement(0, 0) +
+                          xyToRAS->GetElement(1, 0) * xyToRAS->GetElement(1, 0) +
+                          xyToRAS->GetElement(2, 0) * xyToRAS->GetElement(2, 0));
+  double maximumDistance = 5. * pixelSize;
+
+  double rasAsArray[3] = {ras[0], ras[1], ras[2]};
+  vtkMatrix4x4 * sliceToRAS = sliceNode->GetSliceToRAS();
+  double sliceNormal[3] = {sliceToRAS->GetElement(0, 2), sliceToRAS->GetElement(1, 2),
+                           sliceToRAS->GetElement(2, 2)};
+  foreach(vtkMRMLNode * node, this->nodesByClass("vtkMRMLModelNode"))
+    {
+    vtkMRMLModelNode * modelNode = vtkMRMLModelNode::SafeDownCast(node);
+    vtkMRMLModelDisplayNode * displayNode = modelNode ? modelNode->GetModelDisplayNode() : 0;
+    if (!displayNode || !displayNode->GetVisibility() || !displayNode->GetSliceIntersectionVisibility())
+      {
+      continue;
+      }
+    if (this->FiberBundleProbing && modelNode->IsA("vtkMRMLFiberBundleNode"))
+      {
+      // Reported by probeFiberBundles()
+      continue;
+      }
+    int probeStatus = this->DataProbeLogic->ProbeModelIntersection(
+      modelNode, rasAsArray, sliceNormal, maximumDistance);
+    if (!(probeStatus & vtkSlicerDataProbeLogic::PROBE_SUCCESS))
+      {
+      continue;
+      }
+    QString valueAsString = probeStatus == vtkSlicerDataProbeLogic::PROBE_SUCCESS_MODEL_NO_SCALARS ?
+      QString::fromStdString(this->DataProbeLogic->GetPixelProbeStatusAsString()) :
+      this->probedValueAsString(probeStatus);
+    details << QString("%1: %2 (cell %3, %4 mm)")
+      .arg(modelNode->GetName())
+      .arg(valueAsString)
+      .arg(this->DataProbeLogic->GetModelCellId())
+      .arg(this->DataProbeLogic->GetModelDistance(), /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1);
+    }
+  return details;
+}
+
+//-----------------------------------------------------------------------------
+QStringList qSlicerDataProbeInfoWidgetPrivate::probeFiberBundles(const QList<double>& ras)
+{
+  Q_Q(qSlicerDataProbeInfoWidget);
+  QStringList details;
+  if (!this->DataProbeLogic || !q->mrmlScene())
+    {
+    return details;
+    }
+  double rasAsArray[3] = {ras[0], ras[1], ras[2]};
+  // The fiber bundle nodes are registered by the tractography module
+  foreach(vtkMRMLNode * node, this->nodesByClass("vtkMRMLFiberBundleNode"))
+    {
+    vtkMRMLModelNode * fiberBundleNode = vtkMRMLModelNode::SafeDownCast(node);
+    bool visible = false;
+    for (int displayNodeIdx = 0; fiberBundleNode && displayNodeIdx < fiberBundleNode->GetNumberOfDisplayNodes();
+         ++displayNodeIdx)
+      {
+      vtkMRMLDisplayNode * displayNode = fiberBundleNode->GetNthDisplayNode(displayNodeIdx);
+      visible = visible || (displayNode && displayNode->GetVisibility());
+      }
+    if (!visible)
+      {
+      continue;
+      }
+    int probeStatus = this->DataProbeLogic->ProbeFiberBundle(fiberBundleNode, rasAsArray, this->FiberProbingRadius);
+    if (!(probeStatus & vtkSlicerDataProbeLogic::PROBE_SUCCESS))
+      {
+      continue;
+      }
+    int numberOfFibers = this->DataProbeLogic->GetNumberOfProbedFibers();
+    QString fibers = QString("%1: %2 fiber%3 within %4 mm")
+      .arg(fiberBundleNode->GetName())
+      .arg(numberOfFibers)
+      .arg(numberOfFibers > 1 ? "s" : "")
+      .arg(this->FiberProbingRadius, /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1);
+    if (probeStatus != vtkSlicerDataProbeLogic::PROBE_SUCCESS_MODEL_NO_SCALARS)
+      {
+      // Value at the closest point of the nearest fiber and mean over the fibers
+      QString scalarName = QString::fromStdString(this->DataProbeLogic->GetPixelDescription());
+      double sum = 0.;
+      int numberOfValues = 0;
+      for (int fiberIdx = 0; fiberIdx < numberOfFibers; ++fiberIdx)
         {
-        layerName = volumeNode->GetName();
-        QList<double> ijk = d->convertXYZToIJK(sliceLayerLogic, xyz);
+        double value = this->DataProbeLogic->GetProbedFiberValue(fiberIdx);
+        if (!vtkMath::IsNan(value))
+          {
+          sum += value;
+          ++numberOfValues;
+          }
+        }
+      fibers.append(QString(", nearest %1 %2 (%3 mm)")
+        .arg(scalarName)
+        .arg(this->DataProbeLogic->GetProbedFiberValue(0), /* fieldWidth= */ 0, /* format = */ 'g', /* precision= */ 3)
+        .arg(this->DataProbeLogic->GetProbedFiberDistance(0), /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1));
+      if (numberOfValues > 1)
+        {
+        fibers.append(QString(", mean %1 %2").arg(scalarName)
+          .arg(sum / numberOfValues, /* fieldWidth= */ 0, /* format = */ 'g', /* precision= */ 3));
+        }
+      }
+    details << fibers;
+    }
+  return details;
+}
+
+//-----------------------------------------------------------------------------
+QList<double>
+qSlicerDataProbeInfoWidgetPrivate::convertXYZToIJK(vtkMRMLSliceLayerLogic* slicerLayerLogic,
+                                                   const QList<double>& xyz,
+                                                   const QList<double>& ras) const
+{
+  vtkMRMLVolumeNode * volumeNode = slicerLayerLogic->GetVolumeNode();
+  if (!volumeNode)
+    {
+    return QList<double>() << 0.0 << 0.0 << 0.0;
+    }
+  if (this->DataProbeLogic && vtkSlicerDataProbeTransformCache::IsTransformedNonLinearly(volumeNode))
+    {
+    // The XY to IJK transform of the layer only accounts for linear transforms
+    double rasAsArray[3] = {ras[0], ras[1], ras[2]};
+    double ijk[3] = {0.0, 0.0, 0.0};
+    this->DataProbeLogic->ConvertRASToIJK(volumeNode, rasAsArray, ijk);
+    return QList<double>() << ijk[0] << ijk[1] << ijk[2];
+    }
+  vtkMatrix4x4 * xyToIJK = slicerLayerLogic->GetXYToIJKTransform()->GetMatrix();
+  double xyzw[4] = {xyz[0], xyz[1], xyz[2], 1.0};
+  double ijkw[4] = {0.0, 0.0, 0.0, 0.0};
+  xyToIJK->MultiplyPoint(xyzw, ijkw);
+  Q_ASSERT(ijkw[3] == 1.0);
+  return QList<double>() << ijkw[0] <<  ijkw[1] <<  ijkw[2];
+}
+
+//-----------------------------------------------------------------------------
+QString qSlicerDataProbeInfoWidgetPrivate::probedValueAsString(int probeStatus) const
+{
+  QString valueAsString;
+  if (!(probeStatus & vtkSlicerDataProbeLogic::PROBE_SUCCESS))
+    {
+    return QString::fromStdString(this->DataProbeLogic->GetPixelProbeStatusAsString());
+    }
+  if (this->DataProbeLogic->GetPixelNumberOfComponents() > 3)
+    {
+    valueAsString = QString("%1 components").arg(this->DataProbeLogic->GetPixelNumberOfComponents());
+    }
+  else
+    {
+    QStringList valueAsStrings;
+    for(int pixelValueIdx = 0; pixelValueIdx < this->DataProbeLogic->GetNumberOfPixelValues(); ++pixelValueIdx)
+      {
+      valueAsStrings << QString("%1").
+                        arg(this->DataProbeLogic->GetPixelValue(pixelValueIdx), /* fieldWidth= */ 0, /* format = */ 'g', /* precision= */ 4);
+      }
+    valueAsString = valueAsStrings.join(", ");
+    }
+  if (this->DataProbeLogic->GetNumberOfPixelSegments() > 0)
+    {
+    // Overlapping segments of a bit-packed or layered label map
+    QStringList segmentAsStrings;
+    for (int segmentIdx = 0; segmentIdx < this->DataProbeLogic->GetNumberOfPixelSegments(); ++segmentIdx)
+      {
+      segmentAsStrings << QString::number(this->DataProbeLogic->GetPixelSegment(segmentIdx));
+      }
+    valueAsString = segmentAsStrings.join(", ");
+    }
+  QString pixelDescription = QString::fromStdString(this->DataProbeLogic->GetPixelDescription());
+  if (!pixelDescription.isEmpty())
+    {
+    pixelDescription.append(" ");
+    if (probeStatus == vtkSlicerDataProbeLogic::PROBE_SUCCESS_LABEL_VOLUME ||
+        probeStatus == vtkSlicerDataProbeLogic::PROBE_SUCCESS_LABEL_VOLUME_UNKNOWN_LABELNAME)
+      {
+      valueAsString = QString("(%1)").arg(valueAsString);
+      }
+    valueAsString.prepend(pixelDescription);
+    }
+  return valueAsString;
+}
+
+//-----------------------------------------------------------------------------
+QString qSlicerDataProbeInfoWidgetPrivate::probePath(const QString& sliceLayerId,
+                                                     vtkMRMLVolumeNode* volumeNode,
+                                                     const QList<double>& ijk)
+{
+  PathState& state = this->PathStates[sliceLayerId];
+  if (!state.Trace)
+    {
+    state.Trace = vtkSmartPointer<vtkSlicerDataProbePathTrace>::New();
+    }
+  QString volumeNodeID = QString::fromLatin1(volumeNode->GetID());
+  if (state.VolumeNodeID != volumeNodeID || state.LastIJK.isEmpty())
+    {
+    state.Trace->Reset();
+    state.VolumeNodeID = volumeNodeID;
+    state.LastIJK = ijk;
+    }
+  double startIJK[3] = {state.LastIJK[0], state.LastIJK[1], state.LastIJK[2]};
+  double endIJK[3] = {ijk[0], ijk[1], ijk[2]};
+  state.LastIJK = ijk;
+  this->DataProbeLogic->ProbePath(volumeNode, startIJK, endIJK, state.Trace);
+  if (state.Trace->GetNumberOfSamples() == 0)
+    {
+    return QString();
+    }
+  return QString("%1 path: %2 voxels, min %3, max %4, mean %5")
+    .arg(sliceLayerId)
+    .arg(state.Trace->GetNumberOfSamples())
+    .arg(state.Trace->GetMinimum(), /* fieldWidth= */ 0, /* format = */ 'g', /* precision= */ 4)
+    .arg(state.Trace->GetMaximum(), /* fieldWidth= */ 0, /* format = */ 'g', /* precision= */ 4)
+    .arg(state.Trace->GetMean(), /* fieldWidth= */ 0, /* format = */ 'g', /* precision= */ 4);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidgetPrivate::probeView(vtkInteractorObserver * interactorStyle, unsigned long eventId,
+                                                  const int xy[2])
+{
+  qMRMLThreeDWidget * threeDWidget = this->threeDWidget(interactorStyle);
+  if (threeDWidget)
+    {
+    this->probeThreeDView(threeDWidget, xy);
+    this->publishResult();
+    return;
+    }
+  this->updateProgressiveState(interactorStyle, eventId, xy);
+  qMRMLSliceWidget * sliceWidget = this->slicerWidget(interactorStyle);
+  Q_ASSERT(sliceWidget);
+
+  // Compute RAS
+  QList<double> xyz = sliceWidget->convertDeviceToXYZ(QList<int>() << xy[0] << xy[1]);
+  QList<double> ras = sliceWidget->convertXYZToRAS(xyz);
+
+  vtkMRMLSliceLogic * sliceLogic = sliceWidget->sliceLogic();
+  vtkMRMLSliceNode * sliceNode = sliceWidget->mrmlSliceNode();
+
+  // RAS
+  this->ViewerRAS->setText(QString("RAS: (%1, %2, %3)").
+                           arg(ras[0], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1).
+                           arg(ras[1], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1).
+                           arg(ras[2], /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1));
+
+  // Orientation
+  this->ViewerOrient->setText(QString("  %1").arg(sliceWidget->sliceOrientation()));
+
+  // Spacing
+  QString spacing = QString("%1").arg(
+        sliceLogic->GetLowestVolumeSliceSpacing()[2],
+        /* fieldWidth= */ 0, /* format = */ 'f', /* precision= */ 1);
+  if (sliceNode->GetSliceSpacingMode() == vtkMRMLSliceNode::PrescribedSliceSpacingMode)
+    {
+    spacing = "(" + spacing + ")";
+    }
+  this->ViewerSpacing->setText(QString("Sp: %1").arg(spacing));
+
+  // Color
+  double layoutColor[3] = {0.0, 0.0, 0.0};
+  sliceNode->GetLayoutColor(layoutColor);
+  this->ViewerColor->setStyleSheet(
+        QString("QLabel {background-color : %1}").arg(
+          QColor::fromRgbF(layoutColor[0], layoutColor[1], layoutColor[2]).name()));
+
+  // Name
+  this->ViewerName->setText(QString("  %1  ").arg(sliceNode->GetLayoutName()));
+
+  // Published result
+  if (vtkMRMLDataProbeResultNode * resultNode = this->resultNode())
+    {
+    double rasAsArray[3] = {ras[0], ras[1], ras[2]};
+    resultNode->SetViewName(sliceNode->GetLayoutName());
+    resultNode->SetRAS(rasAsArray);
+    }
+
+  // Layer name, ijk and value
+  QStringList details;
+  typedef QPair<QString, vtkMRMLSliceLayerLogic*> LayerIdAndLogicType;
+  foreach(LayerIdAndLogicType layerIdAndLogic,
+          (QList<LayerIdAndLogicType>()
+          << LayerIdAndLogicType("L", sliceLogic->GetLabelLayer())
+          << LayerIdAndLogicType("B", sliceLogic->GetBackgroundLayer())
+          << LayerIdAndLogicType("F", sliceLogic->GetForegroundLayer())))
+    {
+    QString sliceLayerId = layerIdAndLogic.first;
+    vtkMRMLSliceLayerLogic * sliceLayerLogic = layerIdAndLogic.second;
+
+    vtkMRMLVolumeNode * volumeNode = sliceLayerLogic->GetVolumeNode();
+    QString layerName = "None";
+    QString ijkAsString;
+    // Rich text, the names within it are escaped
+    QString valueAsString;
+    if (volumeNode)
+      {
+      layerName = volumeNode->GetName();
+      if (this->DisplayedValueProbing && this->DataProbeLogic)
+        {
+        ijkAsString = QString("XY (%1, %2)").arg(qRound(xyz[0])).arg(qRound(xyz[1]));
+        int probeStatus = this->DataProbeLogic->ProbeDisplayedPixel(sliceLayerLogic, xyz[0], xyz[1], xyz[2]);
+        valueAsString = Qt::escape(this->probedValueAsString(probeStatus));
+        QList<double> ijk = this->convertXYZToIJK(sliceLayerLogic, xyz, ras);
+        double ijkAsArray[3] = {ijk[0], ijk[1], ijk[2]};
+        this->setLayerResult(sliceLayerId, volumeNode, ijkAsArray, probeStatus);
+        double windowLevelValue = this->DataProbeLogic->GetDisplayedWindowLevelValue();
+        if (!vtkMath::IsNan(windowLevelValue))
+          {
+          valueAsString.append(QString(" W/L %1").arg(qRound(windowLevelValue)));
+          }
+        double displayedColor[4] = {0., 0., 0., 0.};
+        if (this->DataProbeLogic->GetDisplayedColor(displayedColor))
+          {
+          // Swatch of the displayed color followed by its RGB components
+          QColor color(qRound(displayedColor[0]), qRound(displayedColor[1]), qRound(displayedColor[2]));
+          valueAsString.append(QString(" <font color=\"%1\">&#9632;</font> RGB (%2, %3, %4)")
+            .arg(color.name()).arg(color.red()).arg(color.green()).arg(color.blue()));
+          }
+        }
+      else
+        {
+        QList<double> ijk = this->convertXYZToIJK(sliceLayerLogic, xyz, ras);
         ijkAsString = QString("(%1, %2, %3)").arg(qRound(ijk[0])).arg(qRound(ijk[1])).arg(qRound(ijk[2]));
-        if(d->DataProbeLogic)
+        if(this->DataProbeLogic)
           {
-          int probeStatus = d->DataProbeLogic->ProbePixel(volumeNode, ijk[0], ijk[1], ijk[2]);
-          if (probeStatus & vtkSlicerDataProbeLogic::PROBE_SUCCESS)
+          if (this->PathProbing)
+            {
+            QString pathDetails = this->probePath(sliceLayerId, volumeNode, ijk);
+            if (!pathDetails.isEmpty())
+              {
+              details << pathDetails;
+              }
+            }
+          vtkMRMLScalarVolumeNode * scalarVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode);
+          // Overlapping segments are only decoded by ProbePixel()
+          if ((this->LabelStatisticsProbing || this->ComponentProbing || this->BoundaryDistanceProbing) &&
+              scalarVolumeNode && scalarVolumeNode->GetLabelMap() &&
+              vtkSlicerDataProbeLogic::GetLabelEncoding(scalarVolumeNode) ==
+              vtkSlicerDataProbeLogic::SINGLE_LABEL_ENCODING)
             {
-            if (d->DataProbeLogic->GetPixelNumberOfComponents() > 3)
+            double ijkAsArray[3] = {ijk[0], ijk[1], ijk[2]};
+            int probeStatus = this->LabelStatisticsProbing ?
+              this->DataProbeLogic->ProbeLabelStatistics(volumeNode, ijkAsArray) :
+              this->DataProbeLogic->ProbePixel(volumeNode, ijkAsArray);
+            valueAsString = Qt::escape(this->probedValueAsString(probeStatus));
+            this->setLayerResult(sliceLayerId, volumeNode, ijkAsArray, probeStatus);
+            QString labelStatistics = this->labelStatisticsAsString(sliceLayerId);
+            if (!labelStatistics.isEmpty())
               {
-              valueAsString = QString("%1 components").arg(d->DataProbeLogic->GetPixelNumberOfComponents());
+              details << labelStatistics;
               }
-            else
+            // The voxel is probed once, the component and the distance are
+            // those of the probed voxel
+            int voxel[3] = {-1, -1, -1};
+            this->DataProbeLogic->GetPixelVoxel(voxel);
+            bool probed = (probeStatus & vtkSlicerDataProbeLogic::PROBE_SUCCESS) != 0;
+            if (this->ComponentProbing && probed)
               {
-              QStringList valueAsStrings;
-              for(int pixelValueIdx = 0; pixelValueIdx < d->DataProbeLogic->GetNumberOfPixelValues(); ++pixelValueIdx)
+              this->DataProbeLogic->ProbeComponent(volumeNode, voxel,
+                                                   static_cast<int>(this->DataProbeLogic->GetPixelValue(0)));
+              QString componentStatistics = this->componentStatisticsAsString(sliceLayerId);
+              if (!componentStatistics.isEmpty())
                 {
-                valueAsStrings << QString("%1").
-                                  arg(d->DataProbeLogic->GetPixelValue(pixelValueIdx), /* fieldWidth= */ 0, /* format = */ 'g', /* precision= */ 4);
+                details << componentStatistics;
                 }
-              valueAsString = valueAsStrings.join(", ");
               }
-            QString pixelDescription = QString::fromStdString(d->DataProbeLogic->GetPixelDescription());
-            if (!pixelDescription.isEmpty())
+            QString boundaryDistance = this->BoundaryDistanceProbing && probed ?
+              this->probeBoundaryDistance(sliceLayerId, volumeNode, voxel) : QString();
+            if (!boundaryDistance.isEmpty())
               {
-              pixelDescription.append(" ");
-              if (probeStatus == vtkSlicerDataProbeLogic::PROBE_SUCCESS_LABEL_VOLUME ||
-                  probeStatus == vtkSlicerDataProbeLogic::PROBE_SUCCESS_LABEL_VOLUME_UNKNOWN_LABELNAME)
-                {
-                valueAsString = QString("(%1)").arg(valueAsString);
-                }
-              valueAsString.prepend(pixelDescription);
+              details << boundaryDistance;
               }
             }
           else
             {
-            valueAsString = QString::fromStdString(d->DataProbeLogic->GetPixelProbeStatusAsString());
+            int probeStatus = this->DataProbeLogic->ProbePixel(volumeNode, ijk[0], ijk[1], ijk[2]);
+            valueAsString = Qt::escape(this->probedValueAsString(probeStatus));
+            double ijkAsArray[3] = {ijk[0], ijk[1], ijk[2]};
+            this->setLayerResult(sliceLayerId, volumeNode, ijkAsArray, probeStatus);
+            QString percentile = this->PercentileProbing && scalarVolumeNode && !scalarVolumeNode->GetLabelMap() ?
+              this->probePercentile(sliceLayerId, volumeNode, ijk) : QString();
+            if (!percentile.isEmpty())
+              {
+              details << percentile;
+              }
+            QString displacement = this->DisplacementFieldProbing && scalarVolumeNode ?
+              this->probeDisplacement(sliceLayerId, volumeNode, ijk) : QString();
+            if (!displacement.isEmpty())
+              {
+              details << displacement;
+              }
+            }
+          QString labelComposition = this->LabelCompositionProbing && scalarVolumeNode &&
+            scalarVolumeNode->GetLabelMap() ? this->probeLabelComposition(sliceLayerId, volumeNode, ijk) : QString();
+          if (!labelComposition.isEmpty())
+            {
+            details << labelComposition;
             }
           }
         }
-      d->RowsOfLayerLabels[sliceLayerId].at(0)->setText(QString("<b>%1</b>").arg(layerName));
-      d->RowsOfLayerLabels[sliceLayerId].at(1)->setText(ijkAsString);
-      d->RowsOfLayerLabels[sliceLayerId].at(2)->setText(QString("<b>%1</b>").arg(valueAsString));
       }
+    if (!volumeNode)
+      {
+      this->setLayerResult(sliceLayerId, 0, 0, 0);
+      }
+    this->RowsOfLayerLabels[sliceLayerId].at(0)->setText(QString("<b>%1</b>").arg(Qt::escape(layerName)));
+    this->RowsOfLayerLabels[sliceLayerId].at(1)->setText(ijkAsString);
+    this->RowsOfLayerLabels[sliceLayerId].at(2)->setText(QString("<b>%1</b>").arg(valueAsString));
+    }
+
+  // Foreground compared to background
+  if (this->LayerComparisonProbing && this->DataProbeLogic && !this->DisplayedValueProbing)
+    {
+    QString layerComparison = this->probeLayerComparison(sliceLogic, ras);
+    if (!layerComparison.isEmpty())
+      {
+      details << layerComparison;
+      }
+    }
+  if (this->LinkedProbing)
+    {
+    details << this->probeLinkedViews(sliceNode, ras);
+    }
+  if (this->ViewportStatisticsProbing)
+    {
+    foreach(LayerIdAndLogicType layerIdAndLogic,
+            (QList<LayerIdAndLogicType>()
+            << LayerIdAndLogicType("B", sliceLogic->GetBackgroundLayer())
+            << LayerIdAndLogicType("F", sliceLogic->GetForegroundLayer())))
+      {
+      QString viewportStatistics = this->probeViewportStatistics(layerIdAndLogic.first, layerIdAndLogic.second);
+      if (!viewportStatistics.isEmpty())
+        {
+        details << viewportStatistics;
+        }
+      }
+    }
+
+  // Models
+  details << this->probeModels(sliceNode, ras);
+  if (this->FiberBundleProbing)
+    {
+    details << this->probeFiberBundles(ras);
+    }
+  this->ProbeDetails->setText(details.join("\n"));
+  this->publishResult();
+}
+
+//-----------------------------------------------------------------------------
+// qSlicerDataProbeInfoWidget methods
+
+//-----------------------------------------------------------------------------
+qSlicerDataProbeInfoWidget::qSlicerDataProbeInfoWidget(QWidget *_parent):
+  Superclass(_parent), d_ptr(new qSlicerDataProbeInfoWidgetPrivate(*this))
+{
+  Q_D(qSlicerDataProbeInfoWidget);
+  d->init();
+}
+
+//-----------------------------------------------------------------------------
+qSlicerDataProbeInfoWidget::~qSlicerDataProbeInfoWidget()
+{
+}
+
+//-----------------------------------------------------------------------------
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, qSlicerLayoutManager*, layoutManager, LayoutManager)
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidget::setLayoutManager(qSlicerLayoutManager* layoutManager)
+{
+  Q_D(qSlicerDataProbeInfoWidget);
+
+  if (layoutManager == d->LayoutManager)
+    {
+    return;
+    }
+  if (d->LayoutManager)
+    {
+    disconnect(d->LayoutManager, SIGNAL(layoutChanged()), this, SLOT(onLayoutChanged()));
+    }
+  if (layoutManager)
+    {
+    connect(layoutManager, SIGNAL(layoutChanged()), this, SLOT(onLayoutChanged()));
+    }
+  d->LayoutManager = layoutManager;
+
+  this->onLayoutChanged();
+}
+
+//-----------------------------------------------------------------------------
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, vtkSlicerDataProbeLogic*, dataProbeLogic, DataProbeLogic)
+CTK_SET_CPP(qSlicerDataProbeInfoWidget, vtkSlicerDataProbeLogic*, setDataProbeLogic, DataProbeLogic)
 
+//-----------------------------------------------------------------------------
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, bool, displayedValueProbing, DisplayedValueProbing)
+CTK_SET_CPP(qSlicerDataProbeInfoWidget, bool, setDisplayedValueProbing, DisplayedValueProbing)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, bool, pathProbing, PathProbing)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, bool, maximumRayProbing, MaximumRayProbing)
+CTK_SET_CPP(qSlicerDataProbeInfoWidget, bool, setMaximumRayProbing, MaximumRayProbing)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, bool, labelStatisticsProbing, LabelStatisticsProbing)
+CTK_SET_CPP(qSlicerDataProbeInfoWidget, bool, setLabelStatisticsProbing, LabelStatisticsProbing)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, bool, componentProbing, ComponentProbing)
+CTK_SET_CPP(qSlicerDataProbeInfoWidget, bool, setComponentProbing, ComponentProbing)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, bool, boundaryDistanceProbing, BoundaryDistanceProbing)
+CTK_SET_CPP(qSlicerDataProbeInfoWidget, bool, setBoundaryDistanceProbing, BoundaryDistanceProbing)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, bool, percentileProbing, PercentileProbing)
+CTK_SET_CPP(qSlicerDataProbeInfoWidget, bool, setPercentileProbing, PercentileProbing)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, bool, layerComparisonProbing, LayerComparisonProbing)
+CTK_SET_CPP(qSlicerDataProbeInfoWidget, bool, setLayerComparisonProbing, LayerComparisonProbing)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, bool, linkedProbing, LinkedProbing)
+CTK_SET_CPP(qSlicerDataProbeInfoWidget, bool, setLinkedProbing, LinkedProbing)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, bool, viewportStatisticsProbing, ViewportStatisticsProbing)
+CTK_SET_CPP(qSlicerDataProbeInfoWidget, bool, setViewportStatisticsProbing, ViewportStatisticsProbing)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, bool, fiberBundleProbing, FiberBundleProbing)
+CTK_SET_CPP(qSlicerDataProbeInfoWidget, bool, setFiberBundleProbing, FiberBundleProbing)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, double, fiberProbingRadius, FiberProbingRadius)
+CTK_SET_CPP(qSlicerDataProbeInfoWidget, double, setFiberProbingRadius, FiberProbingRadius)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, bool, displacementFieldProbing, DisplacementFieldProbing)
+CTK_SET_CPP(qSlicerDataProbeInfoWidget, bool, setDisplacementFieldProbing, DisplacementFieldProbing)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, bool, labelCompositionProbing, LabelCompositionProbing)
+CTK_SET_CPP(qSlicerDataProbeInfoWidget, bool, setLabelCompositionProbing, LabelCompositionProbing)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, double, labelCompositionRadius, LabelCompositionRadius)
+CTK_SET_CPP(qSlicerDataProbeInfoWidget, double, setLabelCompositionRadius, LabelCompositionRadius)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, bool, eventTraceRecording, EventTraceRecording)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, QString, sharedMemoryStreamName, SharedMemoryStreamName)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, bool, progressiveProbing, ProgressiveProbing)
+CTK_GET_CPP(qSlicerDataProbeInfoWidget, int, progressiveRefinementDelay, ProgressiveRefinementDelay)
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidget::setProgressiveProbing(bool enabled)
+{
+  Q_D(qSlicerDataProbeInfoWidget);
+  d->ProgressiveProbing = enabled;
+  if (!enabled)
+    {
+    d->RefinementTimer.stop();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidget::setProgressiveRefinementDelay(int delay)
+{
+  Q_D(qSlicerDataProbeInfoWidget);
+  d->ProgressiveRefinementDelay = qMax(delay, 0);
+  d->RefinementTimer.setInterval(d->ProgressiveRefinementDelay);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidget::setSharedMemoryStreamName(const QString& name)
+{
+  Q_D(qSlicerDataProbeInfoWidget);
+  if (name == d->SharedMemoryStreamName)
+    {
+    return;
+    }
+  d->SharedMemoryStreamName.clear();
+  if (!d->DataProbeLogic)
+    {
+    qWarning() << "setSharedMemoryStreamName: no data probe logic, can't open" << name;
+    return;
+    }
+  vtkSlicerDataProbeSharedMemoryStream * stream = d->DataProbeLogic->GetSharedMemoryStream();
+  stream->Close();
+  if (!name.isEmpty() && stream->Open(name.toLatin1().constData()))
+    {
+    d->SharedMemoryStreamName = name;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidget::setEventTraceRecording(bool enabled)
+{
+  Q_D(qSlicerDataProbeInfoWidget);
+  if (enabled && !d->EventTraceRecording)
+    {
+    d->EventTrace->Reset();
+    d->SceneFingerprint = vtkSlicerDataProbeEventTrace::ComputeSceneFingerprint(this->mrmlScene());
+    }
+  d->EventTraceRecording = enabled;
+}
+
+//-----------------------------------------------------------------------------
+vtkSlicerDataProbeEventTrace* qSlicerDataProbeInfoWidget::eventTrace()const
+{
+  Q_D(const qSlicerDataProbeInfoWidget);
+  return d->EventTrace;
+}
+
+//-----------------------------------------------------------------------------
+int qSlicerDataProbeInfoWidget::replayEventTrace(vtkSlicerDataProbeEventTrace* trace)
+{
+  Q_D(qSlicerDataProbeInfoWidget);
+  if (!trace || !d->LayoutManager || trace == d->EventTrace.GetPointer())
+    {
+    qWarning() << "replayEventTrace: no trace, no layout or trace being recorded";
+    return 0;
+    }
+  unsigned int sceneFingerprint = vtkSlicerDataProbeEventTrace::ComputeSceneFingerprint(this->mrmlScene());
+  bool sceneDifferenceReported = false;
+  int numberOfReplayedEvents = 0;
+  d->Replaying = true;
+  for (vtkIdType eventIdx = 0; eventIdx < trace->GetNumberOfEvents(); ++eventIdx)
+    {
+    if (!sceneDifferenceReported && trace->GetEventSceneFingerprint(eventIdx) != sceneFingerprint)
+      {
+      qWarning() << "replayEventTrace: the events were recorded on a different scene";
+      sceneDifferenceReported = true;
+      }
+    QString viewName = trace->GetEventViewName(eventIdx);
+    vtkInteractorObserver * interactorStyle = d->interactorStyle(viewName);
+    if (!interactorStyle || !interactorStyle->GetInteractor())
+      {
+      continue;
+      }
+    unsigned long eventId = vtkCommand::MouseMoveEvent;
+    QString eventName = "MouseMove";
+    if (trace->GetEventType(eventIdx) == vtkSlicerDataProbeEventTrace::EnterEvent)
+      {
+      eventId = vtkCommand::EnterEvent;
+      eventName = "Enter";
+      }
+    else if (trace->GetEventType(eventIdx) == vtkSlicerDataProbeEventTrace::LeaveEvent)
+      {
+      eventId = vtkCommand::LeaveEvent;
+      eventName = "Leave";
+      }
+    int xy[2] = {0, 0};
+    trace->GetEventPosition(eventIdx, xy);
+    interactorStyle->GetInteractor()->SetEventPosition(xy);
+
+    QByteArray timerEventName = QString("DataProbe %1 %2").arg(eventName).arg(viewName).toLatin1();
+    vtkTimerLog::MarkStartEvent(timerEventName.constData());
+    this->processEvent(interactorStyle, 0, eventId, 0);
+    vtkTimerLog::MarkEndEvent(timerEventName.constData());
+    ++numberOfReplayedEvents;
+    }
+  d->Replaying = false;
+  return numberOfReplayedEvents;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidget::setPathProbing(bool enabled)
+{
+  Q_D(qSlicerDataProbeInfoWidget);
+  d->PathProbing = enabled;
+  this->resetPathTraces();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidget::resetPathTraces()
+{
+  Q_D(qSlicerDataProbeInfoWidget);
+  d->PathStates.clear();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidget::setMRMLScene(vtkMRMLScene* scene)
+{
+  Q_D(qSlicerDataProbeInfoWidget);
+  foreach(int event, QList<int>() << vtkMRMLScene::NodeAddedEvent << vtkMRMLScene::NodeRemovedEvent)
+    {
+    this->qvtkReconnect(this->mrmlScene(), scene, event, this, SLOT(onSceneNodesChanged()));
+    }
+  d->NodesByClass.clear();
+  this->Superclass::setMRMLScene(scene);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidget::onSceneNodesChanged()
+{
+  Q_D(qSlicerDataProbeInfoWidget);
+  d->NodesByClass.clear();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidget::onLayoutChanged()
+{
+  Q_D(qSlicerDataProbeInfoWidget);
+
+  if (!this->mrmlScene())
+    {
+    return;
+    }
+
+  d->removeObservers();
+
+  // Nothing is probed while the widget is hidden
+  if (!this->isVisible())
+    {
+    return;
+    }
+
+  // Add observers
+  foreach(vtkInteractorObserver * interactorStyle,
+          d->currentLayoutSliceViewInteractorStyles() + d->currentLayoutThreeDViewInteractorStyles())
+    {
+    foreach(int event, QList<int>()
+            << vtkCommand::MouseMoveEvent << vtkCommand::EnterEvent << vtkCommand::LeaveEvent)
+      {
+      qvtkConnect(interactorStyle, event,
+                  this, SLOT(processEvent(vtkObject*,void*,ulong,void*)));
+      }
+    d->ObservedInteractorStyles << interactorStyle;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidget::showEvent(QShowEvent* event)
+{
+  this->Superclass::showEvent(event);
+  this->onLayoutChanged();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidget::hideEvent(QHideEvent* event)
+{
+  Q_D(qSlicerDataProbeInfoWidget);
+  this->Superclass::hideEvent(event);
+  d->removeObservers();
+  d->resetLabels();
+  if (vtkMRMLDataProbeResultNode * resultNode = d->resultNode())
+    {
+    resultNode->Reset();
+    }
+  d->publishResult();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidget::
+processEvent(vtkObject* sender, void* callData, unsigned long eventId, void* clientData)
+{
+  Q_D(qSlicerDataProbeInfoWidget);
+  Q_UNUSED(callData);
+  Q_UNUSED(clientData);
+  if (d->EventTraceRecording && !d->Replaying)
+    {
+    d->recordEvent(vtkInteractorObserver::SafeDownCast(sender), eventId);
+    }
+  if (eventId == vtkCommand::LeaveEvent)
+    {
+    d->RefinementTimer.stop();
+    d->resetLabels();
+    if (vtkMRMLDataProbeResultNode * resultNode = d->resultNode())
+      {
+      resultNode->Reset();
+      }
+    d->publishResult();
+    }
+  else if(eventId == vtkCommand::EnterEvent || eventId == vtkCommand::MouseMoveEvent)
+    {
+    if (eventId == vtkCommand::EnterEvent)
+      {
+      this->resetPathTraces();
+      }
+
+    vtkInteractorObserver * interactorStyle = vtkInteractorObserver::SafeDownCast(sender);
+    Q_ASSERT(d->Replaying || d->ObservedInteractorStyles.indexOf(interactorStyle) != -1);
+    vtkRenderWindowInteractor * interactor = interactorStyle->GetInteractor();
+    int xy[2] = {-1, -1};
+    interactor->GetEventPosition(xy);
+    d->probeView(interactorStyle, eventId, xy);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidget::onResultNodeTimeout()
+{
+  Q_D(qSlicerDataProbeInfoWidget);
+  vtkMRMLDataProbeResultNode * resultNode = d->DataProbeLogic ? d->DataProbeLogic->GetResultNode() : 0;
+  if (!resultNode)
+    {
+    return;
+    }
+  resultNode->SetDisableModifiedEvent(0);
+  resultNode->InvokePendingModifiedEvent();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeInfoWidget::onRefinementTimeout()
+{
+  Q_D(qSlicerDataProbeInfoWidget);
+  vtkInteractorObserver * interactorStyle = d->RefinementInteractorStyle;
+  if (!interactorStyle || d->ObservedInteractorStyles.indexOf(interactorStyle) == -1)
+    {
+    return;
     }
+  // Probe the position the cursor rested at, the event position of the
+  // interactor is left untouched
+  d->Refining = true;
+  d->probeView(interactorStyle, vtkCommand::MouseMoveEvent, d->RefinementPosition);
+  d->Refining = false;
 }
@@ -33,6 +33,7 @@
 
 class qSlicerDataProbeInfoWidgetPrivate;
 class qSlicerLayoutManager;
+class vtkSlicerDataProbeEventTrace;
 class vtkSlicerDataProbeLogic;
 
 /// \ingroup Slicer_QtModules_DataProbe
@@ -40,6 +41,118 @@ class Q_SLICER_MODULE_DATAPROBE_WIDGETS_EXPORT qSlicerDataProbeInfoWidget : publ
 { 
   Q_OBJECT
   QVTK_OBJECT
+  /// If enabled, the values displayed in the slice views are probed from the
+  /// resliced layer images instead of the source volumes.
+  /// The slice interpolation is then taken into account and the window/level
+  /// mapped value and the displayed color, as a swatch and its RGB
+  /// components, are reported as well.
+  /// False by default.
+  Q_PROPERTY(bool displayedValueProbing READ displayedValueProbing WRITE setDisplayedValueProbing)
+  /// If enabled, all the voxels crossed by the cursor between two mouse
+  /// events are probed and accumulated per layer. The minimum, maximum and
+  /// mean along the stroke are reported. Strokes are reset when the cursor
+  /// enters a view.
+  /// False by default.
+  Q_PROPERTY(bool pathProbing READ pathProbing WRITE setPathProbing)
+  /// In 3D views, the volumes rendered in the view are probed along the ray
+  /// cast from the cursor, the first three in the B, F and L rows. If enabled, the voxel of maximum value along
+  /// the ray is reported, otherwise the first voxel above the lower bound of
+  /// the volume window (or threshold if applied) is reported.
+  /// False by default.
+  Q_PROPERTY(bool maximumRayProbing READ maximumRayProbing WRITE setMaximumRayProbing)
+  /// If enabled, the voxel count, volume, centroid and bounding box of the
+  /// label under the cursor are reported for label maps. The label index of
+  /// each label map is built on first use, then only the slices modified
+  /// since are scanned again, see vtkSlicerDataProbeLogic::LabelMapModified().
+  /// False by default.
+  Q_PROPERTY(bool labelStatisticsProbing READ labelStatisticsProbing WRITE setLabelStatisticsProbing)
+  /// If enabled, the voxel count, volume and centroid of the connected
+  /// component under the cursor are reported for label maps. The component
+  /// index of each label map is built on first use and updated like the
+  /// label index, see vtkSlicerDataProbeLogic::ProbeComponent().
+  /// False by default.
+  Q_PROPERTY(bool componentProbing READ componentProbing WRITE setComponentProbing)
+  /// If enabled, the signed distance from the cursor to the boundary of the
+  /// hovered label is reported for label maps, or to the boundary of the
+  /// last hovered label when the cursor is over the background.
+  /// The distance map of each label is computed in the background on first
+  /// use, see vtkSlicerDataProbeLogic::ProbeBoundaryDistance().
+  /// False by default.
+  Q_PROPERTY(bool boundaryDistanceProbing READ boundaryDistanceProbing WRITE setBoundaryDistanceProbing)
+  /// If enabled, the percentile of the value under the cursor within its
+  /// volume is reported for scalar volumes. The histogram of each volume is
+  /// computed in the background on first use.
+  /// False by default.
+  Q_PROPERTY(bool percentileProbing READ percentileProbing WRITE setPercentileProbing)
+  /// If enabled and both the background and foreground layers are set, the
+  /// foreground minus background value and their ratio at the cursor, and
+  /// the correlation and RMS difference of their 3x3x3 neighborhoods, are
+  /// reported, see vtkSlicerDataProbeLogic::ProbeLayerDifference().
+  /// False by default.
+  Q_PROPERTY(bool layerComparisonProbing READ layerComparisonProbing WRITE setLayerComparisonProbing)
+  /// If enabled, the layers of all the other slice views of the layout are
+  /// probed at the RAS position of the cursor as well, and their values are
+  /// reported view by view. The volumes shown in several views are sampled
+  /// once, all in a single vtkSlicerDataProbeBatchEngine update.
+  /// False by default.
+  Q_PROPERTY(bool linkedProbing READ linkedProbing WRITE setLinkedProbing)
+  /// If enabled, the mean, standard deviation, minimum and maximum of the
+  /// background and foreground values displayed in the hovered slice view
+  /// are reported, see vtkSlicerDataProbeLogic::ProbeViewportStatistics().
+  /// False by default.
+  Q_PROPERTY(bool viewportStatisticsProbing READ viewportStatisticsProbing WRITE setViewportStatisticsProbing)
+  /// If enabled, the visible fiber bundles with streamlines passing within
+  /// fiberProbingRadius of the cursor are reported in the slice views, with
+  /// the number of streamlines and the scalar (or FA) at their closest
+  /// points, see vtkSlicerDataProbeLogic::ProbeFiberBundle(). They are then
+  /// no longer reported as models.
+  /// False by default.
+  Q_PROPERTY(bool fiberBundleProbing READ fiberBundleProbing WRITE setFiberBundleProbing)
+  /// Radius, in millimeters, within which the streamlines are probed, see
+  /// fiberBundleProbing.
+  /// 2 by default.
+  Q_PROPERTY(double fiberProbingRadius READ fiberProbingRadius WRITE setFiberProbingRadius)
+  /// If enabled, the displacement magnitude, the determinant of the local
+  /// Jacobian and the principal strains are reported for the scalar volumes
+  /// with 3 components or more, taken as displacement fields in millimeters,
+  /// see vtkSlicerDataProbeLogic::ProbeDisplacement().
+  /// False by default.
+  Q_PROPERTY(bool displacementFieldProbing READ displacementFieldProbing WRITE setDisplacementFieldProbing)
+  /// If enabled, the labels of the voxels around the cursor in label maps
+  /// and the fraction of the neighborhood they cover are reported, most
+  /// frequent first, see vtkSlicerDataProbeLogic::ProbeLabelComposition().
+  /// False by default.
+  Q_PROPERTY(bool labelCompositionProbing READ labelCompositionProbing WRITE setLabelCompositionProbing)
+  /// Radius, in millimeters, of the neighborhood whose labels are reported,
+  /// see labelCompositionProbing. If 0, the 3x3x3 voxels around the cursor
+  /// are used instead.
+  /// 0 by default.
+  Q_PROPERTY(double labelCompositionRadius READ labelCompositionRadius WRITE setLabelCompositionRadius)
+  /// If enabled, the Enter, MouseMove and Leave events of the views are
+  /// appended to eventTrace(), with their time and a fingerprint of the
+  /// scene. Enabling the recording discards the previous trace.
+  /// False by default.
+  Q_PROPERTY(bool eventTraceRecording READ eventTraceRecording WRITE setEventTraceRecording)
+  /// If not empty, the shared memory stream of the logic is opened with this
+  /// name (e.g. "/SlicerDataProbe") and every probe result is published into
+  /// it, see vtkSlicerDataProbeSharedMemoryStream. The name is cleared if the
+  /// stream can't be opened. The data probe logic must be set first.
+  /// Empty by default.
+  Q_PROPERTY(QString sharedMemoryStreamName READ sharedMemoryStreamName WRITE setSharedMemoryStreamName)
+  /// If enabled, the expensive readouts of slice views are approximated
+  /// while the cursor moves fast, i.e. when mouse events are less than
+  /// progressiveRefinementDelay ms apart: the viewport statistics are
+  /// computed from every 4th pixel along X and Y, and the layer comparison
+  /// is limited to the voxel under the cursor. Once the cursor rests for
+  /// progressiveRefinementDelay ms, the last position is probed exactly; a
+  /// newer event cancels the pending refinement. Approximate readouts are
+  /// prefixed with "~".
+  /// False by default.
+  Q_PROPERTY(bool progressiveProbing READ progressiveProbing WRITE setProgressiveProbing)
+  /// Time in ms the cursor must rest before the approximate readouts are
+  /// refined, see progressiveProbing.
+  /// 150 by default.
+  Q_PROPERTY(int progressiveRefinementDelay READ progressiveRefinementDelay WRITE setProgressiveRefinementDelay)
 public:
   typedef qSlicerDataProbeInfoWidgetPrivate Pimpl;
   typedef qSlicerWidget Superclass;
@@ -52,13 +165,86 @@ public:
   vtkSlicerDataProbeLogic * dataProbeLogic()const;
   void setDataProbeLogic(vtkSlicerDataProbeLogic * dataProbeLogic);
 
+  bool displayedValueProbing()const;
+  bool pathProbing()const;
+  bool maximumRayProbing()const;
+  bool labelStatisticsProbing()const;
+  bool componentProbing()const;
+  bool boundaryDistanceProbing()const;
+  bool percentileProbing()const;
+  bool layerComparisonProbing()const;
+  bool linkedProbing()const;
+  bool viewportStatisticsProbing()const;
+  bool fiberBundleProbing()const;
+  double fiberProbingRadius()const;
+  bool displacementFieldProbing()const;
+  bool labelCompositionProbing()const;
+  double labelCompositionRadius()const;
+  bool eventTraceRecording()const;
+  QString sharedMemoryStreamName()const;
+  bool progressiveProbing()const;
+  int progressiveRefinementDelay()const;
+
+  /// Events recorded while eventTraceRecording is enabled.
+  /// \sa vtkSlicerDataProbeEventTrace::Write
+  vtkSlicerDataProbeEventTrace* eventTrace()const;
+
+  /// Probe the events of \a trace as fast as possible, whether the widget is
+  /// visible or not. Each event is enclosed in a vtkTimerLog event named
+  /// "DataProbe <type> <view>", enable vtkTimerLog::LoggingOn() to profile
+  /// the replay. Events of views missing from the layout are skipped and a
+  /// warning is printed if the scene differs from the recorded one.
+  /// Return the number of replayed events.
+  int replayEventTrace(vtkSlicerDataProbeEventTrace* trace);
+
+public slots:
+  virtual void setMRMLScene(vtkMRMLScene* scene);
+
+  void setDisplayedValueProbing(bool enabled);
+  void setPathProbing(bool enabled);
+  void setMaximumRayProbing(bool enabled);
+  void setLabelStatisticsProbing(bool enabled);
+  void setComponentProbing(bool enabled);
+  void setBoundaryDistanceProbing(bool enabled);
+  void setPercentileProbing(bool enabled);
+  void setLayerComparisonProbing(bool enabled);
+  void setLinkedProbing(bool enabled);
+  void setViewportStatisticsProbing(bool enabled);
+  void setFiberBundleProbing(bool enabled);
+  void setFiberProbingRadius(double radius);
+  void setDisplacementFieldProbing(bool enabled);
+  void setLabelCompositionProbing(bool enabled);
+  void setLabelCompositionRadius(double radius);
+  void setEventTraceRecording(bool enabled);
+  void setSharedMemoryStreamName(const QString& name);
+  void setProgressiveProbing(bool enabled);
+  void setProgressiveRefinementDelay(int delay);
+
+  /// Discard the voxels accumulated by the path probing.
+  void resetPathTraces();
+
 protected slots:
 
   void onLayoutChanged();
 
+  /// Discard the nodes cached by class when a node is added to or removed
+  /// from the scene.
+  void onSceneNodesChanged();
+
   void processEvent(vtkObject* sender, void* callData, unsigned long eventId, void* clientData);
 
+  /// Invoke the modified events of the result node batched since the last
+  /// call.
+  void onResultNodeTimeout();
+
+  /// Probe exactly the position of the last approximated event.
+  void onRefinementTimeout();
+
 protected:
+  /// The views are observed only while the widget is visible.
+  virtual void showEvent(QShowEvent* event);
+  virtual void hideEvent(QHideEvent* event);
+
   QScopedPointer<qSlicerDataProbeInfoWidgetPrivate> d_ptr;
 
 private:
@@ -22,6 +22,7 @@
 #include <QDebug>
 #include <QLayout>
 #include <QMainWindow>
+#include <QPointer>
 #include <qSlicerApplication.h>
 #include <QtPlugin>
 
@@ -46,7 +47,13 @@ public:
 
   void setupDataProbeInfoWidget();
 
+  /// Create the info widget in \a parent and set it up with the scene, the
+  /// layout manager and the logic.
+  void createDataProbeInfoWidget(QWidget* parent);
+
   qSlicerDataProbeInfoWidget * DataProbeInfoWidget;
+  /// Panel receiving the info widget once it is first expanded.
+  QPointer<QWidget> DataProbeInfoWidgetParent;
 };
 
 //-----------------------------------------------------------------------------
@@ -56,24 +63,49 @@ public:
 qSlicerDataProbeModulePrivate::qSlicerDataProbeModulePrivate(qSlicerDataProbeModule &object)
   : q_ptr(&object)
 {
+  this->DataProbeInfoWidget = 0;
 }
 
 //-----------------------------------------------------------------------------
 void qSlicerDataProbeModulePrivate::setupDataProbeInfoWidget()
 {
+  Q_Q(qSlicerDataProbeModule);
   foreach(QWidget* widget, qApp->topLevelWidgets())
     {
     if (QMainWindow* mainWindow = qobject_cast<QMainWindow*>(widget))
       {
       if (QWidget * parent = mainWindow->findChild<QWidget*>("DataProbeCollapsibleWidget"))
         {
-        this->DataProbeInfoWidget = new qSlicerDataProbeInfoWidget;
-        parent->layout()->addWidget(this->DataProbeInfoWidget);
+        // The widget is created when the panel is first expanded
+        if (parent->property("collapsed").toBool())
+          {
+          this->DataProbeInfoWidgetParent = parent;
+          QObject::connect(parent, SIGNAL(contentsCollapsed(bool)),
+                           q, SLOT(onDataProbeCollapsibleWidgetCollapsed(bool)));
+          }
+        else
+          {
+          this->createDataProbeInfoWidget(parent);
+          }
         }
       }
     }
 }
 
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeModulePrivate::createDataProbeInfoWidget(QWidget* parent)
+{
+  Q_Q(qSlicerDataProbeModule);
+  this->DataProbeInfoWidget = new qSlicerDataProbeInfoWidget;
+  parent->layout()->addWidget(this->DataProbeInfoWidget);
+  if (q->mrmlScene())
+    {
+    this->DataProbeInfoWidget->setMRMLScene(q->mrmlScene());
+    this->DataProbeInfoWidget->setLayoutManager(qSlicerApplication::application()->layoutManager());
+    this->DataProbeInfoWidget->setDataProbeLogic(vtkSlicerDataProbeLogic::SafeDownCast(q->logic()));
+    }
+}
+
 //-----------------------------------------------------------------------------
 // qSlicerDataProbeModule methods
 
@@ -163,3 +195,16 @@ void qSlicerDataProbeModule::setMRMLScene(vtkMRMLScene* mrmlScene)
     d->DataProbeInfoWidget->setDataProbeLogic(vtkSlicerDataProbeLogic::SafeDownCast(this->logic()));
     }
 }
+
+//-----------------------------------------------------------------------------
+void qSlicerDataProbeModule::onDataProbeCollapsibleWidgetCollapsed(bool collapsed)
+{
+  Q_D(qSlicerDataProbeModule);
+  if (collapsed || d->DataProbeInfoWidget || !d->DataProbeInfoWidgetParent)
+    {
+    return;
+    }
+  QObject::disconnect(d->DataProbeInfoWidgetParent, SIGNAL(contentsCollapsed(bool)),
+                      this, SLOT(onDataProbeCollapsibleWidgetCollapsed(bool)));
+  d->createDataProbeInfoWidget(d->DataProbeInfoWidgetParent);
+}
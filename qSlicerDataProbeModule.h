@@ -63,6 +63,10 @@ public:
 public slots:
   virtual void setMRMLScene(vtkMRMLScene* mrmlScene);
 
+protected slots:
+  /// Create the info widget when the DataProbe panel is first expanded.
+  void onDataProbeCollapsibleWidgetCollapsed(bool collapsed);
+
 protected:
 
   /// Initialize the module. Register the volumes reader/writer